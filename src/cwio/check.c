@@ -0,0 +1,116 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * check.c
+ *
+ ****************************************************************************
+ *
+ * - built and run with "make check"
+ * - compares cwio_data_count_invalid() with the per byte loop it replaced,
+ *   on all sizes up to four blocks plus one, on misaligned buffers and on
+ *   random data as well as on values around the valid range
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include "cwio.c"
+
+
+
+
+/****************************************************************************
+ *
+ * local data structures, variables and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define CHECK_MAX_SIZE			(4 * CWIO_BLOCK_SIZE + 1)
+#define CHECK_LARGE_SIZE		(CW_MAX_TRACK_SIZE - 1)
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * check_reference
+ ****************************************************************************/
+static int
+check_reference(
+	unsigned char			*data,
+	int				size)
+
+	{
+	int				invalid = 0;
+	int				i;
+
+	for (i = 0; i < size; i++) if ((data[i] < CWIO_MIN_WRITE_VALUE) || (data[i] > CWIO_MAX_WRITE_VALUE)) invalid++;
+	return (invalid);
+	}
+
+
+
+/****************************************************************************
+ * check_random
+ ****************************************************************************/
+static unsigned int
+check_random(
+	unsigned int			*seed)
+
+	{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return (*seed);
+	}
+
+
+
+/****************************************************************************
+ * main
+ ****************************************************************************/
+int
+main(
+	int				argc,
+	char				**argv)
+
+	{
+	static unsigned char		data[CHECK_LARGE_SIZE + 4];
+	const unsigned char		fills[] = { 0x00, 0x02, 0x03, 0x04, 0x7d, 0x7e, 0x7f, 0xff };
+	const int			fills_count = sizeof (fills) / sizeof (fills[0]);
+	unsigned int			seed = 1;
+	int				tests = 0, failed = 0;
+	int				size, p, o, i;
+
+	for (p = 0; p <= fills_count; p++)
+		{
+		for (size = 0; size <= CHECK_LARGE_SIZE; size++)
+			{
+			if ((size > CHECK_MAX_SIZE) && (size != CHECK_LARGE_SIZE)) continue;
+			for (i = 0; i < size + 4; i++) data[i] = (p < fills_count) ? fills[p] : check_random(&seed);
+			for (o = 0; o < 4; o++)
+				{
+				tests++;
+				if (cwio_data_count_invalid(&data[o], size) == check_reference(&data[o], size)) continue;
+				if (failed++ == 0) fprintf(stderr, "cwio_data_count_invalid() differs from the per byte loop with size %d at offset %d\n", size, o);
+				}
+			}
+		}
+	printf("cwio_data_count_invalid: %d tests, %d failed\n", tests, failed);
+	return ((failed > 0) ? 1 : 0);
+	}
+/******************************************************** Karsten Scheibler */
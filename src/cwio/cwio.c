@@ -59,6 +59,12 @@ struct cwio_device
 
 #define CWIO_DATA_FLAG_INITIALIZED	(1 << 0)
 
+/* block loop of cwio_data_count_invalid(), see cwtool/image/raw.h */
+
+#define CWIO_BLOCK_SIZE			32
+#define CWIO_MIN_WRITE_VALUE		0x03
+#define CWIO_MAX_WRITE_VALUE		0x7e
+
 struct cwio_data
 	{
 	int				flags;
@@ -292,6 +298,31 @@ cwio_data_check_timeout(
 
 
 
+/****************************************************************************
+ * cwio_data_count_invalid
+ ****************************************************************************/
+static int
+cwio_data_count_invalid(
+	unsigned char			*data,
+	int				size)
+
+	{
+	unsigned char			*d, c;
+	int				invalid = 0;
+	int				i, j;
+
+	for (i = 0; i + CWIO_BLOCK_SIZE <= size; i += CWIO_BLOCK_SIZE)
+		{
+		d = &data[i];
+		for (c = j = 0; j < CWIO_BLOCK_SIZE; j++) c += (d[j] < CWIO_MIN_WRITE_VALUE) | (d[j] > CWIO_MAX_WRITE_VALUE);
+		invalid += c;
+		}
+	for ( ; i < size; i++) invalid += (data[i] < CWIO_MIN_WRITE_VALUE) | (data[i] > CWIO_MAX_WRITE_VALUE);
+	return (invalid);
+	}
+
+
+
 /****************************************************************************
  * cwio_data_set_trackinfo
  ****************************************************************************/
@@ -522,9 +553,9 @@ cwio_write(
 	struct cw_trackinfo		tri = CW_TRACKINFO_INIT;
 	int				result;
 	unsigned char			*data;
-	int				i;
 #if CW_STRUCT_VERSION < 2
 	unsigned char			buffer[CWIO_BUFFER_SIZE];
+	int				i;
 #endif /* CW_STRUCT_VERSION */
 
 	if (cwio_dev == NULL) cwio_error(error_device_null);
@@ -536,10 +567,7 @@ cwio_write(
 	if (cwio_data->size >= CWIO_MAX_TRACK_SIZE - CW_WRITE_OVERHEAD) cwio_error("track too large for writing");
 
 	data = cwio_data->data;
-	for (i = 0; i < cwio_data->size; i++)
-		{
-		if ((data[i] < 0x03) || (data[i] > 0x7e)) cwio_error("data contains values too small or too large for writing");
-		}
+	if (cwio_data_count_invalid(data, cwio_data->size) > 0) cwio_error("data contains values too small or too large for writing");
 
 	/*
 	 * until cw-0.12 write values are subtracted from 0x80 in the driver.
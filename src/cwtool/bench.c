@@ -0,0 +1,970 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * bench.c
+ *
+ ****************************************************************************
+ *
+ * - decode benchmark, built with "make bench"
+ * - for every track of the given disks random sector data is encoded with
+ *   the track_write() function of the format to L0, then jitter, drift,
+ *   dropped and extra pulses are applied and track_read() is timed
+ * - everything is deterministic for a given seed, so runs before and
+ *   after a change to a decoder can be compared
+ * - a disk may be given as <diskname>:<encoder diskname>, then the flux is
+ *   generated by the encoder of the second disk. gcr_g64 expects raw GCR
+ *   data instead of sector data, so it is fed with flux from c1541
+ * - results are written as CSV, one line per track and one summary line
+ *   per disk. formats without sectors (gcr_g64) leave the sector columns
+ *   empty
+ * - with -c <dir> a corpus of raw images is checked instead. <dir>/corpus
+ *   lists one image per line:
+ *     <diskname> <raw image> <checksum> <good> <weak> <bad>
+ *   each image is read with disk_read() like cwtool -R does, the output
+ *   image checksum (FNV-1a 64) and the sector counts must match. the time
+ *   per track is compared with <dir>/baseline, an image fails if it needs
+ *   more than the given margin longer than in the baseline. -u writes
+ *   both files from the current results. an image which can not be read
+ *   fails with "error", the remaining images are still checked
+ * - -k compares the block kernels of image/raw.c byte by byte with the
+ *   per byte loops they replaced, on random data and on all lengths up to
+ *   four blocks plus one
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "string.h"
+#include "config.h"
+#include "disk.h"
+#include "file.h"
+#include "fifo.h"
+#include "trackmap.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/* tbe_cw is not used by the builtin config, so define a disk for it here */
+
+static const cw_char_t			bench_config[] =
+	"disk \"bench_tbe_cw\"\n"
+	"\t{\n"
+	"\tinfo \"TBE, only used by the benchmark\"\n"
+	"\tformat \"tbe_cw\"\n"
+	"\tclock 28\n"
+	"\ttrack_range 0 159 1 { }\n"
+	"\t}\n";
+
+/*
+ * jitter and drift in counter values and per mille over one track, dropped
+ * and extra pulses per million pulses
+ */
+
+struct bench_option
+	{
+	int				jitter;
+	int				drift;
+	int				dropped;
+	int				extra;
+	int				repeat;
+	cw_u32_t			seed;
+	};
+
+
+#define BENCH_PROGRAM_NAME		"cwbench"
+#define BENCH_KERNEL_DECREMENT		0
+#define BENCH_KERNEL_HALF		1
+#define BENCH_KERNEL_CLAMP		2
+#define BENCH_KERNELS			4
+#define BENCH_KERNEL_MAX_SIZE		(GLOBAL_MAX_TRACK_SIZE - 1)
+#define BENCH_MAX_IMAGES		1024
+#define BENCH_MAX_LINE_SIZE		(3 * GLOBAL_MAX_PATH_SIZE)
+#define BENCH_MAX_FILES			64
+
+struct bench_image
+	{
+	cw_char_t			disk[GLOBAL_MAX_NAME_SIZE];
+	cw_char_t			file[GLOBAL_MAX_PATH_SIZE];
+	cw_u64_t			checksum;
+	struct disk_summary		sum;
+	cw_count64_t			ns[GLOBAL_NR_TRACKS];
+	};
+
+struct bench_result
+	{
+	cw_u64_t			checksum;
+	struct disk_summary		sum;
+	cw_count64_t			ns[GLOBAL_NR_TRACKS];
+	};
+
+static cw_count64_t			bench_track_ns[GLOBAL_NR_TRACKS];
+static cw_count64_t			bench_last;
+static struct disk_summary		bench_sum;
+
+/* one disk per format with an encoder */
+
+static cw_char_t			*bench_disks[] =
+	{
+	"amiga_dd",
+	"msdos_hd",
+	"dec_rx01_sssd",
+	"c1541",
+	"c1541_g64:c1541",
+	"mac_dd",
+	"victor9000_dsdd",
+	"bench_tbe_cw",
+	NULL
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * bench_usage
+ ****************************************************************************/
+static cw_void_t
+bench_usage(
+	cw_void_t)
+
+	{
+	printf("Usage: %s [-v] [-f <file>] [-e <config>] [-o <file>] [-r <num>]\n"
+		"       [-s <num>] [-j <num>] [-d <num>] [-x <num>] [-a <num>]\n"
+		"       [<diskname>[:<encoder diskname>] ...]\n"
+		"       %s [-v] [-f <file>] [-e <config>] [-o <file>] [-m <num>] [-u]\n"
+		"       -c <dir>\n"
+		"       %s [-o <file>] [-s <num>] -k\n\n"
+		"  -v            be more verbose\n"
+		"  -f <file>     read additional config file\n"
+		"  -e <config>   evaluate given string as config\n"
+		"  -o <file>     write CSV to file instead of stdout\n"
+		"  -r <num>      decode every track <num> times (default 10)\n"
+		"  -s <num>      seed for sector data and distortions (default 1)\n"
+		"  -j <num>      jitter, add -num to +num to each counter value\n"
+		"  -d <num>      drift, scale counter values up to num per mille\n"
+		"                over one track\n"
+		"  -x <num>      drop num per million pulses\n"
+		"  -a <num>      add num per million extra pulses\n"
+		"  -c <dir>      check the corpus of raw images in <dir>\n"
+		"  -m <num>      corpus images may be num percent slower than\n"
+		"                the baseline (default 10)\n"
+		"  -u            rewrite corpus and baseline from the results\n"
+		"  -k            compare the block kernels with per byte loops\n"
+		"  -h            this help\n\n"
+		"without <diskname> one disk of every format is used, with\n"
+		"<encoder diskname> the flux is generated with the format of\n"
+		"that disk\n",
+		BENCH_PROGRAM_NAME, BENCH_PROGRAM_NAME, BENCH_PROGRAM_NAME);
+	exit(0);
+	}
+
+
+
+/****************************************************************************
+ * bench_clock
+ ****************************************************************************/
+static cw_count64_t
+bench_clock(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((cw_count64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec);
+	}
+
+
+
+/****************************************************************************
+ * bench_info
+ ****************************************************************************/
+static void
+bench_info(
+	struct disk_info		*dsk_nfo,
+	int				summary)
+
+	{
+	cw_count64_t			now = bench_clock();
+
+	/*
+	 * called after every try, the time since the last call is the
+	 * time needed to read and decode this try
+	 */
+
+	if (summary) bench_sum = dsk_nfo->sum;
+	else bench_track_ns[dsk_nfo->track] += now - bench_last;
+	bench_last = now;
+	}
+
+
+
+/****************************************************************************
+ * bench_checksum
+ ****************************************************************************/
+static cw_u64_t
+bench_checksum(
+	const cw_char_t			*path)
+
+	{
+	struct file			fil;
+	cw_u8_t				data[0x10000];
+	cw_u64_t			hash = 0xcbf29ce484222325ULL;
+	cw_count_t			len, i;
+
+	file_open(&fil, path, FILE_MODE_READ, FILE_FLAG_NONE);
+	while ((len = file_read(&fil, data, sizeof (data))) > 0) for (i = 0; i < len; i++) hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	file_close(&fil);
+	return (hash);
+	}
+
+
+
+/****************************************************************************
+ * bench_corpus_load
+ ****************************************************************************/
+static cw_count_t
+bench_corpus_load(
+	const cw_char_t			*dir,
+	struct bench_image		*img,
+	cw_bool_t			update)
+
+	{
+	FILE				*fp;
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE], line[BENCH_MAX_LINE_SIZE];
+	cw_char_t			disk[GLOBAL_MAX_NAME_SIZE], file[GLOBAL_MAX_PATH_SIZE];
+	cw_count64_t			ns;
+	cw_count_t			images = 0, n, track;
+	cw_index_t			i;
+
+	/* read the list of images */
+
+	string_snprintf(path, sizeof (path), "%s/corpus", dir);
+	fp = fopen(path, "r");
+	if (fp == NULL) error_perror_message("error while opening '%s'", path);
+	for (n = 1; fgets(line, sizeof (line), fp) != NULL; n++)
+		{
+		if (sscanf(line, " %63s", disk) != 1) continue;
+		if (disk[0] == '#') continue;
+		if (images >= BENCH_MAX_IMAGES) error_message("too many images in '%s'", path);
+		i = sscanf(line, " %63s %4095s %llx %d %d %d", img[images].disk, img[images].file, &img[images].checksum,
+			&img[images].sum.sectors_good, &img[images].sum.sectors_weak, &img[images].sum.sectors_bad);
+		if ((i != 6) && ((! update) || (i < 2))) error_message("syntax error in '%s' line %d", path, n);
+		images++;
+		}
+	fclose(fp);
+
+	/* read the baseline, it may be missing */
+
+	string_snprintf(path, sizeof (path), "%s/baseline", dir);
+	fp = fopen(path, "r");
+	if (fp == NULL) return (images);
+	while (fgets(line, sizeof (line), fp) != NULL)
+		{
+		if (sscanf(line, " %63s %4095s %d %lld", disk, file, &track, &ns) != 4) continue;
+		if ((track < 0) || (track >= GLOBAL_NR_TRACKS)) continue;
+		for (i = 0; i < images; i++) if ((string_equal(disk, img[i].disk)) && (string_equal(file, img[i].file))) img[i].ns[track] = ns;
+		}
+	fclose(fp);
+	return (images);
+	}
+
+
+
+/****************************************************************************
+ * bench_corpus_save
+ ****************************************************************************/
+static cw_void_t
+bench_corpus_save(
+	const cw_char_t			*dir,
+	struct bench_image		*img,
+	cw_count_t			images)
+
+	{
+	struct file			fil_crp, fil_bas;
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_index_t			i, t;
+
+	string_snprintf(path, sizeof (path), "%s/corpus", dir);
+	file_open(&fil_crp, path, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	string_snprintf(path, sizeof (path), "%s/baseline", dir);
+	file_open(&fil_bas, path, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	file_write_string(&fil_crp, "# <diskname> <raw image> <checksum> <good> <weak> <bad>\n");
+	file_write_string(&fil_bas, "# <diskname> <raw image> <track> <ns>\n");
+	for (i = 0; i < images; i++)
+		{
+		file_write_sprintf(&fil_crp, "%s %s %016llx %d %d %d\n", img[i].disk, img[i].file, img[i].checksum,
+			img[i].sum.sectors_good, img[i].sum.sectors_weak, img[i].sum.sectors_bad);
+		for (t = 0; t < GLOBAL_NR_TRACKS; t++) if (img[i].ns[t] > 0) file_write_sprintf(&fil_bas, "%s %s %d %lld\n", img[i].disk, img[i].file, t, img[i].ns[t]);
+		}
+	file_close(&fil_crp);
+	file_close(&fil_bas);
+	}
+
+
+
+/****************************************************************************
+ * bench_corpus_read
+ ****************************************************************************/
+static cw_bool_t
+bench_corpus_read(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	cw_char_t			*path_src,
+	cw_char_t			*path_dst,
+	struct bench_result		*res)
+
+	{
+	struct image_desc		*img_dsc_l0 = dsk->img_dsc_l0;
+	jmp_buf				jmp;
+	int				fd, fd_low;
+
+	/*
+	 * the image is read in this process. error_message() returns here
+	 * instead of exiting, then the image is counted as failed and the
+	 * next one is checked. disk_read() did not get to close its files
+	 * and to restore dsk->img_dsc_l0, so this is done here. all files
+	 * it opened got descriptors from fd_low on
+	 */
+
+	fd_low = open("/dev/null", O_RDONLY);
+	if (fd_low == -1) error_perror_message("error while opening '/dev/null'");
+	close(fd_low);
+	memset(bench_track_ns, 0, sizeof (bench_track_ns));
+	bench_sum  = (struct disk_summary) { };
+	bench_last = bench_clock();
+	if (setjmp(jmp) != 0)
+		{
+		for (fd = fd_low; fd < fd_low + BENCH_MAX_FILES; fd++) close(fd);
+		dsk->img_dsc_l0 = img_dsc_l0;
+		return (CW_BOOL_FAIL);
+		}
+	error_set_return(&jmp);
+	disk_read(dsk, dsk_opt, &path_src, 1, path_dst, NULL, NULL);
+	error_set_return(NULL);
+	*res = (struct bench_result) { .checksum = bench_checksum(path_dst), .sum = bench_sum };
+	memcpy(res->ns, bench_track_ns, sizeof (bench_track_ns));
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * bench_corpus
+ ****************************************************************************/
+static cw_count_t
+bench_corpus(
+	const cw_char_t			*dir,
+	struct file			*fil,
+	cw_count_t			margin,
+	cw_bool_t			update)
+
+	{
+	struct bench_image		*img;
+	struct bench_result		res;
+	struct disk_option		dsk_opt = DISK_OPTION_INIT(bench_info, 0, DISK_OPTION_FLAG_NONE);
+	struct disk			*dsk;
+	cw_char_t			path_dst[] = "/tmp/cwbench.XXXXXX";
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_count64_t			ns, ns_base;
+	cw_count_t			images, failed = 0;
+	cw_bool_t			success;
+	const cw_char_t			*result;
+	cw_index_t			i, t;
+	int				fd;
+
+	img = (struct bench_image *) calloc(BENCH_MAX_IMAGES, sizeof (struct bench_image));
+	if (img == NULL) error_oom();
+	images = bench_corpus_load(dir, img, update);
+	fd = mkstemp(path_dst);
+	if (fd == -1) error_perror_message("error while creating temporary file");
+	close(fd);
+
+	/*
+	 * all images are read one after the other, the output image is
+	 * only kept until its checksum is known. an image which can not be
+	 * read at all fails with "error" and is left as is by -u
+	 */
+
+	file_write_string(fil, "disk,file,track,ns,baseline_ns,result\n");
+	for (i = 0; i < images; i++)
+		{
+		res = (struct bench_result) { };
+		dsk = config_disk_search(img[i].disk);
+		string_snprintf(path, sizeof (path), "%s/%s", dir, img[i].file);
+		verbose_message(GENERIC, 1, "checking '%s' with disk '%s'", path, img[i].disk);
+		if (dsk == NULL) error_warning("unknown disk name '%s'", img[i].disk);
+		success = ((dsk != NULL) && (bench_corpus_read(dsk, &dsk_opt, path, path_dst, &res))) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+		for (ns = ns_base = t = 0; t < GLOBAL_NR_TRACKS; t++)
+			{
+			if (res.ns[t] == 0) continue;
+			file_write_sprintf(fil, "%s,%s,%d,%lld,%lld,\n", img[i].disk, img[i].file, t, res.ns[t], img[i].ns[t]);
+			ns      += res.ns[t];
+			ns_base += img[i].ns[t];
+			}
+		result = "ok";
+		if (! success) result = "error";
+		else if ((res.sum.sectors_good != img[i].sum.sectors_good) ||
+			(res.sum.sectors_weak != img[i].sum.sectors_weak) ||
+			(res.sum.sectors_bad != img[i].sum.sectors_bad)) result = "sectors";
+		else if (res.checksum != img[i].checksum) result = "checksum";
+		else if ((ns_base > 0) && (ns > ns_base * (100 + margin) / 100)) result = "slow";
+		if ((update) && (! string_equal(result, "error")))
+			{
+			img[i].checksum = res.checksum;
+			img[i].sum      = res.sum;
+			memcpy(img[i].ns, res.ns, sizeof (res.ns));
+			result = "updated";
+			}
+		file_write_sprintf(fil, "%s,%s,all,%lld,%lld,%s\n", img[i].disk, img[i].file, ns, ns_base, result);
+		if ((string_equal(result, "ok")) || (string_equal(result, "updated"))) continue;
+		error_warning("'%s' with disk '%s' failed (%s)", img[i].file, img[i].disk, result);
+		failed++;
+		}
+	unlink(path_dst);
+	if (update) bench_corpus_save(dir, img, images);
+	free(img);
+	return (failed);
+	}
+
+
+
+/****************************************************************************
+ * bench_random
+ ****************************************************************************/
+static cw_u32_t
+bench_random(
+	cw_u32_t			*seed)
+
+	{
+
+	/* xorshift32, deterministic and the same on every platform */
+
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return (*seed);
+	}
+
+
+
+/****************************************************************************
+ * bench_pulse
+ ****************************************************************************/
+static cw_void_t
+bench_pulse(
+	struct fifo			*ffo,
+	int				val,
+	int				index)
+
+	{
+	if (val < GLOBAL_MIN_PULSE_LENGTH) val = GLOBAL_MIN_PULSE_LENGTH;
+	if (val > GLOBAL_MAX_PULSE_LENGTH) val = GLOBAL_MAX_PULSE_LENGTH;
+	fifo_write_byte(ffo, val | index);
+	}
+
+
+
+/****************************************************************************
+ * bench_perturb
+ ****************************************************************************/
+static cw_void_t
+bench_perturb(
+	struct bench_option		*bch_opt,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	cw_u32_t			*seed)
+
+	{
+	unsigned char			*data = fifo_get_data(ffo_src);
+	int				len   = fifo_get_wr_ofs(ffo_src);
+	int				i, idx, val, r;
+
+	/*
+	 * ffo_dst keeps limit, flags and speed of ffo_src, only the
+	 * counter values are replaced. jitter is applied after drift, a
+	 * dropped pulse is merged into the next one, an extra pulse splits
+	 * the current one into two halves
+	 */
+
+	for (i = 0; i < len; i++)
+		{
+		idx = data[i] & GLOBAL_PULSE_INDEX_MASK;
+		val = data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		val = val * (1000 + bch_opt->drift * i / len) / 1000;
+		if (bch_opt->jitter > 0) val += (int) (bench_random(seed) % (2 * bch_opt->jitter + 1)) - bch_opt->jitter;
+		r = bench_random(seed) % 1000000;
+		if ((r < bch_opt->dropped) && (i + 1 < len))
+			{
+			val += data[i + 1] & GLOBAL_PULSE_LENGTH_MASK;
+			if (val > GLOBAL_MAX_PULSE_LENGTH) val = GLOBAL_MAX_PULSE_LENGTH;
+			data[i + 1] = (data[i + 1] & GLOBAL_PULSE_INDEX_MASK) | idx | val;
+			continue;
+			}
+		if ((r >= bch_opt->dropped) && (r < bch_opt->dropped + bch_opt->extra))
+			{
+			bench_pulse(ffo_dst, val / 2, idx);
+			val -= val / 2;
+			idx = 0;
+			}
+		bench_pulse(ffo_dst, val, idx);
+		}
+	}
+
+
+
+/****************************************************************************
+ * bench_sectors
+ ****************************************************************************/
+static cw_void_t
+bench_sectors(
+	struct file			*fil,
+	cw_count_t			sectors,
+	cw_count_t			good,
+	cw_count_t			weak,
+	cw_count_t			bad)
+
+	{
+
+	/*
+	 * formats like gcr_g64 decode to raw track data and have no
+	 * sectors, the sector columns stay empty for them instead of
+	 * reporting 0 sectors
+	 */
+
+	if (sectors == 0) file_write_string(fil, ",,,,");
+	else file_write_sprintf(fil, "%d,%d,%d,%d,", sectors, good, weak, bad);
+	}
+
+
+
+/****************************************************************************
+ * bench_rate
+ ****************************************************************************/
+static cw_void_t
+bench_rate(
+	struct file			*fil,
+	cw_count_t			sectors,
+	cw_count64_t			good,
+	cw_count64_t			ns)
+
+	{
+	if (sectors == 0) file_write_string(fil, "\n");
+	else file_write_sprintf(fil, "%.1f\n", (ns > 0) ? 1e9 * good / ns : 0.0);
+	}
+
+
+
+/****************************************************************************
+ * bench_track
+ ****************************************************************************/
+static cw_bool_t
+bench_track(
+	struct disk			*dsk,
+	struct disk			*dsk_enc,
+	struct bench_option		*bch_opt,
+	struct file			*fil,
+	cw_index_t			trackmap_index,
+	struct disk_summary		*sum,
+	cw_count64_t			*bytes,
+	cw_count64_t			*ns)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk, *dsk_trk_enc;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
+	unsigned char			data_l0[GLOBAL_MAX_TRACK_SIZE] = { };
+	unsigned char			data_flux[GLOBAL_MAX_TRACK_SIZE] = { };
+	unsigned char			data_tmp[GLOBAL_MAX_TRACK_SIZE];
+	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE];
+	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
+	struct fifo			ffo_l0  = FIFO_INIT(data_l0, sizeof (data_l0));
+	struct fifo			ffo_flux, ffo_tmp, ffo_dst;
+	struct container		*con;
+	cw_count_t			cwtool_track, format_track, format_side;
+	cw_count64_t			t, elapsed = 0;
+	cw_u32_t			seed;
+	int				sectors, good, weak, bad, size, i, r;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk     = dsk->trk[cwtool_track];
+	dsk_trk_enc = dsk_enc->trk[cwtool_track];
+
+	/* greedy formats have no fixed layout, so they can not be encoded */
+
+	if ((dsk_trk->fmt_dsc == NULL) || (dsk_trk_enc->fmt_dsc == NULL)) return (CW_BOOL_FALSE);
+	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) return (CW_BOOL_FALSE);
+	if (dsk_trk_enc->fmt_dsc->get_flags(&dsk_trk_enc->fmt) & FORMAT_FLAG_GREEDY) return (CW_BOOL_FALSE);
+	if ((dsk_trk->fmt_dsc->track_read == NULL) || (dsk_trk_enc->fmt_dsc->track_write == NULL)) return (CW_BOOL_FALSE);
+
+	/*
+	 * encode deterministic random sector data with the encoder of
+	 * dsk_enc, the seed depends only on the given seed and the track.
+	 * usually dsk_enc is dsk, but formats which do not take sector data
+	 * (like gcr_g64) need flux from another encoder
+	 */
+
+	seed = bch_opt->seed ^ (0x9e3779b9 * (cwtool_track + 1));
+	if (seed == 0) seed = 1;
+	size = disk_sectors_init(dsk_sct, dsk_trk_enc, &ffo_src, 1);
+	if (size == 0) return (CW_BOOL_FALSE);
+	for (i = 0; i < size; i++) data_tmp[i] = bench_random(&seed);
+	fifo_write_block(&ffo_src, data_tmp, size);
+	if (! dsk_trk_enc->fmt_dsc->track_write(&dsk_trk_enc->fmt, &ffo_src, dsk_sct, &ffo_l0, NULL, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	ffo_flux = ffo_l0;
+	ffo_flux.data = data_flux;
+	fifo_reset(&ffo_flux);
+	bench_perturb(bch_opt, &ffo_l0, &ffo_flux, &seed);
+
+	/* decode it repeat times, only track_read() is timed */
+
+	for (r = 0; r < bch_opt->repeat; r++)
+		{
+		memcpy(data_tmp, data_flux, fifo_get_wr_ofs(&ffo_flux));
+		ffo_tmp = ffo_flux;
+		ffo_tmp.data = data_tmp;
+		fifo_set_rd_ofs(&ffo_tmp, 0);
+		ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+		disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0);
+		con = container_init(NULL);
+		t = bench_clock();
+		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, &ffo_tmp, &ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+		elapsed += bench_clock() - t;
+		container_deinit(con);
+		}
+
+	/* report */
+
+	sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	for (i = good = weak = bad = 0; i < sectors; i++)
+		{
+		if (dsk_sct[i].err.errors > 0) bad++;
+		else if (dsk_sct[i].err.warnings > 0) weak++;
+		else good++;
+		}
+	file_write_sprintf(fil, "%s,%s,%d,%d,", dsk->name, dsk_trk->fmt_dsc->name, cwtool_track, fifo_get_wr_ofs(&ffo_flux));
+	bench_sectors(fil, sectors, good, weak, bad);
+	file_write_sprintf(fil, "%d,%lld,%.3f,", bch_opt->repeat, elapsed,
+		(elapsed > 0) ? 1e3 * fifo_get_wr_ofs(&ffo_flux) * bch_opt->repeat / elapsed : 0.0);
+	bench_rate(fil, sectors, good * bch_opt->repeat, elapsed);
+	sum->tracks++;
+	sum->sectors_good += good;
+	sum->sectors_weak += weak;
+	sum->sectors_bad  += bad;
+	*bytes += fifo_get_wr_ofs(&ffo_flux);
+	*ns    += elapsed;
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * bench_disk
+ ****************************************************************************/
+static int
+bench_disk(
+	struct disk			*dsk,
+	struct disk			*dsk_enc,
+	struct bench_option		*bch_opt,
+	struct file			*fil)
+
+	{
+	struct disk_summary		sum = { };
+	cw_count64_t			bytes = 0, ns = 0;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_count_t			sectors;
+	cw_index_t			i;
+
+	/*
+	 * MB/s is flux data (counter values) decoded per second, sectors/s
+	 * counts only good sectors
+	 */
+
+	for (i = 0; i < entries; i++) bench_track(dsk, dsk_enc, bch_opt, fil, i, &sum, &bytes, &ns);
+	if (sum.tracks == 0) return (0);
+	sectors = sum.sectors_good + sum.sectors_weak + sum.sectors_bad;
+	file_write_sprintf(fil, "%s,all,all,%lld,", dsk->name, bytes);
+	bench_sectors(fil, sectors, sum.sectors_good, sum.sectors_weak, sum.sectors_bad);
+	file_write_sprintf(fil, "%d,%lld,%.3f,", bch_opt->repeat, ns,
+		(ns > 0) ? 1e3 * bytes * bch_opt->repeat / ns : 0.0);
+	bench_rate(fil, sectors, sum.sectors_good * bch_opt->repeat, ns);
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * bench_kernel_reference
+ ****************************************************************************/
+static cw_count_t
+bench_kernel_reference(
+	cw_index_t			kernel,
+	cw_raw_t			*data,
+	cw_size_t			size,
+	cw_raw_t			mask)
+
+	{
+	cw_count_t			modified = 0;
+	cw_index_t			i;
+	int				d;
+
+	/* the per byte loops image/raw.c used before the kernels */
+
+	for (i = 0; i < size; i++)
+		{
+		if (kernel == BENCH_KERNEL_DECREMENT)
+			{
+			if (data[i] > 0) data[i]--;
+			}
+		else if (kernel == BENCH_KERNEL_HALF)
+			{
+			d = (data[i] & GLOBAL_PULSE_LENGTH_MASK) / 2;
+			if ((data[i] & GLOBAL_PULSE_INDEX_MASK) != 0) d |= GLOBAL_PULSE_INDEX_MASK;
+			data[i] = d;
+			}
+		else
+			{
+			d = data[i] &= mask;
+			if ((d >= GLOBAL_MIN_PULSE_LENGTH) && (d <= GLOBAL_MAX_PULSE_LENGTH)) continue;
+			if (d < GLOBAL_MIN_PULSE_LENGTH) d = GLOBAL_MIN_PULSE_LENGTH;
+			if (d > GLOBAL_MAX_PULSE_LENGTH) d = GLOBAL_MAX_PULSE_LENGTH;
+			data[i] = d;
+			modified++;
+			}
+		}
+	return (modified);
+	}
+
+
+
+/****************************************************************************
+ * bench_kernel_run
+ ****************************************************************************/
+static cw_count_t
+bench_kernel_run(
+	cw_index_t			kernel,
+	cw_raw_t			*data,
+	cw_size_t			size,
+	cw_raw_t			mask)
+
+	{
+	if (kernel == BENCH_KERNEL_DECREMENT) image_raw_kernel_decrement(data, size);
+	else if (kernel == BENCH_KERNEL_HALF) image_raw_kernel_half(data, size);
+	else return (image_raw_kernel_clamp(data, size, mask));
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * bench_kernels
+ ****************************************************************************/
+static cw_count_t
+bench_kernels(
+	struct file			*fil,
+	cw_u32_t			seed)
+
+	{
+	static cw_raw_t			src[BENCH_KERNEL_MAX_SIZE + 4];
+	static cw_raw_t			data_ref[BENCH_KERNEL_MAX_SIZE + 4];
+	static cw_raw_t			data_knl[BENCH_KERNEL_MAX_SIZE + 4];
+	const cw_char_t			*names[] = { "decrement", "half", "clamp", "clamp_index_stored" };
+	const cw_raw_t			masks[]  = { 0, 0, GLOBAL_PULSE_INDEX_MASK | GLOBAL_PULSE_LENGTH_MASK, GLOBAL_PULSE_LENGTH_MASK };
+	const cw_raw_t			fills[]  = { 0x00, 0x01, 0x02, 0x03, 0x7f, 0x80, 0x81, 0xff };
+	cw_count_t			fills_count = sizeof (fills) / sizeof (fills[0]);
+	cw_count_t			tests, failed, failed_all = 0, size, r1, r2;
+	cw_index_t			k, p, o, i;
+
+	/*
+	 * every kernel is compared with its per byte loop on all sizes up
+	 * to four blocks plus one (this covers 0, 1, odd tails and a full
+	 * block plus one), on a large odd size and on misaligned buffers.
+	 * the data is random or filled with one of the values at the edges
+	 * of the valid range
+	 */
+
+	if (seed == 0) seed = 1;
+	file_write_string(fil, "kernel,tests,failed\n");
+	for (k = 0; k < BENCH_KERNELS; k++)
+		{
+		for (tests = failed = p = 0; p <= fills_count; p++)
+			{
+			for (size = 0; size <= BENCH_KERNEL_MAX_SIZE; size++)
+				{
+				if ((size > 4 * IMAGE_RAW_KERNEL_BLOCK_SIZE + 1) && (size != BENCH_KERNEL_MAX_SIZE)) continue;
+				for (i = 0; i < size + 4; i++) src[i] = (p < fills_count) ? fills[p] : bench_random(&seed);
+				for (o = 0; o < 4; o++)
+					{
+					memcpy(data_ref, src, size + 4);
+					memcpy(data_knl, src, size + 4);
+					r1 = bench_kernel_reference(k, &data_ref[o], size, masks[k]);
+					r2 = bench_kernel_run(k, &data_knl[o], size, masks[k]);
+					tests++;
+					if ((r1 == r2) && (memcmp(data_ref, data_knl, size + 4) == 0)) continue;
+					if (failed++ == 0) error_warning("kernel %s differs from the per byte loop with size %d at offset %d", names[k], size, o);
+					}
+				}
+			}
+		file_write_sprintf(fil, "%s,%d,%d\n", names[k], tests, failed);
+		failed_all += failed;
+		}
+	return (failed_all);
+	}
+
+
+
+/****************************************************************************
+ * bench_number
+ ****************************************************************************/
+static cw_u32_t
+bench_number(
+	const cw_char_t			*option,
+	const cw_char_t			*arg,
+	cw_u32_t			max)
+
+	{
+	cw_u32_t			val;
+
+	if ((arg == NULL) || (sscanf(arg, "%u", &val) != 1) || (val > max)) error_message("%s expects a number between 0 and %u", option, max);
+	return (val);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * main
+ ****************************************************************************/
+int
+main(
+	int				argc,
+	char				**argv)
+
+	{
+	struct bench_option		bch_opt = { .repeat = 10, .seed = 1 };
+	struct file			fil;
+	struct disk			*dsk, *dsk_enc;
+	cw_char_t			**names = bench_disks, *arg, *output = "-", *corpus = NULL;
+	cw_char_t			name[2 * GLOBAL_MAX_NAME_SIZE], *enc;
+	cw_count_t			margin = 10, failed;
+	cw_bool_t			update = CW_BOOL_FALSE, kernels = CW_BOOL_FALSE;
+	cw_index_t			i;
+
+	setlinebuf(stderr);
+	config_parse_memory("(builtin config)", config_default(0), string_length(config_default(0)));
+	config_parse_memory("(bench config)", bench_config, string_length(bench_config));
+	for (argv++; (arg = *argv) != NULL; argv++)
+		{
+		if (arg[0] != '-') break;
+		if (string_equal(arg, "-h")) bench_usage();
+		else if (string_equal(arg, "-v")) verbose_set_level(VERBOSE_CLASS_GENERIC, verbose_get_level(VERBOSE_CLASS_GENERIC) + 1);
+		else if ((string_equal(arg, "-f")) && (argv[1] != NULL)) config_parse_path(*++argv, CW_BOOL_FALSE);
+		else if ((string_equal(arg, "-e")) && (argv[1] != NULL))
+			{
+			argv++;
+			config_parse_memory("(-e)", *argv, string_length(*argv));
+			}
+		else if ((string_equal(arg, "-o")) && (argv[1] != NULL)) output = *++argv;
+		else if (string_equal(arg, "-r")) bch_opt.repeat  = bench_number(arg, *++argv, 1000000);
+		else if (string_equal(arg, "-s")) bch_opt.seed    = bench_number(arg, *++argv, 0xffffffff);
+		else if (string_equal(arg, "-j")) bch_opt.jitter  = bench_number(arg, *++argv, GLOBAL_MAX_PULSE_LENGTH);
+		else if (string_equal(arg, "-d")) bch_opt.drift   = bench_number(arg, *++argv, 1000);
+		else if (string_equal(arg, "-x")) bch_opt.dropped = bench_number(arg, *++argv, 1000000);
+		else if (string_equal(arg, "-a")) bch_opt.extra   = bench_number(arg, *++argv, 1000000);
+		else if ((string_equal(arg, "-c")) && (argv[1] != NULL)) corpus = *++argv;
+		else if (string_equal(arg, "-m")) margin = bench_number(arg, *++argv, 1000000);
+		else if (string_equal(arg, "-u")) update = CW_BOOL_TRUE;
+		else if (string_equal(arg, "-k")) kernels = CW_BOOL_TRUE;
+		else error_message("unrecognized option '%s'", arg);
+		}
+	if (*argv != NULL) names = argv;
+	if (bch_opt.repeat == 0) error_message("-r expects a number greater than 0");
+	if (bch_opt.dropped + bch_opt.extra > 1000000) error_message("-x and -a together exceed one million");
+
+	/* check the kernels */
+
+	file_open(&fil, output, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	if (kernels)
+		{
+		if ((*argv != NULL) || (corpus != NULL)) error_message("no disk names or -c allowed with -k");
+		failed = bench_kernels(&fil, bch_opt.seed);
+		file_close(&fil);
+		return ((failed > 0) ? 1 : 0);
+		}
+
+	/* check the corpus */
+
+	if (corpus != NULL)
+		{
+		if (*argv != NULL) error_message("no disk names allowed with -c");
+		failed = bench_corpus(corpus, &fil, margin, update);
+		file_close(&fil);
+		if (failed > 0) error_warning("%d images of the corpus failed", failed);
+		return ((failed > 0) ? 1 : 0);
+		}
+
+	/* run the benchmark */
+
+	file_write_string(&fil, "disk,format,track,flux_bytes,sectors,good,weak,bad,repeat,ns,mb_per_s,sectors_per_s\n");
+	for (i = 0; names[i] != NULL; i++)
+		{
+		string_copy(name, sizeof (name), names[i]);
+		enc = strchr(name, ':');
+		if (enc != NULL) *enc++ = '\0';
+		else enc = name;
+		dsk     = disk_search(name);
+		dsk_enc = disk_search(enc);
+		if (dsk == NULL) error_message("unknown disk name '%s'", name);
+		if (dsk_enc == NULL) error_message("unknown disk name '%s'", enc);
+		verbose_message(GENERIC, 1, "benchmarking disk '%s' with flux from '%s'", name, enc);
+		if (! bench_disk(dsk, dsk_enc, &bch_opt, &fil)) error_warning("disk '%s' has no tracks with an encoder", names[i]);
+		}
+	file_close(&fil);
+	return (0);
+	}
+/******************************************************** Karsten Scheibler */
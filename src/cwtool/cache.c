@@ -0,0 +1,369 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * cache.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "import.h"
+#include "export.h"
+#include "string.h"
+
+
+
+
+/****************************************************************************
+ *
+ * local data structures, variables and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * entries are written to a temporary file with the pid in its name and
+ * then renamed, so several processes may share one cache directory. a
+ * reader sees either no entry or a complete one. if two processes decode
+ * the same track, the last rename wins, both entries have the same
+ * contents anyway
+ */
+
+#define CACHE_FNV_OFFSET		0xcbf29ce484222325ULL
+#define CACHE_FNV_PRIME			0x00000100000001b3ULL
+#define CACHE_MIX_OFFSET		0x6a09e667f3bcc909ULL
+#define CACHE_MIX_PRIME			0x9e3779b97f4a7c15ULL
+
+static const cw_char_t			cache_magic[CACHE_MAGIC_SIZE] = { 'c', 'w', 't', 'o', 'o', 'l', ' ', 'd', 'e', 'c', 'o', 'd', 'e', ' ', 'c', 'a', 'c', 'h', 'e', ' ', '1', 0, };
+static cw_char_t			cch_path[GLOBAL_MAX_PATH_SIZE];
+static cw_bool_t			cch_enabled;
+static cw_count_t			cch_hits;
+static cw_count_t			cch_misses;
+static cw_count_t			cch_stored;
+
+
+
+
+/****************************************************************************
+ *
+ * misc helper functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * cache_export_key
+ ****************************************************************************/
+static cw_void_t
+cache_export_key(
+	cw_u8_t				*data,
+	struct cache_key		*cch_key)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < 2; i++)
+		{
+		export_u32_le(&data[8 * i], cch_key->hash[i] & 0xffffffff);
+		export_u32_le(&data[8 * i + 4], cch_key->hash[i] >> 32);
+		}
+	}
+
+
+
+/****************************************************************************
+ * cache_entry_path
+ ****************************************************************************/
+static cw_void_t
+cache_entry_path(
+	cw_char_t			*path,
+	cw_size_t			size,
+	struct cache_key		*cch_key,
+	cw_bool_t			tmp)
+
+	{
+	if (tmp) string_snprintf(path, size, "%s/%016llx%016llx.%d.tmp", cch_path, cch_key->hash[0], cch_key->hash[1], (cw_int_t) getpid());
+	else string_snprintf(path, size, "%s/%016llx%016llx", cch_path, cch_key->hash[0], cch_key->hash[1]);
+	}
+
+
+
+/****************************************************************************
+ * cache_write_all
+ ****************************************************************************/
+static cw_bool_t
+cache_write_all(
+	cw_int_t			fd,
+	const cw_void_t			*data,
+	cw_size_t			size)
+
+	{
+	const cw_u8_t			*d = data;
+	cw_count_t			len;
+
+	while (size > 0)
+		{
+		len = write(fd, d, size);
+		if ((len == -1) && (errno == EINTR)) continue;
+		if (len <= 0) return (CW_BOOL_FAIL);
+		d += len;
+		size -= len;
+		}
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * cache_read_all
+ ****************************************************************************/
+static cw_bool_t
+cache_read_all(
+	cw_int_t			fd,
+	cw_void_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_u8_t				*d = data;
+	cw_count_t			len;
+
+	while (size > 0)
+		{
+		len = read(fd, d, size);
+		if ((len == -1) && (errno == EINTR)) continue;
+		if (len <= 0) return (CW_BOOL_FAIL);
+		d += len;
+		size -= len;
+		}
+	return (CW_BOOL_OK);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * cache_open
+ ****************************************************************************/
+cw_void_t
+cache_open(
+	const cw_char_t			*path)
+
+	{
+	struct stat			st;
+
+	if (string_length(path) >= GLOBAL_MAX_PATH_SIZE - 64) error_message("cache directory path '%s' too long", path);
+	if (stat(path, &st) == -1) error_perror_message("error while accessing cache directory '%s'", path);
+	if (! S_ISDIR(st.st_mode)) error_message("cache directory '%s' is not a directory", path);
+	string_copy(cch_path, GLOBAL_MAX_PATH_SIZE, path);
+	cch_enabled = CW_BOOL_TRUE;
+	verbose_message(GENERIC, 1, "using cache directory '%s'", path);
+	}
+
+
+
+/****************************************************************************
+ * cache_close
+ ****************************************************************************/
+cw_void_t
+cache_close(
+	cw_void_t)
+
+	{
+	if (! cch_enabled) return;
+	verbose_message(GENERIC, 1, "cache: %d hits, %d misses, %d entries stored", cch_hits, cch_misses, cch_stored);
+	cch_enabled = CW_BOOL_FALSE;
+	}
+
+
+
+/****************************************************************************
+ * cache_enabled
+ ****************************************************************************/
+cw_bool_t
+cache_enabled(
+	cw_void_t)
+
+	{
+	return (cch_enabled);
+	}
+
+
+
+/****************************************************************************
+ * cache_key_init
+ ****************************************************************************/
+cw_void_t
+cache_key_init(
+	struct cache_key		*cch_key)
+
+	{
+	*cch_key = (struct cache_key) { .hash = { CACHE_FNV_OFFSET, CACHE_MIX_OFFSET } };
+	cache_key_add(cch_key, cache_magic, CACHE_MAGIC_SIZE);
+	}
+
+
+
+/****************************************************************************
+ * cache_key_add
+ ****************************************************************************/
+cw_void_t
+cache_key_add(
+	struct cache_key		*cch_key,
+	const cw_void_t			*data,
+	cw_size_t			size)
+
+	{
+	const cw_u8_t			*d = data;
+	cw_u64_t			h0 = cch_key->hash[0];
+	cw_u64_t			h1 = cch_key->hash[1];
+	cw_index_t			i;
+
+	/*
+	 * two independent byte wise hashes, FNV-1a and a multiplicative
+	 * one with another constant, together give 128 bit. the size is
+	 * mixed in, so different splits of the same bytes differ
+	 */
+
+	for (i = 0; i < size; i++)
+		{
+		h0 = (h0 ^ d[i]) * CACHE_FNV_PRIME;
+		h1 = (h1 + d[i] + 1) * CACHE_MIX_PRIME;
+		h1 ^= h1 >> 29;
+		}
+	h0 = (h0 ^ size) * CACHE_FNV_PRIME;
+	h1 = (h1 + size) * CACHE_MIX_PRIME;
+	cch_key->hash[0] = h0;
+	cch_key->hash[1] = h1;
+	}
+
+
+
+/****************************************************************************
+ * cache_load
+ ****************************************************************************/
+cw_count_t
+cache_load(
+	struct cache_key		*cch_key,
+	cw_raw8_t			*data,
+	cw_size_t			limit)
+
+	{
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_char_t			magic[CACHE_MAGIC_SIZE];
+	cw_u8_t				key[CACHE_KEY_SIZE];
+	struct cache_header		cch_hdr;
+	cw_raw8_t			extra;
+	cw_count_t			size = -1;
+	cw_int_t			fd;
+
+	debug_error_condition(! cch_enabled);
+	cache_entry_path(path, sizeof (path), cch_key, CW_BOOL_FALSE);
+	cache_export_key(key, cch_key);
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		{
+		if (errno != ENOENT) error_warning("could not open cache entry '%s'", path);
+		cch_misses++;
+		return (-1);
+		}
+
+	/*
+	 * the entry has to match exactly, otherwise it is ignored and
+	 * overwritten later
+	 */
+
+	if ((cache_read_all(fd, magic, CACHE_MAGIC_SIZE)) &&
+		(memcmp(magic, cache_magic, CACHE_MAGIC_SIZE) == 0) &&
+		(cache_read_all(fd, &cch_hdr, sizeof (cch_hdr))) &&
+		(memcmp(cch_hdr.key, key, CACHE_KEY_SIZE) == 0) &&
+		(import_u32_le(cch_hdr.size) <= limit) &&
+		(cache_read_all(fd, data, import_u32_le(cch_hdr.size))) &&
+		(! cache_read_all(fd, &extra, 1))) size = import_u32_le(cch_hdr.size);
+	close(fd);
+	if (size >= 0) cch_hits++;
+	else
+		{
+		verbose_message(GENERIC, 1, "ignoring invalid cache entry '%s'", path);
+		cch_misses++;
+		}
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * cache_store
+ ****************************************************************************/
+cw_void_t
+cache_store(
+	struct cache_key		*cch_key,
+	const cw_raw8_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	cw_char_t			path_tmp[GLOBAL_MAX_PATH_SIZE];
+	struct cache_header		cch_hdr = { };
+	cw_bool_t			result;
+	cw_int_t			fd;
+
+	debug_error_condition(! cch_enabled);
+	cache_entry_path(path, sizeof (path), cch_key, CW_BOOL_FALSE);
+	cache_entry_path(path_tmp, sizeof (path_tmp), cch_key, CW_BOOL_TRUE);
+	cache_export_key(cch_hdr.key, cch_key);
+	export_u32_le(cch_hdr.size, size);
+
+	/*
+	 * the cache only saves time, so a full disk or a read only
+	 * directory should not stop reading the disk
+	 */
+
+	fd = open(path_tmp, O_WRONLY | O_CREAT | O_TRUNC | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd == -1)
+		{
+		error_warning("could not create cache entry '%s', disabling cache", path_tmp);
+		cch_enabled = CW_BOOL_FALSE;
+		return;
+		}
+	result = ((cache_write_all(fd, cache_magic, CACHE_MAGIC_SIZE)) &&
+		(cache_write_all(fd, &cch_hdr, sizeof (cch_hdr))) &&
+		(cache_write_all(fd, data, size)));
+	if (close(fd) == -1) result = CW_BOOL_FAIL;
+	if ((result) && (rename(path_tmp, path) == 0))
+		{
+		cch_stored++;
+		return;
+		}
+	error_warning("could not write cache entry '%s', disabling cache", path);
+	unlink(path_tmp);
+	cch_enabled = CW_BOOL_FALSE;
+	}
+/******************************************************** Karsten Scheibler */
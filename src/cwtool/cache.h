@@ -0,0 +1,105 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * cache.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_CACHE_H
+#define CWTOOL_CACHE_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * each cache entry is one file named after the hex digits of its key:
+ *
+ *   magic           CACHE_MAGIC_SIZE bytes
+ *   struct cache_header
+ *   data            size bytes, only interpreted by the caller
+ *
+ * the key is a 128 bit hash over everything the caller considers to
+ * change the data
+ */
+
+#define CACHE_MAGIC_SIZE		32
+#define CACHE_KEY_SIZE			16
+
+struct cache_key
+	{
+	cw_u64_t			hash[2];
+	};
+
+struct cache_header
+	{
+	cw_u8_t				key[CACHE_KEY_SIZE];
+	cw_u8_t				size[4];
+	cw_u8_t				reserved[4];
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+cache_open(
+	const cw_char_t			*path);
+
+extern cw_void_t
+cache_close(
+	cw_void_t);
+
+extern cw_bool_t
+cache_enabled(
+	cw_void_t);
+
+extern cw_void_t
+cache_key_init(
+	struct cache_key		*cch_key);
+
+extern cw_void_t
+cache_key_add(
+	struct cache_key		*cch_key,
+	const cw_void_t			*data,
+	cw_size_t			size);
+
+extern cw_count_t
+cache_load(
+	struct cache_key		*cch_key,
+	cw_raw8_t			*data,
+	cw_size_t			limit);
+
+extern cw_void_t
+cache_store(
+	struct cache_key		*cch_key,
+	const cw_raw8_t			*data,
+	cw_size_t			size);
+
+
+
+#endif /* !CWTOOL_CACHE_H */
+/******************************************************** Karsten Scheibler */
@@ -12,6 +12,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include "cmdline.h"
 #include "error.h"
@@ -22,6 +23,7 @@
 #include "string.h"
 #include "config.h"
 #include "file.h"
+#include "stats.h"
 
 
 
@@ -35,7 +37,7 @@
 
 
 
-static struct cmdline			cmd = { .retry = 5 };
+static struct cmdline			cmd = { .retry = 5, .copies = 1 };
 
 
 
@@ -85,31 +87,63 @@ cmdline_usage(
 		"or:    %s -L [-v] [-n] [-f <file>] [-e <config>]\n"
 		"or:    %s -S [-v] [-n] [-f <file>] [-e <config>]\n"
 		"       %s    [--] <diskname> <srcfile|device>\n"
+		"or:    %s -P [-v] [-n] [-f <file>] [-e <config>]\n"
+		"       %s    [--] <srcfile|device>\n"
 		"or:    %s -R [-v] [-n] [-f <file>] [-e <config>] [-r <num>]\n"
-		"       %s    [-o <file>] [--] <diskname> <srcfile|device>\n"
-		"       %s    [<srcfile> ... ] <dstfile>\n"
+		"       %s    [-l] [-o <file>] [-t <file>] [--] <diskname>\n"
+		"       %s    <srcfile|device> [<srcfile> ... ] <dstfile>\n"
+		"or:    %s -R -m [-v] [-n] [-f <file>] [-e <config>] [-r <num>]\n"
+		"       %s    [-l] [--] <diskname> <srcfile|device> <dstfile>\n"
+		"       %s    [<diskname> <srcfile|device> <dstfile> ... ]\n"
 		"or:    %s -W [-v] [-n] [-f <file>] [-e <config>] [-s]\n"
-		"       %s    [--] <diskname> <srcfile> <dstfile|device>\n\n"
+		"       %s    [-c <num>] [-k] [--] <diskname> <srcfile>\n"
+		"       %s    <dstfile|device> [<dstfile|device> ... ]\n"
+		"or:    %s -C [-v] [--] <srcfile> <dstfile>\n\n"
 		"  -V            print out version\n"
 		"  -D            dump builtin config\n"
 		"  -I            initialize configured drives\n"
 		"  -L            list available disk names\n"
 		"  -S            print out statistics\n"
+		"  -P            probe which disk names match a disk\n"
 		"  -R            read disk\n"
 		"  -W            write disk\n"
+		"  -C            convert raw output of bad sectors to raw text\n"
 		"  -v            be more verbose\n"
 		"  -n            do not read rc files\n"
 		"  -f <file>     read additional config file\n"
 		"  -e <config>   evaluate given string as config\n"
 		"  -r <num>      number of retries if errors occur\n"
 		"  -o <file>     output raw data of bad sectors to file\n"
+		"  -t <file>     also write the raw data of every try to file\n"
+		"  -m            read several disks in parallel, one per device\n"
+		"  -l            retry bad tracks after all other tracks were read\n"
 		"  -s            ignore size\n"
+		"  -c <num>      write <num> copies, ask for new disks in between\n"
+		"  -k            verify written disks by reading them back\n"
+		"  --stats-json <file>\n"
+		"                write timings and counters as JSON to file, only\n"
+		"                available if built with STATS=1 (with -R and -W)\n"
+		"  --events <target>\n"
+		"                send one JSON line per try and per track to\n"
+		"                <target>, which is a file, fd:<num> or unix:<path>\n"
+		"                (with -R and -W)\n"
+		"  --cache <dir>\n"
+		"                keep decoded tracks in <dir> and take them from\n"
+		"                there if the same flux is decoded again (with -R)\n"
+		"  --resume      keep a journal of finished tracks next to <dstfile>\n"
+		"                and continue an interrupted read from it (with -R)\n"
+		"  --async-write <num>\n"
+		"                write image files in a background process and\n"
+		"                sync them every <num> MB, 0 syncs only at the end\n"
+		"                (with -R and -W)\n"
 		"  -h            this help\n",
 		global_version_string(), space1, space1, global_program_name(),
 		global_program_name(), global_program_name(), global_program_name(),
 		global_program_name(), global_program_name(), space2,
-		global_program_name(), space2, space2, global_program_name(),
-		space2);
+		global_program_name(), space2, global_program_name(), space2,
+		space2, global_program_name(),
+		space2, space2, global_program_name(), space2, space2,
+		global_program_name());
 	exit(0);
 	}
 
@@ -180,6 +214,8 @@ cmdline_min_params(
 	if (cmd.mode == CMDLINE_MODE_READ)       return (3);
 	if (cmd.mode == CMDLINE_MODE_WRITE)      return (3);
 	if (cmd.mode == CMDLINE_MODE_STATISTICS) return (2);
+	if (cmd.mode == CMDLINE_MODE_CONVERT)    return (2);
+	if (cmd.mode == CMDLINE_MODE_PROBE)      return (1);
 	return (0);
 	}
 
@@ -194,13 +230,50 @@ cmdline_max_params(
 
 	{
 	if (cmd.mode == CMDLINE_MODE_READ)       return (GLOBAL_NR_IMAGES);
-	if (cmd.mode == CMDLINE_MODE_WRITE)      return (3);
+	if (cmd.mode == CMDLINE_MODE_WRITE)      return (GLOBAL_NR_IMAGES);
 	if (cmd.mode == CMDLINE_MODE_STATISTICS) return (2);
+	if (cmd.mode == CMDLINE_MODE_CONVERT)    return (2);
+	if (cmd.mode == CMDLINE_MODE_PROBE)      return (1);
 	return (0);
 	}
 
 
 
+/****************************************************************************
+ * cmdline_check_jobs
+ ****************************************************************************/
+static cw_void_t
+cmdline_check_jobs(
+	cw_count_t			params)
+
+	{
+	cw_char_t			journal[GLOBAL_MAX_PATH_SIZE];
+	cw_index_t			i, j;
+
+	/*
+	 * with -m every job consists of exactly <diskname>,
+	 * <srcfile|device> and <dstfile>. each source and each destination
+	 * may only be used by one job, because the jobs run in parallel.
+	 * with --resume this is also true for the journal of each job
+	 */
+
+	if (cmd.output != NULL) error_message("-o/--output can not be used together with -m/--multiple");
+	if (cmd.tee != NULL) error_message("-t/--tee can not be used together with -m/--multiple");
+	if ((params % 3) != 0) error_message("-m/--multiple expects <diskname> <srcfile|device> <dstfile> for each job");
+	for (i = 0; i < cmdline_get_jobs(); i++)
+		{
+		cmdline_check_stdout("<dstfile>", cmdline_get_job_param(i, 2));
+		if ((cmd.flags & CMDLINE_FLAG_RESUME) && (string_equal(cmdline_get_job_param(i, 2), "-"))) error_message("--resume can not be used together with stdout as <dstfile>");
+		for (j = 0; j < i; j++) if (string_equal(cmdline_get_job_param(i, 1), cmdline_get_job_param(j, 1))) error_message("'%s' is used by more than one job", cmdline_get_job_param(i, 1));
+		for (j = 0; j < i; j++) if (string_equal(cmdline_get_job_param(i, 2), cmdline_get_job_param(j, 2))) error_message("'%s' is used by more than one job", cmdline_get_job_param(i, 2));
+		if (! (cmd.flags & CMDLINE_FLAG_RESUME)) continue;
+		string_snprintf(journal, sizeof (journal), "%s.journal", cmdline_get_job_param(i, 2));
+		for (j = 0; j < cmdline_get_jobs(); j++) if (string_equal(journal, cmdline_get_job_param(j, 2))) error_message("journal '%s' of one job is <dstfile> of another job", journal);
+		}
+	}
+
+
+
 /****************************************************************************
  * cmdline_read_rc_files
  ****************************************************************************/
@@ -272,6 +345,7 @@ cmdline_parse(
 	cw_char_t			**argv)
 
 	{
+	struct stat			st;
 	cw_char_t			*arg;
 	cw_bool_t			ignore = CW_BOOL_FALSE;
 	cw_count_t			args = 0, params = 0;
@@ -282,7 +356,7 @@ cmdline_parse(
 			{
 			if (cmd.mode == CMDLINE_MODE_DEFAULT) goto bad_option;
 			if (params >= cmdline_max_params()) error_message("too many parameters given");
-			if (params >= 1)
+			if ((params >= 1) || (cmd.mode == CMDLINE_MODE_CONVERT) || (cmd.mode == CMDLINE_MODE_PROBE))
 				{
 				if (cmd.files > 0) cmdline_check_stdin("<srcfile>", cmd.file[cmd.files - 1]);
 				cmd.file[cmd.files++] = arg;
@@ -318,6 +392,10 @@ cmdline_parse(
 			{
 			cmd.mode = CMDLINE_MODE_STATISTICS;
 			}
+		else if ((string_equal2(arg, "-P", "--probe")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_PROBE;
+			}
 		else if ((string_equal2(arg, "-R", "--read")) && (args == 0))
 			{
 			cmd.mode = CMDLINE_MODE_READ;
@@ -326,6 +404,10 @@ cmdline_parse(
 			{
 			cmd.mode = CMDLINE_MODE_WRITE;
 			}
+		else if ((string_equal2(arg, "-C", "--convert")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_CONVERT;
+			}
 		else if ((cmd.mode == CMDLINE_MODE_DEFAULT) || (cmd.mode == CMDLINE_MODE_VERSION) || (cmd.mode == CMDLINE_MODE_DUMP))
 			{
 			goto bad_option;
@@ -373,10 +455,62 @@ cmdline_parse(
 			cmd.output = cmdline_check_stdout("-o/--output", *argv++);
 			options_set_output(CW_BOOL_TRUE);
 			}
+		else if ((string_equal2(arg, "-t", "--tee")) && (cmd.mode == CMDLINE_MODE_READ))
+			{
+			if (cmd.tee != NULL) error_message("-t/--tee already specified");
+			cmd.tee = cmdline_check_stdout("-t/--tee", *argv++);
+			}
+		else if ((string_equal2(arg, "-m", "--multiple")) && (cmd.mode == CMDLINE_MODE_READ))
+			{
+			cmd.flags |= CMDLINE_FLAG_MULTIPLE;
+			}
+		else if ((string_equal2(arg, "-l", "--late-retry")) && (cmd.mode == CMDLINE_MODE_READ))
+			{
+			cmd.flags |= CMDLINE_FLAG_DEFERRED;
+			}
+		else if ((string_equal(arg, "--resume")) && (cmd.mode == CMDLINE_MODE_READ))
+			{
+			cmd.flags |= CMDLINE_FLAG_RESUME;
+			}
 		else if ((string_equal2(arg, "-s", "--ignore-size")) && (cmd.mode == CMDLINE_MODE_WRITE))
 			{
 			cmd.flags |= CMDLINE_FLAG_IGNORE_SIZE;
 			}
+		else if ((string_equal2(arg, "-c", "--copies")) && (cmd.mode == CMDLINE_MODE_WRITE))
+			{
+			cw_count_t	i = 0;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.copies);
+			if ((i != 1) || (cmd.copies < 1)) error_message("-c/--copies expects a valid number of copies");
+			}
+		else if ((string_equal2(arg, "-k", "--verify")) && (cmd.mode == CMDLINE_MODE_WRITE))
+			{
+			cmd.flags |= CMDLINE_FLAG_VERIFY;
+			}
+		else if ((string_equal(arg, "--stats-json")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_WRITE)))
+			{
+			if (! stats_compiled_in) error_message("--stats-json is not available, cwtool was built without STATS=1");
+			if (cmd.stats != NULL) error_message("--stats-json already specified");
+			cmd.stats = cmdline_check_stdout("--stats-json", *argv++);
+			}
+		else if ((string_equal(arg, "--events")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_WRITE)))
+			{
+			if (cmd.events != NULL) error_message("--events already specified");
+			cmd.events = cmdline_check_stdout("--events", *argv++);
+			}
+		else if ((string_equal(arg, "--cache")) && (cmd.mode == CMDLINE_MODE_READ))
+			{
+			if (cmd.cache != NULL) error_message("--cache already specified");
+			if (*argv == NULL) error_message("--cache expects a directory");
+			cmd.cache = *argv++;
+			}
+		else if ((string_equal(arg, "--async-write")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_WRITE)))
+			{
+			cw_count_t	i = 0, mb;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &mb);
+			if ((i != 1) || (mb < 0) || (! options_set_async_write(mb))) error_message("--async-write expects a valid number of MB");
+			}
 		else
 			{
 		bad_option:
@@ -384,7 +518,16 @@ cmdline_parse(
 			}
 		}
 	if ((params < cmdline_min_params()) || (cmd.mode == CMDLINE_MODE_DEFAULT)) error_message("too few parameters given");
-	if (params >= 2) cmdline_check_stdout("<dstfile>", cmd.file[cmd.files - 1]);
+	if ((cmd.copies > 1) && (string_equal(cmd.file[0], "-"))) error_message("-c/--copies can not be used together with stdin as <srcfile>");
+	if ((cmd.mode == CMDLINE_MODE_PROBE) && (string_equal(cmd.file[0], "-"))) error_message("-P/--probe can not be used together with stdin as <srcfile>");
+	if ((cmd.stats != NULL) && (cmd.flags & CMDLINE_FLAG_MULTIPLE)) error_message("--stats-json can not be used together with -m/--multiple");
+	if ((cmd.events != NULL) && (cmd.flags & CMDLINE_FLAG_MULTIPLE)) error_message("--events can not be used together with -m/--multiple");
+	if ((cmd.cache != NULL) && (cmd.output != NULL)) error_message("--cache can not be used together with -o/--output");
+	if ((cmd.tee != NULL) && (cmd.flags & CMDLINE_FLAG_RESUME)) error_message("--resume can not be used together with -t/--tee");
+	if ((cmd.tee != NULL) && (! string_equal(cmd.tee, "-")) && (stat(cmd.tee, &st) == 0) && (! S_ISREG(st.st_mode)) && (! S_ISFIFO(st.st_mode))) error_message("-t/--tee expects a regular file, a pipe or stdout, '%s' is none of them", cmd.tee);
+	if (cmd.flags & CMDLINE_FLAG_MULTIPLE) cmdline_check_jobs(params);
+	else if (params >= 2) cmdline_check_stdout("<dstfile>", cmd.file[cmd.files - 1]);
+	if ((cmd.flags & CMDLINE_FLAG_RESUME) && (! (cmd.flags & CMDLINE_FLAG_MULTIPLE)) && (string_equal(cmd.file[cmd.files - 1], "-"))) error_message("--resume can not be used together with stdout as <dstfile>");
 
 	return (CW_BOOL_OK);
 	}
@@ -430,6 +573,19 @@ cmdline_get_retry(
 
 
 
+/****************************************************************************
+ * cmdline_get_copies
+ ****************************************************************************/
+cw_count_t
+cmdline_get_copies(
+	cw_void_t)
+
+	{
+	return (cmd.copies);
+	}
+
+
+
 /****************************************************************************
  * cmdline_get_output
  ****************************************************************************/
@@ -443,6 +599,58 @@ cmdline_get_output(
 
 
 
+/****************************************************************************
+ * cmdline_get_tee
+ ****************************************************************************/
+cw_char_t *
+cmdline_get_tee(
+	cw_void_t)
+
+	{
+	return (cmd.tee);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_stats
+ ****************************************************************************/
+cw_char_t *
+cmdline_get_stats(
+	cw_void_t)
+
+	{
+	return (cmd.stats);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_events
+ ****************************************************************************/
+cw_char_t *
+cmdline_get_events(
+	cw_void_t)
+
+	{
+	return (cmd.events);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_cache
+ ****************************************************************************/
+cw_char_t *
+cmdline_get_cache(
+	cw_void_t)
+
+	{
+	return (cmd.cache);
+	}
+
+
+
 /****************************************************************************
  * cmdline_get_disk_name
  ****************************************************************************/
@@ -496,6 +704,43 @@ cmdline_get_files(
 
 
 
+/****************************************************************************
+ * cmdline_get_jobs
+ ****************************************************************************/
+cw_count_t
+cmdline_get_jobs(
+	cw_void_t)
+
+	{
+	if (! (cmd.flags & CMDLINE_FLAG_MULTIPLE)) return (1);
+	return ((cmd.files + 1) / 3);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_job_param
+ ****************************************************************************/
+cw_char_t *
+cmdline_get_job_param(
+	cw_index_t			job,
+	cw_index_t			index)
+
+	{
+
+	/*
+	 * index 0 is <diskname>, 1 is <srcfile|device> and 2 is <dstfile>.
+	 * the <diskname> of the first job is stored in cmd.disk_name, all
+	 * other parameters follow in cmd.file[]
+	 */
+
+	if ((job < 0) || (job >= cmdline_get_jobs()) || (index < 0) || (index > 2)) return (NULL);
+	if (3 * job + index == 0) return (cmd.disk_name);
+	return (cmdline_get_file(3 * job + index - 1));
+	}
+
+
+
 /****************************************************************************
  * cmdline_read_config
  ****************************************************************************/
@@ -508,9 +753,14 @@ cmdline_read_config(
 	cw_count_t			e;
 	cw_index_t			i;
 
-	/* read builtin config and rc-files */
+	/*
+	 * read builtin config and rc-files. disks of the builtin config
+	 * are only indexed and parsed when needed, except for -L and -P
+	 * which need all of them
+	 */
 
-	config_parse_memory("(builtin config)", config_default(0), string_length(config_default(0)));
+	if ((cmd.mode == CMDLINE_MODE_LIST) || (cmd.mode == CMDLINE_MODE_PROBE)) config_parse_memory("(builtin config)", config_default(0), string_length(config_default(0)));
+	else config_parse_memory_indexed("(builtin config)", config_default(0), string_length(config_default(0)));
 	if (! (cmd.flags & CMDLINE_FLAG_NO_RCFILES)) cmdline_read_rc_files();
 	
 	/* read configs specified on cmdline */
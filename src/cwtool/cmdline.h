@@ -36,6 +36,8 @@
 #define CMDLINE_MODE_STATISTICS		5
 #define CMDLINE_MODE_READ		6
 #define CMDLINE_MODE_WRITE		7
+#define CMDLINE_MODE_CONVERT		8
+#define CMDLINE_MODE_PROBE		9
 
 #define CMDLINE_NR_CONFIGS		128
 
@@ -50,16 +52,25 @@ struct cmdline_config
 
 #define CMDLINE_FLAG_NO_RCFILES		(1 << 0)
 #define CMDLINE_FLAG_IGNORE_SIZE	(1 << 1)
+#define CMDLINE_FLAG_MULTIPLE		(1 << 2)
+#define CMDLINE_FLAG_VERIFY		(1 << 3)
+#define CMDLINE_FLAG_DEFERRED		(1 << 4)
+#define CMDLINE_FLAG_RESUME		(1 << 5)
 
 struct cmdline
 	{
 	cw_mode_t			mode;
 	cw_flag_t			flags;
 	cw_count_t			retry;
+	cw_count_t			copies;
 	cw_char_t			*disk_name;
 	cw_char_t			*file[GLOBAL_NR_IMAGES];
 	cw_count_t			files;
 	cw_char_t			*output;
+	cw_char_t			*tee;
+	cw_char_t			*stats;
+	cw_char_t			*events;
+	cw_char_t			*cache;
 	struct cmdline_config		cfg[CMDLINE_NR_CONFIGS];
 	cw_count_t			configs;
 	};
@@ -92,10 +103,30 @@ extern cw_count_t
 cmdline_get_retry(
 	cw_void_t);
 
+extern cw_count_t
+cmdline_get_copies(
+	cw_void_t);
+
 extern cw_char_t *
 cmdline_get_output(
 	cw_void_t);
 
+extern cw_char_t *
+cmdline_get_tee(
+	cw_void_t);
+
+extern cw_char_t *
+cmdline_get_stats(
+	cw_void_t);
+
+extern cw_char_t *
+cmdline_get_events(
+	cw_void_t);
+
+extern cw_char_t *
+cmdline_get_cache(
+	cw_void_t);
+
 extern cw_char_t *
 cmdline_get_disk_name(
 	cw_void_t);
@@ -112,6 +143,15 @@ extern cw_count_t
 cmdline_get_files(
 	cw_void_t);
 
+extern cw_count_t
+cmdline_get_jobs(
+	cw_void_t);
+
+extern cw_char_t *
+cmdline_get_job_param(
+	cw_index_t			job,
+	cw_index_t			index);
+
 extern cw_bool_t
 cmdline_read_config(
 	cw_void_t);
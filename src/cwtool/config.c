@@ -20,7 +20,35 @@
 #include "global.h"
 #include "options.h"
 #include "parse.h"
+#include "disk.h"
 #include "string.h"
+#include "stats.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define INDEX_FLAG_PARSED		(1 << 0)
+#define INDEX_FLAG_BUSY			(1 << 1)
+
+struct config_index
+	{
+	cw_char_t			name[GLOBAL_MAX_NAME_SIZE];
+	struct parse			prs;
+	cw_count_t			revision;
+	cw_flag_t			flags;
+	};
+
+static struct config_index		idx[GLOBAL_NR_DISKS];
+static cw_count_t			indices;
 
 
 
@@ -34,6 +62,93 @@
 
 
 
+/****************************************************************************
+ * config_index_search
+ ****************************************************************************/
+static struct config_index *
+config_index_search(
+	const cw_char_t			*name)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < indices; i++)
+		{
+		if (idx[i].flags & INDEX_FLAG_PARSED) continue;
+		if (string_equal(name, idx[i].name)) return (&idx[i]);
+		}
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * config_index_search_revision
+ ****************************************************************************/
+static struct config_index *
+config_index_search_revision(
+	const cw_char_t			*name,
+	cw_count_t			revision)
+
+	{
+	struct config_index		*cfg_idx = NULL;
+	cw_index_t			i;
+
+	/*
+	 * the latest definition up to the given revision, no matter if
+	 * it was already parsed or replaced
+	 */
+
+	for (i = 0; i < indices; i++)
+		{
+		if (idx[i].revision > revision) continue;
+		if (string_equal(name, idx[i].name)) cfg_idx = &idx[i];
+		}
+	return (cfg_idx);
+	}
+
+
+
+/****************************************************************************
+ * config_disk_indexed
+ ****************************************************************************/
+static cw_bool_t
+config_disk_indexed(
+	struct config			*cfg,
+	cw_count_t			revision)
+
+	{
+	cw_char_t			token[GLOBAL_MAX_NAME_SIZE];
+	struct parse			prs = cfg->prs;
+	struct config_index		*cfg_idx;
+
+	/*
+	 * only remember where this disk is defined, it is parsed later
+	 * by config_disk_search() if really needed. if the disk does not
+	 * start with { it is parsed right now
+	 */
+
+	config_name(cfg, "disk name expected", token, sizeof (token));
+	if (! parse_skip_block(&cfg->prs))
+		{
+		cfg->prs = prs;
+		return (config_disk(cfg, revision));
+		}
+	cfg_idx = config_index_search(token);
+	if (cfg_idx != NULL)
+		{
+		if (cfg_idx->revision == revision) config_error(cfg, "already defined disk '%s' within this scope", token);
+		cfg_idx->flags |= INDEX_FLAG_PARSED;
+		}
+	if (indices >= GLOBAL_NR_DISKS) error_message("too many disks defined");
+	debug_message(GENERIC, 2, "indexing disk '%s', revision = %d", token, revision);
+	idx[indices] = (struct config_index) { .prs = prs, .revision = revision };
+	string_copy(idx[indices++].name, GLOBAL_MAX_NAME_SIZE, token);
+	return (CW_BOOL_OK);
+	}
+
+
+
 /****************************************************************************
  * config_top_directive
  ****************************************************************************/
@@ -47,6 +162,7 @@ config_top_directive(
 
 	debug_message(GENERIC, 2, "looking for next top directive, revision = %d", revision);
 	if (! config_token(cfg, token, sizeof (token))) return (CW_BOOL_FAIL);
+	if ((string_equal(token, "disk")) && (cfg->flags & CONFIG_FLAG_INDEXED)) return (config_disk_indexed(cfg, revision));
 	if (string_equal(token, "disk"))     return (config_disk(cfg, revision));
 	if (string_equal(token, "drive"))    return (config_drive(cfg, revision));
 	if (string_equal(token, "options"))  return (config_options(cfg));
@@ -73,7 +189,9 @@ config_parse(
 
 	revision++;
 	verbose_message(GENERIC, 1, "reading config from '%s'", path);
+	stats_begin(CONFIG);
 	while (config_top_directive(cfg, revision)) ;
+	stats_end(CONFIG);
 	}
 
 
@@ -324,7 +442,35 @@ config_parse_memory(
 	cw_size_t			size)
 
 	{
-	struct config			cfg;
+	struct config			cfg = { .flags = CONFIG_FLAG_NONE };
+
+	parse_init_memory(
+		&cfg.prs,
+		parse_valid_chars_config(),
+		path,
+		text,
+		size);
+	config_parse(&cfg, path);
+	}
+
+
+
+/****************************************************************************
+ * config_parse_memory_indexed
+ ****************************************************************************/
+cw_void_t
+config_parse_memory_indexed(
+	const cw_char_t			*path,
+	const cw_char_t			*text,
+	cw_size_t			size)
+
+	{
+	struct config			cfg = { .flags = CONFIG_FLAG_INDEXED };
+
+	/*
+	 * like config_parse_memory(), but disks are only indexed and
+	 * not parsed. all other directives are parsed as usual
+	 */
 
 	parse_init_memory(
 		&cfg.prs,
@@ -337,6 +483,93 @@ config_parse_memory(
 
 
 
+/****************************************************************************
+ * config_index_drop
+ ****************************************************************************/
+cw_void_t
+config_index_drop(
+	const cw_char_t			*name)
+
+	{
+	struct config_index		*cfg_idx = config_index_search(name);
+
+	/* a disk defined later replaces the indexed one */
+
+	if (cfg_idx != NULL) cfg_idx->flags |= INDEX_FLAG_PARSED;
+	}
+
+
+
+/****************************************************************************
+ * config_disk_search
+ ****************************************************************************/
+struct disk *
+config_disk_search(
+	const cw_char_t			*name)
+
+	{
+	struct disk			*dsk = disk_search(name);
+	struct config_index		*cfg_idx;
+	struct config			cfg = { .flags = CONFIG_FLAG_NONE };
+
+	/*
+	 * if the disk is not defined yet, but was indexed, parse it now.
+	 * INDEX_FLAG_PARSED is set before, so a disk copying itself
+	 * gives an error like it does without index
+	 */
+
+	if (dsk != NULL) return (dsk);
+	cfg_idx = config_index_search(name);
+	if (cfg_idx == NULL) return (NULL);
+	cfg_idx->flags |= INDEX_FLAG_PARSED;
+	verbose_message(GENERIC, 1, "reading disk '%s' from '%s'", name, cfg_idx->prs.path);
+	cfg.prs = cfg_idx->prs;
+	stats_begin(CONFIG);
+	config_disk(&cfg, cfg_idx->revision);
+	stats_end(CONFIG);
+	return (disk_search(name));
+	}
+
+
+
+/****************************************************************************
+ * config_disk_search_copy
+ ****************************************************************************/
+struct disk *
+config_disk_search_copy(
+	const cw_char_t			*name,
+	struct disk			*dsk_dst,
+	struct disk			*dsk_old)
+
+	{
+	struct disk			*dsk = config_disk_search(name);
+	struct config_index		*cfg_idx;
+	struct config			cfg = { .flags = CONFIG_FLAG_NONE };
+
+	/*
+	 * a copy directive refers to the disk as it was defined, when
+	 * dsk_dst was defined. an indexed disk may be parsed after a
+	 * later revision (~/.cwtoolrc or -e) replaced the disk to copy
+	 * from, then the replaced definition is parsed again into
+	 * dsk_old. a disk copying itself gives an error like it does
+	 * without index
+	 */
+
+	if ((dsk == NULL) || (dsk->revision <= dsk_dst->revision)) return (dsk);
+	cfg_idx = config_index_search_revision(name, dsk_dst->revision);
+	if ((cfg_idx == NULL) || (cfg_idx->flags & INDEX_FLAG_BUSY)) return (NULL);
+	verbose_message(GENERIC, 1, "reading replaced disk '%s' from '%s'", name, cfg_idx->prs.path);
+	cfg_idx->flags |= INDEX_FLAG_BUSY;
+	cfg.prs = cfg_idx->prs;
+	stats_begin(CONFIG);
+	config_disk_replaced(&cfg, dsk_old, cfg_idx->revision);
+	stats_end(CONFIG);
+	cfg_idx->flags &= ~INDEX_FLAG_BUSY;
+	return (dsk_old);
+	}
+
+
+
 /****************************************************************************
  * config_parse_path
  ****************************************************************************/
@@ -346,7 +579,7 @@ config_parse_path(
 	cw_bool_t			file_may_not_exist)
 
 	{
-	struct config			cfg;
+	struct config			cfg = { .flags = CONFIG_FLAG_NONE };
 	cw_bool_t			success;
 
 	success = parse_init_path(
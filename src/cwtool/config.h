@@ -35,10 +35,15 @@
 
 #define CONFIG_MAX_PARAMS		GLOBAL_NR_SECTORS
 
+#define CONFIG_FLAG_NONE		0
+#define CONFIG_FLAG_INDEXED		(1 << 0)
+
+struct disk;
 
 struct config
 	{
 	struct parse			prs;
+	cw_flag_t			flags;
 	};
 
 
@@ -130,6 +135,26 @@ config_parse_memory(
 	const cw_char_t			*text,
 	cw_size_t			size);
 
+extern cw_void_t
+config_parse_memory_indexed(
+	const cw_char_t			*path,
+	const cw_char_t			*text,
+	cw_size_t			size);
+
+extern cw_void_t
+config_index_drop(
+	const cw_char_t			*name);
+
+extern struct disk *
+config_disk_search(
+	const cw_char_t			*name);
+
+extern struct disk *
+config_disk_search_copy(
+	const cw_char_t			*name,
+	struct disk			*dsk_dst,
+	struct disk			*dsk_old);
+
 extern cw_void_t
 config_parse_path(
 	const cw_char_t			*path,
@@ -177,9 +177,10 @@ config_disk_copy(
 
 	{
 	cw_char_t			token[GLOBAL_MAX_NAME_SIZE];
+	struct disk			dsk_old;
 	struct disk			*dsk2;
 
-	dsk2 = disk_search(config_name(cfg, "disk name expected", token, sizeof (token)));
+	dsk2 = config_disk_search_copy(config_name(cfg, "disk name expected", token, sizeof (token)), dsk, &dsk_old);
 	if (dsk2 == NULL) config_error(cfg, "unknown disk name '%s'", token);
 	if (! disk_copy(dsk, dsk2)) debug_error();
 	return (CW_BOOL_OK);
@@ -339,6 +340,36 @@ config_disk_timeout_write(
 
 
 
+/****************************************************************************
+ * config_disk_retry_patience
+ ****************************************************************************/
+static cw_bool_t
+config_disk_retry_patience(
+	struct config			*cfg,
+	struct disk_track		*dsk_trk)
+
+	{
+	if (! disk_set_retry_patience(dsk_trk, config_number(cfg, NULL, 0))) config_error(cfg, "invalid retry_patience value");
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * config_disk_retry_budget
+ ****************************************************************************/
+static cw_bool_t
+config_disk_retry_budget(
+	struct config			*cfg,
+	struct disk_track		*dsk_trk)
+
+	{
+	if (! disk_set_retry_budget(dsk_trk, config_number(cfg, NULL, 0))) config_error(cfg, "invalid retry_budget value");
+	return (CW_BOOL_OK);
+	}
+
+
+
 /****************************************************************************
  * config_disk_timeout
  ****************************************************************************/
@@ -700,6 +731,8 @@ config_disk_directive(
 		{
 		if (string_equal(token, "timeout"))        return (config_disk_timeout_read(cfg, dsk_trk));
 		if (string_equal(token, "indexed"))        return (config_disk_indexed_read(cfg, dsk_trk));
+		if (string_equal(token, "retry_patience")) return (config_disk_retry_patience(cfg, dsk_trk));
+		if (string_equal(token, "retry_budget"))   return (config_disk_retry_budget(cfg, dsk_trk));
 		if (disk_get_format(dsk_trk) == NULL)      config_disk_error_format(cfg);
 		if (config_disk_read(cfg, dsk_trk, token)) return (CW_BOOL_OK);
 		}
@@ -721,6 +754,26 @@ config_disk_directive(
 
 
 
+/****************************************************************************
+ * config_disk_body
+ ****************************************************************************/
+static cw_void_t
+config_disk_body(
+	struct config			*cfg,
+	struct disk			*dsk,
+	const cw_char_t			*token)
+
+	{
+	config_disk_directive(cfg, dsk, disk_init_track_default(dsk), NULL, SCOPE_ENTER | SCOPE_TRACK | SCOPE_RW);
+	if (! disk_tracks_used(dsk)) config_error(cfg, "no tracks used in disk '%s'", token);
+	if (! disk_image_ok(dsk)) config_error(cfg, "specified format and image do not have the same level in disk '%s'", token);
+	if (! disk_trackmap_ok(dsk)) config_error(cfg, "trackmap incomplete or illegal use of side_offset or flip_side in disk '%s'", token);
+	if (! disk_trackmap_numbering_ok(dsk)) config_error(cfg, "image_track numbering in trackmap not compatible with selected image format in disk '%s'", token);
+	}
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -745,12 +798,34 @@ config_disk(
 	disk_init(&dsk, revision);
 	config_name(cfg, "disk name expected", token, sizeof (token));
 	if (! disk_set_name(&dsk, token)) config_error(cfg, "already defined disk '%s' within this scope", token);
-	config_disk_directive(cfg, &dsk, disk_init_track_default(&dsk), NULL, SCOPE_ENTER | SCOPE_TRACK | SCOPE_RW);
-	if (! disk_tracks_used(&dsk)) config_error(cfg, "no tracks used in disk '%s'", token);
-	if (! disk_image_ok(&dsk)) config_error(cfg, "specified format and image do not have the same level in disk '%s'", token);
-	if (! disk_trackmap_ok(&dsk)) config_error(cfg, "trackmap incomplete or illegal use of side_offset or flip_side in disk '%s'", token);
-	if (! disk_trackmap_numbering_ok(&dsk)) config_error(cfg, "image_track numbering in trackmap not compatible with selected image format in disk '%s'", token);
+	config_disk_body(cfg, &dsk, token);
+	config_index_drop(token);
 	disk_insert(&dsk);
 	return (CW_BOOL_OK);
 	}
+
+
+
+/****************************************************************************
+ * config_disk_replaced
+ ****************************************************************************/
+cw_void_t
+config_disk_replaced(
+	struct config			*cfg,
+	struct disk			*dsk,
+	cw_count_t			revision)
+
+	{
+	cw_char_t			token[GLOBAL_MAX_NAME_SIZE];
+
+	/*
+	 * parse a definition, which was already replaced by a later
+	 * revision, into dsk. it is only used as source for a copy
+	 * directive, so it gets no name and is not inserted
+	 */
+
+	disk_init(dsk, revision);
+	config_name(cfg, "disk name expected", token, sizeof (token));
+	config_disk_body(cfg, dsk, token);
+	}
 /******************************************************** Karsten Scheibler */
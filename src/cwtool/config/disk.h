@@ -16,12 +16,19 @@
 #include "types.h"
 
 struct config;
+struct disk;
 
 extern cw_bool_t
 config_disk(
 	struct config			*cfg,
 	cw_count_t			revision);
 
+extern cw_void_t
+config_disk_replaced(
+	struct config			*cfg,
+	struct disk			*dsk,
+	cw_count_t			revision);
+
 
 
 #endif /* !CWTOOL_CONFIG_DISK_H */
@@ -36,10 +36,12 @@
 
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
 #include "cwtool.h"
 #include "error.h"
@@ -53,6 +55,10 @@
 #include "drive.h"
 #include "file.h"
 #include "string.h"
+#include "stats.h"
+#include "event.h"
+#include "cache.h"
+#include "output.h"
 
 
 
@@ -90,7 +96,7 @@ cwtool_get_disk(
 	void)
 
 	{
-	struct disk			*dsk = disk_search(cmdline_get_disk_name());
+	struct disk			*dsk = config_disk_search(cmdline_get_disk_name());
 
 	if (dsk == NULL) error_message("unknown disk name '%s'", cmdline_get_disk_name());
 	return (dsk);
@@ -295,6 +301,102 @@ cwtool_statistics(
 
 
 
+/****************************************************************************
+ * cwtool_probe
+ ****************************************************************************/
+static void
+cwtool_probe(
+	void)
+
+	{
+	struct disk_probe		prb[GLOBAL_NR_DISKS];
+	char				line[3 * GLOBAL_MAX_PATH_SIZE];
+	int				i, probes;
+
+	/*
+	 * the sample tracks are read only once and decoded with every
+	 * defined disk, disks without any good sector are not listed
+	 */
+
+	cmdline_read_config();
+	if (options_get_always_initialize()) drive_init_all_devices();
+	probes = disk_probe(cmdline_get_file(0), prb, GLOBAL_NR_DISKS);
+	for (i = 0; (i < probes) && (prb[i].sum.sectors_good > 0); i++)
+		{
+		if (i == 0) printf("Matching disk names are:\n");
+		printf("%s\n", cwtool_get_line(line, sizeof (line), disk_get_name(prb[i].dsk), disk_get_info(prb[i].dsk)));
+		printf("    sectors: good %4d weak %4d bad %4d of %4d on %d tracks, clock %d, decoded in %.1f ms\n",
+			prb[i].sum.sectors_good, prb[i].sum.sectors_weak, prb[i].sum.sectors_bad,
+			prb[i].sectors, prb[i].sum.tracks, prb[i].clock, prb[i].decode_ns / 1e6);
+		}
+	if (i > 0) return;
+	printf("No matching disk name found\n");
+	exit_code = 1;
+	}
+
+
+
+/****************************************************************************
+ * cwtool_read_multiple
+ ****************************************************************************/
+static void
+cwtool_read_multiple(
+	void)
+
+	{
+	struct disk			*dsk[GLOBAL_NR_IMAGES];
+	cw_flag_t			flags = (cmdline_get_flag(CMDLINE_FLAG_DEFERRED)) ? DISK_OPTION_FLAG_DEFERRED : DISK_OPTION_FLAG_NONE;
+	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), flags);
+	char				prefix[GLOBAL_MAX_NAME_SIZE], *path_src;
+	pid_t				pid[GLOBAL_NR_IMAGES];
+	int				i, status, jobs = cmdline_get_jobs();
+
+	/*
+	 * config is read only once, the jobs get a copy of it with fork().
+	 * each job runs in its own process, so drives on different
+	 * controllers are read fully in parallel. drives on the same
+	 * controller take turns, because the driver locks the controller
+	 * only while a track is read or written
+	 */
+
+	if (cmdline_get_flag(CMDLINE_FLAG_RESUME)) dsk_opt.flags |= DISK_OPTION_FLAG_RESUME;
+	cmdline_read_config();
+	if (options_get_always_initialize()) drive_init_all_devices();
+	for (i = 0; i < jobs; i++)
+		{
+		dsk[i] = config_disk_search(cmdline_get_job_param(i, 0));
+		if (dsk[i] == NULL) error_message("unknown disk name '%s'", cmdline_get_job_param(i, 0));
+		}
+	fflush(stdout);
+	fflush(stderr);
+	for (i = 0; i < jobs; i++)
+		{
+		pid[i] = fork();
+		if (pid[i] == -1) error_perror_message("error while fork()");
+		if (pid[i] > 0) continue;
+
+		/* child: prefix all messages with the job number */
+
+		string_snprintf(prefix, sizeof (prefix), "job %d: ", i + 1);
+		global_set_prefix(prefix);
+		path_src = cmdline_get_job_param(i, 1);
+		disk_read(dsk[i], &dsk_opt, &path_src, 1, cmdline_get_job_param(i, 2), NULL, NULL);
+		exit(exit_code);
+		}
+
+	/* parent: wait for all jobs, any failed job makes exit code non zero */
+
+	for (i = 0; i < jobs; i++)
+		{
+		if (waitpid(pid[i], &status, 0) == -1) error_perror_message("error while waitpid()");
+		if ((WIFEXITED(status)) && (WEXITSTATUS(status) == 0)) continue;
+		if (! WIFEXITED(status)) error_warning("job %d (%s) terminated abnormally", i + 1, cmdline_get_job_param(i, 1));
+		exit_code = 1;
+		}
+	}
+
+
+
 /****************************************************************************
  * cwtool_read
  ****************************************************************************/
@@ -304,13 +406,43 @@ cwtool_read(
 
 	{
 	struct disk			*dsk;
-	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), DISK_OPTION_FLAG_NONE);
+	cw_flag_t			flags = (cmdline_get_flag(CMDLINE_FLAG_DEFERRED)) ? DISK_OPTION_FLAG_DEFERRED : DISK_OPTION_FLAG_NONE;
+	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), flags);
 	cw_count_t			files = cmdline_get_files();
 
+	if (cmdline_get_flag(CMDLINE_FLAG_MULTIPLE))
+		{
+		cwtool_read_multiple();
+		return;
+		}
+	if (cmdline_get_flag(CMDLINE_FLAG_RESUME)) dsk_opt.flags |= DISK_OPTION_FLAG_RESUME;
 	cmdline_read_config();
 	if (options_get_always_initialize()) drive_init_all_devices();
 	dsk = cwtool_get_disk();
-	disk_read(dsk, &dsk_opt, cmdline_get_all_files(), files - 1, cmdline_get_file(files - 1), cmdline_get_output());
+	disk_read(dsk, &dsk_opt, cmdline_get_all_files(), files - 1, cmdline_get_file(files - 1), cmdline_get_output(), cmdline_get_tee());
+	}
+
+
+
+/****************************************************************************
+ * cwtool_media_change
+ ****************************************************************************/
+static int
+cwtool_media_change(
+	char				**path,
+	int				count,
+	int				copy)
+
+	{
+	char				answer[GLOBAL_MAX_PATH_SIZE];
+	int				i;
+
+	fprintf(stderr, "insert disk for copy %d into", copy);
+	for (i = 0; i < count; i++) fprintf(stderr, " %s", path[i]);
+	fprintf(stderr, " and press return (q to quit) ");
+	if (fgets(answer, sizeof (answer), stdin) == NULL) return (0);
+	if ((answer[0] == 'q') || (answer[0] == 'Q')) return (0);
+	return (1);
 	}
 
 
@@ -326,11 +458,36 @@ cwtool_write(
 	struct disk			*dsk;
 	cw_flag_t			flags = (cmdline_get_flag(CMDLINE_FLAG_IGNORE_SIZE)) ? DISK_OPTION_FLAG_IGNORE_SIZE : DISK_OPTION_FLAG_NONE;
 	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, 0, flags);
+	cw_count_t			files = cmdline_get_files();
+	cw_count_t			copies = cmdline_get_copies();
 
 	cmdline_read_config();
 	if (options_get_always_initialize()) drive_init_all_devices();
 	dsk = cwtool_get_disk();
-	disk_write(dsk, &dsk_opt, cmdline_get_file(0), cmdline_get_file(1));
+	if ((files == 2) && (copies == 1) && (! cmdline_get_flag(CMDLINE_FLAG_VERIFY)))
+		{
+		disk_write(dsk, &dsk_opt, cmdline_get_file(0), cmdline_get_file(1));
+		return;
+		}
+
+	/* encode once and write it to all given destinations */
+
+	dsk_opt.change_func = cwtool_media_change;
+	if (cmdline_get_flag(CMDLINE_FLAG_VERIFY)) dsk_opt.flags |= DISK_OPTION_FLAG_VERIFY;
+	if (disk_duplicate(dsk, &dsk_opt, cmdline_get_file(0), &cmdline_get_all_files()[1], files - 1, copies) > 0) exit_code = 1;
+	}
+
+
+
+/****************************************************************************
+ * cwtool_convert
+ ****************************************************************************/
+static void
+cwtool_convert(
+	void)
+
+	{
+	output_convert(cmdline_get_file(0), cmdline_get_file(1));
 	}
 
 
@@ -351,6 +508,9 @@ main(
 	setlinebuf(stderr);
 	cmdline_parse(argv);
 	mode = cmdline_get_mode();
+	if (cmdline_get_stats() != NULL) stats_enable();
+	if (cmdline_get_events() != NULL) event_open(cmdline_get_events());
+	if (cmdline_get_cache() != NULL) cache_open(cmdline_get_cache());
 
 	/* decide what to do */
 
@@ -359,9 +519,14 @@ main(
 	else if (mode == CMDLINE_MODE_INITIALIZE) cwtool_initialize();
 	else if (mode == CMDLINE_MODE_LIST)       cwtool_list();
 	else if (mode == CMDLINE_MODE_STATISTICS) cwtool_statistics();
+	else if (mode == CMDLINE_MODE_PROBE)      cwtool_probe();
 	else if (mode == CMDLINE_MODE_READ)       cwtool_read();
 	else if (mode == CMDLINE_MODE_WRITE)      cwtool_write();
+	else if (mode == CMDLINE_MODE_CONVERT)    cwtool_convert();
 	else debug_error();
+	if (cmdline_get_stats() != NULL) stats_write(cmdline_get_stats());
+	event_close();
+	cache_close();
 
 	/* done */
 
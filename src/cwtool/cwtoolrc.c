@@ -0,0 +1,2763 @@
+"options\n"
+"\t{\n"
+"\talways_initialize yes\t\n"
+"\t}\n"
+"disk \"clear\"\n"
+"\t{\n"
+"\tinfo \"RAW, 14 MHz, 83 trks, 2 sides, CLEARS ALL TRACKS OF A DISK\"\n"
+"\tformat \"fill\"\n"
+"\tclock 14\n"
+"\ttimeout 230\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"pattern_14\"\n"
+"\t{\n"
+"\tinfo \"RAW, 14 MHz, 83 trks, 2 sides, CLEARS ALL TRACKS OF A DISK\"\n"
+"\tformat \"fill\"\n"
+"\tclock 14\n"
+"\ttimeout 420\n"
+"\tindexed yes\n"
+"\twrite mode 1\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"pattern_28\"\n"
+"\t{\n"
+"\tinfo \"RAW, 28 MHz, 83 trks, 2 sides, CLEARS ALL TRACKS OF A DISK\"\n"
+"\tformat \"fill\"\n"
+"\tclock 28\n"
+"\ttimeout 420\n"
+"\tindexed yes\n"
+"\twrite mode 1\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"pattern_56\"\n"
+"\t{\n"
+"\tinfo \"RAW, 56 MHz, 83 trks, 2 sides, CLEARS ALL TRACKS OF A DISK\"\n"
+"\tformat \"fill\"\n"
+"\tclock 56\n"
+"\ttimeout 420\n"
+"\tindexed yes\n"
+"\twrite mode 1\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"raw_14i\"\n"
+"\t{\n"
+"\tinfo \"RAW, 14 MHz, indexed, 83 trks, 2 sides\"\n"
+"\tformat \"raw\"\n"
+"\timage \"raw\"\n"
+"\tclock 14\n"
+"\ttimeout 420\n"
+"\tindexed yes\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"raw_28i\"\n"
+"\t{\n"
+"\tinfo \"RAW, 28 MHz, indexed, 83 trks, 2 sides\"\n"
+"\tformat \"raw\"\n"
+"\timage \"raw\"\n"
+"\tclock 28\n"
+"\ttimeout 420\n"
+"\tindexed yes\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"raw_56i\"\n"
+"\t{\n"
+"\tinfo \"RAW, 56 MHz, indexed, 83 trks, 2 sides\"\n"
+"\tformat \"raw\"\n"
+"\timage \"raw\"\n"
+"\tclock 56\n"
+"\ttimeout 420\n"
+"\tindexed yes\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"raw_14\"\n"
+"\t{\n"
+"\tinfo \"RAW, 14 MHz, 83 trks, 2 sides\"\n"
+"\tformat \"raw\"\n"
+"\timage \"raw\"\n"
+"\tclock 14\n"
+"\ttimeout 420\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"raw_28\"\n"
+"\t{\n"
+"\tinfo \"RAW, 28 MHz, 83 trks, 2 sides\"\n"
+"\tformat \"raw\"\n"
+"\timage \"raw\"\n"
+"\tclock 28\n"
+"\ttimeout 420\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"raw_56\"\n"
+"\t{\n"
+"\tinfo \"RAW, 56 MHz, 83 trks, 2 sides\"\n"
+"\tformat \"raw\"\n"
+"\timage \"raw\"\n"
+"\tclock 56\n"
+"\ttimeout 420\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"rawpack_14\"\n"
+"\t{\n"
+"\tinfo \"RAW, 14 MHz, 83 trks, 2 sides, packed image\"\n"
+"\tformat \"raw\"\n"
+"\timage \"rawpack\"\n"
+"\tclock 14\n"
+"\ttimeout 420\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"rawpack_28\"\n"
+"\t{\n"
+"\tinfo \"RAW, 28 MHz, 83 trks, 2 sides, packed image\"\n"
+"\tformat \"raw\"\n"
+"\timage \"rawpack\"\n"
+"\tclock 28\n"
+"\ttimeout 420\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"rawpack_56\"\n"
+"\t{\n"
+"\tinfo \"RAW, 56 MHz, 83 trks, 2 sides, packed image\"\n"
+"\tformat \"raw\"\n"
+"\timage \"rawpack\"\n"
+"\tclock 56\n"
+"\ttimeout 420\n"
+"\ttrack_range 0 165 1 optional yes\n"
+"\t}\n"
+"disk \"raw_dd\"\n"
+"\t{\n"
+"\tinfo \"same as raw_14\"\n"
+"\tcopy \"raw_14\"\n"
+"\t}\n"
+"disk \"raw_hd\"\n"
+"\t{\n"
+"\tinfo \"same as raw_28\"\n"
+"\tcopy \"raw_28\"\n"
+"\t}\n"
+"disk \"raw_ed\"\n"
+"\t{\n"
+"\tinfo \"same as raw_56\"\n"
+"\tcopy \"raw_56\"\n"
+"\t}\n"
+"trackmap \"c1541_d64\"\n"
+"\t{\n"
+"\ttrack 0 { image_track 0 format_track 1 }\n"
+"\ttrack 2 { }\n"
+"\ttrack 4 { image_track 1 format_track 2 }\n"
+"\ttrack 6 { }\n"
+"\ttrack 8 { image_track 2 format_track 3 }\n"
+"\ttrack 10 { }\n"
+"\ttrack 12 { image_track 3 format_track 4 }\n"
+"\ttrack 14 { }\n"
+"\ttrack 16 { image_track 4 format_track 5 }\n"
+"\ttrack 18 { }\n"
+"\ttrack 20 { image_track 5 format_track 6 }\n"
+"\ttrack 22 { }\n"
+"\ttrack 24 { image_track 6 format_track 7 }\n"
+"\ttrack 26 { }\n"
+"\ttrack 28 { image_track 7 format_track 8 }\n"
+"\ttrack 30 { }\n"
+"\ttrack 32 { image_track 8 format_track 9 }\n"
+"\ttrack 34 { }\n"
+"\ttrack 36 { image_track 9 format_track 10 }\n"
+"\ttrack 38 { }\n"
+"\ttrack 40 { image_track 10 format_track 11 }\n"
+"\ttrack 42 { }\n"
+"\ttrack 44 { image_track 11 format_track 12 }\n"
+"\ttrack 46 { }\n"
+"\ttrack 48 { image_track 12 format_track 13 }\n"
+"\ttrack 50 { }\n"
+"\ttrack 52 { image_track 13 format_track 14 }\n"
+"\ttrack 54 { }\n"
+"\ttrack 56 { image_track 14 format_track 15 }\n"
+"\ttrack 58 { }\n"
+"\ttrack 60 { image_track 15 format_track 16 }\n"
+"\ttrack 62 { }\n"
+"\ttrack 64 { image_track 16 format_track 17 }\n"
+"\ttrack 66 { }\n"
+"\ttrack 68 { image_track 17 format_track 18 }\n"
+"\ttrack 70 { }\n"
+"\ttrack 72 { image_track 18 format_track 19 }\n"
+"\ttrack 74 { }\n"
+"\ttrack 76 { image_track 19 format_track 20 }\n"
+"\ttrack 78 { }\n"
+"\ttrack 80 { image_track 20 format_track 21 }\n"
+"\ttrack 82 { }\n"
+"\ttrack 84 { image_track 21 format_track 22 }\n"
+"\ttrack 86 { }\n"
+"\ttrack 88 { image_track 22 format_track 23 }\n"
+"\ttrack 90 { }\n"
+"\ttrack 92 { image_track 23 format_track 24 }\n"
+"\ttrack 94 { }\n"
+"\ttrack 96 { image_track 24 format_track 25 }\n"
+"\ttrack 98 { }\n"
+"\ttrack 100 { image_track 25 format_track 26 }\n"
+"\ttrack 102 { }\n"
+"\ttrack 104 { image_track 26 format_track 27 }\n"
+"\ttrack 106 { }\n"
+"\ttrack 108 { image_track 27 format_track 28 }\n"
+"\ttrack 110 { }\n"
+"\ttrack 112 { image_track 28 format_track 29 }\n"
+"\ttrack 114 { }\n"
+"\ttrack 116 { image_track 29 format_track 30 }\n"
+"\ttrack 118 { }\n"
+"\ttrack 120 { image_track 30 format_track 31 }\n"
+"\ttrack 122 { }\n"
+"\ttrack 124 { image_track 31 format_track 32 }\n"
+"\ttrack 126 { }\n"
+"\ttrack 128 { image_track 32 format_track 33 }\n"
+"\ttrack 130 { }\n"
+"\ttrack 132 { image_track 33 format_track 34 }\n"
+"\ttrack 134 { }\n"
+"\ttrack 136 { image_track 34 format_track 35 }\n"
+"\ttrack 138 { }\n"
+"\ttrack 140 { image_track 35 format_track 36 }\n"
+"\ttrack 142 { }\n"
+"\ttrack 144 { image_track 36 format_track 37 }\n"
+"\ttrack 146 { }\n"
+"\ttrack 148 { image_track 37 format_track 38 }\n"
+"\ttrack 150 { }\n"
+"\ttrack 152 { image_track 38 format_track 39 }\n"
+"\ttrack 154 { }\n"
+"\ttrack 156 { image_track 39 format_track 40 }\n"
+"\ttrack 158 { }\n"
+"\ttrack 160 { image_track 40 format_track 41 }\n"
+"\ttrack 162 { }\n"
+"\ttrack 164 { image_track 41 format_track 42 }\n"
+"\ttrack 166 { }\n"
+"\t}\n"
+"trackmap \"c1541_g64\"\n"
+"\t{\n"
+"\ttrack 0 image_track 0\n"
+"\ttrack 2 image_track 1\n"
+"\ttrack 4 image_track 2\n"
+"\ttrack 6 image_track 3\n"
+"\ttrack 8 image_track 4\n"
+"\ttrack 10 image_track 5\n"
+"\ttrack 12 image_track 6\n"
+"\ttrack 14 image_track 7\n"
+"\ttrack 16 image_track 8\n"
+"\ttrack 18 image_track 9\n"
+"\ttrack 20 image_track 10\n"
+"\ttrack 22 image_track 11\n"
+"\ttrack 24 image_track 12\n"
+"\ttrack 26 image_track 13\n"
+"\ttrack 28 image_track 14\n"
+"\ttrack 30 image_track 15\n"
+"\ttrack 32 image_track 16\n"
+"\ttrack 34 image_track 17\n"
+"\ttrack 36 image_track 18\n"
+"\ttrack 38 image_track 19\n"
+"\ttrack 40 image_track 20\n"
+"\ttrack 42 image_track 21\n"
+"\ttrack 44 image_track 22\n"
+"\ttrack 46 image_track 23\n"
+"\ttrack 48 image_track 24\n"
+"\ttrack 50 image_track 25\n"
+"\ttrack 52 image_track 26\n"
+"\ttrack 54 image_track 27\n"
+"\ttrack 56 image_track 28\n"
+"\ttrack 58 image_track 29\n"
+"\ttrack 60 image_track 30\n"
+"\ttrack 62 image_track 31\n"
+"\ttrack 64 image_track 32\n"
+"\ttrack 66 image_track 33\n"
+"\ttrack 68 image_track 34\n"
+"\ttrack 70 image_track 35\n"
+"\ttrack 72 image_track 36\n"
+"\ttrack 74 image_track 37\n"
+"\ttrack 76 image_track 38\n"
+"\ttrack 78 image_track 39\n"
+"\ttrack 80 image_track 40\n"
+"\ttrack 82 image_track 41\n"
+"\ttrack 84 image_track 42\n"
+"\ttrack 86 image_track 43\n"
+"\ttrack 88 image_track 44\n"
+"\ttrack 90 image_track 45\n"
+"\ttrack 92 image_track 46\n"
+"\ttrack 94 image_track 47\n"
+"\ttrack 96 image_track 48\n"
+"\ttrack 98 image_track 49\n"
+"\ttrack 100 image_track 50\n"
+"\ttrack 102 image_track 51\n"
+"\ttrack 104 image_track 52\n"
+"\ttrack 106 image_track 53\n"
+"\ttrack 108 image_track 54\n"
+"\ttrack 110 image_track 55\n"
+"\ttrack 112 image_track 56\n"
+"\ttrack 114 image_track 57\n"
+"\ttrack 116 image_track 58\n"
+"\ttrack 118 image_track 59\n"
+"\ttrack 120 image_track 60\n"
+"\ttrack 122 image_track 61\n"
+"\ttrack 124 image_track 62\n"
+"\ttrack 126 image_track 63\n"
+"\ttrack 128 image_track 64\n"
+"\ttrack 130 image_track 65\n"
+"\ttrack 132 image_track 66\n"
+"\ttrack 134 image_track 67\n"
+"\ttrack 136 image_track 68\n"
+"\ttrack 138 image_track 69\n"
+"\ttrack 140 image_track 70\n"
+"\ttrack 142 image_track 71\n"
+"\ttrack 144 image_track 72\n"
+"\ttrack 146 image_track 73\n"
+"\ttrack 148 image_track 74\n"
+"\ttrack 150 image_track 75\n"
+"\ttrack 152 image_track 76\n"
+"\ttrack 154 image_track 77\n"
+"\ttrack 156 image_track 78\n"
+"\ttrack 158 image_track 79\n"
+"\ttrack 160 image_track 80\n"
+"\ttrack 162 image_track 81\n"
+"\ttrack 164 image_track 82\n"
+"\ttrack 166 image_track 83\n"
+"\t}\n"
+"disk \"c1541\"\n"
+"\t{\n"
+"\tinfo \"C1541, GCR, 5.25 inch, 35 trks, 1 side, 17-21 sec/trk, 170 K\"\n"
+"\ttrackmap \"c1541_d64\"\n"
+"\timage \"d64_noerror\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 138 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tformat \"gcr_cbm\"\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 180\n"
+"\t\tpostcomp_simple yes\n"
+"\t\tsync_length 10\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0f00 0x1200 0x1c00\n"
+"\t\t0x1d00 0x2500 0x2f00\n"
+"\t\t0x3000 0x3800 0x4800\n"
+"\t\t}\n"
+"\tsectors 21\n"
+"\ttrack_range 0 64 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1100 0x1400 0x1f00\n"
+"\t\t0x2000 0x2900 0x3400\n"
+"\t\t0x3500 0x3e00 0x5000\n"
+"\t\t}\n"
+"\tsectors 19\n"
+"\ttrack_range 68 92 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1200 0x1500 0x2000\n"
+"\t\t0x2100 0x2b00 0x3700\n"
+"\t\t0x3800 0x4100 0x5000\n"
+"\t\t}\n"
+"\tsectors 18\n"
+"\ttrack_range 96 116 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1300 0x1600 0x2200\n"
+"\t\t0x2300 0x2d00 0x3900\n"
+"\t\t0x3a00 0x4400 0x5000\n"
+"\t\t}\n"
+"\tsectors 17\n"
+"\ttrack_range 120 136 4 { }\n"
+"\t}\n"
+"disk \"c1541_40\"\n"
+"\t{\n"
+"\tinfo \"C1541, GCR, 5.25 inch, 40 trks, 1 side, 17-21 sec/trk, 192 K\"\n"
+"\tcopy \"c1541\"\n"
+"\ttrack_range 140 156 4 { }\n"
+"\ttrack_range 142 158 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1541_42\"\n"
+"\t{\n"
+"\tinfo \"C1541, GCR, 5.25 inch, 42 trks, 1 side, 17-21 sec/trk, 200 K\"\n"
+"\tcopy \"c1541\"\n"
+"\ttrack_range 140 164 4 { }\n"
+"\ttrack_range 142 166 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1541_d64\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541 plus error info\"\n"
+"\tcopy \"c1541\"\n"
+"\timage \"d64\"\n"
+"\t}\n"
+"disk \"c1541_40_d64\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_40 plus error info\"\n"
+"\tcopy \"c1541_40\"\n"
+"\timage \"d64\"\n"
+"\t}\n"
+"disk \"c1541_42_d64\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_42 plus error info\"\n"
+"\tcopy \"c1541_42\"\n"
+"\timage \"d64\"\n"
+"\t}\n"
+"disk \"c1541_g64\"\n"
+"\t{\n"
+"\tinfo \"C1541, RAW GCR, 5.25 inch, 35 trks, 1 side\"\n"
+"\ttrackmap \"c1541_g64\"\n"
+"\timage \"g64\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 138 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tformat \"gcr_g64\"\n"
+"\tstrip_track yes\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 180\n"
+"\t\talign_track yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\tsync_length 10\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprecomp3\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprecomp2\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprecomp1\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprecomp0\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\ttrack_range 0 64 4 read speed 3\n"
+"\ttrack_range 68 92 4 read speed 2\n"
+"\ttrack_range 96 116 4 read speed 1\n"
+"\ttrack_range 120 136 4 read speed 0\n"
+"\t}\n"
+"disk \"c1541_40_g64\"\n"
+"\t{\n"
+"\tinfo \"C1541, RAW GCR, 5.25 inch, 40 trks, 1 side\"\n"
+"\tcopy \"c1541_g64\"\n"
+"\ttrack_range 140 156 4 read speed 0\n"
+"\ttrack_range 142 158 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1541_42_g64\"\n"
+"\t{\n"
+"\tinfo \"C1541, RAW GCR, 5.25 inch, 42 trks, 1 side\"\n"
+"\tcopy \"c1541_g64\"\n"
+"\ttrack_range 140 164 4 read speed 0\n"
+"\ttrack_range 142 166 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1541_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541 but for 300 RPM drives\"\n"
+"\ttrackmap \"c1541_d64\"\n"
+"\timage \"d64_noerror\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 138 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tformat \"gcr_cbm\"\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\tsync_length 10\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 400\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1300 0x1600 0x2200\n"
+"\t\t0x2300 0x2d00 0x3800\n"
+"\t\t0x3900 0x4300 0x5000\n"
+"\t\t}\n"
+"\tsectors 21\n"
+"\ttrack_range 0 64 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1400 0x1800 0x2500\n"
+"\t\t0x2600 0x3100 0x3e00\n"
+"\t\t0x3f00 0x4b00 0x6000\n"
+"\t\t}\n"
+"\tsectors 19\n"
+"\ttrack_range 68 92 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1500 0x1900 0x2600\n"
+"\t\t0x2700 0x3400 0x4200\n"
+"\t\t0x4300 0x4e00 0x6000\n"
+"\t\t}\n"
+"\tsectors 18\n"
+"\ttrack_range 96 116 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1700 0x1b00 0x2900\n"
+"\t\t0x2a00 0x3600 0x4400\n"
+"\t\t0x4500 0x5200 0x6000\n"
+"\t\t}\n"
+"\tsectors 17\n"
+"\ttrack_range 120 136 4 { }\n"
+"\t}\n"
+"disk \"c1541_40_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_40 but for 300 RPM drives\"\n"
+"\tcopy \"c1541_300\"\n"
+"\ttrack_range 140 156 4 { }\n"
+"\ttrack_range 142 158 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1541_42_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_42 but for 300 RPM drives\"\n"
+"\tcopy \"c1541_300\"\n"
+"\ttrack_range 140 164 4 { }\n"
+"\ttrack_range 142 166 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1541_d64_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_d64 but for 300 RPM drives\"\n"
+"\tcopy \"c1541_300\"\n"
+"\timage \"d64\"\n"
+"\t}\n"
+"disk \"c1541_40_d64_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_40_d64 but for 300 RPM drives\"\n"
+"\tcopy \"c1541_40_300\"\n"
+"\timage \"d64\"\n"
+"\t}\n"
+"disk \"c1541_42_d64_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_42_d64 but for 300 RPM drives\"\n"
+"\tcopy \"c1541_42_300\"\n"
+"\timage \"d64\"\n"
+"\t}\n"
+"disk \"c1541_g64_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_g64 but for 300 RPM drives\"\n"
+"\ttrackmap \"c1541_g64\"\n"
+"\timage \"g64\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 138 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tformat \"gcr_g64\"\n"
+"\tstrip_track yes\n"
+"\tbounds3_new\n"
+"\t\t{\n"
+"\t\t0x1300 0x1600 0x2200\n"
+"\t\t0x2300 0x2d00 0x3800\n"
+"\t\t0x3900 0x4300 0x5000\n"
+"\t\t}\n"
+"\tbounds2_new\n"
+"\t\t{\n"
+"\t\t0x1400 0x1800 0x2500\n"
+"\t\t0x2600 0x3100 0x3e00\n"
+"\t\t0x3f00 0x4b00 0x6000\n"
+"\t\t}\n"
+"\tbounds1_new\n"
+"\t\t{\n"
+"\t\t0x1500 0x1900 0x2600\n"
+"\t\t0x2700 0x3400 0x4200\n"
+"\t\t0x4300 0x4e00 0x6000\n"
+"\t\t}\n"
+"\tbounds0_new\n"
+"\t\t{\n"
+"\t\t0x1700 0x1b00 0x2900\n"
+"\t\t0x2a00 0x3600 0x4400\n"
+"\t\t0x4500 0x5200 0x6000\n"
+"\t\t}\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\talign_track yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\tsync_length 10\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 400\n"
+"\t\tprecomp3\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprecomp2\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprecomp1\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprecomp0\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\ttrack_range 0 64 4 read speed 3\n"
+"\ttrack_range 68 92 4 read speed 2\n"
+"\ttrack_range 96 116 4 read speed 1\n"
+"\ttrack_range 120 136 4 read speed 0\n"
+"\t}\n"
+"disk \"c1541_40_g64_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_40_g64 but for 300 RPM drives\"\n"
+"\tcopy \"c1541_g64_300\"\n"
+"\ttrack_range 140 156 4 read speed 0\n"
+"\ttrack_range 142 158 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1541_42_g64_300\"\n"
+"\t{\n"
+"\tinfo \"C1541, same as c1541_42_g64 but for 300 RPM drives\"\n"
+"\tcopy \"c1541_g64_300\"\n"
+"\ttrack_range 140 164 4 read speed 0\n"
+"\ttrack_range 142 166 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"trackmap \"c1571_d64\"\n"
+"\t{\n"
+"\ttrack 0 { image_track 0 format_track 1 }\n"
+"\ttrack 2 { }\n"
+"\ttrack 4 { image_track 1 format_track 2 }\n"
+"\ttrack 6 { }\n"
+"\ttrack 8 { image_track 2 format_track 3 }\n"
+"\ttrack 10 { }\n"
+"\ttrack 12 { image_track 3 format_track 4 }\n"
+"\ttrack 14 { }\n"
+"\ttrack 16 { image_track 4 format_track 5 }\n"
+"\ttrack 18 { }\n"
+"\ttrack 20 { image_track 5 format_track 6 }\n"
+"\ttrack 22 { }\n"
+"\ttrack 24 { image_track 6 format_track 7 }\n"
+"\ttrack 26 { }\n"
+"\ttrack 28 { image_track 7 format_track 8 }\n"
+"\ttrack 30 { }\n"
+"\ttrack 32 { image_track 8 format_track 9 }\n"
+"\ttrack 34 { }\n"
+"\ttrack 36 { image_track 9 format_track 10 }\n"
+"\ttrack 38 { }\n"
+"\ttrack 40 { image_track 10 format_track 11 }\n"
+"\ttrack 42 { }\n"
+"\ttrack 44 { image_track 11 format_track 12 }\n"
+"\ttrack 46 { }\n"
+"\ttrack 48 { image_track 12 format_track 13 }\n"
+"\ttrack 50 { }\n"
+"\ttrack 52 { image_track 13 format_track 14 }\n"
+"\ttrack 54 { }\n"
+"\ttrack 56 { image_track 14 format_track 15 }\n"
+"\ttrack 58 { }\n"
+"\ttrack 60 { image_track 15 format_track 16 }\n"
+"\ttrack 62 { }\n"
+"\ttrack 64 { image_track 16 format_track 17 }\n"
+"\ttrack 66 { }\n"
+"\ttrack 68 { image_track 17 format_track 18 }\n"
+"\ttrack 70 { }\n"
+"\ttrack 72 { image_track 18 format_track 19 }\n"
+"\ttrack 74 { }\n"
+"\ttrack 76 { image_track 19 format_track 20 }\n"
+"\ttrack 78 { }\n"
+"\ttrack 80 { image_track 20 format_track 21 }\n"
+"\ttrack 82 { }\n"
+"\ttrack 84 { image_track 21 format_track 22 }\n"
+"\ttrack 86 { }\n"
+"\ttrack 88 { image_track 22 format_track 23 }\n"
+"\ttrack 90 { }\n"
+"\ttrack 92 { image_track 23 format_track 24 }\n"
+"\ttrack 94 { }\n"
+"\ttrack 96 { image_track 24 format_track 25 }\n"
+"\ttrack 98 { }\n"
+"\ttrack 100 { image_track 25 format_track 26 }\n"
+"\ttrack 102 { }\n"
+"\ttrack 104 { image_track 26 format_track 27 }\n"
+"\ttrack 106 { }\n"
+"\ttrack 108 { image_track 27 format_track 28 }\n"
+"\ttrack 110 { }\n"
+"\ttrack 112 { image_track 28 format_track 29 }\n"
+"\ttrack 114 { }\n"
+"\ttrack 116 { image_track 29 format_track 30 }\n"
+"\ttrack 118 { }\n"
+"\ttrack 120 { image_track 30 format_track 31 }\n"
+"\ttrack 122 { }\n"
+"\ttrack 124 { image_track 31 format_track 32 }\n"
+"\ttrack 126 { }\n"
+"\ttrack 128 { image_track 32 format_track 33 }\n"
+"\ttrack 130 { }\n"
+"\ttrack 132 { image_track 33 format_track 34 }\n"
+"\ttrack 134 { }\n"
+"\ttrack 136 { image_track 34 format_track 35 }\n"
+"\ttrack 138 { }\n"
+"\ttrack 1 { image_track 35 format_track 36 }\n"
+"\ttrack 3 { }\n"
+"\ttrack 5 { image_track 36 format_track 37 }\n"
+"\ttrack 7 { }\n"
+"\ttrack 9 { image_track 37 format_track 38 }\n"
+"\ttrack 11 { }\n"
+"\ttrack 13 { image_track 38 format_track 39 }\n"
+"\ttrack 15 { }\n"
+"\ttrack 17 { image_track 39 format_track 40 }\n"
+"\ttrack 19 { }\n"
+"\ttrack 21 { image_track 40 format_track 41 }\n"
+"\ttrack 23 { }\n"
+"\ttrack 25 { image_track 41 format_track 42 }\n"
+"\ttrack 27 { }\n"
+"\ttrack 29 { image_track 42 format_track 43 }\n"
+"\ttrack 31 { }\n"
+"\ttrack 33 { image_track 43 format_track 44 }\n"
+"\ttrack 35 { }\n"
+"\ttrack 37 { image_track 44 format_track 45 }\n"
+"\ttrack 39 { }\n"
+"\ttrack 41 { image_track 45 format_track 46 }\n"
+"\ttrack 43 { }\n"
+"\ttrack 45 { image_track 46 format_track 47 }\n"
+"\ttrack 47 { }\n"
+"\ttrack 49 { image_track 47 format_track 48 }\n"
+"\ttrack 51 { }\n"
+"\ttrack 53 { image_track 48 format_track 49 }\n"
+"\ttrack 55 { }\n"
+"\ttrack 57 { image_track 49 format_track 50 }\n"
+"\ttrack 59 { }\n"
+"\ttrack 61 { image_track 50 format_track 51 }\n"
+"\ttrack 63 { }\n"
+"\ttrack 65 { image_track 51 format_track 52 }\n"
+"\ttrack 67 { }\n"
+"\ttrack 69 { image_track 52 format_track 53 }\n"
+"\ttrack 71 { }\n"
+"\ttrack 73 { image_track 53 format_track 54 }\n"
+"\ttrack 75 { }\n"
+"\ttrack 77 { image_track 54 format_track 55 }\n"
+"\ttrack 79 { }\n"
+"\ttrack 81 { image_track 55 format_track 56 }\n"
+"\ttrack 83 { }\n"
+"\ttrack 85 { image_track 56 format_track 57 }\n"
+"\ttrack 87 { }\n"
+"\ttrack 89 { image_track 57 format_track 58 }\n"
+"\ttrack 91 { }\n"
+"\ttrack 93 { image_track 58 format_track 59 }\n"
+"\ttrack 95 { }\n"
+"\ttrack 97 { image_track 59 format_track 60 }\n"
+"\ttrack 99 { }\n"
+"\ttrack 101 { image_track 60 format_track 61 }\n"
+"\ttrack 103 { }\n"
+"\ttrack 105 { image_track 61 format_track 62 }\n"
+"\ttrack 107 { }\n"
+"\ttrack 109 { image_track 62 format_track 63 }\n"
+"\ttrack 111 { }\n"
+"\ttrack 113 { image_track 63 format_track 64 }\n"
+"\ttrack 115 { }\n"
+"\ttrack 117 { image_track 64 format_track 65 }\n"
+"\ttrack 119 { }\n"
+"\ttrack 121 { image_track 65 format_track 66 }\n"
+"\ttrack 123 { }\n"
+"\ttrack 125 { image_track 66 format_track 67 }\n"
+"\ttrack 127 { }\n"
+"\ttrack 129 { image_track 67 format_track 68 }\n"
+"\ttrack 131 { }\n"
+"\ttrack 133 { image_track 68 format_track 69 }\n"
+"\ttrack 135 { }\n"
+"\ttrack 137 { image_track 69 format_track 70 }\n"
+"\ttrack 139 { }\n"
+"\t}\n"
+"trackmap \"c1571_40_d64\"\n"
+"\t{\n"
+"\ttrack 0 { image_track 0 format_track 1 }\n"
+"\ttrack 2 { }\n"
+"\ttrack 4 { image_track 1 format_track 2 }\n"
+"\ttrack 6 { }\n"
+"\ttrack 8 { image_track 2 format_track 3 }\n"
+"\ttrack 10 { }\n"
+"\ttrack 12 { image_track 3 format_track 4 }\n"
+"\ttrack 14 { }\n"
+"\ttrack 16 { image_track 4 format_track 5 }\n"
+"\ttrack 18 { }\n"
+"\ttrack 20 { image_track 5 format_track 6 }\n"
+"\ttrack 22 { }\n"
+"\ttrack 24 { image_track 6 format_track 7 }\n"
+"\ttrack 26 { }\n"
+"\ttrack 28 { image_track 7 format_track 8 }\n"
+"\ttrack 30 { }\n"
+"\ttrack 32 { image_track 8 format_track 9 }\n"
+"\ttrack 34 { }\n"
+"\ttrack 36 { image_track 9 format_track 10 }\n"
+"\ttrack 38 { }\n"
+"\ttrack 40 { image_track 10 format_track 11 }\n"
+"\ttrack 42 { }\n"
+"\ttrack 44 { image_track 11 format_track 12 }\n"
+"\ttrack 46 { }\n"
+"\ttrack 48 { image_track 12 format_track 13 }\n"
+"\ttrack 50 { }\n"
+"\ttrack 52 { image_track 13 format_track 14 }\n"
+"\ttrack 54 { }\n"
+"\ttrack 56 { image_track 14 format_track 15 }\n"
+"\ttrack 58 { }\n"
+"\ttrack 60 { image_track 15 format_track 16 }\n"
+"\ttrack 62 { }\n"
+"\ttrack 64 { image_track 16 format_track 17 }\n"
+"\ttrack 66 { }\n"
+"\ttrack 68 { image_track 17 format_track 18 }\n"
+"\ttrack 70 { }\n"
+"\ttrack 72 { image_track 18 format_track 19 }\n"
+"\ttrack 74 { }\n"
+"\ttrack 76 { image_track 19 format_track 20 }\n"
+"\ttrack 78 { }\n"
+"\ttrack 80 { image_track 20 format_track 21 }\n"
+"\ttrack 82 { }\n"
+"\ttrack 84 { image_track 21 format_track 22 }\n"
+"\ttrack 86 { }\n"
+"\ttrack 88 { image_track 22 format_track 23 }\n"
+"\ttrack 90 { }\n"
+"\ttrack 92 { image_track 23 format_track 24 }\n"
+"\ttrack 94 { }\n"
+"\ttrack 96 { image_track 24 format_track 25 }\n"
+"\ttrack 98 { }\n"
+"\ttrack 100 { image_track 25 format_track 26 }\n"
+"\ttrack 102 { }\n"
+"\ttrack 104 { image_track 26 format_track 27 }\n"
+"\ttrack 106 { }\n"
+"\ttrack 108 { image_track 27 format_track 28 }\n"
+"\ttrack 110 { }\n"
+"\ttrack 112 { image_track 28 format_track 29 }\n"
+"\ttrack 114 { }\n"
+"\ttrack 116 { image_track 29 format_track 30 }\n"
+"\ttrack 118 { }\n"
+"\ttrack 120 { image_track 30 format_track 31 }\n"
+"\ttrack 122 { }\n"
+"\ttrack 124 { image_track 31 format_track 32 }\n"
+"\ttrack 126 { }\n"
+"\ttrack 128 { image_track 32 format_track 33 }\n"
+"\ttrack 130 { }\n"
+"\ttrack 132 { image_track 33 format_track 34 }\n"
+"\ttrack 134 { }\n"
+"\ttrack 136 { image_track 34 format_track 35 }\n"
+"\ttrack 138 { }\n"
+"\ttrack 140 { image_track 35 format_track 36 }\n"
+"\ttrack 142 { }\n"
+"\ttrack 144 { image_track 36 format_track 37 }\n"
+"\ttrack 146 { }\n"
+"\ttrack 148 { image_track 37 format_track 38 }\n"
+"\ttrack 150 { }\n"
+"\ttrack 152 { image_track 38 format_track 39 }\n"
+"\ttrack 154 { }\n"
+"\ttrack 156 { image_track 39 format_track 40 }\n"
+"\ttrack 158 { }\n"
+"\ttrack 1 { image_track 40 format_track 41 }\n"
+"\ttrack 3 { }\n"
+"\ttrack 5 { image_track 41 format_track 42 }\n"
+"\ttrack 7 { }\n"
+"\ttrack 9 { image_track 42 format_track 43 }\n"
+"\ttrack 11 { }\n"
+"\ttrack 13 { image_track 43 format_track 44 }\n"
+"\ttrack 15 { }\n"
+"\ttrack 17 { image_track 44 format_track 45 }\n"
+"\ttrack 19 { }\n"
+"\ttrack 21 { image_track 45 format_track 46 }\n"
+"\ttrack 23 { }\n"
+"\ttrack 25 { image_track 46 format_track 47 }\n"
+"\ttrack 27 { }\n"
+"\ttrack 29 { image_track 47 format_track 48 }\n"
+"\ttrack 31 { }\n"
+"\ttrack 33 { image_track 48 format_track 49 }\n"
+"\ttrack 35 { }\n"
+"\ttrack 37 { image_track 49 format_track 50 }\n"
+"\ttrack 39 { }\n"
+"\ttrack 41 { image_track 50 format_track 51 }\n"
+"\ttrack 43 { }\n"
+"\ttrack 45 { image_track 51 format_track 52 }\n"
+"\ttrack 47 { }\n"
+"\ttrack 49 { image_track 52 format_track 53 }\n"
+"\ttrack 51 { }\n"
+"\ttrack 53 { image_track 53 format_track 54 }\n"
+"\ttrack 55 { }\n"
+"\ttrack 57 { image_track 54 format_track 55 }\n"
+"\ttrack 59 { }\n"
+"\ttrack 61 { image_track 55 format_track 56 }\n"
+"\ttrack 63 { }\n"
+"\ttrack 65 { image_track 56 format_track 57 }\n"
+"\ttrack 67 { }\n"
+"\ttrack 69 { image_track 57 format_track 58 }\n"
+"\ttrack 71 { }\n"
+"\ttrack 73 { image_track 58 format_track 59 }\n"
+"\ttrack 75 { }\n"
+"\ttrack 77 { image_track 59 format_track 60 }\n"
+"\ttrack 79 { }\n"
+"\ttrack 81 { image_track 60 format_track 61 }\n"
+"\ttrack 83 { }\n"
+"\ttrack 85 { image_track 61 format_track 62 }\n"
+"\ttrack 87 { }\n"
+"\ttrack 89 { image_track 62 format_track 63 }\n"
+"\ttrack 91 { }\n"
+"\ttrack 93 { image_track 63 format_track 64 }\n"
+"\ttrack 95 { }\n"
+"\ttrack 97 { image_track 64 format_track 65 }\n"
+"\ttrack 99 { }\n"
+"\ttrack 101 { image_track 65 format_track 66 }\n"
+"\ttrack 103 { }\n"
+"\ttrack 105 { image_track 66 format_track 67 }\n"
+"\ttrack 107 { }\n"
+"\ttrack 109 { image_track 67 format_track 68 }\n"
+"\ttrack 111 { }\n"
+"\ttrack 113 { image_track 68 format_track 69 }\n"
+"\ttrack 115 { }\n"
+"\ttrack 117 { image_track 69 format_track 70 }\n"
+"\ttrack 119 { }\n"
+"\ttrack 121 { image_track 70 format_track 71 }\n"
+"\ttrack 123 { }\n"
+"\ttrack 125 { image_track 71 format_track 72 }\n"
+"\ttrack 127 { }\n"
+"\ttrack 129 { image_track 72 format_track 73 }\n"
+"\ttrack 131 { }\n"
+"\ttrack 133 { image_track 73 format_track 74 }\n"
+"\ttrack 135 { }\n"
+"\ttrack 137 { image_track 74 format_track 75 }\n"
+"\ttrack 139 { }\n"
+"\ttrack 141 { image_track 75 format_track 76 }\n"
+"\ttrack 143 { }\n"
+"\ttrack 145 { image_track 76 format_track 77 }\n"
+"\ttrack 147 { }\n"
+"\ttrack 149 { image_track 77 format_track 78 }\n"
+"\ttrack 151 { }\n"
+"\ttrack 153 { image_track 78 format_track 79 }\n"
+"\ttrack 155 { }\n"
+"\ttrack 157 { image_track 79 format_track 80 }\n"
+"\ttrack 159 { }\n"
+"\t}\n"
+"disk \"c1571\"\n"
+"\t{\n"
+"\tinfo \"C1571, GCR, 5.25 inch, 35 trks, 2 sides, 17-21 sec/trk, 341 K\"\n"
+"\ttrackmap \"c1571_d64\"\n"
+"\timage \"d64_noerror\"\n"
+"\tclock 14\n"
+"\tformat \"fill\"\n"
+"\toptional yes\n"
+"\twrite fill_length 16384\n"
+"\ttrack_range 2 138 4 { }\n"
+"\ttrack_range 3 139 4 { }\n"
+"\tformat \"gcr_cbm\"\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 180\n"
+"\t\tpostcomp_simple yes\n"
+"\t\tsync_length 10\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0f00 0x1200 0x1c00\n"
+"\t\t0x1d00 0x2500 0x2f00\n"
+"\t\t0x3000 0x3800 0x4800\n"
+"\t\t}\n"
+"\tsectors 21\n"
+"\ttrack_range 0 64 4 { }\n"
+"\ttrack_range 1 65 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1100 0x1400 0x1f00\n"
+"\t\t0x2000 0x2900 0x3400\n"
+"\t\t0x3500 0x3e00 0x5000\n"
+"\t\t}\n"
+"\tsectors 19\n"
+"\ttrack_range 68 92 4 { }\n"
+"\ttrack_range 69 93 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1200 0x1500 0x2000\n"
+"\t\t0x2100 0x2b00 0x3700\n"
+"\t\t0x3800 0x4100 0x5000\n"
+"\t\t}\n"
+"\tsectors 18\n"
+"\ttrack_range 96 116 4 { }\n"
+"\ttrack_range 97 117 4 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1300 0x1600 0x2200\n"
+"\t\t0x2300 0x2d00 0x3900\n"
+"\t\t0x3a00 0x4400 0x5000\n"
+"\t\t}\n"
+"\tsectors 17\n"
+"\ttrack_range 120 136 4 { }\n"
+"\ttrack_range 121 137 4 { }\n"
+"\t}\n"
+"disk \"c1571_40\"\n"
+"\t{\n"
+"\tinfo \"C1571, GCR, 5.25 inch, 40 trks, 2 sides, 17-21 sec/trk, 384 K\"\n"
+"\tcopy \"c1571\"\n"
+"\ttrackmap \"c1571_40_d64\"\n"
+"\ttrack_range 140 156 4 { }\n"
+"\ttrack_range 141 157 4 { }\n"
+"\tformat \"fill\"\n"
+"\toptional yes\n"
+"\twrite fill_length 16384\n"
+"\ttrack_range 142 158 4 { }\n"
+"\ttrack_range 143 159 4 { }\n"
+"\t}\n"
+"disk \"c1581_dsdd\"\n"
+"\t{\n"
+"\tinfo \"C1581, MFM, 3.5  inch, 80 trks, 2 sides, *** UNTESTED ***\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 14\n"
+"\tsectors 10\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\tflip_side yes\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"c1581_dd\"\n"
+"\t{\n"
+"\tinfo \"same as c1581_dsdd\"\n"
+"\tcopy \"c1581_dsdd\"\n"
+"\t}\n"
+"disk \"amiga_dsdd_5.25\"\n"
+"\t{\n"
+"\tinfo \"Amiga, MFM, 5.25 inch, 80 trks, 2 sides, 11 sec/trk, 880 K\"\n"
+"\tformat \"mfm_amiga\"\n"
+"\tclock 14\n"
+"\tsectors 11\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 190\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1100 0x15c4 0x1c00\n"
+"\t\t0x1d00 0x2192 0x2700\n"
+"\t\t0x2800 0x2d5e 0x4000\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprolog_length 1024\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"amiga_dsdd\"\n"
+"\t{\n"
+"\tinfo \"Amiga, MFM, 3.5  inch, 80 trks, 2 sides, 11 sec/trk, 880 K\"\n"
+"\tformat \"mfm_amiga\"\n"
+"\tclock 14\n"
+"\tsectors 11\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprolog_length 1024\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"amiga_dshd\"\n"
+"\t{\n"
+"\tinfo \"Amiga, MFM, 3.5  inch, 80 trks, 2 sides, 22 sec/trk, 1660 K\"\n"
+"\tformat \"mfm_amiga\"\n"
+"\tclock 28\n"
+"\tsectors 22\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprolog_length 2048\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"amiga_dd_5.25\"\n"
+"\t{\n"
+"\tinfo \"same as amiga_dsdd_5.25\"\n"
+"\tcopy \"amiga_dsdd_5.25\"\n"
+"\t}\n"
+"disk \"amiga_dd\"\n"
+"\t{\n"
+"\tinfo \"same as amiga_dsdd\"\n"
+"\tcopy \"amiga_dsdd\"\n"
+"\t}\n"
+"disk \"amiga_hd\"\n"
+"\t{\n"
+"\tinfo \"same as amiga_dshd\"\n"
+"\tcopy \"amiga_dshd\"\n"
+"\t}\n"
+"trackmap \"msdos_40_plain\"\n"
+"\t{\n"
+"\ttrack 0 { image_track 0 format_track 0 format_side 0 }\n"
+"\ttrack 1 { image_track 1 format_track 0 format_side 1 }\n"
+"\ttrack 2 { }\n"
+"\ttrack 3 { }\n"
+"\ttrack 4 { image_track 2 format_track 1 format_side 0 }\n"
+"\ttrack 5 { image_track 3 format_track 1 format_side 1 }\n"
+"\ttrack 6 { }\n"
+"\ttrack 7 { }\n"
+"\ttrack 8 { image_track 4 format_track 2 format_side 0 }\n"
+"\ttrack 9 { image_track 5 format_track 2 format_side 1 }\n"
+"\ttrack 10 { }\n"
+"\ttrack 11 { }\n"
+"\ttrack 12 { image_track 6 format_track 3 format_side 0 }\n"
+"\ttrack 13 { image_track 7 format_track 3 format_side 1 }\n"
+"\ttrack 14 { }\n"
+"\ttrack 15 { }\n"
+"\ttrack 16 { image_track 8 format_track 4 format_side 0 }\n"
+"\ttrack 17 { image_track 9 format_track 4 format_side 1 }\n"
+"\ttrack 18 { }\n"
+"\ttrack 19 { }\n"
+"\ttrack 20 { image_track 10 format_track 5 format_side 0 }\n"
+"\ttrack 21 { image_track 11 format_track 5 format_side 1 }\n"
+"\ttrack 22 { }\n"
+"\ttrack 23 { }\n"
+"\ttrack 24 { image_track 12 format_track 6 format_side 0 }\n"
+"\ttrack 25 { image_track 13 format_track 6 format_side 1 }\n"
+"\ttrack 26 { }\n"
+"\ttrack 27 { }\n"
+"\ttrack 28 { image_track 14 format_track 7 format_side 0 }\n"
+"\ttrack 29 { image_track 15 format_track 7 format_side 1 }\n"
+"\ttrack 30 { }\n"
+"\ttrack 31 { }\n"
+"\ttrack 32 { image_track 16 format_track 8 format_side 0 }\n"
+"\ttrack 33 { image_track 17 format_track 8 format_side 1 }\n"
+"\ttrack 34 { }\n"
+"\ttrack 35 { }\n"
+"\ttrack 36 { image_track 18 format_track 9 format_side 0 }\n"
+"\ttrack 37 { image_track 19 format_track 9 format_side 1 }\n"
+"\ttrack 38 { }\n"
+"\ttrack 39 { }\n"
+"\ttrack 40 { image_track 20 format_track 10 format_side 0 }\n"
+"\ttrack 41 { image_track 21 format_track 10 format_side 1 }\n"
+"\ttrack 42 { }\n"
+"\ttrack 43 { }\n"
+"\ttrack 44 { image_track 22 format_track 11 format_side 0 }\n"
+"\ttrack 45 { image_track 23 format_track 11 format_side 1 }\n"
+"\ttrack 46 { }\n"
+"\ttrack 47 { }\n"
+"\ttrack 48 { image_track 24 format_track 12 format_side 0 }\n"
+"\ttrack 49 { image_track 25 format_track 12 format_side 1 }\n"
+"\ttrack 50 { }\n"
+"\ttrack 51 { }\n"
+"\ttrack 52 { image_track 26 format_track 13 format_side 0 }\n"
+"\ttrack 53 { image_track 27 format_track 13 format_side 1 }\n"
+"\ttrack 54 { }\n"
+"\ttrack 55 { }\n"
+"\ttrack 56 { image_track 28 format_track 14 format_side 0 }\n"
+"\ttrack 57 { image_track 29 format_track 14 format_side 1 }\n"
+"\ttrack 58 { }\n"
+"\ttrack 59 { }\n"
+"\ttrack 60 { image_track 30 format_track 15 format_side 0 }\n"
+"\ttrack 61 { image_track 31 format_track 15 format_side 1 }\n"
+"\ttrack 62 { }\n"
+"\ttrack 63 { }\n"
+"\ttrack 64 { image_track 32 format_track 16 format_side 0 }\n"
+"\ttrack 65 { image_track 33 format_track 16 format_side 1 }\n"
+"\ttrack 66 { }\n"
+"\ttrack 67 { }\n"
+"\ttrack 68 { image_track 34 format_track 17 format_side 0 }\n"
+"\ttrack 69 { image_track 35 format_track 17 format_side 1 }\n"
+"\ttrack 70 { }\n"
+"\ttrack 71 { }\n"
+"\ttrack 72 { image_track 36 format_track 18 format_side 0 }\n"
+"\ttrack 73 { image_track 37 format_track 18 format_side 1 }\n"
+"\ttrack 74 { }\n"
+"\ttrack 75 { }\n"
+"\ttrack 76 { image_track 38 format_track 19 format_side 0 }\n"
+"\ttrack 77 { image_track 39 format_track 19 format_side 1 }\n"
+"\ttrack 78 { }\n"
+"\ttrack 79 { }\n"
+"\ttrack 80 { image_track 40 format_track 20 format_side 0 }\n"
+"\ttrack 81 { image_track 41 format_track 20 format_side 1 }\n"
+"\ttrack 82 { }\n"
+"\ttrack 83 { }\n"
+"\ttrack 84 { image_track 42 format_track 21 format_side 0 }\n"
+"\ttrack 85 { image_track 43 format_track 21 format_side 1 }\n"
+"\ttrack 86 { }\n"
+"\ttrack 87 { }\n"
+"\ttrack 88 { image_track 44 format_track 22 format_side 0 }\n"
+"\ttrack 89 { image_track 45 format_track 22 format_side 1 }\n"
+"\ttrack 90 { }\n"
+"\ttrack 91 { }\n"
+"\ttrack 92 { image_track 46 format_track 23 format_side 0 }\n"
+"\ttrack 93 { image_track 47 format_track 23 format_side 1 }\n"
+"\ttrack 94 { }\n"
+"\ttrack 95 { }\n"
+"\ttrack 96 { image_track 48 format_track 24 format_side 0 }\n"
+"\ttrack 97 { image_track 49 format_track 24 format_side 1 }\n"
+"\ttrack 98 { }\n"
+"\ttrack 99 { }\n"
+"\ttrack 100 { image_track 50 format_track 25 format_side 0 }\n"
+"\ttrack 101 { image_track 51 format_track 25 format_side 1 }\n"
+"\ttrack 102 { }\n"
+"\ttrack 103 { }\n"
+"\ttrack 104 { image_track 52 format_track 26 format_side 0 }\n"
+"\ttrack 105 { image_track 53 format_track 26 format_side 1 }\n"
+"\ttrack 106 { }\n"
+"\ttrack 107 { }\n"
+"\ttrack 108 { image_track 54 format_track 27 format_side 0 }\n"
+"\ttrack 109 { image_track 55 format_track 27 format_side 1 }\n"
+"\ttrack 110 { }\n"
+"\ttrack 111 { }\n"
+"\ttrack 112 { image_track 56 format_track 28 format_side 0 }\n"
+"\ttrack 113 { image_track 57 format_track 28 format_side 1 }\n"
+"\ttrack 114 { }\n"
+"\ttrack 115 { }\n"
+"\ttrack 116 { image_track 58 format_track 29 format_side 0 }\n"
+"\ttrack 117 { image_track 59 format_track 29 format_side 1 }\n"
+"\ttrack 118 { }\n"
+"\ttrack 119 { }\n"
+"\ttrack 120 { image_track 60 format_track 30 format_side 0 }\n"
+"\ttrack 121 { image_track 61 format_track 30 format_side 1 }\n"
+"\ttrack 122 { }\n"
+"\ttrack 123 { }\n"
+"\ttrack 124 { image_track 62 format_track 31 format_side 0 }\n"
+"\ttrack 125 { image_track 63 format_track 31 format_side 1 }\n"
+"\ttrack 126 { }\n"
+"\ttrack 127 { }\n"
+"\ttrack 128 { image_track 64 format_track 32 format_side 0 }\n"
+"\ttrack 129 { image_track 65 format_track 32 format_side 1 }\n"
+"\ttrack 130 { }\n"
+"\ttrack 131 { }\n"
+"\ttrack 132 { image_track 66 format_track 33 format_side 0 }\n"
+"\ttrack 133 { image_track 67 format_track 33 format_side 1 }\n"
+"\ttrack 134 { }\n"
+"\ttrack 135 { }\n"
+"\ttrack 136 { image_track 68 format_track 34 format_side 0 }\n"
+"\ttrack 137 { image_track 69 format_track 34 format_side 1 }\n"
+"\ttrack 138 { }\n"
+"\ttrack 139 { }\n"
+"\ttrack 140 { image_track 70 format_track 35 format_side 0 }\n"
+"\ttrack 141 { image_track 71 format_track 35 format_side 1 }\n"
+"\ttrack 142 { }\n"
+"\ttrack 143 { }\n"
+"\ttrack 144 { image_track 72 format_track 36 format_side 0 }\n"
+"\ttrack 145 { image_track 73 format_track 36 format_side 1 }\n"
+"\ttrack 146 { }\n"
+"\ttrack 147 { }\n"
+"\ttrack 148 { image_track 74 format_track 37 format_side 0 }\n"
+"\ttrack 149 { image_track 75 format_track 37 format_side 1 }\n"
+"\ttrack 150 { }\n"
+"\ttrack 151 { }\n"
+"\ttrack 152 { image_track 76 format_track 38 format_side 0 }\n"
+"\ttrack 153 { image_track 77 format_track 38 format_side 1 }\n"
+"\ttrack 154 { }\n"
+"\ttrack 155 { }\n"
+"\ttrack 156 { image_track 78 format_track 39 format_side 0 }\n"
+"\ttrack 157 { image_track 79 format_track 39 format_side 1 }\n"
+"\ttrack 158 { }\n"
+"\ttrack 159 { }\n"
+"\t}\n"
+"disk \"msdos_ssdd_8sector_5.25\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 5.25 inch, 40 trks, 1 side, *** UNTESTED ***\"\n"
+"\ttrackmap \"msdos_40_plain\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 158 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tsectors 8\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 190\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0800 0x15c4 0x1c00\n"
+"\t\t0x1d00 0x2192 0x2700\n"
+"\t\t0x2800 0x2d5e 0x4000\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tepilog_length 1024\n"
+"\t\t}\n"
+"\ttrack_range 0 156 4 { }\n"
+"\t}\n"
+"disk \"msdos_dsdd_8sector_5.25\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 5.25 inch, 40 trks, 2 sides, *** UNTESTED ***\"\n"
+"\tcopy \"msdos_ssdd_8sector_5.25\"\n"
+"\ttrack_range 1 157 4 { }\n"
+"\ttrack_range 3 159 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_ssdd_5.25\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 5.25 inch, 40 trks, 1 side, *** UNTESTED ***\"\n"
+"\ttrackmap \"msdos_40_plain\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 158 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tsectors 9\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 190\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0800 0x15c4 0x1c00\n"
+"\t\t0x1d00 0x2192 0x2700\n"
+"\t\t0x2800 0x2d5e 0x4000\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tepilog_length 1024\n"
+"\t\t}\n"
+"\ttrack_range 0 156 4 { }\n"
+"\t}\n"
+"disk \"msdos_dsdd_5.25\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 5.25 inch, 40 trks, 2 sides, *** UNTESTED ***\"\n"
+"\tcopy \"msdos_ssdd_5.25\"\n"
+"\ttrack_range 1 157 4 { }\n"
+"\ttrack_range 3 159 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_5.25\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 5.25 inch, 80 trks, 2 sides, 15 sec/trk, 1200 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 15\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dsdd\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 80 trks, 2 sides, 9 sec/trk, 720 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 14\n"
+"\tsectors 9\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tepilog_length 1024\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 80 trks, 2 sides, 18 sec/trk, 1440 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 18\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1476\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 82 trks, 2 sides, 18 sec/trk, 1476 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 18\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 163 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1494\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 83 trks, 2 sides, 18 sec/trk, 1494 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 18\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 165 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1600\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 80 trks, 2 sides, 20 sec/trk, 1600 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 20\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length2 44\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1680\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 80 trks, 2 sides, 21 sec/trk, 1680 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 21\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length2 12\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1722\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 82 trks, 2 sides, 21 sec/trk, 1722 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 21\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 163 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length2 12\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1743\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 83 trks, 2 sides, 21 sec/trk, 1743 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 21\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 165 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length2 12\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1760\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 80 trks, 2 sides, 11 sec/trk, 1760 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 11\n"
+"\tsector_sizes\n"
+"\t\t{\n"
+"\t\t1024 1024 1024 1024 1024 1024\n"
+"\t\t1024 1024 1024 1024 1024\n"
+"\t\t}\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 0 159 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length2 40\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"msdos_dshd_1802\"\n"
+"\t{\n"
+"\tinfo \"MSDOS, MFM, 3.5  inch, 82 trks, 2 sides, 11-19 sec/trk, 1802 K\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tindexed yes\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length2 40\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\ttrack 0 sectors 19\n"
+"\tsectors 11\n"
+"\tsector_sizes\n"
+"\t\t{\n"
+"\t\t1024 1024 1024 1024 1024 1024\n"
+"\t\t1024 1024 1024 1024 1024\n"
+"\t\t}\n"
+"\ttrack_range 1 163 1 { }\n"
+"\t}\n"
+"disk \"msdos_dd_5.25\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dsdd_5.25\"\n"
+"\tcopy \"msdos_dsdd_5.25\"\n"
+"\t}\n"
+"disk \"msdos_hd_5.25\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_5.25\"\n"
+"\tcopy \"msdos_dshd_5.25\"\n"
+"\t}\n"
+"disk \"msdos_dd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dsdd\"\n"
+"\tcopy \"msdos_dsdd\"\n"
+"\t}\n"
+"disk \"msdos_hd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd\"\n"
+"\tcopy \"msdos_dshd\"\n"
+"\t}\n"
+"disk \"msdos_hd_1476\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1476\"\n"
+"\tcopy \"msdos_dshd_1476\"\n"
+"\t}\n"
+"disk \"msdos_hd_1494\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1494\"\n"
+"\tcopy \"msdos_dshd_1494\"\n"
+"\t}\n"
+"disk \"msdos_hd_1600\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1600\"\n"
+"\tcopy \"msdos_dshd_1600\"\n"
+"\t}\n"
+"disk \"msdos_hd_1680\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1680\"\n"
+"\tcopy \"msdos_dshd_1680\"\n"
+"\t}\n"
+"disk \"msdos_hd_1722\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1722\"\n"
+"\tcopy \"msdos_dshd_1722\"\n"
+"\t}\n"
+"disk \"msdos_hd_1743\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1743\"\n"
+"\tcopy \"msdos_dshd_1743\"\n"
+"\t}\n"
+"disk \"msdos_hd_1760\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1760\"\n"
+"\tcopy \"msdos_dshd_1760\"\n"
+"\t}\n"
+"disk \"msdos_hd_1802\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd_1802\"\n"
+"\tcopy \"msdos_dshd_1802\"\n"
+"\t}\n"
+"disk \"atari_dsdd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dsdd\"\n"
+"\tcopy \"msdos_dsdd\"\n"
+"\t}\n"
+"disk \"atari_dd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dsdd\"\n"
+"\tcopy \"msdos_dsdd\"\n"
+"\t}\n"
+"disk \"atari_dshd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd\"\n"
+"\tcopy \"msdos_dshd\"\n"
+"\t}\n"
+"disk \"atari_hd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd\"\n"
+"\tcopy \"msdos_dshd\"\n"
+"\t}\n"
+"disk \"mac_5.25\"\n"
+"\t{\n"
+"\tinfo \"Apple, GCR, 5.25 inch, 35 trks, 1 side, 16 sec/trk, 140 K\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 134 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tformat \"gcr_apple\"\n"
+"\tsectors 16\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 190\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length1 23\n"
+"\t\tfill_length2 7\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0800 0x1500 0x2200\n"
+"\t\t0x2300 0x2c00 0x3900\n"
+"\t\t0x3a00 0x4200 0x5000\n"
+"\t\t}\n"
+"\ttrack_range 0 136 4 { }\n"
+"\t}\n"
+"disk \"mac_5.25_300\"\n"
+"\t{\n"
+"\tinfo \"Apple, same as mac_5.25 but for 300 RPM drives\"\n"
+"\tclock 14\n"
+"\ttrack_range 2 134 4\n"
+"\t\t{\n"
+"\t\tformat \"fill\"\n"
+"\t\toptional yes\n"
+"\t\twrite fill_length 16384\n"
+"\t\t}\n"
+"\tformat \"gcr_apple\"\n"
+"\tsectors 16\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 240\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 400\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length1 23\n"
+"\t\tfill_length2 7\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0800 0x1a00 0x2900\n"
+"\t\t0x2a00 0x3500 0x4400\n"
+"\t\t0x4500 0x5100 0x6000\n"
+"\t\t}\n"
+"\ttrack_range 0 136 4 { }\n"
+"\t}\n"
+"disk \"mac_ssdd_400\"\n"
+"\t{\n"
+"\tinfo \"Apple, GCR, 3.5  inch, 80 trks, 1 side, 8-12 sec/trk, 400K\"\n"
+"\tformat \"gcr_apple\"\n"
+"\tclock 14\n"
+"\tmode 1\n"
+"\tvolume_id 0x02\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tmatch_simple yes\n"
+"\t\tmatch_simple_fixup yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length1 30\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\ttrack_range 0 30 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x0f00 0x1258 0x1a00\n"
+"\t\t\t0x1b00 0x24b0 0x2d00\n"
+"\t\t\t0x2e00 0x3708 0x4000\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x01c0 +0x01c0\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 12\n"
+"\t\t}\n"
+"\ttrack_range 32 62 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1100 0x1400 0x1e00\n"
+"\t\t\t0x1f00 0x2800 0x3200\n"
+"\t\t\t0x3300 0x3c00 0x4800\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0180 +0x0180\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 11\n"
+"\t\t}\n"
+"\ttrack_range 64 94 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1200 0x1610 0x2100\n"
+"\t\t\t0x2200 0x2c20 0x3700\n"
+"\t\t\t0x3800 0x4230 0x5000\n"
+"\t\t\t}\n"
+"\t\tsectors 10\n"
+"\t\t}\n"
+"\ttrack_range 96 126 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1400 0x18a0 0x2400\n"
+"\t\t\t0x2500 0x3140 0x3d00\n"
+"\t\t\t0x3e00 0x49e0 0x5400\n"
+"\t\t\t}\n"
+"\t\tsectors 9\n"
+"\t\t}\n"
+"\ttrack_range 128 158 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1700 0x1bc0 0x2900\n"
+"\t\t\t0x2a00 0x3780 0x4500\n"
+"\t\t\t0x4600 0x5340 0x6000\n"
+"\t\t\t}\n"
+"\t\tsectors 8\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"mac_ssdd_400_524\"\n"
+"\t{\n"
+"\tinfo \"Apple, GCR, 3.5  inch, 80 trks, 1 side, 8-12 sec/trk, 400K\"\n"
+"\tformat \"gcr_apple\"\n"
+"\tclock 14\n"
+"\tmode 2\n"
+"\tvolume_id 0x02\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tmatch_simple yes\n"
+"\t\tmatch_simple_fixup yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length1 30\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\ttrack_range 0 30 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x0f00 0x1258 0x1a00\n"
+"\t\t\t0x1b00 0x24b0 0x2d00\n"
+"\t\t\t0x2e00 0x3708 0x4000\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x01c0 +0x01c0\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 12\n"
+"\t\t}\n"
+"\ttrack_range 32 62 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1100 0x1400 0x1e00\n"
+"\t\t\t0x1f00 0x2800 0x3200\n"
+"\t\t\t0x3300 0x3c00 0x4800\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0180 +0x0180\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 11\n"
+"\t\t}\n"
+"\ttrack_range 64 94 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1200 0x1610 0x2100\n"
+"\t\t\t0x2200 0x2c20 0x3700\n"
+"\t\t\t0x3800 0x4230 0x5000\n"
+"\t\t\t}\n"
+"\t\tsectors 10\n"
+"\t\t}\n"
+"\ttrack_range 96 126 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1400 0x18a0 0x2400\n"
+"\t\t\t0x2500 0x3140 0x3d00\n"
+"\t\t\t0x3e00 0x49e0 0x5400\n"
+"\t\t\t}\n"
+"\t\tsectors 9\n"
+"\t\t}\n"
+"\ttrack_range 128 158 2\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1700 0x1bc0 0x2900\n"
+"\t\t\t0x2a00 0x3980 0x4500\n"
+"\t\t\t0x4600 0x5340 0x6000\n"
+"\t\t\t}\n"
+"\t\tsectors 8\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"mac_dsdd_800\"\n"
+"\t{\n"
+"\tinfo \"Apple, GCR, 3.5  inch, 80 trks, 2 sides, 8-12 sec/trk, 800K\"\n"
+"\tformat \"gcr_apple\"\n"
+"\tclock 14\n"
+"\tmode 1\n"
+"\tvolume_id 0x22\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tmatch_simple yes\n"
+"\t\tmatch_simple_fixup yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length1 30\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\ttrack_range 0 31 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x0f00 0x1258 0x1a00\n"
+"\t\t\t0x1b00 0x24b0 0x2d00\n"
+"\t\t\t0x2e00 0x3708 0x4000\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x01c0 +0x01c0\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 12\n"
+"\t\t}\n"
+"\ttrack_range 32 63 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1100 0x1400 0x1e00\n"
+"\t\t\t0x1f00 0x2800 0x3200\n"
+"\t\t\t0x3300 0x3c00 0x4800\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0180 +0x0180\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 11\n"
+"\t\t}\n"
+"\ttrack_range 64 95 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1200 0x1610 0x2100\n"
+"\t\t\t0x2200 0x2c20 0x3700\n"
+"\t\t\t0x3800 0x4230 0x5000\n"
+"\t\t\t}\n"
+"\t\tsectors 10\n"
+"\t\t}\n"
+"\ttrack_range 96 127 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1400 0x18a0 0x2400\n"
+"\t\t\t0x2500 0x3140 0x3d00\n"
+"\t\t\t0x3e00 0x49e0 0x5400\n"
+"\t\t\t}\n"
+"\t\tsectors 9\n"
+"\t\t}\n"
+"\ttrack_range 128 159 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1700 0x1bc0 0x2900\n"
+"\t\t\t0x2a00 0x3780 0x4500\n"
+"\t\t\t0x4600 0x5340 0x6000\n"
+"\t\t\t}\n"
+"\t\tsectors 8\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"mac_dsdd_800_524\"\n"
+"\t{\n"
+"\tinfo \"Apple, GCR, 3.5  inch, 80 trks, 2 sides, 8-12 sec/trk, 800K\"\n"
+"\tformat \"gcr_apple\"\n"
+"\tclock 14\n"
+"\tmode 2\n"
+"\tvolume_id 0x22\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 230\n"
+"\t\tmatch_simple yes\n"
+"\t\tmatch_simple_fixup yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tfill_length1 30\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\ttrack_range 0 31 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x0f00 0x1258 0x1a00\n"
+"\t\t\t0x1b00 0x24b0 0x2d00\n"
+"\t\t\t0x2e00 0x3708 0x4000\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x01c0 +0x01c0\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t-0x01c0 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 12\n"
+"\t\t}\n"
+"\ttrack_range 32 63 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1100 0x1400 0x1e00\n"
+"\t\t\t0x1f00 0x2800 0x3200\n"
+"\t\t\t0x3300 0x3c00 0x4800\n"
+"\t\t\t}\n"
+"\t\twrite precomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0180 +0x0180\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t-0x0180 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tsectors 11\n"
+"\t\t}\n"
+"\ttrack_range 64 95 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1200 0x1610 0x2100\n"
+"\t\t\t0x2200 0x2c20 0x3700\n"
+"\t\t\t0x3800 0x4230 0x5000\n"
+"\t\t\t}\n"
+"\t\tsectors 10\n"
+"\t\t}\n"
+"\ttrack_range 96 127 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1400 0x18a0 0x2400\n"
+"\t\t\t0x2500 0x3140 0x3d00\n"
+"\t\t\t0x3e00 0x49e0 0x5400\n"
+"\t\t\t}\n"
+"\t\tsectors 9\n"
+"\t\t}\n"
+"\ttrack_range 128 159 1\n"
+"\t\t{\n"
+"\t\tinterleave 1\n"
+"\t\tbounds_new\n"
+"\t\t\t{\n"
+"\t\t\t0x1700 0x1bc0 0x2900\n"
+"\t\t\t0x2a00 0x3980 0x4500\n"
+"\t\t\t0x4600 0x5340 0x6000\n"
+"\t\t\t}\n"
+"\t\tsectors 8\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"mac_sd_400\"\n"
+"\t{\n"
+"\tinfo \"same as mac_ssdd_400\"\n"
+"\tcopy \"mac_ssdd_400\"\n"
+"\t}\n"
+"disk \"mac_sd\"\n"
+"\t{\n"
+"\tinfo \"same as mac_ssdd_400\"\n"
+"\tcopy \"mac_ssdd_400\"\n"
+"\t}\n"
+"disk \"mac_ssdd_524\"\n"
+"\t{\n"
+"\tinfo \"same as mac_ssdd_400_524\"\n"
+"\tcopy \"mac_ssdd_400_524\"\n"
+"\t}\n"
+"disk \"mac_sd_524\"\n"
+"\t{\n"
+"\tinfo \"same as mac_ssdd_400_524\"\n"
+"\tcopy \"mac_ssdd_400_524\"\n"
+"\t}\n"
+"disk \"mac_dd_800\"\n"
+"\t{\n"
+"\tinfo \"same as mac_dsdd_800\"\n"
+"\tcopy \"mac_dsdd_800\"\n"
+"\t}\n"
+"disk \"mac_dd\"\n"
+"\t{\n"
+"\tinfo \"same as mac_dsdd_800\"\n"
+"\tcopy \"mac_dsdd_800\"\n"
+"\t}\n"
+"disk \"mac_dsdd_524\"\n"
+"\t{\n"
+"\tinfo \"same as mac_dsdd_800_524\"\n"
+"\tcopy \"mac_dsdd_800_524\"\n"
+"\t}\n"
+"disk \"mac_dd_524\"\n"
+"\t{\n"
+"\tinfo \"same as mac_dsdd_800_524\"\n"
+"\tcopy \"mac_dsdd_800_524\"\n"
+"\t}\n"
+"disk \"mac_dshd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd\"\n"
+"\tcopy \"msdos_dshd\"\n"
+"\t}\n"
+"disk \"mac_hd\"\n"
+"\t{\n"
+"\tinfo \"same as msdos_dshd\"\n"
+"\tcopy \"msdos_dshd\"\n"
+"\t}\n"
+"disk \"ibm_dsdd\"\n"
+"\t{\n"
+"\tinfo \"MFM, 8 inch, 77 trks, 2 sides, 26 sec/track, track 0 side 0 FM\"\n"
+"\tformat \"fm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 26\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack 0 { }\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock  28\n"
+"\tsectors 26\n"
+"\tsector_sizes\n"
+"\t\t{\n"
+"\t\t256 256 256 256 256 256 256 256\n"
+"\t\t256 256 256 256 256 256 256 256\n"
+"\t\t256 256 256 256 256 256 256 256\n"
+"\t\t256 256\n"
+"\t\t}\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\ttrack_range 1 153 1 write\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tepilog_length 2048\n"
+"\t\t}\n"
+"\t}\n"
+"disk \"dec_rx01_sssd\"\n"
+"\t{\n"
+"\tinfo \"FM,  8 inch, 77 trks, 1 side, 26 sec/trk\"\n"
+"\tformat \"fm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 26\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tepilog_length 1024\n"
+"\t\t}\n"
+"\ttrack_range 0 152 2 { }\n"
+"\t}\n"
+"disk \"dg_dsdd\"\n"
+"\t{\n"
+"\tinfo \"MFM, 8 inch, 77 trks, 2 sides, 15 sec/trk\"\n"
+"\tformat \"mfm_nec765\"\n"
+"\tclock 28\n"
+"\tsectors 15\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tpostcomp_simple yes\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 500\n"
+"\t\tepilog_length 1024\n"
+"\t\t}\n"
+"\ttrack_range 0 153 1 { }\n"
+"\t}\n"
+"trackmap \"victor9000_plain\"\n"
+"\t{\n"
+"\ttrack 0 { image_track 0 format_track 0 }\n"
+"\ttrack 2 { image_track 1 format_track 1 }\n"
+"\ttrack 4 { image_track 2 format_track 2 }\n"
+"\ttrack 6 { image_track 3 format_track 3 }\n"
+"\ttrack 8 { image_track 4 format_track 4 }\n"
+"\ttrack 10 { image_track 5 format_track 5 }\n"
+"\ttrack 12 { image_track 6 format_track 6 }\n"
+"\ttrack 14 { image_track 7 format_track 7 }\n"
+"\ttrack 16 { image_track 8 format_track 8 }\n"
+"\ttrack 18 { image_track 9 format_track 9 }\n"
+"\ttrack 20 { image_track 10 format_track 10 }\n"
+"\ttrack 22 { image_track 11 format_track 11 }\n"
+"\ttrack 24 { image_track 12 format_track 12 }\n"
+"\ttrack 26 { image_track 13 format_track 13 }\n"
+"\ttrack 28 { image_track 14 format_track 14 }\n"
+"\ttrack 30 { image_track 15 format_track 15 }\n"
+"\ttrack 32 { image_track 16 format_track 16 }\n"
+"\ttrack 34 { image_track 17 format_track 17 }\n"
+"\ttrack 36 { image_track 18 format_track 18 }\n"
+"\ttrack 38 { image_track 19 format_track 19 }\n"
+"\ttrack 40 { image_track 20 format_track 20 }\n"
+"\ttrack 42 { image_track 21 format_track 21 }\n"
+"\ttrack 44 { image_track 22 format_track 22 }\n"
+"\ttrack 46 { image_track 23 format_track 23 }\n"
+"\ttrack 48 { image_track 24 format_track 24 }\n"
+"\ttrack 50 { image_track 25 format_track 25 }\n"
+"\ttrack 52 { image_track 26 format_track 26 }\n"
+"\ttrack 54 { image_track 27 format_track 27 }\n"
+"\ttrack 56 { image_track 28 format_track 28 }\n"
+"\ttrack 58 { image_track 29 format_track 29 }\n"
+"\ttrack 60 { image_track 30 format_track 30 }\n"
+"\ttrack 62 { image_track 31 format_track 31 }\n"
+"\ttrack 64 { image_track 32 format_track 32 }\n"
+"\ttrack 66 { image_track 33 format_track 33 }\n"
+"\ttrack 68 { image_track 34 format_track 34 }\n"
+"\ttrack 70 { image_track 35 format_track 35 }\n"
+"\ttrack 72 { image_track 36 format_track 36 }\n"
+"\ttrack 74 { image_track 37 format_track 37 }\n"
+"\ttrack 76 { image_track 38 format_track 38 }\n"
+"\ttrack 78 { image_track 39 format_track 39 }\n"
+"\ttrack 80 { image_track 40 format_track 40 }\n"
+"\ttrack 82 { image_track 41 format_track 41 }\n"
+"\ttrack 84 { image_track 42 format_track 42 }\n"
+"\ttrack 86 { image_track 43 format_track 43 }\n"
+"\ttrack 88 { image_track 44 format_track 44 }\n"
+"\ttrack 90 { image_track 45 format_track 45 }\n"
+"\ttrack 92 { image_track 46 format_track 46 }\n"
+"\ttrack 94 { image_track 47 format_track 47 }\n"
+"\ttrack 96 { image_track 48 format_track 48 }\n"
+"\ttrack 98 { image_track 49 format_track 49 }\n"
+"\ttrack 100 { image_track 50 format_track 50 }\n"
+"\ttrack 102 { image_track 51 format_track 51 }\n"
+"\ttrack 104 { image_track 52 format_track 52 }\n"
+"\ttrack 106 { image_track 53 format_track 53 }\n"
+"\ttrack 108 { image_track 54 format_track 54 }\n"
+"\ttrack 110 { image_track 55 format_track 55 }\n"
+"\ttrack 112 { image_track 56 format_track 56 }\n"
+"\ttrack 114 { image_track 57 format_track 57 }\n"
+"\ttrack 116 { image_track 58 format_track 58 }\n"
+"\ttrack 118 { image_track 59 format_track 59 }\n"
+"\ttrack 120 { image_track 60 format_track 60 }\n"
+"\ttrack 122 { image_track 61 format_track 61 }\n"
+"\ttrack 124 { image_track 62 format_track 62 }\n"
+"\ttrack 126 { image_track 63 format_track 63 }\n"
+"\ttrack 128 { image_track 64 format_track 64 }\n"
+"\ttrack 130 { image_track 65 format_track 65 }\n"
+"\ttrack 132 { image_track 66 format_track 66 }\n"
+"\ttrack 134 { image_track 67 format_track 67 }\n"
+"\ttrack 136 { image_track 68 format_track 68 }\n"
+"\ttrack 138 { image_track 69 format_track 69 }\n"
+"\ttrack 140 { image_track 70 format_track 70 }\n"
+"\ttrack 142 { image_track 71 format_track 71 }\n"
+"\ttrack 144 { image_track 72 format_track 72 }\n"
+"\ttrack 146 { image_track 73 format_track 73 }\n"
+"\ttrack 148 { image_track 74 format_track 74 }\n"
+"\ttrack 150 { image_track 75 format_track 75 }\n"
+"\ttrack 152 { image_track 76 format_track 76 }\n"
+"\ttrack 154 { image_track 77 format_track 77 }\n"
+"\ttrack 156 { image_track 78 format_track 78 }\n"
+"\ttrack 158 { image_track 79 format_track 79 }\n"
+"\ttrack 1 { image_track 80 format_track 128 }\n"
+"\ttrack 3 { image_track 81 format_track 129 }\n"
+"\ttrack 5 { image_track 82 format_track 130 }\n"
+"\ttrack 7 { image_track 83 format_track 131 }\n"
+"\ttrack 9 { image_track 84 format_track 132 }\n"
+"\ttrack 11 { image_track 85 format_track 133 }\n"
+"\ttrack 13 { image_track 86 format_track 134 }\n"
+"\ttrack 15 { image_track 87 format_track 135 }\n"
+"\ttrack 17 { image_track 88 format_track 136 }\n"
+"\ttrack 19 { image_track 89 format_track 137 }\n"
+"\ttrack 21 { image_track 90 format_track 138 }\n"
+"\ttrack 23 { image_track 91 format_track 139 }\n"
+"\ttrack 25 { image_track 92 format_track 140 }\n"
+"\ttrack 27 { image_track 93 format_track 141 }\n"
+"\ttrack 29 { image_track 94 format_track 142 }\n"
+"\ttrack 31 { image_track 95 format_track 143 }\n"
+"\ttrack 33 { image_track 96 format_track 144 }\n"
+"\ttrack 35 { image_track 97 format_track 145 }\n"
+"\ttrack 37 { image_track 98 format_track 146 }\n"
+"\ttrack 39 { image_track 99 format_track 147 }\n"
+"\ttrack 41 { image_track 100 format_track 148 }\n"
+"\ttrack 43 { image_track 101 format_track 149 }\n"
+"\ttrack 45 { image_track 102 format_track 150 }\n"
+"\ttrack 47 { image_track 103 format_track 151 }\n"
+"\ttrack 49 { image_track 104 format_track 152 }\n"
+"\ttrack 51 { image_track 105 format_track 153 }\n"
+"\ttrack 53 { image_track 106 format_track 154 }\n"
+"\ttrack 55 { image_track 107 format_track 155 }\n"
+"\ttrack 57 { image_track 108 format_track 156 }\n"
+"\ttrack 59 { image_track 109 format_track 157 }\n"
+"\ttrack 61 { image_track 110 format_track 158 }\n"
+"\ttrack 63 { image_track 111 format_track 159 }\n"
+"\ttrack 65 { image_track 112 format_track 160 }\n"
+"\ttrack 67 { image_track 113 format_track 161 }\n"
+"\ttrack 69 { image_track 114 format_track 162 }\n"
+"\ttrack 71 { image_track 115 format_track 163 }\n"
+"\ttrack 73 { image_track 116 format_track 164 }\n"
+"\ttrack 75 { image_track 117 format_track 165 }\n"
+"\ttrack 77 { image_track 118 format_track 166 }\n"
+"\ttrack 79 { image_track 119 format_track 167 }\n"
+"\ttrack 81 { image_track 120 format_track 168 }\n"
+"\ttrack 83 { image_track 121 format_track 169 }\n"
+"\ttrack 85 { image_track 122 format_track 170 }\n"
+"\ttrack 87 { image_track 123 format_track 171 }\n"
+"\ttrack 89 { image_track 124 format_track 172 }\n"
+"\ttrack 91 { image_track 125 format_track 173 }\n"
+"\ttrack 93 { image_track 126 format_track 174 }\n"
+"\ttrack 95 { image_track 127 format_track 175 }\n"
+"\ttrack 97 { image_track 128 format_track 176 }\n"
+"\ttrack 99 { image_track 129 format_track 177 }\n"
+"\ttrack 101 { image_track 130 format_track 178 }\n"
+"\ttrack 103 { image_track 131 format_track 179 }\n"
+"\ttrack 105 { image_track 132 format_track 180 }\n"
+"\ttrack 107 { image_track 133 format_track 181 }\n"
+"\ttrack 109 { image_track 134 format_track 182 }\n"
+"\ttrack 111 { image_track 135 format_track 183 }\n"
+"\ttrack 113 { image_track 136 format_track 184 }\n"
+"\ttrack 115 { image_track 137 format_track 185 }\n"
+"\ttrack 117 { image_track 138 format_track 186 }\n"
+"\ttrack 119 { image_track 139 format_track 187 }\n"
+"\ttrack 121 { image_track 140 format_track 188 }\n"
+"\ttrack 123 { image_track 141 format_track 189 }\n"
+"\ttrack 125 { image_track 142 format_track 190 }\n"
+"\ttrack 127 { image_track 143 format_track 191 }\n"
+"\ttrack 129 { image_track 144 format_track 192 }\n"
+"\ttrack 131 { image_track 145 format_track 193 }\n"
+"\ttrack 133 { image_track 146 format_track 194 }\n"
+"\ttrack 135 { image_track 147 format_track 195 }\n"
+"\ttrack 137 { image_track 148 format_track 196 }\n"
+"\ttrack 139 { image_track 149 format_track 197 }\n"
+"\ttrack 141 { image_track 150 format_track 198 }\n"
+"\ttrack 143 { image_track 151 format_track 199 }\n"
+"\ttrack 145 { image_track 152 format_track 200 }\n"
+"\ttrack 147 { image_track 153 format_track 201 }\n"
+"\ttrack 149 { image_track 154 format_track 202 }\n"
+"\ttrack 151 { image_track 155 format_track 203 }\n"
+"\ttrack 153 { image_track 156 format_track 204 }\n"
+"\ttrack 155 { image_track 157 format_track 205 }\n"
+"\ttrack 157 { image_track 158 format_track 206 }\n"
+"\ttrack 159 { image_track 159 format_track 207 }\n"
+"\t}\n"
+"disk \"victor9000_dsdd\"\n"
+"\t{\n"
+"\tinfo \"Victor 9000, GCR, 5.25 inch, 80 trks, 2 sides, 11-19 sec/trk\"\n"
+"\ttrackmap \"victor9000_plain\"\n"
+"\tclock 28\n"
+"\tformat \"gcr_v9000\"\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 180\n"
+"\t\tmatch_simple yes\n"
+"\t\tmatch_simple_fixup yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\tpostcomp_simple_adjust { 0x0180 -0x0180 }\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0e00 0x1400 0x1f00\n"
+"\t\t0x2000 0x2800 0x3300\n"
+"\t\t0x3400 0x3c00 0x4800\n"
+"\t\t}\n"
+"\tsectors 19\n"
+"\ttrack_range 0 6 2 read postcomp_simple_adjust { 0x0280 -0x0280 }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1000 0x1500 0x2100\n"
+"\t\t0x2200 0x2a00 0x3500\n"
+"\t\t0x3600 0x3f00 0x4a00\n"
+"\t\t}\n"
+"\tsectors 18\n"
+"\ttrack_range 8 30 2 { }\n"
+"\ttrack_range 1 15 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1200 0x1650 0x2300\n"
+"\t\t0x2400 0x2ca0 0x3700\n"
+"\t\t0x3800 0x42f0 0x5000\n"
+"\t\t}\n"
+"\tsectors 17\n"
+"\ttrack_range 32 52 2 { }\n"
+"\ttrack_range 17 37 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1400 0x1800 0x2500\n"
+"\t\t0x2600 0x3000 0x3900\n"
+"\t\t0x3a00 0x4800 0x5200\n"
+"\t\t}\n"
+"\tsectors 16\n"
+"\ttrack_range 54 74 2 { }\n"
+"\ttrack_range 39 59 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1600 0x1970 0x2700\n"
+"\t\t0x2800 0x32e0 0x3d00\n"
+"\t\t0x3e00 0x4c50 0x5800\n"
+"\t\t}\n"
+"\tsectors 15\n"
+"\ttrack_range 76 94 2 { }\n"
+"\ttrack_range 61 79 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1800 0x1b80 0x2900\n"
+"\t\t0x2a00 0x3700 0x4300\n"
+"\t\t0x4400 0x5280 0x6000\n"
+"\t\t}\n"
+"\tsectors 14\n"
+"\ttrack_range 96 118 2 { }\n"
+"\ttrack_range 81 103 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1a00 0x1d80 0x2b00\n"
+"\t\t0x2c00 0x3b00 0x4700\n"
+"\t\t0x4800 0x5880 0x6800\n"
+"\t\t}\n"
+"\tsectors 13\n"
+"\ttrack_range 120 140 2 { }\n"
+"\ttrack_range 105 125 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1c00 0x2040 0x2f00\n"
+"\t\t0x3000 0x4080 0x5000\n"
+"\t\t0x5100 0x60c0 0x7000\n"
+"\t\t}\n"
+"\tsectors 12\n"
+"\ttrack_range 142 158 2 { }\n"
+"\ttrack_range 127 149 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1c00 0x2150 0x2f00\n"
+"\t\t0x3000 0x42a0 0x5000\n"
+"\t\t0x5100 0x63f0 0x7000\n"
+"\t\t}\n"
+"\tsectors 11\n"
+"\ttrack_range 151 159 2 { }\n"
+"\t}\n"
+"disk \"victor9000_ssdd\"\n"
+"\t{\n"
+"\tinfo \"Victor 9000, GCR, 5.25 inch, 80 trks, 1 side, 12-19 sec/trk\"\n"
+"\ttrackmap \"victor9000_plain\"\n"
+"\tclock 28\n"
+"\tformat \"gcr_v9000\"\n"
+"\tread\n"
+"\t\t{\n"
+"\t\ttimeout 180\n"
+"\t\tmatch_simple yes\n"
+"\t\tmatch_simple_fixup yes\n"
+"\t\tpostcomp_simple yes\n"
+"\t\tpostcomp_simple_adjust { 0x0180 -0x0180 }\n"
+"\t\t}\n"
+"\twrite\n"
+"\t\t{\n"
+"\t\ttimeout 300\n"
+"\t\tprecomp\n"
+"\t\t\t{\n"
+"\t\t\t+0x0000 +0x0100 +0x0100\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t-0x0100 +0x0000 +0x0000\n"
+"\t\t\t}\n"
+"\t\tprolog_length 2048\n"
+"\t\t}\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x0e00 0x1400 0x1f00\n"
+"\t\t0x2000 0x2800 0x3300\n"
+"\t\t0x3400 0x3c00 0x4800\n"
+"\t\t}\n"
+"\tsectors 19\n"
+"\ttrack_range 0 6 2 read postcomp_simple_adjust { 0x0280 -0x0280 }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1000 0x1500 0x2100\n"
+"\t\t0x2200 0x2a00 0x3500\n"
+"\t\t0x3600 0x3f00 0x4a00\n"
+"\t\t}\n"
+"\tsectors 18\n"
+"\ttrack_range 8 30 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1200 0x1650 0x2300\n"
+"\t\t0x2400 0x2ca0 0x3700\n"
+"\t\t0x3800 0x42f0 0x5000\n"
+"\t\t}\n"
+"\tsectors 17\n"
+"\ttrack_range 32 52 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1400 0x1800 0x2500\n"
+"\t\t0x2600 0x3000 0x3900\n"
+"\t\t0x3a00 0x4800 0x5200\n"
+"\t\t}\n"
+"\tsectors 16\n"
+"\ttrack_range 54 74 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1600 0x1970 0x2700\n"
+"\t\t0x2800 0x32e0 0x3d00\n"
+"\t\t0x3e00 0x4c50 0x5800\n"
+"\t\t}\n"
+"\tsectors 15\n"
+"\ttrack_range 76 94 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1800 0x1b80 0x2900\n"
+"\t\t0x2a00 0x3700 0x4300\n"
+"\t\t0x4400 0x5280 0x6000\n"
+"\t\t}\n"
+"\tsectors 14\n"
+"\ttrack_range 96 118 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1a00 0x1d80 0x2b00\n"
+"\t\t0x2c00 0x3b00 0x4700\n"
+"\t\t0x4800 0x5880 0x6800\n"
+"\t\t}\n"
+"\tsectors 13\n"
+"\ttrack_range 120 140 2 { }\n"
+"\tbounds_new\n"
+"\t\t{\n"
+"\t\t0x1c00 0x2040 0x2f00\n"
+"\t\t0x3000 0x4080 0x5000\n"
+"\t\t0x5100 0x60c0 0x7000\n"
+"\t\t}\n"
+"\tsectors 12\n"
+"\ttrack_range 142 158 2 { }\n"
+"\t}\n"
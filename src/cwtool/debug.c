@@ -15,6 +15,7 @@
 
 #include "debug.h"
 #include "error.h"
+#include "global.h"
 
 
 
@@ -57,6 +58,7 @@ debug_message2(
 	va_list				args;
 
 	va_start(args, format);
+	fprintf(stderr, "%s", global_prefix());
 	if (debug_enabled) fprintf(stderr, "%s:%d: ", file, line);
 	vfprintf(stderr, format, args);
 	fprintf(stderr, "\n");
@@ -13,6 +13,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "disk.h"
 #include "error.h"
@@ -26,6 +28,12 @@
 #include "trackmap.h"
 #include "setvalue.h"
 #include "string.h"
+#include "stats.h"
+#include "event.h"
+#include "output.h"
+#include "cache.h"
+#include "import.h"
+#include "export.h"
 
 
 
@@ -33,6 +41,116 @@ struct disk_track_buffer
 	{
 	unsigned char			*data;
 	int				size;
+	int				flags;
+	};
+
+#define DEFERRED_FLAG_READ		(1 << 0)
+#define DEFERRED_FLAG_WRITE		(1 << 1)
+#define DEFERRED_FLAG_DONE		(1 << 2)
+#define DEFERRED_FLAG_NEXT_SOURCE	(1 << 3)
+
+/*
+ * best quality of every sector seen so far and the number of tries which
+ * did not improve any sector, see disk_retry_next()
+ */
+
+struct disk_retry
+	{
+	struct disk_error		err[GLOBAL_NR_SECTORS];
+	int				idle;
+	};
+
+/*
+ * tracks are never modified after disk_set_track(), so disks and
+ * tracks within a disk share them. disk_copy() only copies pointers
+ */
+
+#define DISK_HASH_SIZE			(2 * GLOBAL_NR_DISKS)
+
+static struct disk_track		disk_track_empty;
+static struct disk			*disk_hash[DISK_HASH_SIZE];
+
+/*
+ * flux of a sample track read by disk_probe(), each track is only read
+ * once for all candidate disks with the same struct image_track settings
+ */
+
+#define DISK_PROBE_NR_FLUX		64
+
+struct disk_probe_flux
+	{
+	struct image_track		img_trk;
+	cw_count_t			cwtool_track;
+	cw_bool_t			ok;
+	unsigned char			*data;
+	struct fifo			ffo;
+	};
+
+/*
+ * a cache entry with the decoded track consists of the bit offset of the
+ * destination fifo, the size of the data part, struct disk_error of each
+ * sector and the data part
+ */
+
+#define DISK_CACHE_SECTOR_SIZE		12
+#define DISK_CACHE_SIZE			(8 + GLOBAL_NR_SECTORS * DISK_CACHE_SECTOR_SIZE + GLOBAL_MAX_TRACK_SIZE)
+
+static unsigned char			disk_cache_data[DISK_CACHE_SIZE];
+
+/*
+ * journal written with --resume next to the destination image. after the
+ * magic and the disk name there is one record per finished track:
+ *
+ *   header          DISK_JOURNAL_HEADER_SIZE bytes: magic, reserved,
+ *                   trackmap index, cwtool track, sectors, offset in the
+ *                   destination image, bit offset and size of the data
+ *   sectors         sectors * DISK_JOURNAL_SECTOR_SIZE bytes: flags,
+ *                   errors and warnings of each sector
+ *   data            size bytes, the decoded track as written to the image
+ *
+ * a later record for the same trackmap index replaces an earlier one. the
+ * journal is synced after each record and removed when the disk was read
+ * completely
+ */
+
+#define DISK_JOURNAL_MAGIC_SIZE		32
+#define DISK_JOURNAL_HEADER_MAGIC	0xce
+#define DISK_JOURNAL_HEADER_SIZE	20
+#define DISK_JOURNAL_SECTOR_SIZE	12
+
+static const char			disk_journal_magic[DISK_JOURNAL_MAGIC_SIZE] = { 'c', 'w', 't', 'o', 'o', 'l', ' ', 'r', 'e', 'a', 'd', ' ', 'j', 'o', 'u', 'r', 'n', 'a', 'l', ' ', '1', 0, };
+
+struct disk_journal_entry
+	{
+	struct disk_error		err[GLOBAL_NR_SECTORS];
+	int				track;
+	int				sectors;
+	int				offset;
+	int				bitofs;
+	int				size;
+	unsigned char			*data;
+	};
+
+struct disk_journal
+	{
+	struct file			fil;
+	char				path[GLOBAL_MAX_PATH_SIZE];
+	struct disk_journal_entry	*ent;
+	int				entries;
+	};
+
+struct disk_track_deferred
+	{
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	struct disk_retry		dsk_rty;
+	struct container		*con;
+	unsigned char			*data;
+	struct fifo			ffo_dst;
+	int				offset;
+	int				src;
+	int				try;
+	int				tries;
+	int				flags;
 	};
 
 
@@ -47,10 +165,52 @@ struct disk_track_buffer
 
 
 
+/****************************************************************************
+ * disk_hash_index
+ ****************************************************************************/
+static cw_index_t
+disk_hash_index(
+	const char			*name)
+
+	{
+	cw_u32_t			h = 2166136261U;
+
+	/* FNV-1a */
+
+	while (*name != '\0') h = (h ^ (unsigned char) *name++) * 16777619U;
+	return (h % DISK_HASH_SIZE);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_share
+ ****************************************************************************/
+static struct disk_track *
+disk_track_share(
+	struct disk_track		*dsk_trk)
+
+	{
+	static struct disk_track	*dsk_trk_last;
+
+	/*
+	 * track_range sets the same track many times, so reuse the
+	 * previous copy if nothing changed
+	 */
+
+	if ((dsk_trk_last != NULL) && (memcmp(dsk_trk_last, dsk_trk, sizeof (struct disk_track)) == 0)) return (dsk_trk_last);
+	dsk_trk_last = (struct disk_track *) malloc(sizeof (struct disk_track));
+	if (dsk_trk_last == NULL) error_oom();
+	*dsk_trk_last = *dsk_trk;
+	return (dsk_trk_last);
+	}
+
+
+
 /****************************************************************************
  * disk_sectors_init
  ****************************************************************************/
-static int
+int
 disk_sectors_init(
 	struct disk_sector		*dsk_sct,
 	struct disk_track		*dsk_trk,
@@ -142,7 +302,15 @@ disk_info_update(
 		else if (dsk_sct[i].err.warnings > 0) dsk_nfo->sectors_weak++;
 		else dsk_nfo->sectors_good++;
 		}
-	if (! summary) return;
+	if (! summary)
+		{
+		event_try(track, try, dsk_nfo->sectors_good, dsk_nfo->sectors_weak, dsk_nfo->sectors_bad, &dsk_nfo->evt_tim);
+		return;
+		}
+	event_track(track, try, dsk_nfo->sectors_good, dsk_nfo->sectors_weak, dsk_nfo->sectors_bad, &dsk_nfo->evt_tim_trk[track]);
+	stats_count(SECTORS_GOOD, track, dsk_nfo->sectors_good);
+	stats_count(SECTORS_WEAK, track, dsk_nfo->sectors_weak);
+	stats_count(SECTORS_BAD, track, dsk_nfo->sectors_bad);
 	dsk_nfo->sum.tracks++;
 	dsk_nfo->sum.sectors_good += dsk_nfo->sectors_good;
 	dsk_nfo->sum.sectors_weak += dsk_nfo->sectors_weak;
@@ -165,116 +333,6 @@ disk_info_update_path(
 
 
 
-/****************************************************************************
- * disk_dump_bad_sector_lines
- ****************************************************************************/
-static cw_void_t
-disk_dump_bad_sector_lines(
-	struct file			*fil,
-	struct container		*con,
-	cw_index_t			index,
-	cw_count_t			start,
-	cw_count_t			end)
-
-	{
-	cw_raw8_t			*data;
-	cw_raw8_t			*error;
-	struct container_lookup		*lkp;
-	cw_char_t			string[0x10000];
-	cw_index_t			i, j;
-
-	data  = container_get_data(con, index);
-	error = container_get_error(con, index);
-	lkp   = container_get_lookup(con, index);
-	for (i = start, j = 0; i < end; i++)
-		{
-		j += string_snprintf(&string[j], sizeof (string) - j, "%02x # %2d %d\n", data[i] & 0x7f, error[i], lkp[i].length);
-		if (j < sizeof (string) / 2) continue;
-		file_write(fil, string, j);
-		j = 0;
-		}
-	if (j > 0) file_write(fil, string, j);
-	}
-
-
-
-/****************************************************************************
- * disk_dump_bad_sector
- ****************************************************************************/
-static cw_count_t
-disk_dump_bad_sector(
-	struct file			*fil,
-	struct container		*con,
-	cw_count_t			track,
-	cw_mode_t			clock,
-	cw_count_t			sector)
-
-	{
-	struct range_sector		*rng_sec;
-	cw_flag_t			flags = 8;	/* UGLY: flag "no correction" hard coded */
-	cw_count_t			entries, range_entries, start, end, limit;
-	cw_index_t			i, j, k, l, t;
-
-	entries = container_get_entries(con);
-	for (i = j = t = 0; i < entries; i++)
-		{
-		limit = container_get_limit(con, i);
-		range_entries = container_get_range_entries(con, i);
-		for (k = l = 0; k < range_entries; k++)
-			{
-			rng_sec = container_get_range_sector(con, i, k);
-			if (range_sector_get_number(rng_sec) == sector) l++;
-			}
-		if (l == 0) continue;
-		file_write_sprintf(fil, "track_data_hex %d %d %d {\n", track, clock, flags);
-		t++;
-		for (k = 0; k < range_entries; k++)
-			{
-			rng_sec = container_get_range_sector(con, i, k);
-			if (range_sector_get_number(rng_sec) != sector) continue;
-			j++;
-			file_write_sprintf(fil, "##### start track %d sector %d (%d) #####\n", track, sector, j);
-
-			/* sector header and sector gap */
-
-			start = container_lookup_position(con, i, range_get_start(range_sector_header(rng_sec)));
-			end   = container_lookup_position(con, i, range_get_end(range_sector_header(rng_sec)));
-			if (end > 0)
-				{
-
-				/* UGLY: fixup for incorrect start value */
-
-				if (start > 128) start -= 128;
-				else start = 0;
-				file_write_string(fil, "### sector header ###\n");
-				disk_dump_bad_sector_lines(fil, con, i, start, end);
-				start = end;
-				end   = container_lookup_position(con, i, range_get_start(range_sector_data(rng_sec)));
-				file_write_string(fil, "### sector gap between header and data ###\n");
-				disk_dump_bad_sector_lines(fil, con, i, start, end);
-				}
-
-			/* sector data */
-
-			start = container_lookup_position(con, i, range_get_start(range_sector_data(rng_sec)));
-			end   = container_lookup_position(con, i, range_get_end(range_sector_data(rng_sec)));
-
-			/* UGLY: fixup for incorrect end value */
-
-			if (end < limit - 128) end += 128;
-			else end = limit;
-			file_write_string(fil, "### sector data ###\n");
-			disk_dump_bad_sector_lines(fil, con, i, start, end);
-
-			file_write_sprintf(fil, "##### end track %d sector %d (%d) #####\n", track, sector, j);
-			}
-		file_write_string(fil, "}\n");
-		}
-	return (t);
-	}
-
-
-
 /****************************************************************************
  * disk_dump_bad_sectors
  ****************************************************************************/
@@ -291,24 +349,20 @@ disk_dump_bad_sectors(
 	static cw_count_t		t = 0;
 	static cw_bool_t		known = CW_BOOL_FALSE;
 	cw_count_t			sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	cw_count_t			sector[GLOBAL_NR_SECTORS];
 	cw_count_t			i, j;
 
 	if (track < options_get_output_track_start()) return;
 	if (track > options_get_output_track_end()) return;
 	if (fil == NULL) return;
-	for (i = j = 0; i < sectors; i++) if (dsk_sct[i].err.errors != 0) j++;
+	for (i = j = 0; i < sectors; i++) if (dsk_sct[i].err.errors != 0) sector[j++] = dsk_sct[i].number;
 	if (j == 0) return;
-	file_write_string(fil, "# cwtool raw text 3\n");
 	if (! (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_OUTPUT))
 		{
-		file_write_sprintf(fil, "# track %d: format '%s' does not support raw output of bad sectors\n", track, dsk_trk->fmt_dsc->name);
+		output_write_unsupported(fil, track, clock, dsk_trk->fmt_dsc->name);
 		return;
 		}
-	for (i = 0; i < sectors; i++)
-		{
-		if (dsk_sct[i].err.errors == 0) continue;
-		t += disk_dump_bad_sector(fil, con, track, clock, dsk_sct[i].number);
-		}
+	t += output_write_track(fil, con, track, clock, sector, j);
 
 	/*
 	 * UGLY: using local static variables to count overall number of
@@ -325,296 +379,1232 @@ disk_dump_bad_sectors(
 
 
 /****************************************************************************
- * disk_track_statistics
+ * disk_track_next_index
  ****************************************************************************/
-static void
-disk_track_statistics(
+static cw_index_t
+disk_track_next_index(
 	struct disk			*dsk,
-	union image			*img,
-	int				trackmap_index)
+	cw_index_t			trackmap_index)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct fifo			ffo = FIFO_INIT(data, sizeof (data));
-	cw_count_t			cwtool_track, format_track, format_side;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			ct;
 
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
-	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
+	while (++trackmap_index < entries)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		dsk_trk = dsk->trk[ct];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		if (ct < options_get_disk_track_start()) continue;
+		if (ct > options_get_disk_track_end()) continue;
+		return (trackmap_index);
+		}
+	return (-1);
+	}
 
-	/* if this track is not within the wanted range, ignore it */
 
-	if (cwtool_track < options_get_disk_track_start()) goto done;
-	if (cwtool_track > options_get_disk_track_end()) goto done;
 
-	/* skip this track if no format is defined */
+/****************************************************************************
+ * disk_track_read_hint
+ ****************************************************************************/
+static cw_void_t
+disk_track_read_hint(
+	struct disk			*dsk,
+	union image			*img,
+	cw_index_t			trackmap_index)
 
-	if (dsk_trk->fmt_dsc == NULL) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_statistics == NULL);
+	{
+	struct trackmap_entry		*trm_ent;
+	cw_index_t			ct;
 
-	/* skip this track if it is optional and we got no data */
+	/*
+	 * tell the image which track will be read after this one, so
+	 * stepping may overlap with decoding. trackmap_index == -1 means
+	 * the head should stay where it is
+	 */
 
-	if (! dsk->img_dsc_l0->track_read(img, &dsk_trk->img_trk, &ffo, NULL, 0, cwtool_track))
+	if (dsk->img_dsc_l0->track_next == NULL) return;
+	if (trackmap_index < 0)
 		{
-		if (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL) goto done;
-		error_message("no data available for track %d", cwtool_track);
+		dsk->img_dsc_l0->track_next(img, NULL, -1);
+		return;
 		}
-	dsk_trk->fmt_dsc->track_statistics(&dsk_trk->fmt, &ffo, cwtool_track, format_track, format_side);
-done:
-	dsk->img_dsc_l0->track_done(img, &dsk_trk->img_trk, cwtool_track);
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk->img_dsc_l0->track_next(img, &dsk->trk[ct]->img_trk, ct);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_greedy2
+ * disk_track_read_next
  ****************************************************************************/
-static int
-disk_track_read_greedy2(
+static cw_void_t
+disk_track_read_next(
 	struct disk			*dsk,
-	struct disk_sector		*dsk_sct,
-	struct disk_option		*dsk_opt,
+	union image			*img,
+	cw_index_t			trackmap_index,
+	cw_bool_t			last)
+
+	{
+
+	/*
+	 * if this is not the last read of the current track, the head
+	 * should stay where it is
+	 */
+
+	disk_track_read_hint(dsk, img, (last) ? disk_track_next_index(dsk, trackmap_index) : -1);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_l0
+ ****************************************************************************/
+static cw_bool_t
+disk_track_read_l0(
+	struct disk			*dsk,
+	struct disk_track		*dsk_trk,
 	struct disk_info		*dsk_nfo,
-	union image			*img_src,
-	union image			*img_dst,
-	struct container		*con,
-	struct fifo			*ffo_src,
-	struct fifo			*ffo_dst,
-	int				trackmap_index)
+	union image			*img,
+	struct fifo			*ffo,
+	cw_count_t			cwtool_track,
+	cw_index_t			try)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	int				offset = dsk->img_dsc->offset(img_dst);
-	cw_count_t			cwtool_track, image_track;
-	cw_count_t			format_track, format_side;
-	int				t;
+	cw_count64_t			t = event_clock();
+	cw_bool_t			result;
 
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
-	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
-	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-	for (t = 0; t <= dsk_opt->retry; t++)
+	stats_try(cwtool_track, try);
+	stats_begin(READ);
+	result = dsk->img_dsc_l0->track_read(img, &dsk_trk->img_trk, ffo, NULL, 0, cwtool_track);
+	stats_end(READ);
+	stats_count(PULSES, cwtool_track, fifo_get_wr_ofs(ffo));
+	if (dsk_nfo == NULL) return (result);
+
+	/*
+	 * for devices this is the time spent in the ioctl, for images
+	 * the time to read the file
+	 */
+
+	dsk_nfo->evt_tim = (struct event_timing)
 		{
-		fifo_reset(ffo_src);
+		.ioctl_ns   = event_clock() - t,
+		.flux_bytes = fifo_get_wr_ofs(ffo)
+		};
+	dsk_nfo->evt_tim_trk[cwtool_track].ioctl_ns   += dsk_nfo->evt_tim.ioctl_ns;
+	dsk_nfo->evt_tim_trk[cwtool_track].flux_bytes += dsk_nfo->evt_tim.flux_bytes;
+	if ((! result) || (dsk_nfo->img_tee == NULL)) return (result);
 
-		/*
-		 * currently greedy is only used with format "raw". because
-		 * it uses fifo-functions to append the data, we need to
-		 * reset the fifo pointers before doing another try
-		 */
+	/*
+	 * append the untouched data of this try to the raw image given
+	 * with -t. image_raw_write() writes directly from ffo, it only
+	 * moves the read offset, which has to stay at the start for
+	 * decoding
+	 */
 
-		fifo_reset(ffo_dst);
+	stats_begin(WRITE);
+	image_raw_desc.track_write(dsk_nfo->img_tee, &dsk_trk->img_trk, ffo, NULL, 0, cwtool_track);
+	stats_end(WRITE);
+	fifo_set_rd_ofs(ffo, 0);
+	return (result);
+	}
 
-		/*
-		 * if this track is optional and we could not read
-		 * it, because the drive only supports double steps,
-		 * we simply ignore this track
-		 */
 
-		if (! dsk->img_dsc_l0->track_read(img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
-		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
-		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
-		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
-		dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+
+/****************************************************************************
+ * disk_track_cache_key
+ ****************************************************************************/
+static cw_void_t
+disk_track_cache_key(
+	struct cache_key		*cch_key,
+	struct disk_track		*dsk_trk,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	cw_count_t			cwtool_track,
+	cw_count_t			format_track,
+	cw_count_t			format_side)
+
+	{
+	int				sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	int				param[] = { cwtool_track, format_track, format_side, sectors, dsk_trk->img_trk.clock, fifo_get_flags(ffo_src), fifo_get_speed(ffo_src), fifo_get_wr_bitofs(ffo_dst) };
+	int				i;
+
+	/*
+	 * everything the decoder looks at: version, format and its
+	 * parameters, the state of the sectors (sectors already read
+	 * without errors are skipped) and the flux itself
+	 */
+
+	cache_key_init(cch_key);
+	cache_key_add(cch_key, GLOBAL_VERSION_STRING, sizeof (GLOBAL_VERSION_STRING));
+	cache_key_add(cch_key, dsk_trk->fmt_dsc->name, string_length(dsk_trk->fmt_dsc->name));
+	cache_key_add(cch_key, &dsk_trk->fmt, sizeof (union format));
+	cache_key_add(cch_key, param, sizeof (param));
+	for (i = 0; i < sectors; i++)
+		{
+		int			sct[] = { dsk_sct[i].number, dsk_sct[i].offset, dsk_sct[i].size, dsk_sct[i].err.flags, dsk_sct[i].err.errors, dsk_sct[i].err.warnings };
+
+		cache_key_add(cch_key, sct, sizeof (sct));
 		}
-	return (t);
+	cache_key_add(cch_key, &fifo_get_data(ffo_src)[fifo_get_rd_ofs(ffo_src)], fifo_get_wr_ofs(ffo_src) - fifo_get_rd_ofs(ffo_src));
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_greedy
+ * disk_track_cache_load
  ****************************************************************************/
-static void
-disk_track_read_greedy(
-	struct disk			*dsk,
-	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
-	char				**path_src,
-	union image			**img_src,
-	int				img_src_count,
-	union image			*img_dst,
-	struct file			*fil_output,
-	int				trackmap_index)
+static cw_bool_t
+disk_track_cache_load(
+	struct cache_key		*cch_key,
+	struct disk_track		*dsk_trk,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_dst,
+	cw_count_t			cwtool_track)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { 0, };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { 0, };
+	unsigned char			*data = disk_cache_data;
+	int				sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	int				size = cache_load(cch_key, data, DISK_CACHE_SIZE);
+	int				bitofs, data_size, end, i;
+
+	if (size < 8) return (CW_BOOL_FALSE);
+	bitofs    = import_u32_le(&data[0]);
+	data_size = import_u32_le(&data[4]);
+	if ((size != 8 + sectors * DISK_CACHE_SECTOR_SIZE + data_size) || (data_size > fifo_get_limit(ffo_dst)) || (bitofs > 8 * data_size)) return (CW_BOOL_FALSE);
+
+	/*
+	 * only sectors still needed got decoded, the others keep their
+	 * data from an earlier try
+	 */
+
+	data += 8 + sectors * DISK_CACHE_SECTOR_SIZE;
+	for (i = end = 0; i < sectors; i++)
+		{
+		unsigned char		*err = &disk_cache_data[8 + i * DISK_CACHE_SECTOR_SIZE];
+
+		if (dsk_sct[i].offset + dsk_sct[i].size > end) end = dsk_sct[i].offset + dsk_sct[i].size;
+		if (! disk_sector_needed(&dsk_sct[i])) continue;
+		dsk_sct[i].err = (struct disk_error)
+			{
+			.flags    = import_u32_le(&err[0]),
+			.errors   = import_u32_le(&err[4]),
+			.warnings = import_u32_le(&err[8])
+			};
+		if (dsk_sct[i].offset + dsk_sct[i].size <= data_size) memcpy(dsk_sct[i].data, &data[dsk_sct[i].offset], dsk_sct[i].size);
+		}
+	if (end < data_size) memcpy(&fifo_get_data(ffo_dst)[end], &data[end], data_size - end);
+	fifo_set_wr_bitofs(ffo_dst, bitofs);
+	verbose_message(GENERIC, 2, "took decoded track %d from cache", cwtool_track);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_cache_store
+ ****************************************************************************/
+static cw_void_t
+disk_track_cache_store(
+	struct cache_key		*cch_key,
+	struct disk_track		*dsk_trk,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_dst)
+
+	{
+	unsigned char			*data = disk_cache_data;
+	int				sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	int				data_size = fifo_get_wr_ofs(ffo_dst);
+	int				i;
+
+	for (i = 0; i < sectors; i++) if (dsk_sct[i].offset + dsk_sct[i].size > data_size) data_size = dsk_sct[i].offset + dsk_sct[i].size;
+	export_u32_le(&data[0], fifo_get_wr_bitofs(ffo_dst));
+	export_u32_le(&data[4], data_size);
+	data += 8;
+	for (i = 0; i < sectors; i++, data += DISK_CACHE_SECTOR_SIZE)
+		{
+		export_u32_le(&data[0], dsk_sct[i].err.flags);
+		export_u32_le(&data[4], dsk_sct[i].err.errors);
+		export_u32_le(&data[8], dsk_sct[i].err.warnings);
+		}
+	memcpy(data, fifo_get_data(ffo_dst), data_size);
+	cache_store(cch_key, disk_cache_data, 8 + sectors * DISK_CACHE_SECTOR_SIZE + data_size);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_decode
+ ****************************************************************************/
+static cw_void_t
+disk_track_decode(
+	struct disk_track		*dsk_trk,
+	struct disk_info		*dsk_nfo,
+	struct disk_sector		*dsk_sct,
+	struct container		*con,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	cw_count_t			cwtool_track,
+	cw_count_t			format_track,
+	cw_count_t			format_side)
+
+	{
+	cw_count64_t			t = event_clock();
+	struct cache_key		cch_key;
+	cw_bool_t			cache = cache_enabled();
+	cw_bool_t			cached = CW_BOOL_FALSE;
+
+	/*
+	 * greedy formats append to ffo_dst over all tries, and formats with
+	 * match_simple merge the data of all earlier tries kept in con. so
+	 * their result does not only depend on this flux. a cache hit
+	 * would also leave con without the data of this try
+	 */
+
+	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & (FORMAT_FLAG_GREEDY | FORMAT_FLAG_CONTAINER)) cache = CW_BOOL_FALSE;
+	stats_begin(DECODE);
+	if (cache)
+		{
+		disk_track_cache_key(&cch_key, dsk_trk, dsk_sct, ffo_src, ffo_dst, cwtool_track, format_track, format_side);
+		cached = disk_track_cache_load(&cch_key, dsk_trk, dsk_sct, ffo_dst, cwtool_track);
+		}
+	if (! cached)
+		{
+		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+		if ((cache) && (cache_enabled())) disk_track_cache_store(&cch_key, dsk_trk, dsk_sct, ffo_dst);
+		}
+	stats_end(DECODE);
+	dsk_nfo->evt_tim.decode_ns = event_clock() - t;
+	dsk_nfo->evt_tim_trk[cwtool_track].decode_ns += dsk_nfo->evt_tim.decode_ns;
+	}
+
+
+
+/****************************************************************************
+ * disk_retry_init
+ ****************************************************************************/
+static cw_void_t
+disk_retry_init(
+	struct disk_retry		*dsk_rty,
+	struct disk_sector		*dsk_sct)
+
+	{
+	int				i;
+
+	for (i = 0; i < GLOBAL_NR_SECTORS; i++) dsk_rty->err[i] = dsk_sct[i].err;
+	dsk_rty->idle = 0;
+	}
+
+
+
+/****************************************************************************
+ * disk_retry_more
+ ****************************************************************************/
+static cw_bool_t
+disk_retry_more(
+	struct disk_track		*dsk_trk,
+	struct disk_option		*dsk_opt,
+	cw_count_t			cwtool_track,
+	int				idle,
+	int				try,
+	cw_bool_t			verbose)
+
+	{
+	int				patience = dsk_trk->retry_patience;
+	int				budget   = dsk_trk->retry_budget;
+
+	/*
+	 * give up early if the last tries did not help, otherwise do the
+	 * retries given with -r. after that continue up to the budget as
+	 * long as there is progress
+	 */
+
+	if ((patience > 0) && (idle >= patience))
+		{
+		if (verbose) verbose_message(GENERIC, 1, "track %d: no progress for %d tries, stopping after try %d", cwtool_track, idle, try);
+		return (CW_BOOL_FALSE);
+		}
+	if (try < dsk_opt->retry) return (CW_BOOL_TRUE);
+	if (try >= budget) return (CW_BOOL_FALSE);
+	if (idle == 0)
+		{
+		if (verbose) verbose_message(GENERIC, 1, "track %d: still progress on try %d, extending retries up to %d", cwtool_track, try, budget);
+		return (CW_BOOL_TRUE);
+		}
+	if (patience > 0)
+		{
+		if (verbose) verbose_message(GENERIC, 1, "track %d: no progress on try %d, %d tries of patience left", cwtool_track, try, patience - idle);
+		return (CW_BOOL_TRUE);
+		}
+	return (CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * disk_retry_last
+ ****************************************************************************/
+static cw_bool_t
+disk_retry_last(
+	struct disk_retry		*dsk_rty,
+	struct disk_track		*dsk_trk,
+	struct disk_option		*dsk_opt,
+	cw_count_t			cwtool_track,
+	int				try)
+
+	{
+
+	/*
+	 * tells before the read if disk_retry_next() will stop after this
+	 * try. a retry seldom improves a sector, so this try is assumed to
+	 * improve none. if it does, the head has to come back
+	 */
+
+	return (disk_retry_more(dsk_trk, dsk_opt, cwtool_track, dsk_rty->idle + 1, try, CW_BOOL_FALSE) ? CW_BOOL_FALSE : CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_retry_next
+ ****************************************************************************/
+static cw_bool_t
+disk_retry_next(
+	struct disk_retry		*dsk_rty,
+	struct disk_track		*dsk_trk,
+	struct disk_option		*dsk_opt,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			cwtool_track,
+	int				try)
+
+	{
+	int				sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	int				i, improved;
+
+	/* count sectors which got better with the try just done */
+
+	for (i = improved = 0; i < sectors; i++)
+		{
+		if ((dsk_sct[i].err.errors < dsk_rty->err[i].errors) ||
+			((dsk_sct[i].err.errors == dsk_rty->err[i].errors) && (dsk_sct[i].err.warnings < dsk_rty->err[i].warnings))) improved++;
+		dsk_rty->err[i] = dsk_sct[i].err;
+		}
+	if (improved > 0) dsk_rty->idle = 0;
+	else dsk_rty->idle++;
+	verbose_message(GENERIC, 2, "track %d: try %d improved %d sectors", cwtool_track, try, improved);
+	return (disk_retry_more(dsk_trk, dsk_opt, cwtool_track, dsk_rty->idle, try, CW_BOOL_TRUE));
+	}
+
+
+
+/****************************************************************************
+ * disk_track_write_image
+ ****************************************************************************/
+static cw_void_t
+disk_track_write_image(
+	struct disk			*dsk,
+	struct disk_track		*dsk_trk,
+	struct disk_sector		*dsk_sct,
+	union image			*img_dst,
+	struct fifo			*ffo_dst,
+	cw_count_t			cwtool_track,
+	cw_count_t			image_track)
+
+	{
+	stats_track(cwtool_track);
+	stats_begin(WRITE);
+	dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+	stats_end(WRITE);
+	stats_count(IMAGE_BYTES, cwtool_track, fifo_get_wr_ofs(ffo_dst));
+	}
+
+
+
+/****************************************************************************
+ * disk_journal_write_record
+ ****************************************************************************/
+static cw_size_t
+disk_journal_write_record(
+	struct file			*fil,
+	struct disk_journal_entry	*dsk_jrn_ent,
+	int				index)
+
+	{
+	unsigned char			header[DISK_JOURNAL_HEADER_SIZE] = { DISK_JOURNAL_HEADER_MAGIC };
+	unsigned char			sector[GLOBAL_NR_SECTORS * DISK_JOURNAL_SECTOR_SIZE];
+	int				i;
+
+	export_u16_le(&header[2], index);
+	export_u16_le(&header[4], dsk_jrn_ent->track);
+	export_u16_le(&header[6], dsk_jrn_ent->sectors);
+	export_u32_le(&header[8], dsk_jrn_ent->offset);
+	export_u32_le(&header[12], dsk_jrn_ent->bitofs);
+	export_u32_le(&header[16], dsk_jrn_ent->size);
+	for (i = 0; i < dsk_jrn_ent->sectors; i++)
+		{
+		export_u32_le(&sector[i * DISK_JOURNAL_SECTOR_SIZE], dsk_jrn_ent->err[i].flags);
+		export_u32_le(&sector[i * DISK_JOURNAL_SECTOR_SIZE + 4], dsk_jrn_ent->err[i].errors);
+		export_u32_le(&sector[i * DISK_JOURNAL_SECTOR_SIZE + 8], dsk_jrn_ent->err[i].warnings);
+		}
+	file_write(fil, header, sizeof (header));
+	file_write(fil, sector, dsk_jrn_ent->sectors * DISK_JOURNAL_SECTOR_SIZE);
+	file_write(fil, dsk_jrn_ent->data, dsk_jrn_ent->size);
+	return (sizeof (header) + dsk_jrn_ent->sectors * DISK_JOURNAL_SECTOR_SIZE + dsk_jrn_ent->size);
+	}
+
+
+
+/****************************************************************************
+ * disk_journal_read_record
+ ****************************************************************************/
+static cw_bool_t
+disk_journal_read_record(
+	struct file			*fil,
+	struct disk_journal		*dsk_jrn)
+
+	{
+	struct disk_journal_entry	dsk_jrn_ent = { };
+	unsigned char			header[DISK_JOURNAL_HEADER_SIZE];
+	unsigned char			sector[GLOBAL_NR_SECTORS * DISK_JOURNAL_SECTOR_SIZE];
+	int				index, i;
+
+	/*
+	 * a record may be incomplete if cwtool was interrupted while
+	 * writing it, everything from there on is ignored
+	 */
+
+	if (file_read(fil, header, sizeof (header)) != sizeof (header)) return (CW_BOOL_FALSE);
+	index = import_u16_le(&header[2]);
+	dsk_jrn_ent = (struct disk_journal_entry)
+		{
+		.track   = import_u16_le(&header[4]),
+		.sectors = import_u16_le(&header[6]),
+		.offset  = import_u32_le(&header[8]),
+		.bitofs  = import_u32_le(&header[12]),
+		.size    = import_u32_le(&header[16])
+		};
+	if ((header[0] != DISK_JOURNAL_HEADER_MAGIC) || (index >= dsk_jrn->entries) ||
+		(dsk_jrn_ent.sectors > GLOBAL_NR_SECTORS) || (dsk_jrn_ent.size > GLOBAL_MAX_TRACK_SIZE) ||
+		(dsk_jrn_ent.bitofs > 8 * dsk_jrn_ent.size)) return (CW_BOOL_FALSE);
+	if (file_read(fil, sector, dsk_jrn_ent.sectors * DISK_JOURNAL_SECTOR_SIZE) != dsk_jrn_ent.sectors * DISK_JOURNAL_SECTOR_SIZE) return (CW_BOOL_FALSE);
+	for (i = 0; i < dsk_jrn_ent.sectors; i++) dsk_jrn_ent.err[i] = (struct disk_error)
+		{
+		.flags    = import_u32_le(&sector[i * DISK_JOURNAL_SECTOR_SIZE]),
+		.errors   = import_u32_le(&sector[i * DISK_JOURNAL_SECTOR_SIZE + 4]),
+		.warnings = import_u32_le(&sector[i * DISK_JOURNAL_SECTOR_SIZE + 8])
+		};
+	dsk_jrn_ent.data = (unsigned char *) malloc(dsk_jrn_ent.size + 1);
+	if (dsk_jrn_ent.data == NULL) error_oom();
+	if (file_read(fil, dsk_jrn_ent.data, dsk_jrn_ent.size) != dsk_jrn_ent.size)
+		{
+		free(dsk_jrn_ent.data);
+		return (CW_BOOL_FALSE);
+		}
+	free(dsk_jrn->ent[index].data);
+	dsk_jrn->ent[index] = dsk_jrn_ent;
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_journal_open
+ ****************************************************************************/
+static cw_void_t
+disk_journal_open(
+	struct disk_info		*dsk_nfo,
+	struct disk			*dsk,
+	char				*path_dst)
+
+	{
+	struct disk_journal		*dsk_jrn;
+	struct file			fil;
+	char				path_tmp[GLOBAL_MAX_PATH_SIZE];
+	char				magic[DISK_JOURNAL_MAGIC_SIZE];
+	char				name[GLOBAL_MAX_NAME_SIZE] = { };
+	cw_size_t			size;
+	int				records = 0, i;
+
+	dsk_jrn = (struct disk_journal *) calloc(1, sizeof (struct disk_journal));
+	if (dsk_jrn == NULL) error_oom();
+	dsk_jrn->entries = trackmap_entries(dsk->trm);
+	dsk_jrn->ent = (struct disk_journal_entry *) calloc(dsk_jrn->entries, sizeof (struct disk_journal_entry));
+	if (dsk_jrn->ent == NULL) error_oom();
+	string_snprintf(dsk_jrn->path, GLOBAL_MAX_PATH_SIZE, "%s.journal", path_dst);
+	string_snprintf(path_tmp, GLOBAL_MAX_PATH_SIZE, "%s.journal.tmp", path_dst);
+
+	/* take over the records of a journal left by an interrupted read */
+
+	if (file_open(&fil, dsk_jrn->path, FILE_MODE_READ, FILE_FLAG_RETURN))
+		{
+		if ((file_read(&fil, magic, sizeof (magic)) != sizeof (magic)) || (memcmp(magic, disk_journal_magic, sizeof (magic)) != 0)) error_message("file '%s' is no journal", dsk_jrn->path);
+		if (file_read(&fil, name, sizeof (name)) != sizeof (name)) error_message("file '%s' truncated", dsk_jrn->path);
+		name[sizeof (name) - 1] = '\0';
+		if (! string_equal(name, dsk->name)) error_message("journal '%s' was written for disk '%s' and not for '%s'", dsk_jrn->path, name, dsk->name);
+		while (disk_journal_read_record(&fil, dsk_jrn)) records++;
+		file_close(&fil);
+		verbose_message(GENERIC, 1, "resuming with %d records from journal '%s'", records, dsk_jrn->path);
+		}
+
+	/*
+	 * write the records taken over to a new journal and replace the old
+	 * one, so an incomplete record at the end is dropped
+	 */
+
+	string_copy(name, sizeof (name), dsk->name);
+	file_open(&fil, path_tmp, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	file_write(&fil, disk_journal_magic, sizeof (disk_journal_magic));
+	file_write(&fil, name, sizeof (name));
+	size = sizeof (disk_journal_magic) + sizeof (name);
+	for (i = 0; i < dsk_jrn->entries; i++) if (dsk_jrn->ent[i].data != NULL) size += disk_journal_write_record(&fil, &dsk_jrn->ent[i], i);
+	file_sync(&fil);
+	file_close(&fil);
+	if (rename(path_tmp, dsk_jrn->path) == -1) error_perror_message("error while renaming '%s' to '%s'", path_tmp, dsk_jrn->path);
+	file_open(&dsk_jrn->fil, dsk_jrn->path, FILE_MODE_WRITE, FILE_FLAG_NONE);
+	file_seek(&dsk_jrn->fil, size, FILE_FLAG_NONE);
+	dsk_nfo->dsk_jrn = dsk_jrn;
+	}
+
+
+
+/****************************************************************************
+ * disk_journal_close
+ ****************************************************************************/
+static cw_void_t
+disk_journal_close(
+	struct disk_info		*dsk_nfo,
+	char				*path_dst)
+
+	{
+	struct disk_journal		*dsk_jrn = dsk_nfo->dsk_jrn;
+	struct file			fil;
+	int				i;
+
+	/*
+	 * all tracks are read, so the journal is not needed anymore. the
+	 * destination is already closed, so images like g64 or d64 with
+	 * error info are complete and a background writer has finished.
+	 * it is synced before the journal is removed, otherwise a power
+	 * loss could lose both
+	 */
+
+	if (dsk_jrn == NULL) return;
+	file_close(&dsk_jrn->fil);
+	file_open(&fil, path_dst, FILE_MODE_READ, FILE_FLAG_NONE);
+	file_sync(&fil);
+	file_close(&fil);
+	verbose_message(GENERIC, 1, "removing journal '%s'", dsk_jrn->path);
+	if (unlink(dsk_jrn->path) == -1) error_perror_message("error while removing '%s'", dsk_jrn->path);
+	for (i = 0; i < dsk_jrn->entries; i++) free(dsk_jrn->ent[i].data);
+	free(dsk_jrn->ent);
+	free(dsk_jrn);
+	dsk_nfo->dsk_jrn = NULL;
+	}
+
+
+
+/****************************************************************************
+ * disk_journal_restore
+ ****************************************************************************/
+static cw_bool_t
+disk_journal_restore(
+	struct disk_info		*dsk_nfo,
+	struct disk_track		*dsk_trk,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_dst,
+	cw_count_t			cwtool_track,
+	int				trackmap_index,
+	int				offset)
+
+	{
+	struct disk_journal_entry	*dsk_jrn_ent;
+	int				sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	int				i;
+
+	if (dsk_nfo->dsk_jrn == NULL) return (CW_BOOL_FALSE);
+	dsk_jrn_ent = &dsk_nfo->dsk_jrn->ent[trackmap_index];
+	if (dsk_jrn_ent->data == NULL) return (CW_BOOL_FALSE);
+	if ((dsk_jrn_ent->track != cwtool_track) || (dsk_jrn_ent->sectors != sectors) ||
+		(dsk_jrn_ent->offset != offset) || (dsk_jrn_ent->size > fifo_get_limit(ffo_dst)))
+		{
+		error_warning("journal record for track %d does not match, reading it again", cwtool_track);
+		return (CW_BOOL_FALSE);
+		}
+
+	/*
+	 * sectors keep the best state of the interrupted read, so retries
+	 * only need to care about the sectors which are still bad
+	 */
+
+	for (i = 0; i < sectors; i++) dsk_sct[i].err = dsk_jrn_ent->err[i];
+	memcpy(fifo_get_data(ffo_dst), dsk_jrn_ent->data, dsk_jrn_ent->size);
+	fifo_set_wr_bitofs(ffo_dst, dsk_jrn_ent->bitofs);
+	if (disk_sectors_needed(dsk_sct, sectors) > 0) return (CW_BOOL_FALSE);
+
+	/* nothing left to read on this track */
+
+	verbose_message(GENERIC, 1, "track %d already read, taking it from journal", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, 0, offset, 1);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_journal_write
+ ****************************************************************************/
+static cw_void_t
+disk_journal_write(
+	struct disk_info		*dsk_nfo,
+	struct disk_track		*dsk_trk,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_dst,
+	cw_count_t			cwtool_track,
+	int				trackmap_index,
+	int				offset)
+
+	{
+	struct disk_journal_entry	dsk_jrn_ent;
+	int				i;
+
+	if (dsk_nfo->dsk_jrn == NULL) return;
+	dsk_jrn_ent = (struct disk_journal_entry)
+		{
+		.track   = cwtool_track,
+		.sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt),
+		.offset  = offset,
+		.bitofs  = fifo_get_wr_bitofs(ffo_dst),
+		.size    = fifo_get_wr_ofs(ffo_dst),
+		.data    = fifo_get_data(ffo_dst)
+		};
+	for (i = 0; i < dsk_jrn_ent.sectors; i++) dsk_jrn_ent.err[i] = dsk_sct[i].err;
+	disk_journal_write_record(&dsk_nfo->dsk_jrn->fil, &dsk_jrn_ent, trackmap_index);
+	file_sync(&dsk_nfo->dsk_jrn->fil);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_statistics
+ ****************************************************************************/
+static void
+disk_track_statistics(
+	struct disk			*dsk,
+	union image			*img,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	unsigned char			data[GLOBAL_MAX_TRACK_SIZE] = { };
+	struct fifo			ffo = FIFO_INIT(data, sizeof (data));
+	cw_count_t			cwtool_track, format_track, format_side;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
+
+	/* if this track is not within the wanted range, ignore it */
+
+	if (cwtool_track < options_get_disk_track_start()) goto done;
+	if (cwtool_track > options_get_disk_track_end()) goto done;
+
+	/* skip this track if no format is defined */
+
+	if (dsk_trk->fmt_dsc == NULL) goto done;
+	debug_error_condition(dsk_trk->fmt_dsc->track_statistics == NULL);
+	disk_track_read_next(dsk, img, trackmap_index, CW_BOOL_TRUE);
+
+	/* skip this track if it is optional and we got no data */
+
+	if (! disk_track_read_l0(dsk, dsk_trk, NULL, img, &ffo, cwtool_track, 0))
+		{
+		if (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL) goto done;
+		error_message("no data available for track %d", cwtool_track);
+		}
+	dsk_trk->fmt_dsc->track_statistics(&dsk_trk->fmt, &ffo, cwtool_track, format_track, format_side);
+done:
+	dsk->img_dsc_l0->track_done(img, &dsk_trk->img_trk, cwtool_track);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_greedy2
+ ****************************************************************************/
+static int
+disk_track_read_greedy2(
+	struct disk			*dsk,
+	struct disk_sector		*dsk_sct,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	union image			*img_src,
+	union image			*img_dst,
+	struct container		*con,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	int				offset = dsk->img_dsc->offset(img_dst);
+	cw_count_t			cwtool_track, image_track;
+	cw_count_t			format_track, format_side;
+	int				t;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
+	for (t = 0; t <= dsk_opt->retry; t++)
+		{
+		fifo_reset(ffo_src);
+
+		/*
+		 * currently greedy is only used with format "raw". because
+		 * it uses fifo-functions to append the data, we need to
+		 * reset the fifo pointers before doing another try
+		 */
+
+		fifo_reset(ffo_dst);
+		disk_track_read_next(dsk, img_src, trackmap_index, (t == dsk_opt->retry) ? CW_BOOL_TRUE : CW_BOOL_FALSE);
+
+		/*
+		 * if this track is optional and we could not read
+		 * it, because the drive only supports double steps,
+		 * we simply ignore this track
+		 */
+
+		if (! disk_track_read_l0(dsk, dsk_trk, dsk_nfo, img_src, ffo_src, cwtool_track, t)) break;
+		disk_track_decode(dsk_trk, dsk_nfo, dsk_sct, con, ffo_src, ffo_dst, cwtool_track, format_track, format_side);
+		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		disk_track_write_image(dsk, dsk_trk, dsk_sct, img_dst, ffo_dst, cwtool_track, image_track);
+		}
+	return (t);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_greedy
+ ****************************************************************************/
+static void
+disk_track_read_greedy(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct file			*fil_output,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
+	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { 0, };
+	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { 0, };
+	struct container		*con;
+	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+	int				offset  = dsk->img_dsc->offset(img_dst);
+	cw_count_t			cwtool_track;
+	int				i, t = 0;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
+
+	/*
+	 * if this track is not within the wanted range, ignore it. because
+	 * the format is greedy there is no fixed size for the data to be
+	 * written, so nothing is written to img_dst
+	 */
+
+	if (cwtool_track < options_get_disk_track_start()) goto done;
+	if (cwtool_track > options_get_disk_track_end()) goto done;
+
+	/*
+	 * skip this track if ffo_dst would contain 0 bytes, this is the case
+	 * with format fill
+	 */
+
+	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+
+	con = container_init(NULL);
+	for (i = 0; i < img_src_count; i++)
+		{
+		disk_info_update_path(dsk_nfo, path_src[i]);
+		t += disk_track_read_greedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], img_dst, con, &ffo_src, &ffo_dst, trackmap_index);
+		}
+	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+	container_deinit(con);
+	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_nongreedy2
+ ****************************************************************************/
+static int
+disk_track_read_nongreedy2(
+	struct disk			*dsk,
+	struct disk_sector		*dsk_sct,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	union image			*img_src,
+	struct container		*con,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	int				offset,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_retry		dsk_rty;
+	cw_count_t			cwtool_track, format_track, format_side;
+	cw_bool_t			more;
+	int				t;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
+	disk_retry_init(&dsk_rty, dsk_sct);
+	for (more = CW_BOOL_TRUE, t = 0; more; t++)
+		{
+		fifo_reset(ffo_src);
+
+		/*
+		 * most tracks are good on the first try, so seek ahead
+		 * then. if the track turns out to be bad the head has to
+		 * come back, which costs less than a revolution. further
+		 * retries keep the head on this track, unless
+		 * disk_retry_next() will stop after them
+		 */
+
+		disk_track_read_next(dsk, img_src, trackmap_index, ((t == 0) || (disk_retry_last(&dsk_rty, dsk_trk, dsk_opt, cwtool_track, t))) ? CW_BOOL_TRUE : CW_BOOL_FALSE);
+
+		/*
+		 * if this track is optional and we could not read
+		 * it, because the drive only supports double steps,
+		 * we simply ignore this track
+		 */
+
+		if (! disk_track_read_l0(dsk, dsk_trk, dsk_nfo, img_src, ffo_src, cwtool_track, t)) break;
+		disk_track_decode(dsk_trk, dsk_nfo, dsk_sct, con, ffo_src, ffo_dst, cwtool_track, format_track, format_side);
+		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		if (dsk_nfo->sectors_bad == 0) more = CW_BOOL_FALSE;
+		else more = disk_retry_next(&dsk_rty, dsk_trk, dsk_opt, dsk_sct, cwtool_track, t);
+		}
+	return (t);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_nongreedy
+ ****************************************************************************/
+static void
+disk_track_read_nongreedy(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct file			*fil_output,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
+	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
+	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
 	struct container		*con;
 	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
 	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
 	int				offset  = dsk->img_dsc->offset(img_dst);
+	int				i, t = 0;
+	cw_count_t			cwtool_track, image_track;
+
+	/*
+	 * skip this track if ffo_dst would contain 0 bytes, this is the case
+	 * with format fill
+	 */
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	image_track = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
+	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+
+	/*
+	 * if this track is not within the wanted range, just write zeros
+	 * to img_dst and skip all reading routines. thats why
+	 * disk_sectors_init() can not be skipped
+	 */
+
+	if (cwtool_track < options_get_disk_track_start()) goto done_write;
+	if (cwtool_track > options_get_disk_track_end()) goto done_write;
+	if (disk_journal_restore(dsk_nfo, dsk_trk, dsk_sct, &ffo_dst, cwtool_track, trackmap_index, offset)) goto done_write;
+
+	con = container_init(NULL);
+	for (i = 0; i < img_src_count; i++)
+		{
+		disk_info_update_path(dsk_nfo, path_src[i]);
+		t += disk_track_read_nongreedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], con, &ffo_src, &ffo_dst, offset, trackmap_index);
+		if ((t > 0) && (dsk_nfo->sectors_bad == 0)) break;
+		}
+	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+	container_deinit(con);
+	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
+	disk_journal_write(dsk_nfo, dsk_trk, dsk_sct, &ffo_dst, cwtool_track, trackmap_index, offset);
+done_write:
+	disk_track_write_image(dsk, dsk_trk, dsk_sct, img_dst, &ffo_dst, cwtool_track, image_track);
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read
+ ****************************************************************************/
+static void
+disk_track_read(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct file			*fil_output,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
+
+	/* skip this track if no format is defined */
+
+	if (dsk_trk->fmt_dsc == NULL) return;
+	debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
+	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) disk_track_read_greedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
+	else disk_track_read_nongreedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
+	}
+
+
+
+/****************************************************************************
+ * disk_greedy
+ ****************************************************************************/
+static cw_bool_t
+disk_greedy(
+	struct disk			*dsk)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			i;
+
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		dsk_trk = dsk->trk[trackmap_entry_get_cwtool_track(dsk->trm, trm_ent)];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) return (CW_BOOL_TRUE);
+		}
+	return (CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_deferred_done
+ ****************************************************************************/
+static void
+disk_track_read_deferred_done(
+	struct disk			*dsk,
+	struct disk_info		*dsk_nfo,
+	union image			**img_src,
+	int				img_src_count,
+	struct file			*fil_output,
+	struct disk_track_deferred	*dfr,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
 	cw_count_t			cwtool_track;
-	int				i, t = 0;
+	int				i;
 
 	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
 	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-
-	/*
-	 * if this track is not within the wanted range, ignore it. because
-	 * the format is greedy there is no fixed size for the data to be
-	 * written, so nothing is written to img_dst
-	 */
-
-	if (cwtool_track < options_get_disk_track_start()) goto done;
-	if (cwtool_track > options_get_disk_track_end()) goto done;
-
-	/*
-	 * skip this track if ffo_dst would contain 0 bytes, this is the case
-	 * with format fill
-	 */
-
-	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
-
-	con = container_init(NULL);
-	for (i = 0; i < img_src_count; i++)
+	dsk_trk = dsk->trk[cwtool_track];
+	if (dfr->flags & DEFERRED_FLAG_READ)
 		{
-		disk_info_update_path(dsk_nfo, path_src[i]);
-		t += disk_track_read_greedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], img_dst, con, &ffo_src, &ffo_dst, trackmap_index);
+		disk_dump_bad_sectors(dsk_trk, dfr->dsk_sct, fil_output, dfr->con, cwtool_track, dsk_trk->img_trk.clock);
+		container_deinit(dfr->con);
+		dfr->con = NULL;
+		if ((dfr->tries == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+		disk_info_update(dsk_nfo, dsk_trk, dfr->dsk_sct, cwtool_track, dfr->tries, dfr->offset, 1);
+		disk_journal_write(dsk_nfo, dsk_trk, dfr->dsk_sct, &dfr->ffo_dst, cwtool_track, trackmap_index, dfr->offset);
 		}
-	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
-	container_deinit(con);
-	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
-done:
 	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	dfr->flags |= DEFERRED_FLAG_DONE;
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_nongreedy2
+ * disk_track_read_deferred_try
  ****************************************************************************/
-static int
-disk_track_read_nongreedy2(
+static cw_bool_t
+disk_track_read_deferred_try(
 	struct disk			*dsk,
-	struct disk_sector		*dsk_sct,
 	struct disk_option		*dsk_opt,
 	struct disk_info		*dsk_nfo,
-	union image			*img_src,
-	struct container		*con,
-	struct fifo			*ffo_src,
-	struct fifo			*ffo_dst,
-	int				offset,
-	int				trackmap_index)
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	struct disk_track_deferred	*dfr,
+	cw_index_t			trackmap_index,
+	cw_index_t			trackmap_index_next)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
+	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE];
+	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
 	cw_count_t			cwtool_track, format_track, format_side;
-	int				b, t;
 
 	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
 	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
 	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
 	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-	for (b = -1, t = 0; (b != 0) && (t <= dsk_opt->retry); t++)
+	dsk_trk = dsk->trk[cwtool_track];
+
+	/*
+	 * do exactly one read of this track. the tries are counted per
+	 * source image like disk_track_read_nongreedy2() does, if all
+	 * tries of one source are used up, the next source is taken.
+	 * every revolution is merged into the container kept for this
+	 * track
+	 */
+
+	while (dfr->src < img_src_count)
 		{
-		fifo_reset(ffo_src);
+		if (dfr->flags & DEFERRED_FLAG_NEXT_SOURCE)
+			{
+			dfr->flags &= ~DEFERRED_FLAG_NEXT_SOURCE;
+			dfr->src++, dfr->try = 0;
+			continue;
+			}
+		if (dfr->try == 0) disk_retry_init(&dfr->dsk_rty, dfr->dsk_sct);
+		disk_info_update_path(dsk_nfo, path_src[dfr->src]);
+		disk_track_read_hint(dsk, img_src[dfr->src], trackmap_index_next);
 
 		/*
 		 * if this track is optional and we could not read
 		 * it, because the drive only supports double steps,
-		 * we simply ignore this track
+		 * we simply try the next source
 		 */
 
-		if (! dsk->img_dsc_l0->track_read(img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
-		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
-		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
+		if (! disk_track_read_l0(dsk, dsk_trk, dsk_nfo, img_src[dfr->src], &ffo_src, cwtool_track, dfr->try))
+			{
+			dfr->src++, dfr->try = 0;
+			continue;
+			}
+		disk_track_decode(dsk_trk, dsk_nfo, dfr->dsk_sct, dfr->con, &ffo_src, &dfr->ffo_dst, cwtool_track, format_track, format_side);
+		disk_info_update(dsk_nfo, dsk_trk, dfr->dsk_sct, cwtool_track, dfr->try, dfr->offset, 0);
 		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
-		b = dsk_nfo->sectors_bad;
+		dfr->try++, dfr->tries++;
+		if (dsk_nfo->sectors_bad == 0) return (CW_BOOL_TRUE);
+		if (disk_retry_next(&dfr->dsk_rty, dsk_trk, dsk_opt, dfr->dsk_sct, cwtool_track, dfr->try - 1)) return (CW_BOOL_FALSE);
+		if (dfr->src + 1 >= img_src_count) return (CW_BOOL_TRUE);
+		dfr->flags |= DEFERRED_FLAG_NEXT_SOURCE;
+		return (CW_BOOL_FALSE);
 		}
-	return (t);
+	return (CW_BOOL_TRUE);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_nongreedy
+ * disk_track_read_deferred_flush
  ****************************************************************************/
-static void
-disk_track_read_nongreedy(
+static cw_index_t
+disk_track_read_deferred_flush(
 	struct disk			*dsk,
-	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
-	char				**path_src,
-	union image			**img_src,
-	int				img_src_count,
 	union image			*img_dst,
-	struct file			*fil_output,
-	int				trackmap_index)
+	struct disk_track_deferred	*dfr,
+	cw_index_t			trackmap_index)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
-	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct container		*con;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
-	int				offset  = dsk->img_dsc->offset(img_dst);
-	int				i, t = 0;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
 	cw_count_t			cwtool_track, image_track;
 
 	/*
-	 * skip this track if ffo_dst would contain 0 bytes, this is the case
-	 * with format fill
-	 */
-
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	image_track = trackmap_entry_get_image_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
-
-	/*
-	 * if this track is not within the wanted range, just write zeros
-	 * to img_dst and skip all reading routines. thats why
-	 * disk_sectors_init() can not be skipped
+	 * images are written sequentially, so a track can only be written
+	 * after all tracks before it are done
 	 */
 
-	if (cwtool_track < options_get_disk_track_start()) goto done_write;
-	if (cwtool_track > options_get_disk_track_end()) goto done_write;
-
-	con = container_init(NULL);
-	for (i = 0; i < img_src_count; i++)
+	for ( ; (trackmap_index < entries) && (dfr[trackmap_index].flags & DEFERRED_FLAG_DONE); trackmap_index++)
 		{
-		disk_info_update_path(dsk_nfo, path_src[i]);
-		t += disk_track_read_nongreedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], con, &ffo_src, &ffo_dst, offset, trackmap_index);
-		if ((t > 0) && (dsk_nfo->sectors_bad == 0)) break;
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+		cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+		dsk_trk = dsk->trk[cwtool_track];
+		if (dfr[trackmap_index].flags & DEFERRED_FLAG_WRITE) disk_track_write_image(dsk, dsk_trk,
+			dfr[trackmap_index].dsk_sct, img_dst, &dfr[trackmap_index].ffo_dst, cwtool_track, image_track);
+		if (dfr[trackmap_index].data != NULL) free(dfr[trackmap_index].data);
+		dfr[trackmap_index].data = NULL;
 		}
-	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
-	container_deinit(con);
-	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
-done_write:
-	dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, &ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
-done:
-	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	return (trackmap_index);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read
+ * disk_track_read_deferred
  ****************************************************************************/
 static void
-disk_track_read(
+disk_track_read_deferred(
 	struct disk			*dsk,
 	struct disk_option		*dsk_opt,
 	struct disk_info		*dsk_nfo,
@@ -622,24 +1612,100 @@ disk_track_read(
 	union image			**img_src,
 	int				img_src_count,
 	union image			*img_dst,
-	struct file			*fil_output,
-	cw_index_t			trackmap_index)
+	struct file			*fil_output)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	cw_count_t			cwtool_track;
+	struct disk_track_deferred	*dfr;
+	cw_index_t			*order;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_count_t			cwtool_track, pending = 0;
+	int				offset = dsk->img_dsc->offset(img_dst);
+	cw_index_t			flushed = 0, i, j, k, p;
 
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
+	dfr   = (struct disk_track_deferred *) calloc(entries, sizeof (struct disk_track_deferred));
+	order = (cw_index_t *) malloc(entries * sizeof (cw_index_t));
+	if ((dfr == NULL) || (order == NULL)) error_oom();
 
-	/* skip this track if no format is defined */
+	/*
+	 * first pass: read every track once. good tracks are finished
+	 * immediately, bad tracks keep their container and sectors for
+	 * later passes. the offsets in img_dst are known in advance,
+	 * because nongreedy formats always write a fixed size
+	 */
 
-	if (dsk_trk->fmt_dsc == NULL) return;
-	debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
-	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) disk_track_read_greedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
-	else disk_track_read_nongreedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
+	for (i = 0; i < entries; i++)
+		{
+		struct trackmap_entry	*trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		struct disk_track	*dsk_trk;
+
+		cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		dsk_trk = dsk->trk[cwtool_track];
+		if (dsk_trk->fmt_dsc == NULL)
+			{
+			dfr[i].flags = DEFERRED_FLAG_DONE;
+			goto flush;
+			}
+		debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+		dfr[i].data = (unsigned char *) calloc(GLOBAL_MAX_TRACK_SIZE, sizeof (unsigned char));
+		if (dfr[i].data == NULL) error_oom();
+		dfr[i].ffo_dst = FIFO_INIT(dfr[i].data, GLOBAL_MAX_TRACK_SIZE);
+		dfr[i].offset  = offset;
+
+		/*
+		 * skip this track if ffo_dst would contain 0 bytes, this is
+		 * the case with format fill. tracks not within the wanted
+		 * range are written with zeros
+		 */
+
+		if (disk_sectors_init(dfr[i].dsk_sct, dsk_trk, &dfr[i].ffo_dst, 0) == 0) goto done;
+		dfr[i].flags = DEFERRED_FLAG_WRITE;
+		offset += fifo_get_wr_ofs(&dfr[i].ffo_dst);
+		if (cwtool_track < options_get_disk_track_start()) goto done;
+		if (cwtool_track > options_get_disk_track_end()) goto done;
+		if (disk_journal_restore(dsk_nfo, dsk_trk, dfr[i].dsk_sct, &dfr[i].ffo_dst, cwtool_track, i, dfr[i].offset)) goto done;
+		dfr[i].flags |= DEFERRED_FLAG_READ;
+		dfr[i].con = container_init(NULL);
+		if (! disk_track_read_deferred_try(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, &dfr[i], i, disk_track_next_index(dsk, i)))
+			{
+			pending++;
+			goto flush;
+			}
+	done:
+		disk_track_read_deferred_done(dsk, dsk_nfo, img_src, img_src_count, fil_output, &dfr[i], i);
+	flush:
+		flushed = disk_track_read_deferred_flush(dsk, img_dst, dfr, flushed);
+		}
+
+	/*
+	 * retry passes: only bad tracks are read again, each pass sweeps in
+	 * the opposite direction of the previous one, so the head does not
+	 * need to travel back and the track read last is read first again
+	 */
+
+	for (p = 1; pending > 0; p++)
+		{
+		verbose_message(GENERIC, 1, "retry pass %d with %d bad tracks", p, pending);
+		for (i = j = 0; i < entries; i++)
+			{
+			k = (p & 1) ? entries - 1 - i : i;
+			if (! (dfr[k].flags & DEFERRED_FLAG_READ)) continue;
+			if (dfr[k].flags & DEFERRED_FLAG_DONE) continue;
+			order[j++] = k;
+			}
+		for (i = 0; i < j; i++)
+			{
+			if (! disk_track_read_deferred_try(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, &dfr[order[i]], order[i], (i + 1 < j) ? order[i + 1] : -1)) continue;
+			disk_track_read_deferred_done(dsk, dsk_nfo, img_src, img_src_count, fil_output, &dfr[order[i]], order[i]);
+			pending--;
+			}
+		flushed = disk_track_read_deferred_flush(dsk, img_dst, dfr, flushed);
+		}
+
+	/* done */
+
+	debug_error_condition(flushed != entries);
+	free(order);
+	free(dfr);
 	}
 
 
@@ -665,7 +1731,7 @@ disk_write_data_size(
 		{
 		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
 		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-		dsk_trk = &dsk->trk[ct];
+		dsk_trk = dsk->trk[ct];
 		if (dsk_trk->fmt_dsc == NULL) continue;
 		if (dsk_trk->fmt_dsc->get_data_offset == NULL) continue;
 		if (dsk_trk->fmt_dsc->get_data_size == NULL) continue;
@@ -708,7 +1774,7 @@ disk_write_data_get(
 		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
 		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
 		it = trackmap_entry_get_image_track(dsk->trm, trm_ent);
-		dsk_trk = &dsk->trk[ct];
+		dsk_trk = dsk->trk[ct];
 		if (dsk_trk->fmt_dsc == NULL) continue;
 		disk_sectors_init(dsk_sct, dsk_trk, &ffo_tmp, 1);
 		if (fifo_get_limit(&ffo_tmp) == 0) continue;
@@ -735,27 +1801,22 @@ disk_write_data_get(
 
 
 /****************************************************************************
- * disk_track_write
+ * disk_track_encode
  ****************************************************************************/
-static void
-disk_track_write(
+static cw_bool_t
+disk_track_encode(
 	struct disk			*dsk,
-	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
 	struct disk_track_buffer	*dsk_trk_buf,
 	union image			*img_src,
-	union image			*img_dst,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
 	cw_index_t			trackmap_index)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
-	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
 	unsigned char			*data = NULL;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
 	int				offset, size;
 	cw_count_t			cwtool_track, image_track, format_track, format_side;
 
@@ -764,12 +1825,13 @@ disk_track_write(
 	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
 	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
 	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
+	dsk_trk = dsk->trk[cwtool_track];
+	stats_track(cwtool_track);
 
 	/* skip this track if no format is defined */
 
-	if (dsk_trk->fmt_dsc == NULL) return;
-	disk_sectors_init(dsk_sct, dsk_trk, &ffo_src, 1);
+	if (dsk_trk->fmt_dsc == NULL) return (CW_BOOL_FALSE);
+	disk_sectors_init(dsk_sct, dsk_trk, ffo_src, 1);
 	debug_error_condition(dsk_trk->fmt_dsc->track_write == NULL);
 
 	/*
@@ -779,7 +1841,7 @@ disk_track_write(
 	 * expected, so in this case we do not skip this track
 	 */
 
-	if (fifo_get_limit(&ffo_src) > 0)
+	if (fifo_get_limit(ffo_src) > 0)
 		{
 		if (dsk_trk_buf != NULL)
 			{
@@ -794,12 +1856,17 @@ disk_track_write(
 			if (offset + size > dsk_trk_buf[0].size) data = NULL;
 			else data = &dsk_trk_buf[0].data[offset];
 			fifo_write_block(
-				&ffo_src,
+				ffo_src,
 				dsk_trk_buf[cwtool_track + 1].data,
 				dsk_trk_buf[cwtool_track + 1].size);
 			}
-		else dsk->img_dsc->track_read(img_src, &dsk_trk->img_trk, &ffo_src, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
-		if (fifo_get_wr_ofs(&ffo_src) == 0) return;
+		else
+			{
+			stats_begin(READ);
+			dsk->img_dsc->track_read(img_src, &dsk_trk->img_trk, ffo_src, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+			stats_end(READ);
+			}
+		if (fifo_get_wr_ofs(ffo_src) == 0) return (CW_BOOL_FALSE);
 		}
 
 	/*
@@ -807,12 +1874,48 @@ disk_track_write(
 	 * do not write to img_dsc_l0
 	 */
 	
-	if (cwtool_track < options_get_disk_track_start()) return;
-	if (cwtool_track > options_get_disk_track_end()) return;
+	if (cwtool_track < options_get_disk_track_start()) return (CW_BOOL_FALSE);
+	if (cwtool_track > options_get_disk_track_end()) return (CW_BOOL_FALSE);
 
 	/* encode the data */
 
-	if (! dsk_trk->fmt_dsc->track_write(&dsk_trk->fmt, &ffo_src, dsk_sct, &ffo_dst, data, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	stats_begin(ENCODE);
+	if (! dsk_trk->fmt_dsc->track_write(&dsk_trk->fmt, ffo_src, dsk_sct, ffo_dst, data, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	stats_end(ENCODE);
+	stats_count(IMAGE_BYTES, cwtool_track, fifo_get_wr_ofs(ffo_src));
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_write
+ ****************************************************************************/
+static void
+disk_track_write(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	struct disk_track_buffer	*dsk_trk_buf,
+	union image			*img_src,
+	union image			*img_dst,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
+	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
+	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
+	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+	cw_count_t			cwtool_track;
+	cw_bool_t			result;
+
+	if (! disk_track_encode(dsk, dsk_trk_buf, img_src, dsk_sct, &ffo_src, &ffo_dst, trackmap_index)) return;
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
 
 	/*
 	 * if this track is optional and we could not write it,
@@ -820,9 +1923,132 @@ disk_track_write(
 	 * continue with the next track
 	 */
 
-	if (! dsk->img_dsc_l0->track_write(img_dst, &dsk_trk->img_trk, &ffo_dst, NULL, 0, cwtool_track)) return;
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, 0, 0, 1);
-	if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+	stats_begin(WRITE);
+	result = dsk->img_dsc_l0->track_write(img_dst, &dsk_trk->img_trk, &ffo_dst, NULL, 0, cwtool_track);
+	stats_end(WRITE);
+	if (! result) return;
+	stats_count(PULSES, cwtool_track, fifo_get_wr_ofs(&ffo_dst));
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, 0, 0, 1);
+	if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+	}
+
+
+
+/****************************************************************************
+ * disk_duplicate_write
+ ****************************************************************************/
+static void
+disk_duplicate_write(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_track_buffer	*trk_l0,
+	char				*path_dst)
+
+	{
+	struct disk_info		dsk_nfo = { };
+	union image			img_dst;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			i, ct;
+
+	dsk->img_dsc_l0->open(&img_dst, path_dst, IMAGE_MODE_WRITE, IMAGE_FLAG_NONE);
+	for (i = 0; i < entries; i++)
+		{
+		struct trackmap_entry	*trm_ent;
+		struct disk_track	*dsk_trk;
+		struct disk_sector	dsk_sct[GLOBAL_NR_SECTORS] = { };
+		unsigned char		data[GLOBAL_MAX_TRACK_SIZE];
+		struct fifo		ffo = FIFO_INIT(data, sizeof (data));
+
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		dsk_trk = dsk->trk[ct];
+		if (trk_l0[ct].data == NULL) continue;
+
+		/*
+		 * image raw modifies the data while writing to a device,
+		 * so always work on a copy of the encoded track
+		 */
+
+		fifo_write_block(&ffo, trk_l0[ct].data, trk_l0[ct].size);
+		fifo_set_flags(&ffo, trk_l0[ct].flags);
+		if (! dsk->img_dsc_l0->track_write(&img_dst, &dsk_trk->img_trk, &ffo, NULL, 0, ct)) continue;
+		disk_sectors_init(dsk_sct, dsk_trk, &ffo, 1);
+		disk_info_update(&dsk_nfo, dsk_trk, dsk_sct, ct, 0, 0, 1);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(&dsk_nfo, 0);
+		}
+	if (dsk_opt->info_func != NULL) dsk_opt->info_func(&dsk_nfo, 1);
+	dsk->img_dsc_l0->close(&img_dst);
+	}
+
+
+
+/****************************************************************************
+ * disk_duplicate_verify
+ ****************************************************************************/
+static int
+disk_duplicate_verify(
+	struct disk			*dsk,
+	struct disk_track_buffer	*trk_l0,
+	struct disk_track_buffer	*trk_src,
+	char				*path_dst)
+
+	{
+	union image			img_dst;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			i, ct;
+	int				failed = 0;
+
+	dsk->img_dsc_l0->open(&img_dst, path_dst, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
+	for (i = 0; i < entries; i++)
+		{
+		struct trackmap_entry	*trm_ent;
+		struct disk_track	*dsk_trk;
+		struct disk_info	dsk_nfo = { };
+		struct disk_sector	dsk_sct[GLOBAL_NR_SECTORS] = { };
+		unsigned char		data_src[GLOBAL_MAX_TRACK_SIZE] = { };
+		unsigned char		data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
+		struct fifo		ffo_src = FIFO_INIT(data_src, sizeof (data_src));
+		struct fifo		ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+		struct container	*con;
+		cw_count_t		format_track, format_side;
+		int			size;
+
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+		format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+		dsk_trk = dsk->trk[ct];
+		if (trk_l0[ct].data == NULL) continue;
+
+		/*
+		 * greedy formats like raw return the flux as is, this will
+		 * never match what was written
+		 */
+
+		if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) continue;
+		if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) continue;
+		if (! dsk->img_dsc_l0->track_read(&img_dst, &dsk_trk->img_trk, &ffo_src, NULL, 0, ct)) continue;
+		con = container_init(NULL);
+		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, &ffo_src, &ffo_dst, dsk_sct, ct, format_track, format_side)) error_message("data too long on track %d", ct);
+		container_deinit(con);
+		dsk->img_dsc_l0->track_done(&img_dst, &dsk_trk->img_trk, ct);
+		disk_info_update(&dsk_nfo, dsk_trk, dsk_sct, ct, 0, 0, 0);
+		verbose_message(GENERIC, 1, "verifying track %d (sectors: good %d weak %d bad %d)", ct, dsk_nfo.sectors_good, dsk_nfo.sectors_weak, dsk_nfo.sectors_bad);
+
+		/*
+		 * sector data can only be compared directly with what was
+		 * written, if the image contains sector data only
+		 */
+
+		size = fifo_get_wr_ofs(&ffo_dst);
+		if ((dsk_nfo.sectors_bad == 0) && ((dsk->img_dsc->level != 3) ||
+			((size == trk_src[ct].size) &&
+			(memcmp(data_dst, trk_src[ct].data, size) == 0)))) continue;
+		error_warning("verify of track %d on '%s' failed (%d bad sectors)", ct, path_dst, dsk_nfo.sectors_bad);
+		failed++;
+		}
+	dsk->img_dsc_l0->close(&img_dst);
+	return (failed);
 	}
 
 
@@ -845,16 +2071,18 @@ disk_get(
 	int				i)
 
 	{
-	static struct disk		dsk[GLOBAL_NR_DISKS];
+	static struct disk		*dsk[GLOBAL_NR_DISKS];
 	static int			disks;
 
 	if (i == -1)
 		{
 		if (disks >= GLOBAL_NR_DISKS) error_message("too many disks defined");
 		debug_message(GENERIC, 1, "request for unused disk struct, disks = %d", disks);
-		return (&dsk[disks++]);
+		dsk[disks] = (struct disk *) malloc(sizeof (struct disk));
+		if (dsk[disks] == NULL) error_oom();
+		return (dsk[disks++]);
 		}
-	if ((i >= 0) && (i < disks)) return (&dsk[i]);
+	if ((i >= 0) && (i < disks)) return (dsk[i]);
 	return (NULL);
 	}
 
@@ -869,9 +2097,9 @@ disk_search(
 
 	{
 	struct disk			*dsk;
-	int				i;
+	cw_index_t			h;
 
-	for (i = 0; (dsk = disk_get(i)) != NULL; i++) if (string_equal(name, dsk->name)) break;
+	for (h = disk_hash_index(name); (dsk = disk_hash[h]) != NULL; h = (h + 1) % DISK_HASH_SIZE) if (string_equal(name, dsk->name)) break;
 	return (dsk);
 	}
 
@@ -902,6 +2130,8 @@ disk_init(
 	int				revision)
 
 	{
+	int				t;
+
 	*dsk = (struct disk)
 		{
 		.revision   = revision,
@@ -909,6 +2139,7 @@ disk_init(
 		.img_dsc    = image_search_desc("plain"),
 		.trm        = trackmap_search("#default")
 		};
+	for (t = 0; t < GLOBAL_NR_TRACKS; t++) dsk->trk[t] = &disk_track_empty;
 	debug_error_condition((dsk->img_dsc_l0 == NULL) || (dsk->img_dsc == NULL));
 	return (1);
 	}
@@ -924,10 +2155,18 @@ disk_insert(
 
 	{
 	struct disk			*dsk2;
+	cw_index_t			h;
 
 	dsk2 = disk_search(dsk->name);
-	if (dsk2 != NULL) *dsk2 = *dsk;
-	else *disk_get(-1) = *dsk;
+	if (dsk2 != NULL)
+		{
+		*dsk2 = *dsk;
+		return (1);
+		}
+	dsk2 = disk_get(-1);
+	*dsk2 = *dsk;
+	for (h = disk_hash_index(dsk->name); disk_hash[h] != NULL; h = (h + 1) % DISK_HASH_SIZE) ;
+	disk_hash[h] = dsk2;
 	return (1);
 	}
 
@@ -971,7 +2210,7 @@ disk_tracks_used(
 
 	for (t = used = 0; t < GLOBAL_NR_TRACKS; t++)
 		{
-		dsk_trk = &dsk->trk[t];
+		dsk_trk = dsk->trk[t];
 		if (dsk_trk->fmt_dsc == NULL) continue;
 		debug_error_condition(dsk_trk->fmt_dsc->get_sectors == NULL);
 		debug_error_condition(dsk_trk->fmt_dsc->get_sector_size == NULL);
@@ -1001,7 +2240,7 @@ disk_image_ok(
 	debug_error_condition(dsk->img_dsc == NULL);
 	for (t = 0; t < GLOBAL_NR_TRACKS; t++)
 		{
-		dsk_trk = &dsk->trk[t];
+		dsk_trk = dsk->trk[t];
 		if (dsk_trk->fmt_dsc == NULL) continue;
 		if (dsk_trk->fmt_dsc->level == -1) continue;
 		if (dsk_trk->fmt_dsc->level != dsk->img_dsc->level) return (0);
@@ -1025,7 +2264,7 @@ disk_trackmap_ok(
 	debug_error_condition(dsk->img_dsc == NULL);
 	for (ct = 0; ct < GLOBAL_NR_TRACKS; ct++)
 		{
-		dsk_trk = &dsk->trk[ct];
+		dsk_trk = dsk->trk[ct];
 		if (dsk_trk->fmt_dsc == NULL) continue;
 		if (! trackmap_cwtool_track_present(dsk->trm, ct)) return (CW_BOOL_FALSE);
 
@@ -1065,7 +2304,7 @@ disk_trackmap_numbering_ok(
 		{
 		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
 		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-		dsk_trk = &dsk->trk[ct];
+		dsk_trk = dsk->trk[ct];
 
 		/* skip this track if no format is defined */
 
@@ -1205,7 +2444,7 @@ disk_set_track(
 	{
 	if (! disk_check_track(cwtool_track)) return (CW_BOOL_FALSE);
 	debug_message(GENERIC, 2, "setting track %d", cwtool_track);
-	dsk->trk[cwtool_track] = *dsk_trk;
+	dsk->trk[cwtool_track] = disk_track_share(dsk_trk);
 	return (CW_BOOL_TRUE);
 	}
 
@@ -1391,6 +2630,34 @@ disk_set_interleave(
 
 
 
+/****************************************************************************
+ * disk_set_retry_patience
+ ****************************************************************************/
+int
+disk_set_retry_patience(
+	struct disk_track		*dsk_trk,
+	int				patience)
+
+	{
+	return (setvalue_uchar(&dsk_trk->retry_patience, patience, 0, GLOBAL_NR_RETRIES));
+	}
+
+
+
+/****************************************************************************
+ * disk_set_retry_budget
+ ****************************************************************************/
+int
+disk_set_retry_budget(
+	struct disk_track		*dsk_trk,
+	int				budget)
+
+	{
+	return (setvalue_uchar(&dsk_trk->retry_budget, budget, 0, GLOBAL_NR_RETRIES));
+	}
+
+
+
 /****************************************************************************
  * disk_set_sector_number
  ****************************************************************************/
@@ -1572,6 +2839,37 @@ disk_sector_read(
 
 
 
+/****************************************************************************
+ * disk_sector_needed
+ ****************************************************************************/
+int
+disk_sector_needed(
+	struct disk_sector		*dsk_sct)
+
+	{
+	if ((dsk_sct->err.errors == 0) && (dsk_sct->err.warnings == 0)) return (0);
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * disk_sectors_needed
+ ****************************************************************************/
+int
+disk_sectors_needed(
+	struct disk_sector		*dsk_sct,
+	int				sectors)
+
+	{
+	int				i, needed;
+
+	for (i = needed = 0; i < sectors; i++) needed += disk_sector_needed(&dsk_sct[i]);
+	return (needed);
+	}
+
+
+
 /****************************************************************************
  * disk_sector_write
  ****************************************************************************/
@@ -1597,6 +2895,7 @@ disk_statistics(
 
 	{
 	union image			img;
+	struct image_desc		*img_dsc_l0 = dsk->img_dsc_l0;
 	cw_count_t			entries;
 	cw_index_t			i;
 
@@ -1604,8 +2903,9 @@ disk_statistics(
 	debug_error_condition(dsk->img_dsc_l0->close == NULL);
 	debug_error_condition(dsk->img_dsc_l0->track_read == NULL);
 
-	/* open image */
+	/* open image, it may also be a packed raw image */
 
+	dsk->img_dsc_l0 = image_search_desc_l0(img_dsc_l0, &path, 1);
 	dsk->img_dsc_l0->open(&img, path, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
 
 	/* iterate over all defined tracks */
@@ -1616,6 +2916,7 @@ disk_statistics(
 	/* close image */
 
 	dsk->img_dsc_l0->close(&img);
+	dsk->img_dsc_l0 = img_dsc_l0;
 
 	/* done */
 
@@ -1634,7 +2935,8 @@ disk_read(
 	char				**path_src,
 	int				path_src_count,
 	char				*path_dst,
-	char				*path_output)
+	char				*path_output,
+	char				*path_tee)
 
 	{
 
@@ -1647,6 +2949,7 @@ disk_read(
 
 	struct disk_info		dsk_nfo = { };
 	union image			*img_src[GLOBAL_NR_IMAGES], img_dst;
+	struct image_desc		*img_dsc_l0 = dsk->img_dsc_l0;
 	struct file			fil;
 	struct file			*fil_output = NULL;
 	cw_count_t			entries;
@@ -1659,8 +2962,12 @@ disk_read(
 	debug_error_condition(dsk->img_dsc->close == NULL);
 	debug_error_condition(dsk->img_dsc->track_write == NULL);
 
-	/* open images */
+	/*
+	 * open images, sources may also be packed raw images. then
+	 * img_dsc_l0 is replaced until all tracks are read
+	 */
 
+	dsk->img_dsc_l0 = image_search_desc_l0(img_dsc_l0, path_src, path_src_count);
 	for (i = 0; i < path_src_count; i++)
 		{
 		img_src[i] = (union image *) malloc(sizeof (union image));
@@ -1673,19 +2980,56 @@ disk_read(
 
 	if (path_output != NULL)
 		{
-		file_open(&fil, path_output, FILE_MODE_CREATE, FILE_FLAG_NONE);
+		output_open(&fil, path_output);
 		fil_output = &fil;
 		}
 
+	/*
+	 * open raw image for the data of every try, so archiving and
+	 * decoding need only one read of the disk
+	 */
+
+	if (path_tee != NULL)
+		{
+		dsk_nfo.img_tee = (union image *) malloc(sizeof (union image));
+		if (dsk_nfo.img_tee == NULL) error_oom();
+		image_raw_desc.open(dsk_nfo.img_tee, path_tee, IMAGE_MODE_WRITE, IMAGE_FLAG_NONE);
+
+		/*
+		 * image_raw_write() on a device would clamp the flux shared
+		 * with the decoder and write it to a floppy
+		 */
+
+		if (image_raw_is_device(dsk_nfo.img_tee)) error_message("-t/--tee can not write to device '%s'", path_tee);
+		}
+
+	/*
+	 * with --resume tracks finished by an interrupted read are taken
+	 * from the journal instead of reading them again
+	 */
+
+	if (dsk_opt->flags & DISK_OPTION_FLAG_RESUME) disk_journal_open(&dsk_nfo, dsk, path_dst);
+
 	/* iterate over all tracks */
 
 	entries = trackmap_entries(dsk->trm);
+	if ((dsk_opt->flags & DISK_OPTION_FLAG_DEFERRED) && (disk_greedy(dsk))) verbose_message(GENERIC, 1, "disk contains greedy formats, not deferring retries");
+	else if (dsk_opt->flags & DISK_OPTION_FLAG_DEFERRED)
+		{
+		disk_track_read_deferred(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output);
+		entries = 0;
+		}
 	for (i = 0; i < entries; i++) disk_track_read(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output, i);
 	if (dsk_opt->info_func != NULL) dsk_opt->info_func(&dsk_nfo, 1);
 
-	/* close output file */
+	/* close output files */
 
 	if (fil_output != NULL) file_close(fil_output);
+	if (dsk_nfo.img_tee != NULL)
+		{
+		image_raw_desc.close(dsk_nfo.img_tee);
+		free(dsk_nfo.img_tee);
+		}
 
 	/* close images */
 
@@ -1694,7 +3038,9 @@ disk_read(
 		dsk->img_dsc_l0->close(img_src[i]);
 		free(img_src[i]);
 		}
+	dsk->img_dsc_l0 = img_dsc_l0;
 	dsk->img_dsc->close(&img_dst);
+	disk_journal_close(&dsk_nfo, path_dst);
 
 	/* done */
 
@@ -1763,4 +3109,373 @@ disk_write(
 
 	return (1);
 	}
+
+
+
+/****************************************************************************
+ * disk_duplicate
+ ****************************************************************************/
+int
+disk_duplicate(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	char				*path_src,
+	char				**path_dst,
+	int				path_dst_count,
+	int				copies)
+
+	{
+	struct disk_track_buffer	dsk_trk_buf[GLOBAL_NR_TRACKS + 1] = { };
+	struct disk_track_buffer	trk_l0[GLOBAL_NR_TRACKS] = { };
+	struct disk_track_buffer	trk_src[GLOBAL_NR_TRACKS] = { };
+	union image			img_src;
+	int				flags = (dsk_opt->flags & DISK_OPTION_FLAG_IGNORE_SIZE) ? IMAGE_FLAG_IGNORE_SIZE : IMAGE_FLAG_NONE;
+	int				c, d, failed = 0;
+	cw_count_t			entries;
+	cw_index_t			i, ct;
+
+	debug_error_condition(dsk->img_dsc->open == NULL);
+	debug_error_condition(dsk->img_dsc->close == NULL);
+	debug_error_condition(dsk->img_dsc->track_read == NULL);
+	debug_error_condition(dsk->img_dsc_l0->open == NULL);
+	debug_error_condition(dsk->img_dsc_l0->close == NULL);
+	debug_error_condition(dsk->img_dsc_l0->track_write == NULL);
+
+	/*
+	 * read the image and encode all tracks only once, keep the
+	 * encoded tracks and the source data (needed for verify) in memory
+	 */
+
+	dsk->img_dsc->open(&img_src, path_src, IMAGE_MODE_READ, flags);
+	entries = trackmap_entries(dsk->trm);
+	dsk_trk_buf[0].size = disk_write_data_size(dsk);
+	if (dsk_trk_buf[0].size > 0)
+		{
+		dsk_trk_buf[0].data = malloc(dsk_trk_buf[0].size * sizeof (unsigned char));
+		if (dsk_trk_buf[0].data == NULL) error_oom();
+		disk_write_data_get(dsk, dsk_trk_buf, &img_src);
+		}
+	for (i = 0; i < entries; i++)
+		{
+		struct trackmap_entry	*trm_ent;
+		struct disk_sector	dsk_sct[GLOBAL_NR_SECTORS] = { };
+		unsigned char		data_src[GLOBAL_MAX_TRACK_SIZE] = { };
+		unsigned char		data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
+		struct fifo		ffo_src = FIFO_INIT(data_src, sizeof (data_src));
+		struct fifo		ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+
+		if (! disk_track_encode(dsk, (dsk_trk_buf[0].size > 0) ? dsk_trk_buf : NULL, &img_src, dsk_sct, &ffo_src, &ffo_dst, i)) continue;
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		trk_l0[ct].size  = fifo_get_wr_ofs(&ffo_dst);
+		trk_l0[ct].flags = fifo_get_flags(&ffo_dst);
+		trk_src[ct].size = fifo_get_wr_ofs(&ffo_src);
+		trk_l0[ct].data  = malloc(trk_l0[ct].size + trk_src[ct].size + 1);
+		if (trk_l0[ct].data == NULL) error_oom();
+		trk_src[ct].data = &trk_l0[ct].data[trk_l0[ct].size];
+		memcpy(trk_l0[ct].data, data_dst, trk_l0[ct].size);
+		memcpy(trk_src[ct].data, data_src, trk_src[ct].size);
+		}
+	if (dsk_trk_buf[0].data != NULL) free(dsk_trk_buf[0].data);
+	dsk->img_dsc->close(&img_src);
+
+	/*
+	 * now write the encoded tracks as often as wanted, before each
+	 * further copy change_func() is asked for new media
+	 */
+
+	for (c = 0; c < copies; c++)
+		{
+		if ((c > 0) && (dsk_opt->change_func != NULL) && (! dsk_opt->change_func(path_dst, path_dst_count, c + 1))) break;
+		for (d = 0; d < path_dst_count; d++)
+			{
+			disk_duplicate_write(dsk, dsk_opt, trk_l0, path_dst[d]);
+			if (dsk_opt->flags & DISK_OPTION_FLAG_VERIFY) failed += disk_duplicate_verify(dsk, trk_l0, trk_src, path_dst[d]);
+			}
+		}
+
+	/* done */
+
+	for (i = 0; i < GLOBAL_NR_TRACKS; i++) if (trk_l0[i].data != NULL) free(trk_l0[i].data);
+	return (failed);
+	}
+
+
+
+/****************************************************************************
+ * disk_clock
+ ****************************************************************************/
+static cw_count64_t
+disk_clock(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((cw_count64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec);
+	}
+
+
+
+/****************************************************************************
+ * disk_probe_flux
+ ****************************************************************************/
+static struct fifo *
+disk_probe_flux(
+	struct image_desc		*img_dsc,
+	union image			*img,
+	char				*path,
+	struct disk_probe_flux		*flx,
+	int				*fluxes,
+	struct image_track		*img_trk,
+	cw_count_t			cwtool_track)
+
+	{
+	int				mask = IMAGE_TRACK_FLAG_INDEXED_READ | IMAGE_TRACK_FLAG_FLIP_SIDE;
+	int				i;
+
+	/*
+	 * the flux of a track only depends on the track and on clock, side
+	 * and index settings, so it is read only once for all candidates
+	 * sharing these settings
+	 */
+
+	for (i = 0; i < *fluxes; i++)
+		{
+		if (flx[i].cwtool_track != cwtool_track) continue;
+		if ((flx[i].img_trk.flags & mask) != (img_trk->flags & mask)) continue;
+		if (flx[i].img_trk.clock != img_trk->clock) continue;
+		if (flx[i].img_trk.side_offset != img_trk->side_offset) continue;
+		return ((flx[i].ok) ? &flx[i].ffo : NULL);
+		}
+	if (*fluxes >= DISK_PROBE_NR_FLUX)
+		{
+		verbose_message(GENERIC, 1, "too many different reads of track %d needed, skipping it", cwtool_track);
+		return (NULL);
+		}
+	flx[i] = (struct disk_probe_flux)
+		{
+		.img_trk      = *img_trk,
+		.cwtool_track = cwtool_track,
+		.data         = (unsigned char *) malloc(GLOBAL_MAX_TRACK_SIZE)
+		};
+	if (flx[i].data == NULL) error_oom();
+	flx[i].ffo = FIFO_INIT(flx[i].data, GLOBAL_MAX_TRACK_SIZE);
+	(*fluxes)++;
+
+	/*
+	 * a raw image gives out each stored track only once, so it is
+	 * opened again for every read. the disk may have less tracks than
+	 * probed, so all of them are optional
+	 */
+
+	flx[i].img_trk.flags |= IMAGE_TRACK_FLAG_OPTIONAL;
+	verbose_message(GENERIC, 1, "reading track %d with clock %d for probing", cwtool_track, 14 << img_trk->clock);
+	img_dsc->open(img, path, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
+	stats_begin(READ);
+	flx[i].ok = img_dsc->track_read(img, &flx[i].img_trk, &flx[i].ffo, NULL, 0, cwtool_track);
+	stats_end(READ);
+	img_dsc->track_done(img, &flx[i].img_trk, cwtool_track);
+	img_dsc->close(img);
+	return ((flx[i].ok) ? &flx[i].ffo : NULL);
+	}
+
+
+
+/****************************************************************************
+ * disk_probe_track
+ ****************************************************************************/
+static cw_void_t
+disk_probe_track(
+	struct disk			*dsk,
+	struct fifo			*ffo_flux,
+	struct disk_probe		*prb,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE];
+	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE];
+	struct fifo			ffo_src = *ffo_flux;
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+	struct container		*con;
+	cw_count_t			cwtool_track, format_track, format_side;
+	cw_count64_t			t;
+	int				sectors, good, weak, bad, i;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = dsk->trk[cwtool_track];
+
+	/* decoding may modify the flux (postcomp), so work on a copy */
+
+	memcpy(data_src, fifo_get_data(ffo_flux), fifo_get_wr_ofs(ffo_flux));
+	ffo_src.data = data_src;
+	fifo_set_rd_ofs(&ffo_src, 0);
+	disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0);
+	con = container_init(NULL);
+	t = disk_clock();
+	if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, &ffo_src, &ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	prb->decode_ns += disk_clock() - t;
+	container_deinit(con);
+
+	sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	for (i = good = weak = bad = 0; i < sectors; i++)
+		{
+		if (dsk_sct[i].err.errors > 0) bad++;
+		else if (dsk_sct[i].err.warnings > 0) weak++;
+		else good++;
+		}
+	verbose_message(GENERIC, 1, "probing disk '%s' track %3d (sectors: good %2d weak %2d bad %2d)", dsk->name, cwtool_track, good, weak, bad);
+	prb->sum.tracks++;
+	prb->sum.sectors_good += good;
+	prb->sum.sectors_weak += weak;
+	prb->sum.sectors_bad  += bad;
+	}
+
+
+
+/****************************************************************************
+ * disk_probe_disk
+ ****************************************************************************/
+static cw_bool_t
+disk_probe_disk(
+	struct disk			*dsk,
+	struct image_desc		*img_dsc,
+	union image			*img,
+	char				*path,
+	struct disk_probe_flux		*flx,
+	int				*fluxes,
+	struct disk_probe		*prb)
+
+	{
+	const static cw_count_t		sample[] = { 0, 1, 2, 3, 80, 81, 158, 159 };
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct fifo			*ffo;
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_index_t			index[sizeof (sample) / sizeof (sample[0])];
+	cw_count_t			ct, distance[sizeof (sample) / sizeof (sample[0])];
+	int				i, j, s;
+
+	/*
+	 * take the defined track nearest to each sample track, so disks
+	 * with other track numbering (like c1541) get comparable samples.
+	 * greedy formats accept everything, so disks using them are no
+	 * candidates
+	 */
+
+	for (s = 0; s < sizeof (sample) / sizeof (sample[0]); s++) index[s] = -1;
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		dsk_trk = dsk->trk[ct];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) return (CW_BOOL_FALSE);
+		if ((dsk_trk->fmt_dsc->track_read == NULL) || (dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt) == 0)) continue;
+		for (s = 0; s < sizeof (sample) / sizeof (sample[0]); s++)
+			{
+			if ((index[s] != -1) && (distance[s] <= abs(ct - sample[s]))) continue;
+			index[s]    = i;
+			distance[s] = abs(ct - sample[s]);
+			}
+		}
+
+	/* decode every selected track once */
+
+	*prb = (struct disk_probe) { .dsk = dsk, .clock = -1 };
+	for (s = 0; s < sizeof (sample) / sizeof (sample[0]); s++)
+		{
+		if (index[s] == -1) continue;
+		for (j = 0; (j < s) && (index[j] != index[s]); j++) ;
+		if (j < s) continue;
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, index[s]);
+		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		dsk_trk = dsk->trk[ct];
+		prb->sectors += dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+		if (prb->clock == -1) prb->clock = 14 << dsk_trk->img_trk.clock;
+		ffo = disk_probe_flux(img_dsc, img, path, flx, fluxes, &dsk_trk->img_trk, ct);
+		if (ffo != NULL) disk_probe_track(dsk, ffo, prb, index[s]);
+		}
+	return ((prb->sectors > 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * disk_probe_compare
+ ****************************************************************************/
+static int
+disk_probe_compare(
+	const void			*a,
+	const void			*b)
+
+	{
+	const struct disk_probe		*prb_a = (const struct disk_probe *) a;
+	const struct disk_probe		*prb_b = (const struct disk_probe *) b;
+	long long			r;
+
+	/*
+	 * best ratio of good sectors first, then more good sectors, then
+	 * less weak sectors (errors the disk is told to ignore). then the
+	 * lower clock and finally the order of the config. the decode
+	 * time differs from run to run, so it is not used here
+	 */
+
+	r = (long long) prb_b->sum.sectors_good * prb_a->sectors - (long long) prb_a->sum.sectors_good * prb_b->sectors;
+	if (r == 0) r = prb_b->sum.sectors_good - prb_a->sum.sectors_good;
+	if (r == 0) r = prb_a->sum.sectors_weak - prb_b->sum.sectors_weak;
+	if (r == 0) r = prb_a->clock - prb_b->clock;
+	if (r == 0) r = prb_a->order - prb_b->order;
+	return ((r < 0) ? -1 : (r > 0) ? 1 : 0);
+	}
+
+
+
+/****************************************************************************
+ * disk_probe
+ ****************************************************************************/
+int
+disk_probe(
+	char				*path,
+	struct disk_probe		*prb,
+	int				max)
+
+	{
+	struct disk_probe_flux		flx[DISK_PROBE_NR_FLUX];
+	struct image_desc		*img_dsc;
+	union image			*img;
+	struct disk			*dsk;
+	int				fluxes = 0, probes = 0;
+	cw_index_t			i;
+
+	/*
+	 * struct image_raw is large, so it is not put onto the stack. the
+	 * source may also be a packed raw image
+	 */
+
+	img_dsc = image_search_desc_l0(image_search_desc("raw"), &path, 1);
+	img = (union image *) malloc(sizeof (union image));
+	if (img == NULL) error_oom();
+
+	/* decode the sample tracks with every defined disk */
+
+	for (i = 0; ((dsk = disk_get(i)) != NULL) && (probes < max); i++)
+		{
+		if (disk_probe_disk(dsk, img_dsc, img, path, flx, &fluxes, &prb[probes])) prb[probes++].order = i;
+		}
+	qsort(prb, probes, sizeof (struct disk_probe), disk_probe_compare);
+
+	/* done */
+
+	for (i = 0; i < fluxes; i++) free(flx[i].data);
+	free(img);
+	return (probes);
+	}
 /******************************************************** Karsten Scheibler */
@@ -17,14 +17,16 @@
 #include "global.h"
 #include "image.h"
 #include "format.h"
+#include "event.h"
 
-#define DISK_TRACK_INIT			(struct disk_track) { .skew = 0, .interleave = 0, .reserved = { 0, }, .img_trk = IMAGE_TRACK_INIT(CW_DEFAULT_TIMEOUT), .fmt_dsc = 0 }
+#define DISK_TRACK_INIT			(struct disk_track) { .skew = 0, .interleave = 0, .retry_patience = 0, .retry_budget = 0, .img_trk = IMAGE_TRACK_INIT(CW_DEFAULT_TIMEOUT), .fmt_dsc = 0 }
 
 struct disk_track
 	{
 	unsigned char			skew;
 	unsigned char			interleave;
-	unsigned char			reserved[2];
+	unsigned char			retry_patience;
+	unsigned char			retry_budget;
 	struct image_track		img_trk;
 	struct format_desc		*fmt_dsc;
 	union format			fmt;
@@ -46,7 +48,7 @@ struct disk
 	struct image_desc		*img_dsc_l0;
 	struct image_desc		*img_dsc;
 	struct trackmap			*trm;
-	struct disk_track		trk[GLOBAL_NR_TRACKS];
+	struct disk_track		*trk[GLOBAL_NR_TRACKS];
 	struct disk_track		trk_def;
 	};
 
@@ -92,6 +94,8 @@ struct disk_sector_info
 	int				offset;
 	};
 
+struct disk_journal;
+
 struct disk_info
 	{
 	char				path[GLOBAL_MAX_PATH_SIZE];
@@ -102,15 +106,39 @@ struct disk_info
 	int				sectors_bad;
 	struct disk_summary		sum;
 	struct disk_sector_info		sct_nfo[GLOBAL_NR_TRACKS][GLOBAL_NR_SECTORS];
+	struct event_timing		evt_tim;
+	struct event_timing		evt_tim_trk[GLOBAL_NR_TRACKS];
+	union image			*img_tee;
+	struct disk_journal		*dsk_jrn;
+	};
+
+/*
+ * result of disk_probe() for one candidate disk, sectors is the number
+ * of sectors expected on the probed tracks, order the index of the disk
+ * in the config
+ */
+
+struct disk_probe
+	{
+	struct disk			*dsk;
+	int				clock;
+	int				sectors;
+	struct disk_summary		sum;
+	cw_count64_t			decode_ns;
+	cw_index_t			order;
 	};
 
 #define DISK_OPTION_INIT(i, r, f)	(struct disk_option) { .info_func = i, .retry = r, .flags = f }
 #define DISK_OPTION_FLAG_NONE		0
 #define DISK_OPTION_FLAG_IGNORE_SIZE	(1 << 0)
+#define DISK_OPTION_FLAG_VERIFY		(1 << 1)
+#define DISK_OPTION_FLAG_DEFERRED	(1 << 2)
+#define DISK_OPTION_FLAG_RESUME		(1 << 3)
 
 struct disk_option
 	{
 	void				(*info_func)(struct disk_info *, int);
+	int				(*change_func)(char **, int, int);
 	int				retry;
 	int				flags;
 	};
@@ -143,6 +171,8 @@ extern int				disk_set_write_option(struct disk_track *, struct format_option *,
 extern int				disk_set_rw_option(struct disk_track *, struct format_option *, int, int);
 extern int				disk_set_skew(struct disk_track *, int);
 extern int				disk_set_interleave(struct disk_track *, int);
+extern int				disk_set_retry_patience(struct disk_track *, int);
+extern int				disk_set_retry_budget(struct disk_track *, int);
 extern int				disk_set_sector_number(struct disk_sector *, int);
 extern int				disk_get_sector_number(struct disk_sector *);
 extern int				disk_get_sectors(struct disk_track *);
@@ -156,9 +186,14 @@ extern int				disk_error_add(struct disk_error *, int, int);
 extern int				disk_warning_add(struct disk_error *, int);
 extern int				disk_sector_read(struct disk_sector *, struct disk_error *, unsigned char *);
 extern int				disk_sector_write(unsigned char *, struct disk_sector *);
+extern int				disk_sectors_init(struct disk_sector *, struct disk_track *, struct fifo *, int);
+extern int				disk_sector_needed(struct disk_sector *);
+extern int				disk_sectors_needed(struct disk_sector *, int);
 extern int				disk_statistics(struct disk *, char *);
-extern int				disk_read(struct disk *, struct disk_option *, char **, int, char *, char *);
+extern int				disk_read(struct disk *, struct disk_option *, char **, int, char *, char *, char *);
 extern int				disk_write(struct disk *, struct disk_option *, char *, char *);
+extern int				disk_duplicate(struct disk *, struct disk_option *, char *, char **, int, int);
+extern int				disk_probe(char *, struct disk_probe *, int);
 
 #define disk_set_indexed_read(t, v)	disk_set_image_track_flag(t, v, IMAGE_TRACK_FLAG_INDEXED_READ)
 #define disk_set_indexed_write(t, v)	disk_set_image_track_flag(t, v, IMAGE_TRACK_FLAG_INDEXED_WRITE)
@@ -22,6 +22,20 @@
 
 
 
+/****************************************************************************
+ *
+ * local data structures, variables and defines
+ *
+ ****************************************************************************/
+
+
+
+
+static jmp_buf				*err_jmp;
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -39,11 +53,41 @@ error_exit(
 	cw_void_t)
 
 	{
+	jmp_buf				*jmp = err_jmp;
+
+	/*
+	 * a caller which wants to continue after an error gets it back
+	 * once, an error while it cleans up exits as usual
+	 */
+
+	err_jmp = NULL;
+	if (jmp != NULL) longjmp(*jmp, 1);
 	exit(1);
 	}
 
 
 
+/****************************************************************************
+ * error_set_return
+ ****************************************************************************/
+cw_void_t
+error_set_return(
+	jmp_buf				*jmp)
+
+	{
+
+	/*
+	 * with jmp != NULL error_exit() returns with longjmp() to the
+	 * setjmp() of the caller instead of exiting. this is only meant for
+	 * callers like cwbench, which read many images one after the other
+	 * and have to continue after one of them failed
+	 */
+
+	err_jmp = jmp;
+	}
+
+
+
 /****************************************************************************
  * error_message2
  ****************************************************************************/
@@ -64,7 +108,7 @@ error_message2(
 	if (append == NULL) append = empty;
 	if (format != NULL)
 		{
-		fprintf(stderr, "%s: %s", global_program_name(), prepend);
+		fprintf(stderr, "%s: %s%s", global_program_name(), global_prefix(), prepend);
 		vfprintf(stderr, format, args);
 		fprintf(stderr, "%s\n", append);
 		}
@@ -13,6 +13,8 @@
 #ifndef CWTOOL_ERROR_H
 #define CWTOOL_ERROR_H
 
+#include <setjmp.h>
+
 #include "types.h"
 
 
@@ -31,6 +33,10 @@ extern cw_void_t
 error_exit(
 	cw_void_t);
 
+extern cw_void_t
+error_set_return(
+	jmp_buf				*jmp);
+
 #define ERROR_FLAG_NONE			0
 #define ERROR_FLAG_EXIT			(1 << 0)
 #define ERROR_FLAG_PERROR		(1 << 1)
@@ -0,0 +1,430 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * event.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "event.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "string.h"
+
+
+
+
+/****************************************************************************
+ *
+ * local data structures, variables and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * records are queued in evt_data and written with nonblocking writes, so
+ * a slow or stalled reader never holds up reading the disk. if the queue
+ * is full, the record is dropped and only counted. O_NONBLOCK is only set
+ * on descriptors opened by us, an inherited descriptor shares its file
+ * description with other processes (e.g. a terminal), so it is polled
+ * before every write or, if it is a socket, written with MSG_DONTWAIT.
+ * sockets are written with MSG_NOSIGNAL, for all other targets SIGPIPE
+ * is only ignored while event_flush() writes
+ */
+
+#define EVENT_FD_OWN			0
+#define EVENT_FD_OWN_SOCKET		1
+#define EVENT_FD_INHERITED		2
+#define EVENT_FD_INHERITED_SOCKET	3
+
+static cw_int_t				evt_fd = -1;
+static cw_int_t				evt_fd_type;
+static cw_char_t			evt_data[EVENT_BUFFER_SIZE];
+static cw_size_t			evt_rd_ofs;
+static cw_size_t			evt_wr_ofs;
+static cw_count64_t			evt_records;
+static cw_count64_t			evt_dropped;
+static cw_count64_t			evt_start;
+
+
+
+
+/****************************************************************************
+ *
+ * misc helper functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * event_nonblock
+ ****************************************************************************/
+static cw_void_t
+event_nonblock(
+	const cw_char_t			*target)
+
+	{
+	cw_int_t			flags = fcntl(evt_fd, F_GETFL);
+
+	if ((flags == -1) || (fcntl(evt_fd, F_SETFL, flags | O_NONBLOCK) == -1)) error_perror_message("error while setting '%s' to nonblocking mode", target);
+	}
+
+
+
+/****************************************************************************
+ * event_inherit
+ ****************************************************************************/
+static cw_void_t
+event_inherit(
+	const cw_char_t			*target)
+
+	{
+	struct stat			st;
+
+	if (fstat(evt_fd, &st) == -1) error_perror_message("file descriptor in '%s' is not open", target);
+	evt_fd_type = (S_ISSOCK(st.st_mode)) ? EVENT_FD_INHERITED_SOCKET : EVENT_FD_INHERITED;
+	}
+
+
+
+/****************************************************************************
+ * event_write
+ ****************************************************************************/
+static cw_count_t
+event_write(
+	const cw_char_t			*data,
+	cw_size_t			size)
+
+	{
+	struct pollfd			pfd = { .fd = evt_fd, .events = POLLOUT };
+
+	if (evt_fd_type == EVENT_FD_OWN) return (write(evt_fd, data, size));
+	if (evt_fd_type == EVENT_FD_OWN_SOCKET) return (send(evt_fd, data, size, MSG_NOSIGNAL));
+	if (evt_fd_type == EVENT_FD_INHERITED_SOCKET) return (send(evt_fd, data, size, MSG_DONTWAIT | MSG_NOSIGNAL));
+
+	/*
+	 * POLLOUT on a pipe guarantees room for PIPE_BUF bytes, so a
+	 * write of at most this size does not block
+	 */
+
+	if (poll(&pfd, 1, 0) == -1) return (-1);
+	if (! (pfd.revents & (POLLOUT | POLLERR | POLLHUP)))
+		{
+		errno = EAGAIN;
+		return (-1);
+		}
+	if (size > PIPE_BUF) size = PIPE_BUF;
+	return (write(evt_fd, data, size));
+	}
+
+
+
+/****************************************************************************
+ * event_connect
+ ****************************************************************************/
+static cw_void_t
+event_connect(
+	const cw_char_t			*target,
+	const cw_char_t			*path)
+
+	{
+	struct sockaddr_un		sun = { .sun_family = AF_UNIX };
+
+	if (string_length(path) >= sizeof (sun.sun_path)) error_message("socket path '%s' too long", path);
+	string_copy(sun.sun_path, sizeof (sun.sun_path), path);
+	evt_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (evt_fd == -1) error_perror_message("error while creating socket for '%s'", target);
+	if (connect(evt_fd, (struct sockaddr *) &sun, sizeof (sun)) == -1) error_perror_message("error while connecting to '%s'", target);
+	}
+
+
+
+/****************************************************************************
+ * event_send
+ ****************************************************************************/
+static cw_void_t
+event_send(
+	cw_void_t)
+
+	{
+	cw_count_t			len;
+
+	while (evt_rd_ofs < evt_wr_ofs)
+		{
+		len = event_write(&evt_data[evt_rd_ofs], evt_wr_ofs - evt_rd_ofs);
+		if (len > 0)
+			{
+			evt_rd_ofs += len;
+			continue;
+			}
+		if ((len == -1) && (errno == EINTR)) continue;
+		if ((len == -1) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) return;
+
+		/*
+		 * reader went away, events are optional so do not
+		 * abort reading the disk because of this
+		 */
+
+		error_warning("event receiver gone, no further events are sent");
+		close(evt_fd);
+		evt_fd = -1;
+		break;
+		}
+	evt_rd_ofs = evt_wr_ofs = 0;
+	}
+
+
+
+/****************************************************************************
+ * event_flush
+ ****************************************************************************/
+static cw_void_t
+event_flush(
+	cw_void_t)
+
+	{
+	struct sigaction		sa = { .sa_handler = SIG_IGN }, sa_old;
+
+	if ((evt_fd_type == EVENT_FD_OWN_SOCKET) || (evt_fd_type == EVENT_FD_INHERITED_SOCKET))
+		{
+		event_send();
+		return;
+		}
+
+	/*
+	 * a vanished reader should not kill us with SIGPIPE, but only
+	 * while events are written. a closed reader of other output
+	 * (e.g. stdout in a pipeline) still ends the process as usual
+	 */
+
+	if (sigaction(SIGPIPE, &sa, &sa_old) == -1) error_perror_message("error while sigaction()");
+	event_send();
+	if (sigaction(SIGPIPE, &sa_old, NULL) == -1) error_perror_message("error while sigaction()");
+	}
+
+
+
+/****************************************************************************
+ * event_queue
+ ****************************************************************************/
+static cw_void_t
+event_queue(
+	const cw_char_t			*format,
+	...)
+
+	{
+	va_list				args;
+	cw_char_t			record[EVENT_MAX_RECORD_SIZE];
+	cw_count_t			len;
+
+	va_start(args, format);
+	len = vsnprintf(record, sizeof (record), format, args);
+	va_end(args);
+	debug_error_condition((len < 0) || (len >= sizeof (record)));
+	if (evt_wr_ofs + len > EVENT_BUFFER_SIZE)
+		{
+		memmove(evt_data, &evt_data[evt_rd_ofs], evt_wr_ofs - evt_rd_ofs);
+		evt_wr_ofs -= evt_rd_ofs;
+		evt_rd_ofs = 0;
+		}
+	if (evt_wr_ofs + len > EVENT_BUFFER_SIZE)
+		{
+		evt_dropped++;
+		debug_message(GENERIC, 1, "event queue full, %lld records dropped", evt_dropped);
+		}
+	else
+		{
+		memcpy(&evt_data[evt_wr_ofs], record, len);
+		evt_wr_ofs += len;
+		evt_records++;
+		}
+	event_flush();
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * event_open
+ ****************************************************************************/
+cw_void_t
+event_open(
+	const cw_char_t			*target)
+
+	{
+
+	/*
+	 * target is one of:
+	 * - fd:<num>     an already open file descriptor
+	 * - unix:<path>  a listening UNIX stream socket
+	 * - -            stdout
+	 * - <path>       a file, which is created or truncated
+	 */
+
+	if (strncmp(target, "fd:", 3) == 0)
+		{
+		if ((sscanf(&target[3], "%d", &evt_fd) != 1) || (evt_fd < 0)) error_message("invalid file descriptor in '%s'", target);
+		event_inherit(target);
+		}
+	else if (string_equal(target, "-"))
+		{
+		evt_fd = STDOUT_FILENO;
+		event_inherit(target);
+		}
+	else
+		{
+		if (strncmp(target, "unix:", 5) == 0)
+			{
+			event_connect(target, &target[5]);
+			evt_fd_type = EVENT_FD_OWN_SOCKET;
+			}
+		else
+			{
+			evt_fd = open(target, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+			if (evt_fd == -1) error_perror_message("error while opening '%s'", target);
+			evt_fd_type = EVENT_FD_OWN;
+			}
+		event_nonblock(target);
+		}
+	evt_start = event_clock();
+	verbose_message(GENERIC, 1, "sending events to '%s'", target);
+	}
+
+
+
+/****************************************************************************
+ * event_close
+ ****************************************************************************/
+cw_void_t
+event_close(
+	cw_void_t)
+
+	{
+	struct pollfd			pfd;
+
+	if (evt_fd == -1) return;
+	event_queue("{\"ev\":\"done\",\"records\":%lld,\"dropped\":%lld,\"ns\":%lld}\n",
+		evt_records, evt_dropped, event_clock() - evt_start);
+
+	/*
+	 * reading is over, so now it is ok to wait a bit for the reader
+	 * to take the remaining records
+	 */
+
+	while ((evt_fd != -1) && (evt_rd_ofs < evt_wr_ofs))
+		{
+		pfd = (struct pollfd) { .fd = evt_fd, .events = POLLOUT };
+		if (poll(&pfd, 1, EVENT_CLOSE_TIMEOUT) <= 0) break;
+		event_flush();
+		}
+	if (evt_rd_ofs < evt_wr_ofs) error_warning("event receiver too slow, %d bytes of events not sent", evt_wr_ofs - evt_rd_ofs);
+	if (evt_dropped > 0) error_warning("event queue was full, %lld events dropped", evt_dropped);
+	if ((evt_fd != -1) && (evt_fd != STDOUT_FILENO)) close(evt_fd);
+	evt_fd = -1;
+	}
+
+
+
+/****************************************************************************
+ * event_enabled
+ ****************************************************************************/
+cw_bool_t
+event_enabled(
+	cw_void_t)
+
+	{
+	return ((evt_fd != -1) ? CW_BOOL_TRUE : CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * event_clock
+ ****************************************************************************/
+cw_count64_t
+event_clock(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	/* avoid the system call if nobody is listening */
+
+	if (evt_fd == -1) return (0);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((cw_count64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec);
+	}
+
+
+
+/****************************************************************************
+ * event_try
+ ****************************************************************************/
+cw_void_t
+event_try(
+	cw_index_t			track,
+	cw_index_t			try,
+	cw_count_t			good,
+	cw_count_t			weak,
+	cw_count_t			bad,
+	struct event_timing		*evt_tim)
+
+	{
+	if (evt_fd == -1) return;
+	event_queue("{\"ev\":\"try\",\"track\":%d,\"try\":%d,\"good\":%d,\"weak\":%d,\"bad\":%d,\"ioctl_ns\":%lld,\"decode_ns\":%lld,\"flux\":%lld}\n",
+		track, try, good, weak, bad, evt_tim->ioctl_ns, evt_tim->decode_ns, evt_tim->flux_bytes);
+	}
+
+
+
+/****************************************************************************
+ * event_track
+ ****************************************************************************/
+cw_void_t
+event_track(
+	cw_index_t			track,
+	cw_count_t			tries,
+	cw_count_t			good,
+	cw_count_t			weak,
+	cw_count_t			bad,
+	struct event_timing		*evt_tim)
+
+	{
+	if (evt_fd == -1) return;
+	event_queue("{\"ev\":\"track\",\"track\":%d,\"tries\":%d,\"good\":%d,\"weak\":%d,\"bad\":%d,\"ioctl_ns\":%lld,\"decode_ns\":%lld,\"flux\":%lld}\n",
+		track, tries, good, weak, bad, evt_tim->ioctl_ns, evt_tim->decode_ns, evt_tim->flux_bytes);
+	}
+/******************************************************** Karsten Scheibler */
@@ -0,0 +1,90 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * event.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_EVENT_H
+#define CWTOOL_EVENT_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define EVENT_BUFFER_SIZE		0x10000
+#define EVENT_MAX_RECORD_SIZE		256
+#define EVENT_CLOSE_TIMEOUT		5000
+
+struct event_timing
+	{
+	cw_count64_t			ioctl_ns;
+	cw_count64_t			decode_ns;
+	cw_count64_t			flux_bytes;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+event_open(
+	const cw_char_t			*target);
+
+extern cw_void_t
+event_close(
+	cw_void_t);
+
+extern cw_bool_t
+event_enabled(
+	cw_void_t);
+
+extern cw_count64_t
+event_clock(
+	cw_void_t);
+
+extern cw_void_t
+event_try(
+	cw_index_t			track,
+	cw_index_t			try,
+	cw_count_t			good,
+	cw_count_t			weak,
+	cw_count_t			bad,
+	struct event_timing		*evt_tim);
+
+extern cw_void_t
+event_track(
+	cw_index_t			track,
+	cw_count_t			tries,
+	cw_count_t			good,
+	cw_count_t			weak,
+	cw_count_t			bad,
+	struct event_timing		*evt_tim);
+
+
+
+#endif /* !CWTOOL_EVENT_H */
+/******************************************************** Karsten Scheibler */
@@ -135,6 +135,23 @@ fifo_get_wr_bitofs(
 
 
 
+/****************************************************************************
+ * fifo_set_wr_bitofs
+ ****************************************************************************/
+int
+fifo_set_wr_bitofs(
+	struct fifo			*ffo,
+	int				wr_bitofs)
+
+	{
+	debug_error_condition((wr_bitofs < 0) || (wr_bitofs > 8 * ffo->limit));
+	ffo->wr_ofs    = (wr_bitofs + 7) / 8;
+	ffo->wr_bitofs = wr_bitofs;
+	return (0);
+	}
+
+
+
 /****************************************************************************
  * fifo_set_rd_ofs
  ****************************************************************************/
@@ -237,6 +254,14 @@ fifo_read_bits(
 	int				mask = (1 << bits) - 1;
 
 	debug_error_condition(bits > 16);
+
+	/*
+	 * if the data is produced on demand, get more of it before the
+	 * read reaches the end. fill_func removes itself after the last
+	 * data was written
+	 */
+
+	while ((ffo->fill_func != NULL) && (ffo->rd_bitofs + bits >= ffo->wr_bitofs)) ffo->fill_func(ffo, ffo->fill_data);
 	if (shift > 0) avail = 8 - shift;
 	while (avail < bits)
 		{
@@ -533,4 +558,21 @@ fifo_get_speed(
 	{
 	return (ffo->speed);
 	}
+
+
+
+/****************************************************************************
+ * fifo_set_fill_func
+ ****************************************************************************/
+int
+fifo_set_fill_func(
+	struct fifo			*ffo,
+	int				(*fill_func)(struct fifo *, void *),
+	void				*fill_data)
+
+	{
+	ffo->fill_func = fill_func;
+	ffo->fill_data = fill_data;
+	return (0);
+	}
 /******************************************************** Karsten Scheibler */
@@ -27,7 +27,7 @@
 
 
 
-#define FIFO_INIT(d, s)			(struct fifo) { .data = d, .size = s, .limit = s, .wr_ofs = 0, .wr_bitofs = 0, .rd_ofs = 0, .rd_bitofs = 0, .reg = 0, .flags = 0, .speed = 0  }
+#define FIFO_INIT(d, s)			(struct fifo) { .data = d, .size = s, .limit = s, .wr_ofs = 0, .wr_bitofs = 0, .rd_ofs = 0, .rd_bitofs = 0, .reg = 0, .flags = 0, .speed = 0, .fill_func = NULL, .fill_data = NULL }
 
 /* writable in the sense of "writable to a catweasel device" */
 
@@ -47,6 +47,8 @@ struct fifo
 	int				reg;
 	int				flags;
 	int				speed;
+	int				(*fill_func)(struct fifo *, void *);
+	void				*fill_data;
 	};
 
 
@@ -69,6 +71,7 @@ extern unsigned char			*fifo_get_data(struct fifo *);
 extern int				fifo_set_wr_ofs(struct fifo *, int);
 extern int				fifo_get_wr_ofs(struct fifo *);
 extern int				fifo_get_wr_bitofs(struct fifo *);
+extern int				fifo_set_wr_bitofs(struct fifo *, int);
 extern int				fifo_set_rd_ofs(struct fifo *, int);
 extern int				fifo_set_rd_bitofs(struct fifo *, int);
 extern int				fifo_get_rd_ofs(struct fifo *);
@@ -90,6 +93,7 @@ extern int				fifo_clear_flags(struct fifo *, int);
 extern int				fifo_get_flags(struct fifo *);
 extern int				fifo_set_speed(struct fifo *, int);
 extern int				fifo_get_speed(struct fifo *);
+extern int				fifo_set_fill_func(struct fifo *, int (*)(struct fifo *, void *), void *);
 
 #define fifo_write_count(ffo, count)	fifo_write_bits(ffo, 1, count + 1)
 
@@ -12,14 +12,19 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/wait.h>
 
 #include "file.h"
 #include "error.h"
@@ -93,6 +98,197 @@ file_try_again(
 
 
 
+/****************************************************************************
+ * file_async_clock
+ ****************************************************************************/
+static cw_count64_t
+file_async_clock(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((cw_count64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec);
+	}
+
+
+
+/****************************************************************************
+ * file_async_flush
+ ****************************************************************************/
+static cw_void_t
+file_async_flush(
+	struct file			*fil,
+	cw_u8_t				*data,
+	cw_size_t			size,
+	cw_count64_t			*writes)
+
+	{
+	cw_int_t			result;
+
+	while (size > 0)
+		{
+		result = write(fil->fd, data, size);
+		if (result == -1)
+			{
+			if (file_try_again(errno)) continue;
+			error_perror_message("error while writing to '%s'", fil->path);
+			}
+		data += result;
+		size -= result;
+		(*writes)++;
+		}
+	}
+
+
+
+/****************************************************************************
+ * file_async_writer
+ ****************************************************************************/
+static cw_void_t
+file_async_writer(
+	struct file			*fil,
+	cw_int_t			fd)
+
+	{
+	cw_u8_t				*data = malloc(FILE_ASYNC_BUFFER_SIZE);
+	cw_count64_t			sync_interval = (cw_count64_t) options_get_async_write() * 0x100000;
+	cw_count64_t			start = file_async_clock(), sync_ns = 0, t;
+	cw_count64_t			total = 0, synced = 0, writes = 0, syncs = 0;
+	cw_size_t			size = 0, chunk;
+	cw_int_t			result;
+
+	/*
+	 * runs in the writer process. data from the pipe is collected until
+	 * at least one chunk is available, then whole chunks are written,
+	 * so the file system gets few large writes at chunk aligned offsets
+	 */
+
+	if (data == NULL) error_oom();
+	while (1)
+		{
+		result = read(fd, &data[size], FILE_ASYNC_BUFFER_SIZE - size);
+		if (result == -1)
+			{
+			if (file_try_again(errno)) continue;
+			error_perror_message("error while reading data for '%s'", fil->path);
+			}
+		size += result;
+		chunk = (result == 0) ? size : size - size % FILE_ASYNC_CHUNK_SIZE;
+		if (chunk > 0)
+			{
+			file_async_flush(fil, data, chunk, &writes);
+			memmove(data, &data[chunk], size - chunk);
+			size  -= chunk;
+			total += chunk;
+			}
+		if ((result > 0) && ((sync_interval == 0) || (total - synced < sync_interval))) continue;
+
+		/* checkpoint or end of data */
+
+		t = file_async_clock();
+		if (fdatasync(fil->fd) == -1) error_perror_message("error while syncing '%s'", fil->path);
+		sync_ns += file_async_clock() - t;
+		synced = total;
+		syncs++;
+		if (result == 0) break;
+		}
+	t = file_async_clock() - start;
+	verbose_message(GENERIC, 1, "wrote %lld bytes to '%s' with %lld writes and %lld syncs in %lld ms (%lld ms syncing), %.1f MB/s",
+		total, fil->path, writes, syncs, t / 1000000, sync_ns / 1000000, (t > 0) ? total * 1e3 / t : 0.0);
+	free(data);
+	}
+
+
+
+/****************************************************************************
+ * file_async_sigpipe
+ ****************************************************************************/
+static cw_void_t
+file_async_sigpipe(
+	cw_bool_t			ignore)
+
+	{
+	static struct sigaction		sa_old;
+	static cw_count_t		writers;
+	struct sigaction		sa = { .sa_handler = SIG_IGN };
+
+	/*
+	 * a writer which died already printed its error, so get EPIPE
+	 * instead of SIGPIPE while writers run. the previous handler is
+	 * restored when the last writer is gone
+	 */
+
+	if (ignore)
+		{
+		if ((writers++ == 0) && (sigaction(SIGPIPE, &sa, &sa_old) == -1)) error_perror_message("error while sigaction()");
+		return;
+		}
+	debug_error_condition(writers <= 0);
+	if ((--writers == 0) && (sigaction(SIGPIPE, &sa_old, NULL) == -1)) error_perror_message("error while sigaction()");
+	}
+
+
+
+/****************************************************************************
+ * file_async_start
+ ****************************************************************************/
+static cw_void_t
+file_async_start(
+	struct file			*fil)
+
+	{
+	struct stat			st;
+	cw_int_t			pfd[2], fd, pid;
+
+	/*
+	 * devices need ioctl() and other files may be seeked, so only
+	 * regular files opened for creation are handed to a writer. stdout
+	 * is left alone, its fd may not be replaced by a pipe
+	 */
+
+	if ((fil->fd == STDOUT_FILENO) || (fstat(fil->fd, &st) == -1) || (! S_ISREG(st.st_mode)))
+		{
+		verbose_message(GENERIC, 2, "'%s' is no regular file, writing it directly", fil->path);
+		return;
+		}
+	if (pipe(pfd) == -1) error_perror_message("error while creating pipe for '%s'", fil->path);
+#ifdef F_SETPIPE_SZ
+	fcntl(pfd[1], F_SETPIPE_SZ, FILE_ASYNC_PIPE_SIZE);
+#endif /* F_SETPIPE_SZ */
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid == -1) error_perror_message("error while fork()");
+	if (pid == 0)
+		{
+
+		/*
+		 * child: keep only the pipe, the file and stdio open.
+		 * otherwise write ends of other pipes would stay open here
+		 * and the corresponding writers would never see their end
+		 * of data
+		 */
+
+		for (fd = 3; fd < 1024; fd++) if ((fd != pfd[0]) && (fd != fil->fd)) close(fd);
+		file_async_writer(fil, pfd[0]);
+		if (close(fil->fd) == -1) error_perror_message("error while closing '%s'", fil->path);
+		_exit(0);
+		}
+
+	/* parent: from now on fil->fd is the pipe */
+
+	file_async_sigpipe(CW_BOOL_TRUE);
+	close(pfd[0]);
+	close(fil->fd);
+	fil->fd  = pfd[1];
+	fil->pid = pid;
+	verbose_message(GENERIC, 2, "writing '%s' in background process %d", fil->path, pid);
+	}
+
+
+
 
 /****************************************************************************
  *
@@ -218,6 +414,7 @@ file_open(
 		verbose_message(GENERIC, 2, "unlinking temporary file '%s' but keeping it open, so it will consume disk space", path);
 		if (unlink(path) == -1) error_perror_message("error while unlinking '%s'", path);
 		}
+	if ((mode == FILE_MODE_CREATE) && (flags & FILE_FLAG_ASYNC)) file_async_start(fil);
 	return (CW_BOOL_OK);
 	}
 
@@ -231,7 +428,18 @@ file_close(
 	struct file			*fil)
 
 	{
+	cw_int_t			status;
+
 	if (close(fil->fd) == -1) error_perror_message("error while closing '%s'", fil->path);
+
+	/* wait until the writer has written and synced everything */
+
+	if (fil->pid > 0)
+		{
+		if (waitpid(fil->pid, &status, 0) == -1) error_perror_message("error while waitpid()");
+		file_async_sigpipe(CW_BOOL_FALSE);
+		if ((! WIFEXITED(status)) || (WEXITSTATUS(status) != 0)) error_message("error while writing '%s' in background", fil->path);
+		}
 	if (fil->allocated) free(fil->path);
 	*fil = (struct file) { .fd = -1 };
 	}
@@ -282,6 +490,64 @@ file_is_writable(
 
 
 
+/****************************************************************************
+ * file_get_size
+ ****************************************************************************/
+cw_count_t
+file_get_size(
+	struct file			*fil)
+
+	{
+	struct stat			st;
+
+	/* only regular files have a meaningful size */
+
+	if ((fstat(fil->fd, &st) == -1) || (! S_ISREG(st.st_mode))) return (-1);
+	return (st.st_size);
+	}
+
+
+
+/****************************************************************************
+ * file_map
+ ****************************************************************************/
+cw_void_t *
+file_map(
+	struct file			*fil,
+	cw_size_t			size)
+
+	{
+	cw_void_t			*data;
+
+	/*
+	 * returns NULL if the file can not be mapped (pipes, devices,
+	 * empty files), the caller then has to use file_read()
+	 */
+
+	if ((size == 0) || (fil->pid != 0)) return (NULL);
+	data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fil->fd, 0);
+	if (data == MAP_FAILED) return (NULL);
+	verbose_message(GENERIC, 2, "mapped %d bytes of '%s'", size, fil->path);
+	return (data);
+	}
+
+
+
+/****************************************************************************
+ * file_unmap
+ ****************************************************************************/
+cw_void_t
+file_unmap(
+	struct file			*fil,
+	cw_void_t			*data,
+	cw_size_t			size)
+
+	{
+	if (munmap(data, size) == -1) error_perror_message("error while unmapping '%s'", fil->path);
+	}
+
+
+
 /****************************************************************************
  * file_ioctl2
  ****************************************************************************/
@@ -457,4 +723,18 @@ file_write_sprintf(
 	if ((len == -1) || (len >= sizeof (string))) error_message("file_write_sprintf() size exceeded");
 	return (file_write(fil, string, len));
 	}
+
+
+
+/****************************************************************************
+ * file_sync
+ ****************************************************************************/
+cw_void_t
+file_sync(
+	struct file			*fil)
+
+	{
+	debug_error_condition(fil->pid > 0);
+	if (fsync(fil->fd) == -1) error_perror_message("error while syncing '%s'", fil->path);
+	}
 /******************************************************** Karsten Scheibler */
@@ -34,6 +34,17 @@
 
 #define FILE_FLAG_NONE			0
 #define FILE_FLAG_RETURN		(1 << 0)
+#define FILE_FLAG_ASYNC			(1 << 1)
+
+/*
+ * with FILE_FLAG_ASYNC a writer process takes the data through a pipe and
+ * writes it in chunks of FILE_ASYNC_CHUNK_SIZE. the pipe and the buffer of
+ * the writer bound the amount of data not yet written
+ */
+
+#define FILE_ASYNC_PIPE_SIZE		0x100000
+#define FILE_ASYNC_BUFFER_SIZE		0x400000
+#define FILE_ASYNC_CHUNK_SIZE		0x100000
 
 struct file
 	{
@@ -41,6 +52,7 @@ struct file
 	cw_int_t			fd;
 	cw_mode_t			mode;
 	cw_bool_t			allocated;
+	cw_int_t			pid;
 	};
 
 
@@ -78,6 +90,21 @@ extern cw_bool_t
 file_is_writable(
 	struct file			*fil);
 
+extern cw_count_t
+file_get_size(
+	struct file			*fil);
+
+extern cw_void_t *
+file_map(
+	struct file			*fil,
+	cw_size_t			size);
+
+extern cw_void_t
+file_unmap(
+	struct file			*fil,
+	cw_void_t			*data,
+	cw_size_t			size);
+
 extern cw_int_t
 file_ioctl2(
 	struct file			*fil,
@@ -120,6 +147,10 @@ file_write_sprintf(
 	const cw_char_t			*format,
 	...);
 
+extern cw_void_t
+file_sync(
+	struct file			*fil);
+
 #define file_ioctl(fil, cmd, arg, fl)	file_ioctl2(fil, cmd, (cw_ptr_t) arg, fl)
 
 
@@ -44,6 +44,7 @@ union format
 #define FORMAT_FLAG_NONE		0
 #define FORMAT_FLAG_GREEDY		(1 << 0)
 #define FORMAT_FLAG_OUTPUT		(1 << 1)
+#define FORMAT_FLAG_CONTAINER		(1 << 2)
 
 #define FORMAT_OPTION_TYPE_NONE			0
 #define FORMAT_OPTION_TYPE_BOOLEAN		1
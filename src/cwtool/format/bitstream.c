@@ -19,6 +19,7 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../stats.h"
 #include "bounds.h"
 
 
@@ -33,6 +34,13 @@
 
 
 
+/* number of counter values converted by one call of bitstream_stream_fill() */
+
+#define STREAM_CHUNK_SIZE		2048
+
+
+
+
 /****************************************************************************
  * bitstream_read_lookup2
  ****************************************************************************/
@@ -80,6 +88,157 @@ bitstream_read_lookup2(
 
 
 
+/****************************************************************************
+ * bitstream_pll_setup
+ ****************************************************************************/
+static int
+bitstream_pll_setup(
+	struct bitstream_pll		*bst_pll,
+	struct bounds			*bnd,
+	int				bnd_size)
+
+	{
+	int				i, l, h;
+
+	/*
+	 * the nominal cell period and the constant offset of all pulse
+	 * lengths are taken from the write values of the shortest and the
+	 * longest pulse. the pll may drift away from the nominal period by
+	 * 1/8. returns 0 if the bounds do not give a usable period,
+	 * bitstream_pll_counter() would never terminate with it
+	 */
+
+	for (i = l = h = 0; i < bnd_size; i++)
+		{
+		if (bnd[i].count < bnd[l].count) l = i;
+		if (bnd[i].count > bnd[h].count) h = i;
+		}
+	if (bnd[l].count == bnd[h].count) return (0);
+	bst_pll->period     = (bnd[h].write - bnd[l].write) / (bnd[h].count - bnd[l].count);
+	bst_pll->period_min = bst_pll->period - bst_pll->period / 8;
+	bst_pll->period_max = bst_pll->period + bst_pll->period / 8;
+	bst_pll->offset     = bnd[l].write - (bnd[l].count + 1) * bst_pll->period;
+	bst_pll->phase      = 0;
+	bst_pll->cells_min  = bnd[l].count + 1;
+	bst_pll->cells_max  = bnd[h].count + 1;
+	return ((bst_pll->period > 0) && (bst_pll->period_min > 0));
+	}
+
+
+
+/****************************************************************************
+ * bitstream_pll_init
+ ****************************************************************************/
+static void
+bitstream_pll_init(
+	struct bitstream_pll		*bst_pll,
+	struct bounds			*bnd,
+	int				bnd_size)
+
+	{
+
+	/*
+	 * bitstream_pll_check() already rejects "pll yes" with such
+	 * bounds, but bounds may still be changed after "pll yes"
+	 */
+
+	debug_error_condition(bnd_size < 2);
+	if (! bitstream_pll_setup(bst_pll, bnd, bnd_size)) error_message("bounds do not give a valid bit cell period for pll");
+	}
+
+
+
+/****************************************************************************
+ * bitstream_pll_counter
+ ****************************************************************************/
+static int
+bitstream_pll_counter(
+	struct fifo			*ffo_l0,
+	struct bitstream_pll		*bst_pll,
+	int				*error)
+
+	{
+	int				c, t, i = fifo_read_byte(ffo_l0);
+
+	if (i == -1) return (-1);
+
+	/*
+	 * count the bit cells up to this pulse, t is left with the phase
+	 * error of the pulse. pulses not fitting into the allowed number
+	 * of cells generate an invalid bit pattern like
+	 * bitstream_read_counter() does. error gets the phase error in
+	 * counter values like bitstream_read_lookup2() computes it
+	 */
+
+	t = ((i & GLOBAL_PULSE_LENGTH_MASK) << 8) - bst_pll->offset + bst_pll->phase;
+	for (c = 0; t > bst_pll->period / 2; c++) t -= bst_pll->period;
+	if ((c < bst_pll->cells_min) || (c > bst_pll->cells_max))
+		{
+		bst_pll->phase = 0;
+		if (error != NULL) *error = 0xff;
+		return (bst_pll->cells_max);
+		}
+	if (error != NULL) *error = (((t < 0) ? -t : t) + 0x80) >> 8;
+	if ((error != NULL) && (*error > 0xfe)) *error = 0xfe;
+
+	/*
+	 * a late pulse means the period is too short. correct the period
+	 * by 1/64 of the error and carry 1/4 of it over to the next pulse,
+	 * higher gains follow drift faster but also follow the jitter
+	 */
+
+	bst_pll->period += t / 64;
+	if (bst_pll->period < bst_pll->period_min) bst_pll->period = bst_pll->period_min;
+	if (bst_pll->period > bst_pll->period_max) bst_pll->period = bst_pll->period_max;
+	bst_pll->phase = t / 4;
+	return (c - 1);
+	}
+
+
+
+/****************************************************************************
+ * bitstream_stream_fill
+ ****************************************************************************/
+static int
+bitstream_stream_fill(
+	struct fifo			*ffo_l1,
+	void				*data)
+
+	{
+	struct bitstream_stream		*bst_str = (struct bitstream_stream *) data;
+	int				i, j;
+
+	stats_begin(BITSTREAM);
+	for (j = 0; j < STREAM_CHUNK_SIZE; j++)
+		{
+		if (bst_str->flags & BITSTREAM_FLAG_PLL) i = bitstream_pll_counter(bst_str->ffo_l0, &bst_str->pll, NULL);
+		else i = bitstream_read_counter(bst_str->ffo_l0, bst_str->lookup);
+		if (i == -1) break;
+		if (fifo_write_count(&bst_str->ffo_l1, i) == -1) debug_error();
+		}
+
+	/*
+	 * the reader only gets complete bytes, because the last byte is
+	 * not yet written to the fifo data. at the end of ffo_l0 the
+	 * remaining bits are flushed and no further calls are needed
+	 */
+
+	if (j < STREAM_CHUNK_SIZE)
+		{
+		fifo_write_flush(&bst_str->ffo_l1);
+		fifo_set_wr_bitofs(ffo_l1, fifo_get_wr_bitofs(&bst_str->ffo_l1));
+		fifo_set_fill_func(ffo_l1, NULL, NULL);
+		debug_message(GENERIC, 3, "bitstream_stream_fill ffo_l0->wr_ofs = %d, ffo_l1->wr_bitofs = %d", fifo_get_wr_ofs(bst_str->ffo_l0), fifo_get_wr_bitofs(ffo_l1));
+		stats_end(BITSTREAM);
+		return (-1);
+		}
+	fifo_set_wr_bitofs(ffo_l1, fifo_get_wr_bitofs(&bst_str->ffo_l1) & ~7);
+	stats_end(BITSTREAM);
+	return (0);
+	}
+
+
+
 
 /****************************************************************************
  *
@@ -175,6 +334,7 @@ bitstream_read(
 
 	/* create lookup table */
 
+	stats_begin(BITSTREAM);
 	bitstream_read_lookup(bnd, bnd_size, lookup);
 
 	/* convert raw counter values to raw bits */
@@ -188,6 +348,58 @@ bitstream_read(
 		}
 	fifo_write_flush(ffo_l1);
 	debug_message(GENERIC, 3, "bitstream_read ffo_l0->wr_ofs = %d, ffo_l1->wr_bitofs = %d", fifo_get_wr_ofs(ffo_l0), fifo_get_wr_bitofs(ffo_l1));
+	stats_end(BITSTREAM);
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * bitstream_pll_check
+ ****************************************************************************/
+int
+bitstream_pll_check(
+	struct bounds			*bnd,
+	int				bnd_size)
+
+	{
+	struct bitstream_pll		bst_pll;
+
+	return (bitstream_pll_setup(&bst_pll, bnd, bnd_size));
+	}
+
+
+
+/****************************************************************************
+ * bitstream_read_stream
+ ****************************************************************************/
+int
+bitstream_read_stream(
+	struct fifo			*ffo_l0,
+	struct fifo			*ffo_l1,
+	struct bitstream_stream		*bst_str,
+	struct bounds			*bnd,
+	int				bnd_size,
+	int				flags)
+
+	{
+
+	/*
+	 * like bitstream_read(), but the raw counter values are only
+	 * converted when the sector parser reads from ffo_l1. so only the
+	 * part of the track really scanned is converted, and it is done in
+	 * small chunks right before the data is needed. with
+	 * BITSTREAM_FLAG_PLL the fixed bounds are replaced by a pll, which
+	 * follows the bit cell period of the track
+	 */
+
+	debug_error_condition(fifo_get_wr_bitofs(ffo_l1) != 0);
+	bst_str->flags = flags;
+	if (flags & BITSTREAM_FLAG_PLL) bitstream_pll_init(&bst_str->pll, bnd, bnd_size);
+	else bitstream_read_lookup(bnd, bnd_size, bst_str->lookup);
+	bst_str->ffo_l0 = ffo_l0;
+	bst_str->ffo_l1 = *ffo_l1;
+	fifo_set_fill_func(ffo_l1, bitstream_stream_fill, bst_str);
 	return (0);
 	}
 
@@ -203,16 +415,24 @@ bitstream_read_map(
 	struct bounds			*bnd,
 	int				bnd_size,
 	struct bitstream_map		*bst_map,
-	int				bst_map_size)
+	int				bst_map_size,
+	int				flags)
 
 	{
+	struct bitstream_pll		bst_pll;
 	int				b, e, i, j, s;
 	int				lookup[GLOBAL_NR_PULSE_LENGTHS];
 	int				error[GLOBAL_NR_PULSE_LENGTHS];
 
-	/* create lookup table */
+	/*
+	 * create lookup table. with BITSTREAM_FLAG_PLL the map has to be
+	 * built from the same pll bitstream_read_stream() uses, otherwise
+	 * the bit offsets of the decoder do not match length_sum
+	 */
 
-	bitstream_read_lookup2(bnd, bnd_size, lookup, error);
+	stats_begin(BITSTREAM);
+	if (flags & BITSTREAM_FLAG_PLL) bitstream_pll_init(&bst_pll, bnd, bnd_size);
+	else bitstream_read_lookup2(bnd, bnd_size, lookup, error);
 
 	/* convert raw counter values to raw bits */
 
@@ -220,10 +440,18 @@ bitstream_read_map(
 	if (ffo_l1 != NULL) debug_message(GENERIC, 3, "bitstream_read_map ffo_l1->limit = %d", fifo_get_limit(ffo_l1));
 	for (j = 0, s = 0; j < bst_map_size; j++)
 		{
-		b = fifo_read_byte(ffo_l0);
-		if (b == -1) break;
-		e = error[b & GLOBAL_PULSE_LENGTH_MASK];
-		i = lookup[b & GLOBAL_PULSE_LENGTH_MASK];
+		if (flags & BITSTREAM_FLAG_PLL)
+			{
+			i = bitstream_pll_counter(ffo_l0, &bst_pll, &e);
+			if (i == -1) break;
+			}
+		else
+			{
+			b = fifo_read_byte(ffo_l0);
+			if (b == -1) break;
+			e = error[b & GLOBAL_PULSE_LENGTH_MASK];
+			i = lookup[b & GLOBAL_PULSE_LENGTH_MASK];
+			}
 		s += i + 1;
 		bst_map[j] = (struct bitstream_map)
 			{
@@ -242,6 +470,7 @@ bitstream_read_map(
 		fifo_write_flush(ffo_l1);
 		debug_message(GENERIC, 3, "bitstream_read_map ffo_l1->wr_bitofs = %d", fifo_get_wr_bitofs(ffo_l1));
 		}
+	stats_end(BITSTREAM);
 	return (j);
 	}
 
@@ -14,6 +14,8 @@
 #define CWTOOL_FORMAT_BITSTREAM_H
 
 #include "types.h"
+#include "../global.h"
+#include "../fifo.h"
 
 
 
@@ -27,7 +29,6 @@
 
 
 
-struct fifo;
 struct bounds;
 
 #define BITSTREAM_COUNTER_INIT(b, p, s)	(struct bitstream_counter) { .bnd = b, .precomp = p, .bnd_size = s }
@@ -43,6 +44,38 @@ struct bitstream_counter
 	int				bnd_size;
 	};
 
+/*
+ * software pll, period and offset are in the same fixed point units as
+ * struct bounds. a pulse length is offset + cells * period
+ */
+
+struct bitstream_pll
+	{
+	int				period;
+	int				period_min;
+	int				period_max;
+	int				offset;
+	int				phase;
+	int				cells_min;
+	int				cells_max;
+	};
+
+/*
+ * state of bitstream_read_stream(), ffo_l1 is the writing side of the
+ * fifo given to the sector parser
+ */
+
+#define BITSTREAM_FLAG_PLL		(1 << 0)
+
+struct bitstream_stream
+	{
+	struct fifo			*ffo_l0;
+	struct fifo			ffo_l1;
+	int				flags;
+	int				lookup[GLOBAL_NR_PULSE_LENGTHS];
+	struct bitstream_pll		pll;
+	};
+
 struct bitstream_map
 	{
 	cw_count_t			length:8;
@@ -66,7 +99,9 @@ extern int				bitstream_read_lookup(struct bounds *, int, int *);
 extern int				bitstream_read_counter(struct fifo *, int *);
 extern int				bitstream_write_counter(struct fifo *, struct bitstream_counter *, int);
 extern int				bitstream_read(struct fifo *, struct fifo *, struct bounds *, int);
-extern int				bitstream_read_map(struct fifo *, struct fifo *, struct bounds *, int, struct bitstream_map *, int);
+extern int				bitstream_pll_check(struct bounds *, int);
+extern int				bitstream_read_stream(struct fifo *, struct fifo *, struct bitstream_stream *, struct bounds *, int, int);
+extern int				bitstream_read_map(struct fifo *, struct fifo *, struct bounds *, int, struct bitstream_map *, int, int);
 extern int				bitstream_write(struct fifo *, struct fifo *, struct bounds *, short *, int);
 
 
@@ -50,6 +50,7 @@
 #define FLAG_RD_MATCH_SIMPLE		(1 << 3)
 #define FLAG_RD_MATCH_SIMPLE_FIXUP	(1 << 4)
 #define FLAG_RD_POSTCOMP_SIMPLE		(1 << 5)
+#define FLAG_RD_PLL			(1 << 6)
 #define FLAG_RW_CRC16_INIT_VALUE1_SET	(1 << 0)
 #define FLAG_RW_CRC16_INIT_VALUE2_SET	(1 << 1)
 #define FLAG_RW_CRC16_INIT_VALUE3_SET	(1 << 2)
@@ -128,27 +129,41 @@ static int
 fm_nec765_read_sector2(
 	struct fifo			*ffo_l1,
 	struct fm_nec765		*fm_nec,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
 	unsigned char			*data)
 
 	{
-	int				bitofs, data_size, result;
+	int				bitofs, sector, data_size, result;
 
 	*dsk_err = (struct disk_error) { };
 	if (fm_read_sync(ffo_l1, range_sector_header(rng_sec), fm_nec->rw.sync_value1, fm_nec->rw.sync_value1) == -1) return (-1);
 	bitofs = fifo_get_rd_bitofs(ffo_l1);
 	if (fm_read_bytes(ffo_l1, dsk_err, header, HEADER_SIZE) == -1) return (-1);
 	range_set_end(range_sector_header(rng_sec), fifo_get_rd_bitofs(ffo_l1));
-	data_size = fm_nec765_sector_size(fm_nec, header[2] - 1);
+
+	/*
+	 * do not decode sectors again, which were already read without
+	 * errors on a previous try
+	 */
+
+	sector = header[2] - 1;
+	if ((sector >= 0) && (sector < fm_nec->rw.sectors) && (! disk_sector_needed(&dsk_sct[sector])))
+		{
+		verbose_message(GENERIC, 1, "skipping sector %d, already read", sector);
+		fifo_set_rd_bitofs(ffo_l1, bitofs);
+		return (0);
+		}
+	data_size = fm_nec765_sector_size(fm_nec, sector);
 	result = fm_read_sync(ffo_l1, range_sector_data(rng_sec), fm_nec->rw.sync_value2, fm_nec->rw.sync_value3);
 	if (result == -1) return (-1);
 	if (fm_read_bytes(ffo_l1, dsk_err, data, data_size + 2) == -1) return (-1);
 	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
 	verbose_message(GENERIC, 2, "rewinding to bit offset %d", bitofs);
 	fifo_set_rd_bitofs(ffo_l1, bitofs);
-	return (result);
+	return (result + 1);
 	}
 
 
@@ -199,9 +214,9 @@ fm_nec765_read_sector(
 	int				result, track, side, sector, data_size;
 	int				init = fm_nec->rw.crc16_init_value2;
 
-	result = fm_nec765_read_sector2(ffo_l1, fm_nec, &dsk_err, &rng_sec, header, data);
-	if (result == -1) return (-1);
-	if (result == 1) init = fm_nec->rw.crc16_init_value3;
+	result = fm_nec765_read_sector2(ffo_l1, fm_nec, dsk_sct, &dsk_err, &rng_sec, header, data);
+	if (result < 1) return (result);
+	if (result == 2) init = fm_nec->rw.crc16_init_value3;
 
 	/* accept only valid sector numbers */
 
@@ -328,10 +343,12 @@ fm_nec765_read_track2(
 	{
 	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
 	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	struct bitstream_stream		bst_str;
 
 	if (fmt->fm_nec.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->fm_nec.rw.bnd, 2);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->fm_nec.rw.bnd, 2);
-	while (fm_nec765_read_sector(&ffo_l1, &fmt->fm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	bitstream_read_stream(ffo_l0, &ffo_l1, &bst_str, fmt->fm_nec.rw.bnd, 2, (fmt->fm_nec.rd.flags & FLAG_RD_PLL) ? BITSTREAM_FLAG_PLL : 0);
+	while ((disk_sectors_needed(dsk_sct, fmt->fm_nec.rw.sectors) > 0) &&
+		(fm_nec765_read_sector(&ffo_l1, &fmt->fm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1)) ;
 	}
 
 
@@ -363,6 +380,7 @@ fm_nec765_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->fm_nec.rw.bnd,
 		.bnd_size     = 2,
+		.bst_flags    = (fmt->fm_nec.rd.flags & FLAG_RD_PLL) ? BITSTREAM_FLAG_PLL : 0,
 		.callback     = fm_nec765_read_track2,
 		.merge_two    = fmt->fm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE,
 		.merge_all    = fmt->fm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE,
@@ -455,6 +473,7 @@ fm_nec765_write_track(
 #define MAGIC_SECTOR_SIZES		33
 #define MAGIC_BOUNDS_OLD		34
 #define MAGIC_BOUNDS_NEW		35
+#define MAGIC_PLL			36
 
 
 
@@ -571,6 +590,8 @@ fm_nec765_set_read_option(
 	if (magic == MAGIC_IGNORE_TRACK_MISMATCH) return (setvalue_uchar_bit(&fmt->fm_nec.rd.flags, val, FLAG_RD_IGNORE_TRACK_MISMATCH));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->fm_nec.rd.flags, val, FLAG_RD_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->fm_nec.rd.flags, val, FLAG_RD_MATCH_SIMPLE_FIXUP));
+	if ((magic == MAGIC_PLL) && (val) && (! bitstream_pll_check(fmt->fm_nec.rw.bnd, 2))) error_message("bounds do not give a valid bit cell period for pll");
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->fm_nec.rd.flags, val, FLAG_RD_PLL));
 	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE);
 	return (setvalue_uchar_bit(&fmt->fm_nec.rd.flags, val, FLAG_RD_POSTCOMP_SIMPLE));
 	}
@@ -730,6 +751,7 @@ fm_nec765_get_flags(
 
 	{
 	if (options_get_output()) return (FORMAT_FLAG_OUTPUT);
+	if (fmt->fm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE) return (FORMAT_FLAG_CONTAINER);
 	return (FORMAT_FLAG_NONE);
 	}
 
@@ -773,6 +795,7 @@ static struct format_option		fm_nec765_read_options[] =
 	FORMAT_OPTION_BOOLEAN("match_simple_fixup",    MAGIC_MATCH_SIMPLE_FIXUP,    1),
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",       MAGIC_POSTCOMP_SIMPLE,       1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",       MAGIC_POSTCOMP_SIMPLE,       1),
+	FORMAT_OPTION_BOOLEAN("pll",                   MAGIC_PLL,                   1),
 	FORMAT_OPTION_END
 	};
 
@@ -1078,6 +1078,7 @@ gcr_apple_get_flags(
 
 	{
 	if (options_get_output()) return (FORMAT_FLAG_OUTPUT);
+	if (fmt->gcr_apl.rd.flags & FLAG_MATCH_SIMPLE) return (FORMAT_FLAG_CONTAINER);
 	return (FORMAT_FLAG_NONE);
 	}
 
@@ -922,7 +922,7 @@ gcr_apple_test_read_track2(
 		{
 		.data         = fifo_get_data(ffo_l0),
 		.bst_map      = bst_map,
-		.bst_map_size = bitstream_read_map(ffo_l0, &ffo_l1, fmt->gcr_apl_tst.rw.bnd, 3, bst_map, GLOBAL_MAX_TRACK_SIZE)
+		.bst_map_size = bitstream_read_map(ffo_l0, &ffo_l1, fmt->gcr_apl_tst.rw.bnd, 3, bst_map, GLOBAL_MAX_TRACK_SIZE, 0)
 		};
 	while (gcr_apple_test_read_sector(&ffo_l1, &fmt->gcr_apl_tst, con, dsk_sct, cwtool_track, format_track, format_side, &xtr_nfo) != -1) ;
 	}
@@ -1197,6 +1197,7 @@ gcr_apple_test_get_flags(
 
 	{
 	if (options_get_output()) return (FORMAT_FLAG_OUTPUT);
+	if (fmt->gcr_apl_tst.rd.flags & FLAG_MATCH_SIMPLE) return (FORMAT_FLAG_CONTAINER);
 	return (FORMAT_FLAG_NONE);
 	}
 
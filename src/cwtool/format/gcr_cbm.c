@@ -230,6 +230,7 @@ gcr_write_bytes(
 #define FLAG_MATCH_SIMPLE		(1 << 3)
 #define FLAG_MATCH_SIMPLE_FIXUP		(1 << 4)
 #define FLAG_POSTCOMP_SIMPLE		(1 << 5)
+#define FLAG_PLL			(1 << 6)
 
 
 
@@ -274,13 +275,14 @@ static int
 gcr_cbm_read_sector2(
 	struct fifo			*ffo_l1,
 	struct gcr_cbm			*gcr_cbm,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
 	unsigned char			*data)
 
 	{
-	int				bitofs;
+	int				bitofs, sector;
 
 	while (1)
 		{
@@ -292,6 +294,18 @@ gcr_cbm_read_sector2(
 		fifo_set_rd_bitofs(ffo_l1, bitofs);
 		if (format_compare2("header_id: got 0x%02x, expected 0x%02x", header[0], gcr_cbm->rw.header_id) == 0) break;
 		}
+
+	/*
+	 * do not decode sectors again, which were already read without
+	 * errors on a previous try
+	 */
+
+	sector = header[2];
+	if ((sector < gcr_cbm->rw.sectors) && (! disk_sector_needed(&dsk_sct[sector])))
+		{
+		verbose_message(GENERIC, 1, "skipping sector %d, already read", sector);
+		return (0);
+		}
 	if (gcr_read_sync(ffo_l1, range_sector_data(rng_sec), gcr_cbm->rd.sync_length) == -1) return (-1);
 	if (gcr_read_bytes(ffo_l1, dsk_err, data, DATA_READ_SIZE) == -1) return (-1);
 	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
@@ -344,7 +358,8 @@ gcr_cbm_read_sector(
 	unsigned char			data[DATA_SIZE];
 	int				result, track, sector;
 
-	if (gcr_cbm_read_sector2(ffo_l1, gcr_cbm, &dsk_err, &rng_sec, header, data) == -1) return (-1);
+	result = gcr_cbm_read_sector2(ffo_l1, gcr_cbm, dsk_sct, &dsk_err, &rng_sec, header, data);
+	if (result != 1) return (result);
 
 	/* accept only valid sector numbers */
 
@@ -472,10 +487,12 @@ gcr_cbm_read_track2(
 	{
 	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
 	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	struct bitstream_stream		bst_str;
 
 	if (fmt->gcr_cbm.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->gcr_cbm.rw.bnd, 3);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_cbm.rw.bnd, 3);
-	while (gcr_cbm_read_sector(&ffo_l1, &fmt->gcr_cbm, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	bitstream_read_stream(ffo_l0, &ffo_l1, &bst_str, fmt->gcr_cbm.rw.bnd, 3, (fmt->gcr_cbm.rd.flags & FLAG_PLL) ? BITSTREAM_FLAG_PLL : 0);
+	while ((disk_sectors_needed(dsk_sct, fmt->gcr_cbm.rw.sectors) > 0) &&
+		(gcr_cbm_read_sector(&ffo_l1, &fmt->gcr_cbm, con, dsk_sct, cwtool_track, format_track, format_side) != -1)) ;
 	}
 
 
@@ -507,6 +524,7 @@ gcr_cbm_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->gcr_cbm.rw.bnd,
 		.bnd_size     = 3,
+		.bst_flags    = (fmt->gcr_cbm.rd.flags & FLAG_PLL) ? BITSTREAM_FLAG_PLL : 0,
 		.callback     = gcr_cbm_read_track2,
 		.merge_two    = fmt->gcr_cbm.rd.flags & FLAG_MATCH_SIMPLE,
 		.merge_all    = fmt->gcr_cbm.rd.flags & FLAG_MATCH_SIMPLE,
@@ -580,6 +598,7 @@ gcr_cbm_write_track(
 #define MAGIC_TRACK_STEP		16
 #define MAGIC_BOUNDS_OLD		17
 #define MAGIC_BOUNDS_NEW		18
+#define MAGIC_PLL			19
 
 
 
@@ -650,6 +669,8 @@ gcr_cbm_set_read_option(
 	if (magic == MAGIC_IGNORE_DATA_ID)        return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_IGNORE_DATA_ID));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_MATCH_SIMPLE_FIXUP));
+	if ((magic == MAGIC_PLL) && (val) && (! bitstream_pll_check(fmt->gcr_cbm.rw.bnd, 3))) error_message("bounds do not give a valid bit cell period for pll");
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_PLL));
 	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE);
 	return (setvalue_uchar_bit(&fmt->gcr_cbm.rd.flags, val, FLAG_POSTCOMP_SIMPLE));
 	}
@@ -740,6 +761,7 @@ gcr_cbm_get_flags(
 
 	{
 	if (options_get_output()) return (FORMAT_FLAG_OUTPUT);
+	if (fmt->gcr_cbm.rd.flags & FLAG_MATCH_SIMPLE) return (FORMAT_FLAG_CONTAINER);
 	return (FORMAT_FLAG_NONE);
 	}
 
@@ -784,6 +806,7 @@ static struct format_option		gcr_cbm_read_options[] =
 	FORMAT_OPTION_BOOLEAN("match_simple_fixup",    MAGIC_MATCH_SIMPLE_FIXUP,    1),
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",       MAGIC_POSTCOMP_SIMPLE,       1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",       MAGIC_POSTCOMP_SIMPLE,       1),
+	FORMAT_OPTION_BOOLEAN("pll",                   MAGIC_PLL,                   1),
 	FORMAT_OPTION_END
 	};
 
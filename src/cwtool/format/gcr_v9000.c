@@ -210,6 +210,7 @@ gcr_write_bytes(
 #define FLAG_RD_MATCH_SIMPLE		(1 << 3)
 #define FLAG_RD_MATCH_SIMPLE_FIXUP	(1 << 4)
 #define FLAG_RD_POSTCOMP_SIMPLE		(1 << 5)
+#define FLAG_RD_PLL			(1 << 6)
 #define FLAG_RW_FLIP_TRACK_ID		(1 << 0)
 
 
@@ -299,13 +300,14 @@ static int
 gcr_v9000_read_sector2(
 	struct fifo			*ffo_l1,
 	struct gcr_v9000		*gcr_v9,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
 	unsigned char			*data)
 
 	{
-	int				bitofs;
+	int				bitofs, sector;
 
 	while (1)
 		{
@@ -317,6 +319,18 @@ gcr_v9000_read_sector2(
 		fifo_set_rd_bitofs(ffo_l1, bitofs);
 		if (format_compare2("header_id: got 0x%02x, expected 0x%02x", header[0], gcr_v9->rw.header_id) == 0) break;
 		}
+
+	/*
+	 * do not decode sectors again, which were already read without
+	 * errors on a previous try
+	 */
+
+	sector = header[2];
+	if ((sector < gcr_v9->rw.sectors) && (! disk_sector_needed(&dsk_sct[sector])))
+		{
+		verbose_message(GENERIC, 1, "skipping sector %d, already read", sector);
+		return (0);
+		}
 	if (gcr_read_sync(ffo_l1, range_sector_data(rng_sec), gcr_v9->rd.sync_length2) == -1) return (-1);
 	if (gcr_read_bytes(ffo_l1, dsk_err, data, DATA_SIZE) == -1) return (-1);
 	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
@@ -369,7 +383,8 @@ gcr_v9000_read_sector(
 	unsigned char			data[DATA_SIZE];
 	int				result, track, sector;
 
-	if (gcr_v9000_read_sector2(ffo_l1, gcr_v9, &dsk_err, &rng_sec, header, data) == -1) return (-1);
+	result = gcr_v9000_read_sector2(ffo_l1, gcr_v9, dsk_sct, &dsk_err, &rng_sec, header, data);
+	if (result != 1) return (result);
 
 	/* accept only valid sector numbers */
 
@@ -498,10 +513,12 @@ gcr_v9000_read_track2(
 	{
 	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
 	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	struct bitstream_stream		bst_str;
 
 	if (fmt->gcr_v9.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple_adjust(ffo_l0, fmt->gcr_v9.rw.bnd, 3, fmt->gcr_v9.rd.postcomp_simple_adjust[0], fmt->gcr_v9.rd.postcomp_simple_adjust[1]);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_v9.rw.bnd, 3);
-	while (gcr_v9000_read_sector(&ffo_l1, &fmt->gcr_v9, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	bitstream_read_stream(ffo_l0, &ffo_l1, &bst_str, fmt->gcr_v9.rw.bnd, 3, (fmt->gcr_v9.rd.flags & FLAG_RD_PLL) ? BITSTREAM_FLAG_PLL : 0);
+	while ((disk_sectors_needed(dsk_sct, fmt->gcr_v9.rw.sectors) > 0) &&
+		(gcr_v9000_read_sector(&ffo_l1, &fmt->gcr_v9, con, dsk_sct, cwtool_track, format_track, format_side) != -1)) ;
 	}
 
 
@@ -533,6 +550,7 @@ gcr_v9000_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->gcr_v9.rw.bnd,
 		.bnd_size     = 3,
+		.bst_flags    = (fmt->gcr_v9.rd.flags & FLAG_RD_PLL) ? BITSTREAM_FLAG_PLL : 0,
 		.callback     = gcr_v9000_read_track2,
 		.merge_two    = fmt->gcr_v9.rd.flags & FLAG_RD_MATCH_SIMPLE,
 		.merge_all    = fmt->gcr_v9.rd.flags & FLAG_RD_MATCH_SIMPLE,
@@ -607,6 +625,7 @@ gcr_v9000_write_track(
 #define MAGIC_SIDE_OFFSET		19
 #define MAGIC_BOUNDS_OLD		20
 #define MAGIC_BOUNDS_NEW		21
+#define MAGIC_PLL			22
 
 
 
@@ -680,6 +699,8 @@ gcr_v9000_set_read_option(
 	if (magic == MAGIC_IGNORE_DATA_ID)        return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_IGNORE_DATA_ID));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_MATCH_SIMPLE_FIXUP));
+	if ((magic == MAGIC_PLL) && (val) && (! bitstream_pll_check(fmt->gcr_v9.rw.bnd, 3))) error_message("bounds do not give a valid bit cell period for pll");
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_PLL));
 	if (magic == MAGIC_POSTCOMP_SIMPLE)       return (setvalue_uchar_bit(&fmt->gcr_v9.rd.flags, val, FLAG_RD_POSTCOMP_SIMPLE));
 	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE_ADJUST);
 	return (setvalue_short(&fmt->gcr_v9.rd.postcomp_simple_adjust[ofs], val, -0x0400, 0x0400));
@@ -773,6 +794,7 @@ gcr_v9000_get_flags(
 
 	{
 	if (options_get_output()) return (FORMAT_FLAG_OUTPUT);
+	if (fmt->gcr_v9.rd.flags & FLAG_RD_MATCH_SIMPLE) return (FORMAT_FLAG_CONTAINER);
 	return (FORMAT_FLAG_NONE);
 	}
 
@@ -819,6 +841,7 @@ static struct format_option		gcr_v9000_read_options[] =
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",        MAGIC_POSTCOMP_SIMPLE,        1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",        MAGIC_POSTCOMP_SIMPLE,        1),
 	FORMAT_OPTION_INTEGER("postcomp_simple_adjust", MAGIC_POSTCOMP_SIMPLE_ADJUST, 2),
+	FORMAT_OPTION_BOOLEAN("pll",                    MAGIC_PLL,                    1),
 	FORMAT_OPTION_END
 	};
 
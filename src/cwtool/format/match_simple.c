@@ -82,6 +82,7 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../stats.h"
 #include "bitstream.h"
 #include "container.h"
 
@@ -498,7 +499,8 @@ match_simple_store(
 		mat_sim_nfo->bnd,
 		mat_sim_nfo->bnd_size,
 		bst_map,
-		GLOBAL_MAX_TRACK_SIZE);
+		GLOBAL_MAX_TRACK_SIZE,
+		mat_sim_nfo->bst_flags);
 	fifo_set_rd_ofs(mat_sim_nfo->ffo_l0, 0);
 
 	/*
@@ -538,6 +540,7 @@ match_simple_do_callback(
 	struct container		*con)
 
 	{
+	stats_begin(DECODE);
 	mat_sim_nfo->callback(
 		mat_sim_nfo->fmt,
 		con,
@@ -547,6 +550,7 @@ match_simple_do_callback(
 		mat_sim_nfo->cwtool_track,
 		mat_sim_nfo->format_track,
 		mat_sim_nfo->format_side);
+	stats_end(DECODE);
 	}
 
 
@@ -682,6 +686,7 @@ match_simple(
 
 	/* store raw data for later usage */
 
+	stats_begin(MATCH);
 	i = match_simple_store(mat_sim_nfo);
 
 	/* give unprocessed data to callback */
@@ -735,5 +740,6 @@ match_simple(
 		match_simple_do_callback(mat_sim_nfo, NULL);
 		break;
 		}
+	stats_end(MATCH);
 	}
 /******************************************************** Karsten Scheibler */
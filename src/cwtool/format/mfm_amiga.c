@@ -49,6 +49,7 @@
 #define FLAG_MATCH_SIMPLE		(1 << 3)
 #define FLAG_MATCH_SIMPLE_FIXUP		(1 << 4)
 #define FLAG_POSTCOMP_SIMPLE		(1 << 5)
+#define FLAG_PLL			(1 << 6)
 
 
 
@@ -146,19 +147,34 @@ static int
 mfm_amiga_read_sector2(
 	struct fifo			*ffo_l1,
 	struct mfm_amiga		*mfm_amg,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*data)
 
 	{
-	int				bitofs;
+	int				bitofs, sector;
 
 	*dsk_err = (struct disk_error) { };
 	if (mfm_read_sync(ffo_l1, range_sector_data(rng_sec), mfm_amg->rw.sync_value, mfm_amg->rw.sync_length) == -1) return (-1);
 	bitofs = fifo_get_rd_bitofs(ffo_l1);
-	if (mfm_read_bytes(ffo_l1, dsk_err, data, DATA_SIZE) == -1) return (-1);
-	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
+	if (mfm_read_bytes(ffo_l1, dsk_err, data, 4) == -1) return (-1);
 	mfm_amiga_unshuffle(data, 4);
+
+	/*
+	 * do not decode sectors again, which were already read without
+	 * errors on a previous try
+	 */
+
+	sector = data[2];
+	if ((sector < mfm_amg->rw.sectors) && (! disk_sector_needed(&dsk_sct[sector])))
+		{
+		verbose_message(GENERIC, 1, "skipping sector %d, already read", sector);
+		fifo_set_rd_bitofs(ffo_l1, bitofs);
+		return (0);
+		}
+	if (mfm_read_bytes(ffo_l1, dsk_err, &data[4], DATA_SIZE - 4) == -1) return (-1);
+	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
 	mfm_amiga_unshuffle(&data[4], 16);
 	mfm_amiga_unshuffle(&data[20], 4);
 	mfm_amiga_unshuffle(&data[24], 4);
@@ -212,7 +228,8 @@ mfm_amiga_read_sector(
 	unsigned char			data[DATA_SIZE];
 	int				result, track, sector;
 
-	if (mfm_amiga_read_sector2(ffo_l1, mfm_amg, &dsk_err, &rng_sec, data) == -1) return (-1);
+	result = mfm_amiga_read_sector2(ffo_l1, mfm_amg, dsk_sct, &dsk_err, &rng_sec, data);
+	if (result != 1) return (result);
 
 	/* accept only valid sector numbers */
 
@@ -333,10 +350,12 @@ mfm_amiga_read_track2(
 	{
 	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
 	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	struct bitstream_stream		bst_str;
 
 	if (fmt->mfm_amg.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->mfm_amg.rw.bnd, 3);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_amg.rw.bnd, 3);
-	while (mfm_amiga_read_sector(&ffo_l1, &fmt->mfm_amg, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	bitstream_read_stream(ffo_l0, &ffo_l1, &bst_str, fmt->mfm_amg.rw.bnd, 3, (fmt->mfm_amg.rd.flags & FLAG_PLL) ? BITSTREAM_FLAG_PLL : 0);
+	while ((disk_sectors_needed(dsk_sct, fmt->mfm_amg.rw.sectors) > 0) &&
+		(mfm_amiga_read_sector(&ffo_l1, &fmt->mfm_amg, con, dsk_sct, cwtool_track, format_track, format_side) != -1)) ;
 	}
 
 
@@ -368,6 +387,7 @@ mfm_amiga_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->mfm_amg.rw.bnd,
 		.bnd_size     = 3,
+		.bst_flags    = (fmt->mfm_amg.rd.flags & FLAG_PLL) ? BITSTREAM_FLAG_PLL : 0,
 		.callback     = mfm_amiga_read_track2,
 		.merge_two    = fmt->mfm_amg.rd.flags & FLAG_MATCH_SIMPLE,
 		.merge_all    = fmt->mfm_amg.rd.flags & FLAG_MATCH_SIMPLE,
@@ -440,6 +460,7 @@ mfm_amiga_write_track(
 #define MAGIC_FORMAT_BYTE		17
 #define MAGIC_BOUNDS_OLD		18
 #define MAGIC_BOUNDS_NEW		19
+#define MAGIC_PLL			20
 
 
 
@@ -505,6 +526,8 @@ mfm_amiga_set_read_option(
 	if (magic == MAGIC_IGNORE_FORMAT_BYTE)    return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_IGNORE_FORMAT_BYTE));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_MATCH_SIMPLE_FIXUP));
+	if ((magic == MAGIC_PLL) && (val) && (! bitstream_pll_check(fmt->mfm_amg.rw.bnd, 3))) error_message("bounds do not give a valid bit cell period for pll");
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_PLL));
 	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE);
 	return (setvalue_uchar_bit(&fmt->mfm_amg.rd.flags, val, FLAG_POSTCOMP_SIMPLE));
 	}
@@ -596,6 +619,7 @@ mfm_amiga_get_flags(
 
 	{
 	if (options_get_output()) return (FORMAT_FLAG_OUTPUT);
+	if (fmt->mfm_amg.rd.flags & FLAG_MATCH_SIMPLE) return (FORMAT_FLAG_CONTAINER);
 	return (FORMAT_FLAG_NONE);
 	}
 
@@ -639,6 +663,7 @@ static struct format_option		mfm_amiga_read_options[] =
 	FORMAT_OPTION_BOOLEAN("match_simple_fixup",    MAGIC_MATCH_SIMPLE_FIXUP,    1),
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",       MAGIC_POSTCOMP_SIMPLE,       1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",       MAGIC_POSTCOMP_SIMPLE,       1),
+	FORMAT_OPTION_BOOLEAN("pll",                   MAGIC_PLL,                   1),
 	FORMAT_OPTION_END
 	};
 
@@ -51,6 +51,7 @@
 #define FLAG_RD_MATCH_SIMPLE		(1 << 4)
 #define FLAG_RD_MATCH_SIMPLE_FIXUP	(1 << 5)
 #define FLAG_RD_POSTCOMP_SIMPLE		(1 << 6)
+#define FLAG_RD_PLL			(1 << 7)
 #define FLAG_RW_CRC16_INIT_VALUE_SET	(1 << 0)
 
 
@@ -127,13 +128,14 @@ static int
 mfm_nec765_read_sector2(
 	struct fifo			*ffo_l1,
 	struct mfm_nec765		*mfm_nec,
+	struct disk_sector		*dsk_sct,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
 	unsigned char			*header,
 	unsigned char			*data)
 
 	{
-	int				bitofs, data_size;
+	int				bitofs, sector, data_size;
 
 	while (1)
 		{
@@ -145,7 +147,19 @@ mfm_nec765_read_sector2(
 		fifo_set_rd_bitofs(ffo_l1, bitofs);
 		if (format_compare2("id_address_mark: got 0x%02x, expected 0x%02x", header[0], mfm_nec->rw.id_address_mark) == 0) break;
 		}
-	data_size = mfm_nec765_sector_size(mfm_nec, header[3] - 1);
+
+	/*
+	 * do not decode sectors again, which were already read without
+	 * errors on a previous try
+	 */
+
+	sector = header[3] - 1;
+	if ((sector >= 0) && (sector < mfm_nec->rw.sectors) && (! disk_sector_needed(&dsk_sct[sector])))
+		{
+		verbose_message(GENERIC, 1, "skipping sector %d, already read", sector);
+		return (0);
+		}
+	data_size = mfm_nec765_sector_size(mfm_nec, sector);
 	if (mfm_read_sync(ffo_l1, range_sector_data(rng_sec), mfm_nec->rw.sync_value, mfm_nec->rw.sync_length) == -1) return (-1);
 	if (mfm_read_bytes(ffo_l1, dsk_err, data, data_size + 3) == -1) return (-1);
 	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
@@ -201,7 +215,8 @@ mfm_nec765_read_sector(
 	unsigned char			data[DATA_SIZE];
 	int				result, track, side, sector, data_size;
 
-	if (mfm_nec765_read_sector2(ffo_l1, mfm_nec, &dsk_err, &rng_sec, header, data) == -1) return (-1);
+	result = mfm_nec765_read_sector2(ffo_l1, mfm_nec, dsk_sct, &dsk_err, &rng_sec, header, data);
+	if (result != 1) return (result);
 
 	/* accept only valid sector numbers */
 
@@ -334,10 +349,12 @@ mfm_nec765_read_track2(
 	{
 	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
 	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	struct bitstream_stream		bst_str;
 
 	if (fmt->mfm_nec.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->mfm_nec.rw.bnd, 3);
-	bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_nec.rw.bnd, 3);
-	while (mfm_nec765_read_sector(&ffo_l1, &fmt->mfm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	bitstream_read_stream(ffo_l0, &ffo_l1, &bst_str, fmt->mfm_nec.rw.bnd, 3, (fmt->mfm_nec.rd.flags & FLAG_RD_PLL) ? BITSTREAM_FLAG_PLL : 0);
+	while ((disk_sectors_needed(dsk_sct, fmt->mfm_nec.rw.sectors) > 0) &&
+		(mfm_nec765_read_sector(&ffo_l1, &fmt->mfm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1)) ;
 	}
 
 
@@ -369,6 +386,7 @@ mfm_nec765_read_track(
 		.format_side  = format_side,
 		.bnd          = fmt->mfm_nec.rw.bnd,
 		.bnd_size     = 3,
+		.bst_flags    = (fmt->mfm_nec.rd.flags & FLAG_RD_PLL) ? BITSTREAM_FLAG_PLL : 0,
 		.callback     = mfm_nec765_read_track2,
 		.merge_two    = fmt->mfm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE,
 		.merge_all    = fmt->mfm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE,
@@ -465,6 +483,7 @@ mfm_nec765_write_track(
 #define MAGIC_SECTOR_SIZES		35
 #define MAGIC_BOUNDS_OLD		36
 #define MAGIC_BOUNDS_NEW		37
+#define MAGIC_PLL			38
 
 
 
@@ -571,6 +590,8 @@ mfm_nec765_set_read_option(
 	if (magic == MAGIC_IGNORE_FORMAT_BYTE)    return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_IGNORE_FORMAT_BYTE));
 	if (magic == MAGIC_MATCH_SIMPLE)          return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_MATCH_SIMPLE));
 	if (magic == MAGIC_MATCH_SIMPLE_FIXUP)    return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_MATCH_SIMPLE_FIXUP));
+	if ((magic == MAGIC_PLL) && (val) && (! bitstream_pll_check(fmt->mfm_nec.rw.bnd, 3))) error_message("bounds do not give a valid bit cell period for pll");
+	if (magic == MAGIC_PLL)                   return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_PLL));
 	debug_error_condition(magic != MAGIC_POSTCOMP_SIMPLE);
 	return (setvalue_uchar_bit(&fmt->mfm_nec.rd.flags, val, FLAG_RD_POSTCOMP_SIMPLE));
 	}
@@ -699,6 +720,7 @@ mfm_nec765_get_flags(
 
 	{
 	if (options_get_output()) return (FORMAT_FLAG_OUTPUT);
+	if (fmt->mfm_nec.rd.flags & FLAG_RD_MATCH_SIMPLE) return (FORMAT_FLAG_CONTAINER);
 	return (FORMAT_FLAG_NONE);
 	}
 
@@ -743,6 +765,7 @@ static struct format_option		mfm_nec765_read_options[] =
 	FORMAT_OPTION_BOOLEAN("match_simple_fixup",    MAGIC_MATCH_SIMPLE_FIXUP,    1),
 	FORMAT_OPTION_BOOLEAN_COMPAT("postcomp",       MAGIC_POSTCOMP_SIMPLE,       1),
 	FORMAT_OPTION_BOOLEAN("postcomp_simple",       MAGIC_POSTCOMP_SIMPLE,       1),
+	FORMAT_OPTION_BOOLEAN("pll",                   MAGIC_PLL,                   1),
 	FORMAT_OPTION_END
 	};
 
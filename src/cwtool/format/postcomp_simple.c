@@ -19,6 +19,7 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../stats.h"
 #include "bounds.h"
 
 
@@ -233,7 +234,7 @@ postcomp_simple_adjust(
 	int				len   = fifo_get_wr_ofs(ffo);
 	char				error[GLOBAL_MAX_TRACK_SIZE] = { };
 	char				done[GLOBAL_MAX_TRACK_SIZE] = { };
-	int				stage, area;
+	int				stage, area, result;
 
 	/*
 	 * increasing number of stages produces sometimes very nice
@@ -246,10 +247,13 @@ postcomp_simple_adjust(
 		postcomp_simple_value(adjust0),
 		postcomp_simple_sign(adjust1),
 		postcomp_simple_value(adjust1));
+	stats_begin(POSTCOMP);
 	for (stage = 1; stage < 2; stage++) for (area = 2; area < 16; area++)
 		{
 		postcomp_simple_calculate(bnd, bnd_size, data, error, done, len, stage, area, adjust0, adjust1);
 		}
-	return (postcomp_simple_apply(data, error, len));
+	result = postcomp_simple_apply(data, error, len);
+	stats_end(POSTCOMP);
+	return (result);
 	}
 /******************************************************** Karsten Scheibler */
@@ -15,6 +15,20 @@
 
 
 
+/****************************************************************************
+ *
+ * local data structures, variables and defines
+ *
+ ****************************************************************************/
+
+
+
+
+static const cw_char_t			*global_prefix_string = "";
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -47,4 +61,30 @@ global_version_string(
 	{
 	return (GLOBAL_VERSION_STRING);
 	}
+
+
+
+/****************************************************************************
+ * global_set_prefix
+ ****************************************************************************/
+cw_void_t
+global_set_prefix(
+	const cw_char_t			*prefix)
+
+	{
+	global_prefix_string = prefix;
+	}
+
+
+
+/****************************************************************************
+ * global_prefix
+ ****************************************************************************/
+const cw_char_t *
+global_prefix(
+	cw_void_t)
+
+	{
+	return (global_prefix_string);
+	}
 /******************************************************** Karsten Scheibler */
@@ -78,6 +78,14 @@ extern const cw_char_t *
 global_version_string(
 	cw_void_t);
 
+extern cw_void_t
+global_set_prefix(
+	const cw_char_t			*prefix);
+
+extern const cw_char_t *
+global_prefix(
+	cw_void_t);
+
 
 
 #endif /* !CWTOOL_GLOBAL_H */
@@ -26,6 +26,7 @@
 static struct image_desc		*img_dsc[] =
 	{
 	&image_raw_desc,
+	&image_rawpack_desc,
 	&image_g64_desc,
 	&image_d64_desc,
 	&image_d64_noerror_desc,
@@ -51,6 +52,32 @@ image_search_desc(
 
 
 
+/****************************************************************************
+ * image_search_desc_l0
+ ****************************************************************************/
+struct image_desc *
+image_search_desc_l0(
+	struct image_desc		*img_dsc,
+	char				**path,
+	int				path_count)
+
+	{
+	int				i, packed;
+
+	/*
+	 * packed raw images are recognized by their magic, so they may be
+	 * given wherever a raw image or a device is expected as source
+	 */
+
+	for (i = packed = 0; i < path_count; i++) packed += image_rawpack_probe(path[i]);
+	if (packed == 0) return (img_dsc);
+	if (packed < path_count) error_message("packed and unpacked raw images can not be mixed");
+	verbose_message(GENERIC, 2, "using image '%s' for raw data", image_rawpack_desc.name);
+	return (&image_rawpack_desc);
+	}
+
+
+
 /****************************************************************************
  * image_open
  ****************************************************************************/
@@ -62,8 +89,11 @@ image_open(
 	int				mode)
 
 	{
+	cw_flag_t			flags = FILE_FLAG_NONE;
+
 	debug_error_condition((mode != IMAGE_MODE_READ) && (mode != IMAGE_MODE_WRITE));
 	mode = (mode == IMAGE_MODE_READ) ? FILE_MODE_READ : FILE_MODE_CREATE;
+	if ((mode == FILE_MODE_CREATE) && (options_get_async_write() >= 0)) flags = FILE_FLAG_ASYNC;
 
 	/*
 	 * clearing img also means clearing fil, because fil is part of img
@@ -72,7 +102,7 @@ image_open(
 	 */
 
 	*img = (union image) { };
-	file_open(fil, path, mode, FILE_FLAG_NONE);
+	file_open(fil, path, mode, flags);
 	return (1);
 	}
 
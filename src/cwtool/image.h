@@ -16,6 +16,7 @@
 #include "types.h"
 #include "global.h"
 #include "image/raw.h"
+#include "image/rawpack.h"
 #include "image/g64.h"
 #include "image/d64.h"
 #include "image/plain.h"
@@ -24,6 +25,7 @@
 union image
 	{
 	struct image_raw		raw;
+	struct image_rawpack		rpk;
 	struct image_g64		g64;
 	struct image_d64		d64;
 	struct image_plain		pln;
@@ -65,6 +67,7 @@ struct image_track
 struct file;
 
 extern struct image_desc		*image_search_desc(const char *);
+extern struct image_desc		*image_search_desc_l0(struct image_desc *, char **, int);
 extern int				image_open(union image *, struct file *, char *, int);
 extern int				image_close(union image *, struct file *);
 
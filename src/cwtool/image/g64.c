@@ -43,6 +43,26 @@ struct g64_header
 
 
 
+/*
+ * in write mode the whole image is built in one buffer. every track gets
+ * a slot of TRACK_SIZE + 2 bytes at a fixed position, unused slots are
+ * squeezed out in image_g64_write_data()
+ */
+
+#define HEADER_SIZE			(MAGIC_SIZE + sizeof (struct g64_header))
+#define SLOT_SIZE			(TRACK_SIZE + 2)
+#define BUFFER_SIZE			(HEADER_SIZE + 8 * IMAGE_G64_MAX_TRACK + SLOT_SIZE * IMAGE_G64_MAX_TRACK)
+#define READ_SIZE			0x100000
+
+struct g64_offset
+	{
+	unsigned int			offset;
+	int				track;
+	};
+
+
+
+
 /****************************************************************************
  *
  * low level functions
@@ -53,78 +73,73 @@ struct g64_header
 
 
 /****************************************************************************
- * image_g64_allocate_track
+ * image_g64_slot
  ****************************************************************************/
-static struct image_g64_track
-image_g64_allocate_track(
-	int				size,
-	int				speed,
-	int				used)
+static unsigned char *
+image_g64_slot(
+	struct image_g64		*img_g64,
+	int				track)
 
 	{
-	struct image_g64_track		img_g64_trk;
-
-	img_g64_trk = (struct image_g64_track)
-		{
-		.data  = (unsigned char *) malloc(size),
-		.size  = size,
-		.speed = speed,
-		.used  = used
-		};
-	if (img_g64_trk.data == NULL) error_oom();
-	return (img_g64_trk);
+	return (&img_g64->data[HEADER_SIZE + 8 * IMAGE_G64_MAX_TRACK + SLOT_SIZE * track]);
 	}
 
 
 
 /****************************************************************************
- * image_g64_read_fill
+ * image_g64_compare
  ****************************************************************************/
 static int
-image_g64_read_fill(
-	struct image_g64		*img_g64,
-	int				size)
+image_g64_compare(
+	const void			*a,
+	const void			*b)
 
 	{
-	unsigned char			buffer[0x10000];
-	int				l, s = size;
+	const struct g64_offset		*g64_ofs1 = a, *g64_ofs2 = b;
 
-	debug_error_condition(size < 0);
-	while (s > 0)
-		{
-		l = size;
-		if (l > sizeof (buffer)) l = sizeof (buffer);
-		verbose_message(GENERIC, 2, "reading %d fill bytes", l);
-		s -= file_read_strict(&img_g64->fil, buffer, l);
-		}
-	return (size);
+	if (g64_ofs1->offset < g64_ofs2->offset) return (-1);
+	if (g64_ofs1->offset > g64_ofs2->offset) return (1);
+	return (0);
 	}
 
 
 
 /****************************************************************************
- * image_g64_write_fill
+ * image_g64_load
  ****************************************************************************/
-static int
-image_g64_write_fill(
-	struct image_g64		*img_g64,
-	int				value,
-	int				size)
+static void
+image_g64_load(
+	struct image_g64		*img_g64)
 
 	{
-	unsigned char			buffer[0x10000];
-	int				l, s = size;
+	int				size, l;
 
-	debug_error_condition(size < 0);
-	memset(buffer, value, (size > sizeof (buffer)) ? sizeof (buffer) : size);
-	while (s > 0)
+	/* regular files are mapped, so no track data is copied */
+
+	size = file_get_size(&img_g64->fil);
+	if (size >= 0) img_g64->data = (unsigned char *) file_map(&img_g64->fil, size);
+	if (img_g64->data != NULL)
 		{
-		l = size;
-		if (l > sizeof (buffer)) l = sizeof (buffer);
-		verbose_message(GENERIC, 2, "writing %d fill bytes", l);
-		s -= file_write(&img_g64->fil, buffer, l);
+		img_g64->size   = size;
+		img_g64->mapped = 1;
+		return;
 		}
-	return (size);
+
+	/* pipes and the like are read completely into memory */
+
+	for (size = 0; ; img_g64->size += l)
+		{
+		if (img_g64->size == size)
+			{
+			size += READ_SIZE;
+			img_g64->data = (unsigned char *) realloc(img_g64->data, size);
+			if (img_g64->data == NULL) error_oom();
+			}
+		verbose_message(GENERIC, 2, "reading G64 data from '%s'", file_get_path(&img_g64->fil));
+		l = file_read(&img_g64->fil, &img_g64->data[img_g64->size], size - img_g64->size);
+		if (l == 0) break;
+		}
+	verbose_message(GENERIC, 2, "got %d bytes", img_g64->size);
 	}
 
 
@@ -136,74 +151,52 @@ static void
 image_g64_read_data(
 	struct image_g64		*img_g64,
 	int				tracks,
-	int				max_track_size,
-	int				offset)
+	int				max_track_size)
 
 	{
-	unsigned char			buffer[4];
-	unsigned int			track_offsets[IMAGE_G64_MAX_TRACK];
-	unsigned int			speed_offsets[IMAGE_G64_MAX_TRACK];
-	int				i, s, t;
+	struct g64_offset		g64_ofs[IMAGE_G64_MAX_TRACK];
+	unsigned char			*data = img_g64->data;
+	unsigned int			o;
+	int				ofs = HEADER_SIZE + 8 * tracks;
+	int				i, s, t, u;
 
-	/* read track offsets */
+	if (ofs > img_g64->size) error_message("file '%s' truncated", file_get_path(&img_g64->fil));
 
-	for (t = 0; t < tracks; t++, offset += 4)
-		{
-		verbose_message(GENERIC, 2, "reading G64 track offset for track %d from '%s'", t, file_get_path(&img_g64->fil));
-		file_read_strict(&img_g64->fil, buffer, 4);
-		track_offsets[t] = import_u32_le(buffer);
-		verbose_message(GENERIC, 2, "got track offset %d", track_offsets[t]);
-		}
-
-	/* read speed offsets */
+	/* read track and speed offsets */
 
-	for (t = 0; t < tracks; t++, offset += 4)
+	for (i = t = 0; t < tracks; t++)
 		{
-		verbose_message(GENERIC, 2, "reading G64 speed offset for track %d from '%s'", t, file_get_path(&img_g64->fil));
-		file_read_strict(&img_g64->fil, buffer, 4);
-		speed_offsets[t] = import_u32_le(buffer);
-		verbose_message(GENERIC, 2, "got speed offset %d", speed_offsets[t]);
-		if (speed_offsets[t] > 3)  error_message("file '%s' uses unsupported speed zone map", file_get_path(&img_g64->fil));
+		o = import_u32_le(&data[HEADER_SIZE + 4 * t]);
+		s = import_u32_le(&data[HEADER_SIZE + 4 * (tracks + t)]);
+		verbose_message(GENERIC, 2, "got G64 track offset %d and speed offset %d for track %d from '%s'", o, s, t, file_get_path(&img_g64->fil));
+		if ((unsigned int) s > 3)  error_message("file '%s' uses unsupported speed zone map", file_get_path(&img_g64->fil));
+		img_g64->trk[t].speed = s;
+		if (o != 0) g64_ofs[i++] = (struct g64_offset) { .offset = o, .track = t };
 		}
 
-	/* read track data */
+	/* check track data in file order */
 
-	while (1)
+	qsort(g64_ofs, i, sizeof (struct g64_offset), image_g64_compare);
+	for (u = 0; u < i; u++)
 		{
-
-		/* find smallest track offset */
-
-		for (i = s = 0, t = -1; i < tracks; i++)
-			{
-			if (track_offsets[i] == 0) continue;
-			if ((t != -1) && (s < track_offsets[i])) continue;
-			s = track_offsets[i];
-			t = i;
-			}
-		if (t == -1) break;
+		o = g64_ofs[u].offset;
+		t = g64_ofs[u].track;
 		verbose_message(GENERIC, 2, "reading G64 data for track %d from '%s'", t, file_get_path(&img_g64->fil));
-
-		/* skip fill bytes in between tracks (if any) */
-
-		offset += image_g64_read_fill(img_g64, track_offsets[t] - offset);
-
-		/* read in data */
-
-		file_read_strict(&img_g64->fil, buffer, 2);
-		s = import_u16_le(buffer);
+		if (o < ofs) error_message("track %d in file '%s' overlaps other data", t, file_get_path(&img_g64->fil));
+		if (o > img_g64->size - 2) error_message("file '%s' truncated", file_get_path(&img_g64->fil));
+		s = import_u16_le(&data[o]);
 		if (s > max_track_size) error_message("track %d in file '%s' too large", t, file_get_path(&img_g64->fil));
-		img_g64->trk[t] = image_g64_allocate_track(s, speed_offsets[t], 0);
-		file_read_strict(&img_g64->fil, img_g64->trk[t].data, s);
-		offset += s + 2;
-		track_offsets[t] = 0;
-		verbose_message(GENERIC, 2, "got %d bytes", s);
 
-		/* skip fill bytes */
+		/* fill bytes up to max_track_size have to be present */
 
-		offset += image_g64_read_fill(img_g64, max_track_size - s);
+		ofs = o + max_track_size + 2;
+		if (ofs > img_g64->size) error_message("file '%s' truncated", file_get_path(&img_g64->fil));
+		img_g64->trk[t].data = &data[o + 2];
+		img_g64->trk[t].size = s;
+		verbose_message(GENERIC, 2, "got %d bytes", s);
 		}
 	if (img_g64->flags & FLAG_IGNORE_SIZE) return;
-	if (file_read(&img_g64->fil, buffer, 1) == 0) return;
+	if (ofs == img_g64->size) return;
 	error_warning("file '%s' has trailing junk", file_get_path(&img_g64->fil));
 	}
 
@@ -215,52 +208,41 @@ image_g64_read_data(
 static void
 image_g64_write_data(
 	struct image_g64		*img_g64,
-	int				max_track_size,
-	int				offset)
+	int				max_track_size)
 
 	{
-	unsigned char			buffer[4];
+	unsigned char			*data = img_g64->data, *slot;
+	int				ofs = HEADER_SIZE + 8 * IMAGE_G64_MAX_TRACK;
 	int				s, t;
 
-	/* write track offsets */
-
-	offset += 8 * IMAGE_G64_MAX_TRACK;
+	debug_error_condition(max_track_size != TRACK_SIZE);
 	for (t = 0; t < IMAGE_G64_MAX_TRACK; t++)
 		{
-		if (img_g64->trk[t].data == NULL) s = 0;
-		else s = offset, offset += max_track_size + 2;
-		export_u32_le(buffer, s);
-		verbose_message(GENERIC, 2, "writing G64 track offset %d for track %d to '%s'", s, t, file_get_path(&img_g64->fil));
-		file_write(&img_g64->fil, buffer, 4);
-		}
-
-	/* write speed offsets */
 
-	for (t = 0; t < IMAGE_G64_MAX_TRACK; t++)
-		{
-		export_u32_le(buffer, img_g64->trk[t].speed);
-		verbose_message(GENERIC, 2, "writing G64 speed offset %d for track %d to '%s'", img_g64->trk[t].speed, t, file_get_path(&img_g64->fil));
-		file_write(&img_g64->fil, buffer, 4);
-		}
+		/* track and speed offsets */
 
-	/* write track data */
-
-	for (t = 0; t < IMAGE_G64_MAX_TRACK; t++)
-		{
-		if (img_g64->trk[t].data == NULL) continue;
-		s = img_g64->trk[t].size;
-		export_u16_le(buffer, s);
-		verbose_message(GENERIC, 2, "writing G64 data for track %d with %d bytes to '%s'", t, s, file_get_path(&img_g64->fil));
-		file_write(&img_g64->fil, buffer, 2);
-		file_write(&img_g64->fil, img_g64->trk[t].data, s);
+		s = (img_g64->trk[t].data == NULL) ? 0 : ofs;
+		verbose_message(GENERIC, 2, "writing G64 track offset %d and speed offset %d for track %d to '%s'", s, img_g64->trk[t].speed, t, file_get_path(&img_g64->fil));
+		export_u32_le(&data[HEADER_SIZE + 4 * t], s);
+		export_u32_le(&data[HEADER_SIZE + 4 * (IMAGE_G64_MAX_TRACK + t)], img_g64->trk[t].speed);
+		if (s == 0) continue;
 
 		/*
-		 * write fill bytes (if needed). use 0xaa as fill value in
-		 * case the last two bits were already zero
+		 * track data, slots only move towards the start of the
+		 * buffer. use 0xaa as fill value in case the last two bits
+		 * were already zero
 		 */
 
-		image_g64_write_fill(img_g64, 0xaa, max_track_size - s);
+		s = img_g64->trk[t].size;
+		slot = image_g64_slot(img_g64, t);
+		verbose_message(GENERIC, 2, "writing G64 data for track %d with %d bytes to '%s'", t, s, file_get_path(&img_g64->fil));
+		export_u16_le(slot, s);
+		memset(&slot[s + 2], 0xaa, max_track_size - s);
+		if (slot != &data[ofs]) memmove(&data[ofs], slot, max_track_size + 2);
+		ofs += max_track_size + 2;
 		}
+	verbose_message(GENERIC, 2, "writing %d bytes to '%s'", ofs, file_get_path(&img_g64->fil));
+	file_write(&img_g64->fil, data, ofs);
 	}
 
 
@@ -288,23 +270,26 @@ image_g64_open(
 	{
 	struct g64_header		g64_hdr;
 	static const char		magic[MAGIC_SIZE] = { 'G', 'C', 'R', '-', '1', '5', '4', '1' };
-	char				buffer[MAGIC_SIZE];
 
 	image_open(img, &img->g64.fil, path, mode);
 	if (flags & IMAGE_FLAG_IGNORE_SIZE) img->g64.flags = FLAG_IGNORE_SIZE;
 	if (file_is_readable(&img->g64.fil))
 		{
-		int			track_size, i;
-
-		file_read_strict(&img->g64.fil, buffer, sizeof (buffer));
-		file_read_strict(&img->g64.fil, &g64_hdr, sizeof (g64_hdr));
-		for (i = 0; i < sizeof (magic); i++) if (magic[i] != buffer[i]) error_message("file '%s' has wrong magic", file_get_path(&img->g64.fil));
+		image_g64_load(&img->g64);
+		if (img->g64.size < HEADER_SIZE) error_message("file '%s' truncated", file_get_path(&img->g64.fil));
+		if (memcmp(img->g64.data, magic, sizeof (magic)) != 0) error_message("file '%s' has wrong magic", file_get_path(&img->g64.fil));
+		memcpy(&g64_hdr, &img->g64.data[MAGIC_SIZE], sizeof (g64_hdr));
 		if (g64_hdr.version != 0) error_message("file '%s' has wrong version", file_get_path(&img->g64.fil));
 		if (g64_hdr.tracks > IMAGE_G64_MAX_TRACK) error_message("file '%s' has too many tracks", file_get_path(&img->g64.fil));
-		track_size = import_u16_le(g64_hdr.track_size);
-		image_g64_read_data(&img->g64, g64_hdr.tracks, track_size, sizeof (magic) + sizeof (g64_hdr));
+		image_g64_read_data(&img->g64, g64_hdr.tracks, import_u16_le(g64_hdr.track_size));
+		}
+	else
+		{
+		img->g64.data = (unsigned char *) malloc(BUFFER_SIZE);
+		if (img->g64.data == NULL) error_oom();
+		img->g64.size = BUFFER_SIZE;
+		memcpy(img->g64.data, magic, sizeof (magic));
 		}
-	else file_write(&img->g64.fil, magic, sizeof (magic));
 	return (1);
 	}
 
@@ -334,8 +319,8 @@ image_g64_close(
 		if (s != TRACK_SIZE) error_warning("file '%s' contains large tracks, file may be unusable with other software", file_get_path(&img->g64.fil));
 		g64_hdr = (struct g64_header) { .tracks = IMAGE_G64_MAX_TRACK };
 		export_u16_le(g64_hdr.track_size, s);
-		file_write(&img->g64.fil, &g64_hdr, sizeof (g64_hdr));
-		image_g64_write_data(&img->g64, s, MAGIC_SIZE + sizeof (g64_hdr));
+		memcpy(&img->g64.data[MAGIC_SIZE], &g64_hdr, sizeof (g64_hdr));
+		image_g64_write_data(&img->g64, s);
 		}
 	else
 		{
@@ -345,7 +330,8 @@ image_g64_close(
 			error_warning("track %d from file '%s' was not used", t, file_get_path(&img->g64.fil));
 			}
 		}
-	for (t = 0; t < IMAGE_G64_MAX_TRACK; t++) if (img->g64.trk[t].data != NULL) free(img->g64.trk[t].data);
+	if (img->g64.mapped) file_unmap(&img->g64.fil, img->g64.data, img->g64.size);
+	else free(img->g64.data);
 	return (image_close(img, &img->g64.fil));
 	}
 
@@ -421,7 +407,8 @@ image_g64_write(
 
 	/*
 	 * changing this limit to a larger value than TRACK_SIZE may cause
-	 * image_g64_close() to print out warnings
+	 * image_g64_close() to print out warnings and needs larger slots
+	 * in the image buffer
 	 */
 
 	if (size > TRACK_SIZE)
@@ -431,7 +418,13 @@ image_g64_write(
 		}
 	debug_error_condition(img->g64.trk[track].data != NULL);
 	verbose_message(GENERIC, 1, "writing G64 track %d with %d bytes to memory", track, size);
-	img->g64.trk[track] = image_g64_allocate_track(size, fifo_get_speed(ffo), 1);
+	img->g64.trk[track] = (struct image_g64_track)
+		{
+		.data  = &image_g64_slot(&img->g64, track)[2],
+		.size  = size,
+		.speed = fifo_get_speed(ffo),
+		.used  = 1
+		};
 	fifo_read_block(ffo, img->g64.trk[track].data, size);
 	return (1);
 	}
@@ -31,6 +31,9 @@ struct image_g64
 	{
 	struct file			fil;
 	struct image_g64_track		trk[IMAGE_G64_MAX_TRACK];
+	unsigned char			*data;
+	int				size;
+	int				mapped;
 	int				flags;
 	};
 
@@ -27,6 +27,8 @@
 #include "../export.h"
 #include "../parse.h"
 #include "../string.h"
+#include "../stats.h"
+#include "../output.h"
 #ifdef CW_CATWEASEL_OSX
 #include "../osx/cwmac.h"
 #endif /* CW_CATWEASEL_OSX */
@@ -44,6 +46,7 @@
 #define SUBTYPE_NONE			0
 #define SUBTYPE_DATA			1
 #define SUBTYPE_TEXT			2
+#define SUBTYPE_OUTPUT			3
 
 #define FLAG_SEARCH_HINTS		(1 << 0)
 
@@ -56,6 +59,12 @@
 #define HEADER_FLAG_INDEX_ALIGNED	(1 << 2)
 #define HEADER_FLAG_NO_CORRECTION	(1 << 3)
 
+/*
+ * the kernels below work on blocks of IMAGE_RAW_KERNEL_BLOCK_SIZE bytes
+ * (see raw.h), the remaining bytes are done one by one with the same
+ * expression. cwbench -k compares them with plain per byte loops
+ */
+
 struct track_header
 	{
 	unsigned char			magic;
@@ -78,10 +87,10 @@ struct track_header
 
 
 /****************************************************************************
- * image_raw_track_translate
+ * image_raw_track_translate2
  ****************************************************************************/
 static int
-image_raw_track_translate(
+image_raw_track_translate2(
 	struct image_track		*img_trk,
 	int				track)
 
@@ -99,6 +108,22 @@ image_raw_track_translate(
 		}
 	if (img_trk->flags & IMAGE_TRACK_FLAG_FLIP_SIDE) xlated_track ^= 1;
 	debug_error_condition((xlated_track < 0) || (xlated_track >= GLOBAL_NR_TRACKS));
+	return (xlated_track);
+	}
+
+
+
+/****************************************************************************
+ * image_raw_track_translate
+ ****************************************************************************/
+int
+image_raw_track_translate(
+	struct image_track		*img_trk,
+	int				track)
+
+	{
+	int				xlated_track = image_raw_track_translate2(img_trk, track);
+
 	if (track != xlated_track) verbose_message(GENERIC, 1, "translating track from %d to %d", track, xlated_track);
 	return (xlated_track);
 	}
@@ -121,7 +146,7 @@ image_raw_ioctl(
 
 	{
 	struct cw_trackinfo		tri = CW_TRACKINFO_INIT;
-	int				result = -1;
+	int				result = -1, t;
 
 	tri.clock   = img_trk->clock;
 	tri.timeout = timeout;
@@ -159,16 +184,36 @@ image_raw_ioctl(
 	/* for now do no special handling for a "preposition track" */
 
 	tri.track_seek = tri.track;
+
+	/*
+	 * if we know which track is read next, let the driver step there
+	 * while we are decoding this one. only whole tracks matter here,
+	 * the side is selected anyway on the next access
+	 */
+
+	if ((cmd == CW_IOC_READ) && (img_raw->track_next >= 0))
+		{
+		t = img_raw->track_next / 2;
+		if (img_raw->fli.flags & CW_FLOPPYINFO_FLAG_DOUBLE_STEP) t = ((t & 1) == 0) ? t / 2 : -1;
+		if ((t >= 0) && (t < img_raw->fli.nr_tracks))
+			{
+			tri.flags      |= CW_TRACKINFO_FLAG_SEEK_AHEAD;
+			tri.track_next = t;
+			debug_message(GENERIC, 2, "seek ahead to hardware track %d", t);
+			}
+		}
 	verbose_message(GENERIC, 1, "accessing hardware track %d side %d with timeout %d ms on '%s'", tri.track, tri.side, tri.timeout, file_get_path(&img_raw->fil[0]));
 	if (tri.clock >= img_raw->fli.nr_clocks) error_message("error while accessing track %d, clock is not supported by device '%s'", track, file_get_path(&img_raw->fil[0]));
 	if (tri.track >= img_raw->fli.nr_tracks) error_message("error while accessing track %d, track is not supported by device '%s'", track, file_get_path(&img_raw->fil[0]));
 	if (tri.side  >= img_raw->fli.nr_sides)  error_message("error while accessing track %d, side is not supported by device '%s'", track, file_get_path(&img_raw->fil[0]));
 	if (tri.mode  >= img_raw->fli.nr_modes)  error_message("error while accessing track %d, mode is not supported by device '%s'", track, file_get_path(&img_raw->fil[0]));
+	stats_begin(IOCTL);
 #ifdef CW_CATWEASEL_OSX
 	result = cwmac_ioctl(cmd, (cw_ptr_t) &tri, FILE_FLAG_NONE, img_raw->osx_c, img_raw->osx_drive);
 #else /* CW_CATWEASEL_OSX */
 	result = file_ioctl(&img_raw->fil[0], cmd, &tri, FILE_FLAG_NONE);
 #endif /* CW_CATWEASEL_OSX */
+	stats_end(IOCTL);
 done:
 	return (result);
 	}
@@ -191,6 +236,99 @@ image_raw_seekable(
 
 
 
+/****************************************************************************
+ * image_raw_kernel_decrement
+ ****************************************************************************/
+cw_void_t
+image_raw_kernel_decrement(
+	cw_raw_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_raw_t			*d;
+	cw_index_t			i, j;
+
+	/* decrement every value, but not below 0 */
+
+	for (i = 0; i + IMAGE_RAW_KERNEL_BLOCK_SIZE <= size; i += IMAGE_RAW_KERNEL_BLOCK_SIZE)
+		{
+		d = &data[i];
+		for (j = 0; j < IMAGE_RAW_KERNEL_BLOCK_SIZE; j++) d[j] -= (d[j] > 0);
+		}
+	for ( ; i < size; i++) data[i] -= (data[i] > 0);
+	}
+
+
+
+/****************************************************************************
+ * image_raw_kernel_half
+ ****************************************************************************/
+cw_void_t
+image_raw_kernel_half(
+	cw_raw_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_raw_t			*d;
+	cw_index_t			i, j;
+
+	/* halve the pulse length and keep the index bit */
+
+	for (i = 0; i + IMAGE_RAW_KERNEL_BLOCK_SIZE <= size; i += IMAGE_RAW_KERNEL_BLOCK_SIZE)
+		{
+		d = &data[i];
+		for (j = 0; j < IMAGE_RAW_KERNEL_BLOCK_SIZE; j++) d[j] = ((d[j] & GLOBAL_PULSE_LENGTH_MASK) >> 1) | (d[j] & GLOBAL_PULSE_INDEX_MASK);
+		}
+	for ( ; i < size; i++) data[i] = ((data[i] & GLOBAL_PULSE_LENGTH_MASK) >> 1) | (data[i] & GLOBAL_PULSE_INDEX_MASK);
+	}
+
+
+
+/****************************************************************************
+ * image_raw_kernel_clamp
+ ****************************************************************************/
+cw_count_t
+image_raw_kernel_clamp(
+	cw_raw_t			*data,
+	cw_size_t			size,
+	cw_raw_t			mask)
+
+	{
+	cw_raw_t			*d, c, v;
+	cw_count_t			modified = 0;
+	cw_index_t			i, j;
+
+	/*
+	 * mask every value and limit it to the valid pulse lengths, the
+	 * number of values out of range after masking is returned. c counts
+	 * per block and can not overflow, because
+	 * IMAGE_RAW_KERNEL_BLOCK_SIZE < 256
+	 */
+
+	for (i = 0; i + IMAGE_RAW_KERNEL_BLOCK_SIZE <= size; i += IMAGE_RAW_KERNEL_BLOCK_SIZE)
+		{
+		d = &data[i];
+		for (c = j = 0; j < IMAGE_RAW_KERNEL_BLOCK_SIZE; j++)
+			{
+			v = d[j] & mask;
+			c += (v < GLOBAL_MIN_PULSE_LENGTH) | (v > GLOBAL_MAX_PULSE_LENGTH);
+			v = (v < GLOBAL_MIN_PULSE_LENGTH) ? GLOBAL_MIN_PULSE_LENGTH : v;
+			d[j] = (v > GLOBAL_MAX_PULSE_LENGTH) ? GLOBAL_MAX_PULSE_LENGTH : v;
+			}
+		modified += c;
+		}
+	for ( ; i < size; i++)
+		{
+		v = data[i] & mask;
+		modified += (v < GLOBAL_MIN_PULSE_LENGTH) | (v > GLOBAL_MAX_PULSE_LENGTH);
+		v = (v < GLOBAL_MIN_PULSE_LENGTH) ? GLOBAL_MIN_PULSE_LENGTH : v;
+		data[i] = (v > GLOBAL_MAX_PULSE_LENGTH) ? GLOBAL_MAX_PULSE_LENGTH : v;
+		}
+	return (modified);
+	}
+
+
+
 /****************************************************************************
  * image_raw_read_correction
  ****************************************************************************/
@@ -201,10 +339,8 @@ image_raw_read_correction(
 	cw_count_t			track)
 
 	{
-	cw_index_t			i;
-
 	verbose_message(GENERIC, 1, "doing '0x80 -> 0x7f' correction on raw track %d", track);
-	for (i = 0; i < size; i++) if (data[i] > 0) data[i]--;
+	image_raw_kernel_decrement(data, size);
 	}
 
 
@@ -226,7 +362,8 @@ image_raw_clock_adjust_double(
 	/*
 	 * double values without creating gaps in the histogram. this is
 	 * done by using 2 * value and 2 * value + 1 alternately for each
-	 * value
+	 * value. each value depends on the histogram of all values before,
+	 * so this can not be done with a kernel
 	 */
 
 	verbose_message(GENERIC, 1, "doing clock adjustment (doubling values) on raw track %d", track);
@@ -254,23 +391,8 @@ image_raw_clock_adjust_half(
 	cw_count_t			track)
 
 	{
-	cw_count_t			d1, d2;
-	cw_index_t			i;
-
-	/*
-	 * double values without creating gaps in the histogram. this is
-	 * done by using 2 * value and 2 * value + 1 alternately for each
-	 * value
-	 */
-
 	verbose_message(GENERIC, 1, "doing clock adjustment (halving values) on raw track %d", track);
-	for (i = 0; i < size; i++)
-		{
-		d1 = data[i];
-		d2 = (d1 & GLOBAL_PULSE_LENGTH_MASK) / 2;
-		if ((d1 & GLOBAL_PULSE_INDEX_MASK) != 0) d2 |= GLOBAL_PULSE_INDEX_MASK;
-		data[i] = d2;
-		}
+	image_raw_kernel_half(data, size);
 	}
 
 
@@ -338,15 +460,8 @@ image_raw_read_track_text(
 			};
 		parse_token(&img_raw->prs, token, GLOBAL_MAX_NAME_SIZE);
 		if (! string_equal(token, "{")) parse_error(&img_raw->prs, "{ expected");
-		size = 0;
 		parse_hex_only(&img_raw->prs, hex_only);
-		while (1)
-			{
-			if (parse_token(&img_raw->prs, token, GLOBAL_MAX_NAME_SIZE) == 0) parse_error(&img_raw->prs, "} expected");
-			if (string_equal(token, "}")) break;
-			if (size > limit) parse_error(&img_raw->prs, "track %d too large");
-			data[size++] = parse_number(&img_raw->prs, token, GLOBAL_MAX_NAME_SIZE);
-			}
+		size = parse_numbers(&img_raw->prs, data, limit);
 		parse_hex_only(&img_raw->prs, CW_BOOL_FALSE);
 		}
 	while (size == 0);
@@ -369,6 +484,45 @@ image_raw_read_track_text(
 
 
 
+/****************************************************************************
+ * image_raw_read_track_output
+ ****************************************************************************/
+static cw_size_t
+image_raw_read_track_output(
+	struct image_raw		*img_raw,
+	struct file			*fil,
+	struct track_header		*trk_hdr,
+	struct fifo			*ffo)
+
+	{
+	struct output_header		out_hdr;
+	cw_count_t			size;
+
+	/* only img_raw->fil[0] could be bad sector output */
+
+	error_condition(&img_raw->fil[0] != fil);
+
+	/* records without flux data are skipped like empty text tracks */
+
+	do
+		{
+		size = output_read_record(fil, &out_hdr, fifo_get_data(ffo), fifo_get_limit(ffo));
+		if (size == -1) return (0);
+		}
+	while (size == 0);
+	*trk_hdr = (struct track_header)
+		{
+		.magic = TRACK_MAGIC,
+		.track = out_hdr.track,
+		.clock = out_hdr.clock,
+		.flags = out_hdr.flags
+		};
+	export_u32_le(trk_hdr->size, size);
+	return (size);
+	}
+
+
+
 /****************************************************************************
  * image_raw_read_track2
  ****************************************************************************/
@@ -389,6 +543,7 @@ image_raw_read_track2(
 
 	fifo_reset(ffo);
 	if (subtype == SUBTYPE_DATA) size = image_raw_read_track_data(img_raw, fil, trk_hdr, ffo);
+	else if (subtype == SUBTYPE_OUTPUT) size = image_raw_read_track_output(img_raw, fil, trk_hdr, ffo);
 	else size = image_raw_read_track_text(img_raw, fil, trk_hdr, ffo);
 	if (size == 0) return (0);
 
@@ -679,19 +834,11 @@ image_raw_write_prepare(
 	unsigned char			*data = fifo_get_data(ffo);
 	int				size  = fifo_get_wr_ofs(ffo);
 	int				mask  = GLOBAL_PULSE_INDEX_MASK | GLOBAL_PULSE_LENGTH_MASK;
-	int				d, i, j;
+	int				j;
 
 	if (! (fifo_get_flags(ffo) & FIFO_FLAG_WRITABLE)) error_warning("data written on track %d may be corrupt", track);
 	if (fifo_get_flags(ffo) & FIFO_FLAG_INDEX_STORED) mask = GLOBAL_PULSE_LENGTH_MASK;
-	for (i = j = 0; i < size; i++)
-		{
-		d = data[i] &= mask;
-		if ((d >= GLOBAL_MIN_PULSE_LENGTH) && (d <= GLOBAL_MAX_PULSE_LENGTH)) continue;
-		if (d < GLOBAL_MIN_PULSE_LENGTH) d = GLOBAL_MIN_PULSE_LENGTH;
-		if (d > GLOBAL_MAX_PULSE_LENGTH) d = GLOBAL_MAX_PULSE_LENGTH;
-		data[i] = d;
-		j++;
-		}
+	j = image_raw_kernel_clamp(data, size, mask);
 	if (j > 0) error_warning("had to modify catweasel counters %d times on track %d", j, track);
 	}
 
@@ -700,7 +847,7 @@ image_raw_write_prepare(
 /****************************************************************************
  * image_raw_write_flags
  ****************************************************************************/
-static int
+int
 image_raw_write_flags(
 	struct image_track		*img_trk,
 	struct fifo			*ffo)
@@ -725,6 +872,19 @@ image_raw_write_flags(
 
 
 
+/****************************************************************************
+ * image_raw_is_device
+ ****************************************************************************/
+int
+image_raw_is_device(
+	union image			*img)
+
+	{
+	return ((img->raw.type == TYPE_DEVICE) ? 1 : 0);
+	}
+
+
+
 /****************************************************************************
  * image_raw_close_read_remaining
  ****************************************************************************/
@@ -748,6 +908,31 @@ image_raw_close_read_remaining(
 
 
 
+/****************************************************************************
+ * image_raw_close_seek_statistics
+ ****************************************************************************/
+static void
+image_raw_close_seek_statistics(
+	union image			*img)
+
+	{
+	struct cw_seekinfo		ski = CW_SEEKINFO_INIT;
+
+	/*
+	 * print seek statistics of the drive, they are useful to tune
+	 * step_time and settle_time. older drivers do not provide them
+	 */
+
+	if (img->raw.type != TYPE_DEVICE) return;
+	if (file_ioctl(&img->raw.fil[0], CW_IOC_GSKINFO, &ski, FILE_FLAG_RETURN) != 0) return;
+	verbose_message(GENERIC, 1, "seek statistics of '%s': %d seeks (%d ahead), %d steps, %d dummy steps, %d calibrations",
+		file_get_path(&img->raw.fil[0]), ski.seeks, ski.seeks_ahead, ski.steps, ski.dummy_steps, ski.calibrations);
+	if (ski.seeks > 0) verbose_message(GENERIC, 1, "seek time of '%s': %lld us average, %d us maximum",
+		file_get_path(&img->raw.fil[0]), (long long) (ski.time_total / ski.seeks), ski.time_max);
+	}
+
+
+
 
 /****************************************************************************
  *
@@ -785,6 +970,7 @@ image_raw_open(
 	img->raw.type    = TYPE_DEVICE;
 	img->raw.subtype = SUBTYPE_NONE;
 	img->raw.fli     = CW_FLOPPYINFO_INIT;
+	img->raw.track_next = -1;
 #ifdef CW_CATWEASEL_OSX
 	if (string_is_cwmac_device(path))
 		{
@@ -808,7 +994,12 @@ image_raw_open(
 		if (! image_raw_seekable(&img->raw)) type_name = "pipe";
 		else type_name = "file", img->raw.type = TYPE_REGULAR;
 		file_read_strict(&img->raw.fil[0], buffer, MAGIC_SIZE);
-		for (i = 0; i < MAGIC_SIZE; i++)
+		if (output_check_magic(buffer))
+			{
+			subtype_name = " (bad sector output)";
+			img->raw.subtype = SUBTYPE_OUTPUT;
+			}
+		else for (i = 0; i < MAGIC_SIZE; i++)
 			{
 			if (buffer[i] == magic_data[i]) continue;
 			if (buffer[i] == magic_data2[i]) continue;
@@ -868,6 +1059,7 @@ image_raw_close(
 		}
 #else /* CW_CATWEASEL_OSX */
 	image_raw_close_read_remaining(img);
+	image_raw_close_seek_statistics(img);
 #endif /* CW_CATWEASEL_OSX */
 	return (image_close(img, &img->raw.fil[0]));
 	}
@@ -1019,6 +1211,30 @@ image_raw_done(
 
 
 
+/****************************************************************************
+ * image_raw_next
+ ****************************************************************************/
+static int
+image_raw_next(
+	union image			*img,
+	struct image_track		*img_trk,
+	int				track)
+
+	{
+
+	/*
+	 * remember which track will be read after the current one,
+	 * track == -1 means the head should stay where it is (because we
+	 * expect to read the same track again or there is no next track)
+	 */
+
+	img->raw.track_next = -1;
+	if ((track >= 0) && (img->raw.type == TYPE_DEVICE)) img->raw.track_next = image_raw_track_translate2(img_trk, track);
+	return (1);
+	}
+
+
+
 
 /****************************************************************************
  *
@@ -1042,6 +1258,7 @@ struct image_desc			image_raw_desc =
 	.offset      = image_raw_offset,
 	.track_read  = image_raw_read,
 	.track_write = image_raw_write,
-	.track_done  = image_raw_done
+	.track_done  = image_raw_done,
+	.track_next  = image_raw_next
 	};
 /******************************************************** Karsten Scheibler */
@@ -22,6 +22,15 @@
 #include "cw2dmk-osx/cwfloppy.h"
 #endif /* CW_CATWEASEL_OSX */
 
+/*
+ * size of the blocks the kernels image_raw_kernel_*() work on. the inner
+ * loop has a constant trip count and no branches, so gcc -O2 turns it
+ * into SIMD instructions (SSE2 on x86-64, NEON on arm64) without the need
+ * for intrinsics or a runtime check of the cpu
+ */
+
+#define IMAGE_RAW_KERNEL_BLOCK_SIZE	32
+
 /* number of retries + first read == GLOBAL_NR_RETRIES + 1 */
 
 #define IMAGE_RAW_NR_HINTS		((GLOBAL_NR_RETRIES + 1) * GLOBAL_NR_TRACKS)
@@ -59,11 +68,18 @@ struct image_raw
 	int				subtype;
 	int				flags;
 	int				track_flags[GLOBAL_NR_TRACKS];
+	int				track_next;
 	struct image_raw_text		txt;
 	struct parse			prs;
 	};
 
 extern struct image_desc		image_raw_desc;
+extern int				image_raw_track_translate(struct image_track *, int);
+extern int				image_raw_write_flags(struct image_track *, struct fifo *);
+extern int				image_raw_is_device(union image *);
+extern cw_void_t			image_raw_kernel_decrement(cw_raw_t *, cw_size_t);
+extern cw_void_t			image_raw_kernel_half(cw_raw_t *, cw_size_t);
+extern cw_count_t			image_raw_kernel_clamp(cw_raw_t *, cw_size_t, cw_raw_t);
 
 
 
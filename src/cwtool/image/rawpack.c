@@ -0,0 +1,725 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * image/rawpack.c
+ *
+ ****************************************************************************
+ *
+ * packed variant of image "raw", only regular files are supported:
+ *
+ * - file magic (32 bytes)
+ * - one block per stored track: struct block_header followed by the
+ *   huffman coded counter values. each block uses its own static code,
+ *   either over the plain counter values or over the differences of
+ *   successive values, whichever is shorter
+ * - index with one struct index_entry per block
+ * - struct index_footer, pointing to the index
+ *
+ * the index allows to read tracks in any order without scanning the whole
+ * file, the checksum in each block detects damaged archive files
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "rawpack.h"
+#include "../error.h"
+#include "../debug.h"
+#include "../verbose.h"
+#include "../global.h"
+#include "../options.h"
+#include "../fifo.h"
+#include "../file.h"
+#include "../image.h"
+#include "../import.h"
+#include "../export.h"
+
+
+
+#define MAGIC_SIZE			32
+#define INDEX_MAGIC_SIZE		8
+
+#define BLOCK_MAGIC			0xcb
+
+#define MODEL_PLAIN			0
+#define MODEL_DELTA			1
+
+#define NR_SYMBOLS			0x100
+#define MAX_CODE_LENGTH			12
+#define TABLE_SIZE			(1 << MAX_CODE_LENGTH)
+#define PACKED_SIZE			(GLOBAL_MAX_TRACK_SIZE * MAX_CODE_LENGTH / 8 + 8)
+
+/* same values as used by image "raw" */
+
+#define HEADER_FLAG_WRITABLE		(1 << 0)
+#define HEADER_FLAG_INDEX_STORED	(1 << 1)
+#define HEADER_FLAG_INDEX_ALIGNED	(1 << 2)
+
+struct block_header
+	{
+	unsigned char			magic;
+	unsigned char			track;
+	unsigned char			clock;
+	unsigned char			flags;
+	unsigned char			model;
+	unsigned char			reserved[3];
+	unsigned char			size[4];
+	unsigned char			packed_size[4];
+	unsigned char			checksum[4];
+	unsigned char			lengths[NR_SYMBOLS / 2];
+	};
+
+struct index_entry
+	{
+	unsigned char			track;
+	unsigned char			clock;
+	unsigned char			flags;
+	unsigned char			reserved;
+	unsigned char			offset[4];
+	};
+
+struct index_footer
+	{
+	unsigned char			entries[4];
+	unsigned char			offset[4];
+	char				magic[INDEX_MAGIC_SIZE];
+	};
+
+static const char			magic_data[MAGIC_SIZE]  = { 'c', 'w', 't', 'o', 'o', 'l', ' ', 'r', 'a', 'w', ' ', 'p', 'a', 'c', 'k', 'e', 'd', ' ', '1', 0, };
+static const char			magic_index[INDEX_MAGIC_SIZE] = { 'c', 'w', 'r', 'p', 'i', 'd', 'x', 0 };
+static unsigned char			packed_data[PACKED_SIZE];
+
+
+
+
+/****************************************************************************
+ *
+ * low level functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * image_rawpack_checksum
+ ****************************************************************************/
+static cw_u32_t
+image_rawpack_checksum(
+	cw_raw_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_u32_t			checksum = 0x811c9dc5;
+	cw_index_t			i;
+
+	/* FNV-1a */
+
+	for (i = 0; i < size; i++) checksum = (checksum ^ data[i]) * 0x01000193;
+	return (checksum);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_lengths
+ ****************************************************************************/
+static cw_void_t
+image_rawpack_lengths(
+	const cw_count_t		*count,
+	cw_u8_t				*length)
+
+	{
+	cw_count_t			freq[2 * NR_SYMBOLS], cnt[NR_SYMBOLS];
+	cw_index_t			parent[2 * NR_SYMBOLS], leaf[NR_SYMBOLS];
+	cw_count_t			nodes, active, l, max;
+	cw_index_t			i, m1, m2, s;
+
+	for (s = 0; s < NR_SYMBOLS; s++) cnt[s] = count[s];
+	while (1)
+		{
+		for (s = nodes = 0; s < NR_SYMBOLS; s++)
+			{
+			leaf[s]   = -1;
+			length[s] = 0;
+			if (cnt[s] == 0) continue;
+			leaf[s]         = nodes;
+			freq[nodes]     = cnt[s];
+			parent[nodes++] = -1;
+			}
+		if (nodes == 0) return;
+		if (nodes == 1)
+			{
+			for (s = 0; s < NR_SYMBOLS; s++) if (leaf[s] >= 0) length[s] = 1;
+			return;
+			}
+
+		/* huffman, join the two least frequent nodes until one is left */
+
+		for (active = nodes; active > 1; active--)
+			{
+			for (i = 0, m1 = m2 = -1; i < nodes; i++)
+				{
+				if (parent[i] != -1) continue;
+				if ((m1 == -1) || (freq[i] < freq[m1])) m2 = m1, m1 = i;
+				else if ((m2 == -1) || (freq[i] < freq[m2])) m2 = i;
+				}
+			freq[nodes]   = freq[m1] + freq[m2];
+			parent[nodes] = -1;
+			parent[m1]    = parent[m2] = nodes++;
+			}
+		for (s = max = 0; s < NR_SYMBOLS; s++)
+			{
+			if (leaf[s] < 0) continue;
+			for (l = 0, i = leaf[s]; parent[i] != -1; i = parent[i]) l++;
+			length[s] = l;
+			if (l > max) max = l;
+			}
+
+		/*
+		 * codes must fit into the decoding table, if they do not,
+		 * flatten the distribution and try again. this converges,
+		 * because with all counts equal to 1 no code is longer than
+		 * 8 bits
+		 */
+
+		if (max <= MAX_CODE_LENGTH) return;
+		for (s = 0; s < NR_SYMBOLS; s++) if (cnt[s] > 0) cnt[s] = (cnt[s] + 1) / 2;
+		}
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_codes
+ ****************************************************************************/
+static cw_void_t
+image_rawpack_codes(
+	const cw_u8_t			*length,
+	cw_u32_t			*code)
+
+	{
+	cw_count_t			lengths[MAX_CODE_LENGTH + 1] = { };
+	cw_u32_t			next[MAX_CODE_LENGTH + 1], c;
+	cw_index_t			l, s;
+
+	/* canonical codes, so only the lengths need to be stored */
+
+	for (s = 0; s < NR_SYMBOLS; s++) lengths[length[s]]++;
+	for (l = 1, c = 0, lengths[0] = 0; l <= MAX_CODE_LENGTH; l++)
+		{
+		c = (c + lengths[l - 1]) << 1;
+		next[l] = c;
+		}
+	for (s = 0; s < NR_SYMBOLS; s++) code[s] = (length[s] > 0) ? next[length[s]]++ : 0;
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_encode
+ ****************************************************************************/
+static cw_size_t
+image_rawpack_encode(
+	struct block_header		*blk_hdr,
+	cw_raw_t			*data,
+	cw_size_t			size,
+	cw_u8_t				*packed)
+
+	{
+	cw_count_t			count[2][NR_SYMBOLS] = { };
+	cw_count64_t			bits[2] = { };
+	cw_u8_t				length[2][NR_SYMBOLS];
+	cw_u32_t			code[NR_SYMBOLS];
+	cw_u64_t			reg = 0;
+	cw_count_t			reg_bits = 0;
+	cw_size_t			ofs = 0;
+	cw_index_t			i, m, s;
+	cw_raw_t			prev = 0;
+
+	/* build both models and take the one giving less bits */
+
+	for (i = 0; i < size; prev = data[i++])
+		{
+		count[MODEL_PLAIN][data[i]]++;
+		count[MODEL_DELTA][(cw_u8_t) (data[i] - prev)]++;
+		}
+	for (m = MODEL_PLAIN; m <= MODEL_DELTA; m++)
+		{
+		image_rawpack_lengths(count[m], length[m]);
+		for (s = 0; s < NR_SYMBOLS; s++) bits[m] += (cw_count64_t) count[m][s] * length[m][s];
+		}
+	m = (bits[MODEL_DELTA] < bits[MODEL_PLAIN]) ? MODEL_DELTA : MODEL_PLAIN;
+	image_rawpack_codes(length[m], code);
+	blk_hdr->model = m;
+	for (s = 0; s < NR_SYMBOLS; s += 2) blk_hdr->lengths[s / 2] = length[m][s] | (length[m][s + 1] << 4);
+
+	/* write codes msb first */
+
+	for (i = 0, prev = 0; i < size; prev = data[i++])
+		{
+		s        = (m == MODEL_DELTA) ? (cw_u8_t) (data[i] - prev) : data[i];
+		reg      = (reg << length[m][s]) | code[s];
+		reg_bits += length[m][s];
+		while (reg_bits >= 8)
+			{
+			reg_bits -= 8;
+			packed[ofs++] = reg >> reg_bits;
+			}
+		}
+	if (reg_bits > 0) packed[ofs++] = reg << (8 - reg_bits);
+	debug_error_condition(ofs > PACKED_SIZE);
+	return (ofs);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_decode
+ ****************************************************************************/
+static cw_bool_t
+image_rawpack_decode(
+	struct block_header		*blk_hdr,
+	cw_u8_t				*packed,
+	cw_size_t			packed_size,
+	cw_raw_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_u16_t			table[TABLE_SIZE] = { };
+	cw_u8_t				length[NR_SYMBOLS];
+	cw_u32_t			code[NR_SYMBOLS];
+	cw_u64_t			reg = 0;
+	cw_count_t			reg_bits = 0, l, entry;
+	cw_size_t			ofs = 0;
+	cw_index_t			i, j, s;
+	cw_raw_t			prev = 0;
+
+	if (blk_hdr->model > MODEL_DELTA) return (CW_BOOL_FALSE);
+	for (s = 0; s < NR_SYMBOLS; s += 2)
+		{
+		length[s]     = blk_hdr->lengths[s / 2] & 0x0f;
+		length[s + 1] = blk_hdr->lengths[s / 2] >> 4;
+		if ((length[s] > MAX_CODE_LENGTH) || (length[s + 1] > MAX_CODE_LENGTH)) return (CW_BOOL_FALSE);
+		}
+	image_rawpack_codes(length, code);
+
+	/*
+	 * one table lookup per counter value, each entry contains symbol
+	 * and code length. entries not covered by a code stay 0, so
+	 * damaged data is noticed
+	 */
+
+	for (s = 0; s < NR_SYMBOLS; s++)
+		{
+		if (length[s] == 0) continue;
+		i = code[s] << (MAX_CODE_LENGTH - length[s]);
+		l = 1 << (MAX_CODE_LENGTH - length[s]);
+		if (i + l > TABLE_SIZE) return (CW_BOOL_FALSE);
+		for (j = 0; j < l; j++) table[i + j] = (s << 4) | length[s];
+		}
+	for (i = 0; i < size; i++)
+		{
+		while ((reg_bits <= 56) && (ofs < packed_size)) reg = (reg << 8) | packed[ofs++], reg_bits += 8;
+		if (reg_bits >= MAX_CODE_LENGTH) entry = table[(reg >> (reg_bits - MAX_CODE_LENGTH)) & (TABLE_SIZE - 1)];
+		else entry = table[(reg << (MAX_CODE_LENGTH - reg_bits)) & (TABLE_SIZE - 1)];
+		l = entry & 0x0f;
+		if ((l == 0) || (l > reg_bits)) return (CW_BOOL_FALSE);
+		reg_bits -= l;
+		s = entry >> 4;
+		data[i] = prev = (blk_hdr->model == MODEL_DELTA) ? (cw_u8_t) (prev + s) : s;
+		}
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_found
+ ****************************************************************************/
+static cw_bool_t
+image_rawpack_found(
+	struct image_rawpack_block	*blk,
+	struct image_track		*img_trk,
+	int				track)
+
+	{
+	int				flag1 = (img_trk->flags & IMAGE_TRACK_FLAG_INDEXED_READ) ? 1 : 0;
+	int				flag2 = (blk->flags & HEADER_FLAG_INDEX_ALIGNED) ? 1 : 0;
+
+	/*
+	 * same rules as for image "raw", but without clock adjusting. if
+	 * this is needed, the image has to be unpacked first
+	 */
+
+	if ((blk->track != track) || (blk->clock != img_trk->clock) || (flag1 > flag2)) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_read_block
+ ****************************************************************************/
+static int
+image_rawpack_read_block(
+	struct image_rawpack		*img_rpk,
+	struct image_rawpack_block	*blk,
+	struct image_track		*img_trk,
+	struct fifo			*ffo)
+
+	{
+	struct block_header		blk_hdr;
+	struct file			*fil = &img_rpk->fil;
+	cw_size_t			size, packed_size;
+
+	fifo_reset(ffo);
+	file_seek(fil, blk->offset, FILE_FLAG_NONE);
+	file_read_strict(fil, &blk_hdr, sizeof (blk_hdr));
+	if ((blk_hdr.magic != BLOCK_MAGIC) || (blk_hdr.track != blk->track)) error_message("wrong block magic in file '%s'", file_get_path(fil));
+	size        = import_u32_le(blk_hdr.size);
+	packed_size = import_u32_le(blk_hdr.packed_size);
+	if (size > fifo_get_limit(ffo)) error_message("track %d too large in file '%s'", blk->track, file_get_path(fil));
+	if (packed_size > PACKED_SIZE) error_message("packed track %d too large in file '%s'", blk->track, file_get_path(fil));
+	file_read_strict(fil, packed_data, packed_size);
+
+	/* decode directly into the fifo, there is no intermediate copy */
+
+	if (! image_rawpack_decode(&blk_hdr, packed_data, packed_size, fifo_get_data(ffo), size))
+		{
+		error_warning("could not unpack track %d in file '%s'", blk->track, file_get_path(fil));
+		return (-1);
+		}
+	if (image_rawpack_checksum(fifo_get_data(ffo), size) != import_u32_le(blk_hdr.checksum)) error_message("checksum error on track %d in file '%s'", blk->track, file_get_path(fil));
+	if (blk_hdr.flags & HEADER_FLAG_WRITABLE)      fifo_set_flags(ffo, FIFO_FLAG_WRITABLE);
+	if (blk_hdr.flags & HEADER_FLAG_INDEX_STORED)  fifo_set_flags(ffo, FIFO_FLAG_INDEX_STORED);
+	if (blk_hdr.flags & HEADER_FLAG_INDEX_ALIGNED) fifo_set_flags(ffo, FIFO_FLAG_INDEX_ALIGNED);
+
+	/* strict flag checking as done by image "raw" */
+
+	if (((img_trk->flags & IMAGE_TRACK_FLAG_INDEXED_READ) ? 1 : 0) != ((blk_hdr.flags & HEADER_FLAG_INDEX_ALIGNED) ? 1 : 0)) fifo_clear_flags(ffo, FIFO_FLAG_WRITABLE);
+	verbose_message(GENERIC, 1, "got packed raw track %d with %d bytes (%d bytes packed) from '%s'", blk->track, size, packed_size, file_get_path(fil));
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_read_index
+ ****************************************************************************/
+static void
+image_rawpack_read_index(
+	struct image_rawpack		*img_rpk)
+
+	{
+	struct file			*fil = &img_rpk->fil;
+	struct index_footer		idx_ftr;
+	struct index_entry		idx_ent;
+	char				buffer[MAGIC_SIZE];
+	cw_count_t			size, offset;
+	cw_index_t			i;
+
+	file_read_strict(fil, buffer, MAGIC_SIZE);
+	if (memcmp(buffer, magic_data, MAGIC_SIZE) != 0) error_message("file '%s' has wrong magic", file_get_path(fil));
+	size = file_get_size(fil);
+	if (size < (cw_count_t) (MAGIC_SIZE + sizeof (idx_ftr))) error_message("file '%s' is not a regular file or too short", file_get_path(fil));
+	file_seek(fil, size - sizeof (idx_ftr), FILE_FLAG_NONE);
+	file_read_strict(fil, &idx_ftr, sizeof (idx_ftr));
+	if (memcmp(idx_ftr.magic, magic_index, INDEX_MAGIC_SIZE) != 0) error_message("file '%s' has no index, it may be truncated", file_get_path(fil));
+	img_rpk->blocks = import_u32_le(idx_ftr.entries);
+	offset          = import_u32_le(idx_ftr.offset);
+	if ((img_rpk->blocks > IMAGE_RAWPACK_NR_BLOCKS) ||
+		(offset + img_rpk->blocks * sizeof (idx_ent) + sizeof (idx_ftr) != size)) error_message("file '%s' has a corrupt index", file_get_path(fil));
+	file_seek(fil, offset, FILE_FLAG_NONE);
+	for (i = 0; i < img_rpk->blocks; i++)
+		{
+		file_read_strict(fil, &idx_ent, sizeof (idx_ent));
+		img_rpk->blk[i] = (struct image_rawpack_block)
+			{
+			.track  = idx_ent.track,
+			.clock  = idx_ent.clock,
+			.flags  = idx_ent.flags,
+			.offset = import_u32_le(idx_ent.offset)
+			};
+		if ((idx_ent.track >= GLOBAL_NR_TRACKS) || (idx_ent.clock >= CW_NR_CLOCKS) ||
+			(img_rpk->blk[i].offset < MAGIC_SIZE) || (img_rpk->blk[i].offset >= offset)) error_message("file '%s' has a corrupt index", file_get_path(fil));
+		}
+	verbose_message(GENERIC, 2, "index of '%s' contains %d tracks", file_get_path(fil), img_rpk->blocks);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_write_index
+ ****************************************************************************/
+static void
+image_rawpack_write_index(
+	struct image_rawpack		*img_rpk)
+
+	{
+	struct index_footer		idx_ftr;
+	struct index_entry		idx_ent;
+	cw_index_t			i;
+
+	for (i = 0; i < img_rpk->blocks; i++)
+		{
+		idx_ent = (struct index_entry)
+			{
+			.track = img_rpk->blk[i].track,
+			.clock = img_rpk->blk[i].clock,
+			.flags = img_rpk->blk[i].flags
+			};
+		export_u32_le(idx_ent.offset, img_rpk->blk[i].offset);
+		file_write(&img_rpk->fil, &idx_ent, sizeof (idx_ent));
+		}
+	export_u32_le(idx_ftr.entries, img_rpk->blocks);
+	export_u32_le(idx_ftr.offset, img_rpk->offset);
+	memcpy(idx_ftr.magic, magic_index, INDEX_MAGIC_SIZE);
+	file_write(&img_rpk->fil, &idx_ftr, sizeof (idx_ftr));
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * interface functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * image_rawpack_open
+ ****************************************************************************/
+static int
+image_rawpack_open(
+	union image			*img,
+	char				*path,
+	int				mode,
+	int				flags)
+
+	{
+	image_open(img, &img->rpk.fil, path, mode);
+	if (file_is_readable(&img->rpk.fil)) image_rawpack_read_index(&img->rpk);
+	else
+		{
+		file_write(&img->rpk.fil, magic_data, MAGIC_SIZE);
+		img->rpk.offset = MAGIC_SIZE;
+		}
+	verbose_message(GENERIC, 1, "assuming '%s' is a packed raw image", file_get_path(&img->rpk.fil));
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_close
+ ****************************************************************************/
+static int
+image_rawpack_close(
+	union image			*img)
+
+	{
+	if (file_is_writable(&img->rpk.fil)) image_rawpack_write_index(&img->rpk);
+	return (image_close(img, &img->rpk.fil));
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_offset
+ ****************************************************************************/
+static int
+image_rawpack_offset(
+	union image			*img)
+
+	{
+
+	/* like image "raw" it may be used as destination while reading */
+
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_read
+ ****************************************************************************/
+static int
+image_rawpack_read(
+	union image			*img,
+	struct image_track		*img_trk,
+	struct fifo			*ffo,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				track)
+
+	{
+	cw_bool_t			found = CW_BOOL_FALSE;
+	int				size = -1;
+	cw_index_t			b;
+
+	track = image_raw_track_translate(img_trk, track);
+	debug_error_condition(! file_is_readable(&img->rpk.fil));
+
+	/*
+	 * every stored copy of a track is returned once, like it is done
+	 * by image "raw" for images with more than one try per track
+	 */
+
+	for (b = 0; b < img->rpk.blocks; b++)
+		{
+		if (! image_rawpack_found(&img->rpk.blk[b], img_trk, track)) continue;
+		found = CW_BOOL_TRUE;
+		if (img->rpk.blk[b].used) continue;
+		img->rpk.blk[b].used = 1;
+		size = image_rawpack_read_block(&img->rpk, &img->rpk.blk[b], img_trk, ffo);
+		break;
+		}
+	if ((! found) && (! (img_trk->flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_warning("track %d not found in file '%s'", track, file_get_path(&img->rpk.fil));
+	if (size == -1) return (0);
+	if (size < GLOBAL_MIN_TRACK_SIZE) error_warning("got only %d bytes while reading track %d", size, track);
+	if (size > options_get_track_size_limit())
+		{
+		size = options_get_track_size_limit();
+		verbose_message(GENERIC, 1, "truncating track according to track_size_limit to %d bytes", size);
+		}
+	fifo_set_wr_ofs(ffo, size);
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_write
+ ****************************************************************************/
+static int
+image_rawpack_write(
+	union image			*img,
+	struct image_track		*img_trk,
+	struct fifo			*ffo,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				track)
+
+	{
+	struct block_header		blk_hdr;
+	int				size = fifo_get_wr_ofs(ffo);
+	cw_size_t			packed_size;
+
+	track = image_raw_track_translate(img_trk, track);
+	debug_error_condition(! file_is_writable(&img->rpk.fil));
+	if (size < GLOBAL_MIN_TRACK_SIZE)
+		{
+		error_warning("got only %d bytes for writing track %d, will skip it", size, track);
+		goto done;
+		}
+	if (img->rpk.blocks >= IMAGE_RAWPACK_NR_BLOCKS) error_message("file '%s' has too many tracks", file_get_path(&img->rpk.fil));
+	blk_hdr = (struct block_header)
+		{
+		.magic = BLOCK_MAGIC,
+		.track = track,
+		.clock = img_trk->clock,
+		.flags = image_raw_write_flags(img_trk, ffo)
+		};
+	packed_size = image_rawpack_encode(&blk_hdr, fifo_get_data(ffo), size, packed_data);
+	export_u32_le(blk_hdr.size, size);
+	export_u32_le(blk_hdr.packed_size, packed_size);
+	export_u32_le(blk_hdr.checksum, image_rawpack_checksum(fifo_get_data(ffo), size));
+	verbose_message(GENERIC, 1, "writing packed raw track %d with %d bytes (%d bytes packed) to '%s'", track, size, packed_size, file_get_path(&img->rpk.fil));
+	file_write(&img->rpk.fil, &blk_hdr, sizeof (blk_hdr));
+	file_write(&img->rpk.fil, packed_data, packed_size);
+	img->rpk.blk[img->rpk.blocks++] = (struct image_rawpack_block)
+		{
+		.track  = blk_hdr.track,
+		.clock  = blk_hdr.clock,
+		.flags  = blk_hdr.flags,
+		.offset = img->rpk.offset
+		};
+	img->rpk.offset += sizeof (blk_hdr) + packed_size;
+done:
+	fifo_set_rd_ofs(ffo, size);
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_done
+ ****************************************************************************/
+static int
+image_rawpack_done(
+	union image			*img,
+	struct image_track		*img_trk,
+	int				track)
+
+	{
+	cw_index_t			b;
+
+	track = image_raw_track_translate(img_trk, track);
+	for (b = 0; b < img->rpk.blocks; b++) if (img->rpk.blk[b].track == track) img->rpk.blk[b].used = 1;
+	return (1);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * image_rawpack_probe
+ ****************************************************************************/
+int
+image_rawpack_probe(
+	const char			*path)
+
+	{
+	struct file			fil;
+	struct stat			st;
+	char				buffer[MAGIC_SIZE];
+	int				result = 0;
+
+	/* devices and pipes can not be checked without consuming data */
+
+	if ((stat(path, &st) == -1) || (! S_ISREG(st.st_mode))) return (0);
+	file_open(&fil, path, FILE_MODE_READ, FILE_FLAG_NONE);
+	if ((file_read(&fil, buffer, MAGIC_SIZE) == MAGIC_SIZE) && (memcmp(buffer, magic_data, MAGIC_SIZE) == 0)) result = 1;
+	file_close(&fil);
+	return (result);
+	}
+
+
+
+/****************************************************************************
+ * image_rawpack_desc
+ ****************************************************************************/
+struct image_desc			image_rawpack_desc =
+	{
+	.name        = "rawpack",
+	.level       = 0,
+	.flags       = IMAGE_FLAG_SAME_TRACK,
+	.open        = image_rawpack_open,
+	.close       = image_rawpack_close,
+	.offset      = image_rawpack_offset,
+	.track_read  = image_rawpack_read,
+	.track_write = image_rawpack_write,
+	.track_done  = image_rawpack_done,
+	.track_next  = NULL
+	};
+/******************************************************** Karsten Scheibler */
@@ -0,0 +1,47 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * image/rawpack.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_IMAGE_RAWPACK_H
+#define CWTOOL_IMAGE_RAWPACK_H
+
+#include "types.h"
+#include "../global.h"
+#include "../file.h"
+#include "raw.h"
+#include "desc.h"
+
+#define IMAGE_RAWPACK_NR_BLOCKS		IMAGE_RAW_NR_HINTS
+
+struct image_rawpack_block
+	{
+	unsigned char			track;
+	unsigned char			clock;
+	unsigned char			flags;
+	unsigned char			used;
+	int				offset;
+	};
+
+struct image_rawpack
+	{
+	struct file			fil;
+	struct image_rawpack_block	blk[IMAGE_RAWPACK_NR_BLOCKS];
+	int				blocks;
+	int				offset;
+	};
+
+extern struct image_desc		image_rawpack_desc;
+extern int				image_rawpack_probe(const char *);
+
+
+
+#endif /* !CWTOOL_IMAGE_RAWPACK_H */
+/******************************************************** Karsten Scheibler */
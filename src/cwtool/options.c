@@ -36,7 +36,8 @@ static struct options			opt =
 	.disk_track_end     = GLOBAL_NR_TRACKS - 1,
 	.output_track_start = 0,
 	.output_track_end   = GLOBAL_NR_TRACKS - 1,
-	.track_size_limit   = GLOBAL_MAX_TRACK_SIZE
+	.track_size_limit   = GLOBAL_MAX_TRACK_SIZE,
+	.async_write        = -1
 	};
 
 
@@ -323,4 +324,38 @@ options_get_track_size_limit(
 	{
 	return (opt.track_size_limit);
 	}
+
+
+
+/****************************************************************************
+ * options_set_async_write
+ ****************************************************************************/
+cw_bool_t
+options_set_async_write(
+	cw_count_t			sync_interval)
+
+	{
+
+	/*
+	 * sync_interval is given in MB, 0 means fdatasync() is only called
+	 * when the file is closed, -1 disables the background writer
+	 */
+
+	if ((sync_interval < -1) || (sync_interval > 0x100000)) return (CW_BOOL_FAIL);
+	opt.async_write = sync_interval;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_async_write
+ ****************************************************************************/
+cw_count_t
+options_get_async_write(
+	cw_void_t)
+
+	{
+	return (opt.async_write);
+	}
 /******************************************************** Karsten Scheibler */
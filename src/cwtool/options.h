@@ -39,6 +39,7 @@ struct options
 	cw_count_t			output_track_start;
 	cw_count_t			output_track_end;
 	cw_count_t			track_size_limit;
+	cw_count_t			async_write;
 	};
 
 
@@ -133,6 +134,14 @@ extern cw_count_t
 options_get_track_size_limit(
 	cw_void_t);
 
+extern cw_bool_t
+options_set_async_write(
+	cw_count_t			sync_interval);
+
+extern cw_count_t
+options_get_async_write(
+	cw_void_t);
+
 
 
 #endif /* !CWTOOL_OPTIONS_H */
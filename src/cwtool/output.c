@@ -0,0 +1,660 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * output.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "output.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "file.h"
+#include "import.h"
+#include "export.h"
+#include "string.h"
+#include "format/container.h"
+#include "format/range.h"
+
+
+
+
+/****************************************************************************
+ *
+ * local data structures, variables and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define OUTPUT_FLAGS			8	/* UGLY: flag "no correction" hard coded */
+#define OUTPUT_FIXUP			128
+#define OUTPUT_SKIP_SIZE		0x10000
+
+static const cw_char_t			output_magic[OUTPUT_MAGIC_SIZE] = { 'c', 'w', 't', 'o', 'o', 'l', ' ', 'r', 'a', 'w', ' ', 'o', 'u', 't', 'p', 'u', 't', ' ', '1', 0, };
+
+/*
+ * start of header, gap and data part of one range within the arrays of
+ * the container entry
+ */
+
+struct output_slice
+	{
+	cw_index_t			header;
+	cw_index_t			gap;
+	cw_index_t			data;
+	};
+
+struct output_record
+	{
+	struct output_header		out_hdr;
+	struct output_range		*out_rng;
+	cw_raw8_t			*data;
+	cw_raw8_t			*error;
+	cw_raw8_t			*length;
+	cw_size_t			size;
+	cw_count_t			ranges;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * write functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * output_order
+ ****************************************************************************/
+static cw_index_t
+output_order(
+	cw_count_t			*sector,
+	cw_count_t			sectors,
+	cw_count_t			number)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < sectors; i++) if (sector[i] == number) return (i);
+	return (-1);
+	}
+
+
+
+/****************************************************************************
+ * output_entry_ranges
+ ****************************************************************************/
+static cw_count_t
+output_entry_ranges(
+	struct container		*con,
+	cw_index_t			index,
+	cw_count_t			*sector,
+	cw_count_t			sectors,
+	struct output_range		*out_rng,
+	struct output_slice		*out_slc)
+
+	{
+	struct range_sector		*rng_sec;
+	cw_count_t			range_entries = container_get_range_entries(con, index);
+	cw_count_t			limit = container_get_limit(con, index);
+	cw_count_t			start, end, gap;
+	cw_index_t			i, j, o;
+
+	for (i = j = 0; i < range_entries; i++)
+		{
+		rng_sec = container_get_range_sector(con, index, i);
+		o = output_order(sector, sectors, range_sector_get_number(rng_sec));
+		if (o == -1) continue;
+		if (out_rng == NULL)
+			{
+			j++;
+			continue;
+			}
+		out_rng[j] = (struct output_range) { .order = o };
+		export_u16_le(out_rng[j].sector, range_sector_get_number(rng_sec));
+		out_slc[j] = (struct output_slice) { };
+
+		/* sector header and sector gap */
+
+		gap = 0;
+		start = container_lookup_position(con, index, range_get_start(range_sector_header(rng_sec)));
+		end   = container_lookup_position(con, index, range_get_end(range_sector_header(rng_sec)));
+		if (end > 0)
+			{
+
+			/* UGLY: fixup for incorrect start value */
+
+			if (start > OUTPUT_FIXUP) start -= OUTPUT_FIXUP;
+			else start = 0;
+			out_rng[j].flags = OUTPUT_RANGE_FLAG_HEADER;
+			out_slc[j].header = start;
+			out_slc[j].gap    = end;
+			export_u32_le(out_rng[j].header, (end > start) ? end - start : 0);
+			gap = container_lookup_position(con, index, range_get_start(range_sector_data(rng_sec)));
+			export_u32_le(out_rng[j].gap, (gap > end) ? gap - end : 0);
+			}
+
+		/* sector data */
+
+		start = container_lookup_position(con, index, range_get_start(range_sector_data(rng_sec)));
+		end   = container_lookup_position(con, index, range_get_end(range_sector_data(rng_sec)));
+
+		/* UGLY: fixup for incorrect end value */
+
+		if (end < limit - OUTPUT_FIXUP) end += OUTPUT_FIXUP;
+		else end = limit;
+		out_slc[j].data = start;
+		export_u32_le(out_rng[j].data, (end > start) ? end - start : 0);
+		j++;
+		}
+	return (j);
+	}
+
+
+
+/****************************************************************************
+ * output_copy
+ ****************************************************************************/
+static cw_size_t
+output_copy(
+	struct container		*con,
+	cw_index_t			index,
+	cw_raw8_t			*data,
+	cw_raw8_t			*error,
+	cw_raw8_t			*length,
+	cw_index_t			start,
+	cw_size_t			size)
+
+	{
+	cw_raw8_t			*con_data  = container_get_data(con, index);
+	cw_raw8_t			*con_error = container_get_error(con, index);
+	struct container_lookup		*con_lkp   = container_get_lookup(con, index);
+	cw_index_t			i;
+
+	for (i = 0; i < size; i++)
+		{
+		data[i]   = con_data[start + i] & 0x7f;
+		error[i]  = con_error[start + i];
+		length[i] = con_lkp[start + i].length;
+		}
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * output_write_entry
+ ****************************************************************************/
+static cw_void_t
+output_write_entry(
+	struct file			*fil,
+	struct container		*con,
+	cw_index_t			index,
+	cw_count_t			track,
+	cw_mode_t			clock,
+	cw_count_t			*sector,
+	cw_count_t			sectors,
+	cw_index_t			record,
+	cw_count_t			records)
+
+	{
+	struct output_range		out_rng[CONTAINER_NR_RANGES];
+	struct output_slice		out_slc[CONTAINER_NR_RANGES];
+	struct output_header		*out_hdr;
+	cw_raw8_t			*buffer, *data, *error, *length;
+	cw_count_t			ranges;
+	cw_size_t			h, g, d, s, size;
+	cw_index_t			i;
+
+	ranges = output_entry_ranges(con, index, sector, sectors, out_rng, out_slc);
+	for (i = size = 0; i < ranges; i++) size += import_u32_le(out_rng[i].header) + import_u32_le(out_rng[i].gap) + import_u32_le(out_rng[i].data);
+
+	/* build the whole record, so it can be written at once */
+
+	s = sizeof (struct output_header) + size + ranges * sizeof (struct output_range) + 2 * size;
+	buffer = (cw_raw8_t *) malloc(s);
+	if (buffer == NULL) error_oom();
+	out_hdr = (struct output_header *) buffer;
+	*out_hdr = (struct output_header)
+		{
+		.magic = OUTPUT_HEADER_MAGIC,
+		.track = track,
+		.clock = clock,
+		.flags = OUTPUT_FLAGS
+		};
+	export_u32_le(out_hdr->size, size);
+	export_u16_le(out_hdr->ranges, ranges);
+	export_u16_le(out_hdr->record, record);
+	export_u16_le(out_hdr->records, records);
+	data   = &buffer[sizeof (struct output_header)];
+	error  = &data[size + ranges * sizeof (struct output_range)];
+	length = &error[size];
+	memcpy(&data[size], out_rng, ranges * sizeof (struct output_range));
+	for (i = d = 0; i < ranges; i++)
+		{
+		h = import_u32_le(out_rng[i].header);
+		g = import_u32_le(out_rng[i].gap);
+		d += output_copy(con, index, &data[d], &error[d], &length[d], out_slc[i].header, h);
+		d += output_copy(con, index, &data[d], &error[d], &length[d], out_slc[i].gap, g);
+		d += output_copy(con, index, &data[d], &error[d], &length[d], out_slc[i].data, import_u32_le(out_rng[i].data));
+		}
+	debug_error_condition(d != size);
+	verbose_message(GENERIC, 2, "writing %d bytes of bad sector output for track %d to '%s'", s, track, file_get_path(fil));
+	file_write(fil, buffer, s);
+	free(buffer);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * read functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * output_skip
+ ****************************************************************************/
+static cw_void_t
+output_skip(
+	struct file			*fil,
+	cw_size_t			size)
+
+	{
+	cw_raw8_t			buffer[OUTPUT_SKIP_SIZE];
+	cw_size_t			s;
+
+	for ( ; size > 0; size -= s)
+		{
+		s = (size > sizeof (buffer)) ? sizeof (buffer) : size;
+		file_read_strict(fil, buffer, s);
+		}
+	}
+
+
+
+/****************************************************************************
+ * output_read_header
+ ****************************************************************************/
+static cw_bool_t
+output_read_header(
+	struct file			*fil,
+	struct output_header		*out_hdr)
+
+	{
+	cw_size_t			size = file_read(fil, out_hdr, sizeof (struct output_header));
+
+	if (size == 0) return (CW_BOOL_FALSE);
+	if (size != sizeof (struct output_header)) error_message("file '%s' truncated", file_get_path(fil));
+	if (out_hdr->magic != OUTPUT_HEADER_MAGIC) error_message("wrong header magic in file '%s'", file_get_path(fil));
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * output_read_full
+ ****************************************************************************/
+static cw_bool_t
+output_read_full(
+	struct file			*fil,
+	struct output_record		*out_rec)
+
+	{
+	cw_size_t			size;
+
+	if (! output_read_header(fil, &out_rec->out_hdr)) return (CW_BOOL_FALSE);
+	out_rec->size   = import_u32_le(out_rec->out_hdr.size);
+	out_rec->ranges = import_u16_le(out_rec->out_hdr.ranges);
+	size = out_rec->size;
+	if (import_u16_le(out_rec->out_hdr.records) > 0) size = 3 * out_rec->size + out_rec->ranges * sizeof (struct output_range);
+	out_rec->data = (cw_raw8_t *) malloc(size + 1);
+	if (out_rec->data == NULL) error_oom();
+	file_read_strict(fil, out_rec->data, size);
+	out_rec->out_rng = (struct output_range *) &out_rec->data[out_rec->size];
+	out_rec->error   = (cw_raw8_t *) &out_rec->out_rng[out_rec->ranges];
+	out_rec->length  = &out_rec->error[out_rec->size];
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * convert functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * output_convert_lines
+ ****************************************************************************/
+static cw_void_t
+output_convert_lines(
+	struct file			*fil,
+	struct output_record		*out_rec,
+	cw_index_t			start,
+	cw_size_t			size)
+
+	{
+	cw_char_t			string[0x10000];
+	cw_index_t			i, j;
+
+	for (i = start, j = 0; i < start + size; i++)
+		{
+		j += string_snprintf(&string[j], sizeof (string) - j, "%02x # %2d %d\n", out_rec->data[i], out_rec->error[i], out_rec->length[i]);
+		if (j < sizeof (string) / 2) continue;
+		file_write(fil, string, j);
+		j = 0;
+		}
+	if (j > 0) file_write(fil, string, j);
+	}
+
+
+
+/****************************************************************************
+ * output_convert_check
+ ****************************************************************************/
+static cw_void_t
+output_convert_check(
+	struct file			*fil,
+	struct output_record		*out_rec)
+
+	{
+	struct output_range		*out_rng;
+	cw_count64_t			size;
+	cw_index_t			i;
+
+	/*
+	 * the ranges of a record must fit into its size, otherwise a
+	 * truncated or corrupt file would make us read past the record
+	 */
+
+	for (i = 0, size = 0; i < out_rec->ranges; i++)
+		{
+		out_rng = &out_rec->out_rng[i];
+		size += (cw_count64_t) import_u32_le(out_rng->header) + import_u32_le(out_rng->gap) + import_u32_le(out_rng->data);
+		if (size > out_rec->size) error_message("file '%s' contains record with ranges exceeding its size", file_get_path(fil));
+		}
+	}
+
+
+
+/****************************************************************************
+ * output_convert_sector
+ ****************************************************************************/
+static cw_void_t
+output_convert_sector(
+	struct file			*fil,
+	struct output_record		*out_rec,
+	cw_count_t			records,
+	cw_index_t			order)
+
+	{
+	struct output_range		*out_rng;
+	cw_count_t			track = out_rec->out_hdr.track;
+	cw_count_t			sector;
+	cw_size_t			h, g, d;
+	cw_index_t			i, j, k, r;
+
+	/*
+	 * write one block per record, which contains copies of this
+	 * sector. copies are numbered over all records
+	 */
+
+	for (j = r = 0; r < records; r++)
+		{
+		for (i = 0; i < out_rec[r].ranges; i++) if (out_rec[r].out_rng[i].order == order) break;
+		if (i == out_rec[r].ranges) continue;
+		file_write_sprintf(fil, "track_data_hex %d %d %d {\n", track, out_rec[r].out_hdr.clock, out_rec[r].out_hdr.flags);
+		for (i = k = 0; i < out_rec[r].ranges; i++, k += h + g + d)
+			{
+			out_rng = &out_rec[r].out_rng[i];
+			h = import_u32_le(out_rng->header);
+			g = import_u32_le(out_rng->gap);
+			d = import_u32_le(out_rng->data);
+			if (out_rng->order != order) continue;
+			sector = import_u16_le(out_rng->sector);
+			j++;
+			file_write_sprintf(fil, "##### start track %d sector %d (%d) #####\n", track, sector, j);
+			if (out_rng->flags & OUTPUT_RANGE_FLAG_HEADER)
+				{
+				file_write_string(fil, "### sector header ###\n");
+				output_convert_lines(fil, &out_rec[r], k, h);
+				file_write_string(fil, "### sector gap between header and data ###\n");
+				output_convert_lines(fil, &out_rec[r], k + h, g);
+				}
+			file_write_string(fil, "### sector data ###\n");
+			output_convert_lines(fil, &out_rec[r], k + h + g, d);
+			file_write_sprintf(fil, "##### end track %d sector %d (%d) #####\n", track, sector, j);
+			}
+		file_write_string(fil, "}\n");
+		}
+	}
+
+
+
+/****************************************************************************
+ * output_convert_track
+ ****************************************************************************/
+static cw_bool_t
+output_convert_track(
+	struct file			*fil_src,
+	struct file			*fil_dst)
+
+	{
+	struct output_record		out_rec0, *out_rec;
+	cw_count_t			records, orders;
+	cw_index_t			i, r;
+
+	if (! output_read_full(fil_src, &out_rec0)) return (CW_BOOL_FALSE);
+	file_write_string(fil_dst, "# cwtool raw text 3\n");
+	records = import_u16_le(out_rec0.out_hdr.records);
+	if (records == 0)
+		{
+		out_rec0.data[out_rec0.size] = '\0';
+		file_write_sprintf(fil_dst, "# track %d: format '%s' does not support raw output of bad sectors\n", out_rec0.out_hdr.track, out_rec0.data);
+		free(out_rec0.data);
+		return (CW_BOOL_TRUE);
+		}
+
+	/* all records of a track are needed, output is ordered by sector */
+
+	out_rec = (struct output_record *) malloc(records * sizeof (struct output_record));
+	if (out_rec == NULL) error_oom();
+	out_rec[0] = out_rec0;
+	for (r = orders = 0; r < records; r++)
+		{
+		if ((r > 0) && (! output_read_full(fil_src, &out_rec[r]))) error_message("file '%s' truncated", file_get_path(fil_src));
+		if ((import_u16_le(out_rec[r].out_hdr.record) != r) ||
+			(import_u16_le(out_rec[r].out_hdr.records) != records) ||
+			(out_rec[r].out_hdr.track != out_rec0.out_hdr.track)) error_message("file '%s' contains inconsistent records", file_get_path(fil_src));
+		output_convert_check(fil_src, &out_rec[r]);
+		for (i = 0; i < out_rec[r].ranges; i++) if (out_rec[r].out_rng[i].order >= orders) orders = out_rec[r].out_rng[i].order + 1;
+		}
+	for (i = 0; i < orders; i++) output_convert_sector(fil_dst, out_rec, records, i);
+	for (r = 0; r < records; r++) free(out_rec[r].data);
+	free(out_rec);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * output_open
+ ****************************************************************************/
+cw_void_t
+output_open(
+	struct file			*fil,
+	const cw_char_t			*path)
+
+	{
+	file_open(fil, path, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	file_write(fil, output_magic, sizeof (output_magic));
+	}
+
+
+
+/****************************************************************************
+ * output_write_track
+ ****************************************************************************/
+cw_count_t
+output_write_track(
+	struct file			*fil,
+	struct container		*con,
+	cw_count_t			track,
+	cw_mode_t			clock,
+	cw_count_t			*sector,
+	cw_count_t			sectors)
+
+	{
+	cw_count_t			ranges[CONTAINER_NR_ENTRIES];
+	cw_count_t			entries = container_get_entries(con);
+	cw_count_t			records;
+	cw_index_t			i, r;
+
+	/*
+	 * every container entry with copies of the given sectors gets one
+	 * record. the range entries are scanned once to count the records,
+	 * because every record header contains their number
+	 */
+
+	for (i = records = 0; i < entries; i++)
+		{
+		ranges[i] = output_entry_ranges(con, i, sector, sectors, NULL, NULL);
+		if (ranges[i] > 0) records++;
+		}
+	for (i = r = 0; i < entries; i++) if (ranges[i] > 0) output_write_entry(fil, con, i, track, clock, sector, sectors, r++, records);
+	return (records);
+	}
+
+
+
+/****************************************************************************
+ * output_write_unsupported
+ ****************************************************************************/
+cw_void_t
+output_write_unsupported(
+	struct file			*fil,
+	cw_count_t			track,
+	cw_mode_t			clock,
+	const cw_char_t			*name)
+
+	{
+	struct output_header		out_hdr =
+		{
+		.magic = OUTPUT_HEADER_MAGIC,
+		.track = track,
+		.clock = clock,
+		.flags = OUTPUT_FLAGS
+		};
+	cw_size_t			size = string_length(name);
+
+	export_u32_le(out_hdr.size, size);
+	file_write(fil, &out_hdr, sizeof (out_hdr));
+	file_write(fil, name, size);
+	}
+
+
+
+/****************************************************************************
+ * output_check_magic
+ ****************************************************************************/
+cw_bool_t
+output_check_magic(
+	const cw_char_t			*buffer)
+
+	{
+	if (memcmp(buffer, output_magic, sizeof (output_magic)) == 0) return (CW_BOOL_TRUE);
+	return (CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * output_read_record
+ ****************************************************************************/
+cw_count_t
+output_read_record(
+	struct file			*fil,
+	struct output_header		*out_hdr,
+	cw_raw8_t			*data,
+	cw_size_t			limit)
+
+	{
+	cw_size_t			size;
+
+	/*
+	 * returns -1 at end of file and 0 for records without flux data,
+	 * the range index, errors and pulse lengths are skipped
+	 */
+
+	if (! output_read_header(fil, out_hdr)) return (-1);
+	size = import_u32_le(out_hdr->size);
+	if (import_u16_le(out_hdr->records) == 0)
+		{
+		output_skip(fil, size);
+		return (0);
+		}
+	if (size > limit) error_message("track %d too large in file '%s'", out_hdr->track, file_get_path(fil));
+	file_read_strict(fil, data, size);
+	output_skip(fil, import_u16_le(out_hdr->ranges) * sizeof (struct output_range) + 2 * size);
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * output_convert
+ ****************************************************************************/
+cw_void_t
+output_convert(
+	const cw_char_t			*path_src,
+	const cw_char_t			*path_dst)
+
+	{
+	struct file			fil_src, fil_dst;
+	cw_char_t			buffer[OUTPUT_MAGIC_SIZE];
+
+	file_open(&fil_src, path_src, FILE_MODE_READ, FILE_FLAG_NONE);
+	if ((file_read(&fil_src, buffer, sizeof (buffer)) != sizeof (buffer)) ||
+		(! output_check_magic(buffer))) error_message("file '%s' has wrong magic", file_get_path(&fil_src));
+	file_open(&fil_dst, path_dst, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	while (output_convert_track(&fil_src, &fil_dst)) ;
+	file_close(&fil_dst);
+	file_close(&fil_src);
+	}
+/******************************************************** Karsten Scheibler */
@@ -0,0 +1,127 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * output.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_OUTPUT_H
+#define CWTOOL_OUTPUT_H
+
+#include "types.h"
+#include "file.h"
+
+struct container;
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * raw data of bad sectors as written with -o. after the magic there is one
+ * record per container entry which contains copies of bad sectors:
+ *
+ *   struct output_header
+ *   flux data       size bytes, readable as raw track
+ *   range index     ranges * struct output_range
+ *   errors          size bytes
+ *   pulse lengths   size bytes
+ *
+ * the flux data of each range consists of header, gap and data part. a
+ * record with records == 0 is only followed by the name of a format which
+ * does not support this output
+ */
+
+#define OUTPUT_MAGIC_SIZE		32
+#define OUTPUT_HEADER_MAGIC		0xcd
+#define OUTPUT_RANGE_FLAG_HEADER	(1 << 0)
+
+struct output_header
+	{
+	cw_u8_t				magic;
+	cw_u8_t				track;
+	cw_u8_t				clock;
+	cw_u8_t				flags;
+	cw_u8_t				size[4];
+	cw_u8_t				ranges[2];
+	cw_u8_t				record[2];
+	cw_u8_t				records[2];
+	cw_u8_t				reserved[2];
+	};
+
+struct output_range
+	{
+	cw_u8_t				sector[2];
+	cw_u8_t				order;
+	cw_u8_t				flags;
+	cw_u8_t				header[4];
+	cw_u8_t				gap[4];
+	cw_u8_t				data[4];
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+output_open(
+	struct file			*fil,
+	const cw_char_t			*path);
+
+extern cw_count_t
+output_write_track(
+	struct file			*fil,
+	struct container		*con,
+	cw_count_t			track,
+	cw_mode_t			clock,
+	cw_count_t			*sector,
+	cw_count_t			sectors);
+
+extern cw_void_t
+output_write_unsupported(
+	struct file			*fil,
+	cw_count_t			track,
+	cw_mode_t			clock,
+	const cw_char_t			*name);
+
+extern cw_bool_t
+output_check_magic(
+	const cw_char_t			*buffer);
+
+extern cw_count_t
+output_read_record(
+	struct file			*fil,
+	struct output_header		*out_hdr,
+	cw_raw8_t			*data,
+	cw_size_t			limit);
+
+extern cw_void_t
+output_convert(
+	const cw_char_t			*path_src,
+	const cw_char_t			*path_dst);
+
+
+
+#endif /* !CWTOOL_OUTPUT_H */
+/******************************************************** Karsten Scheibler */
@@ -25,6 +25,13 @@
 
 
 
+#define CLASS_OTHER			0x10
+#define CLASS_SPACE			0x20
+#define CLASS_COMMENT			0x21
+#define CLASS_INVALID			0x22
+
+
+
 
 /****************************************************************************
  *
@@ -49,6 +56,71 @@ parse_is_space(
 
 
 
+/****************************************************************************
+ * parse_valid_map
+ ****************************************************************************/
+static cw_void_t
+parse_valid_map(
+	struct parse			*prs)
+
+	{
+	cw_u8_t				c;
+	cw_index_t			i;
+
+	/*
+	 * parse_get_char() is called for every single character, so
+	 * valid_chars is turned into a bitmap once instead of scanning
+	 * it each time
+	 */
+
+	for (c = 1; c != 0; c++)
+		{
+		if ((c >= '0') && (c <= '9')) goto ok;
+		if ((c >= 'A') && (c <= 'Z')) goto ok;
+		if ((c >= 'a') && (c <= 'z')) goto ok;
+		for (i = 0; prs->valid_chars[i] != '\0'; i++) if (c == (cw_u8_t) prs->valid_chars[i]) goto ok;
+		continue;
+	ok:
+		prs->valid_map[c / 8] |= 1 << (c % 8);
+		}
+	}
+
+
+
+/****************************************************************************
+ * parse_count_char
+ ****************************************************************************/
+static cw_void_t
+parse_count_char(
+	struct parse			*prs,
+	cw_char_t			c)
+
+	{
+	if (c == '\t') prs->line_ofs += 8;
+	else prs->line_ofs++;
+	if (c == '\n') prs->line++, prs->line_ofs = 0;
+	}
+
+
+
+/****************************************************************************
+ * parse_fill
+ ****************************************************************************/
+static cw_bool_t
+parse_fill(
+	struct parse			*prs)
+
+	{
+	if (prs->ofs < prs->limit) return (CW_BOOL_TRUE);
+	if (prs->mode == PARSE_MODE_MEMORY) return (CW_BOOL_FALSE);
+	prs->limit = file_read(prs->fil, prs->text, prs->size);
+	prs->ofs = 0;
+	if (prs->limit == 0) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
 /****************************************************************************
  * parse_get_char
  ****************************************************************************/
@@ -59,30 +131,12 @@ parse_get_char(
 
 	{
 	cw_char_t			c;
-	cw_index_t			i;
 
-	if (prs->ofs >= prs->limit)
-		{
-		if (prs->mode == PARSE_MODE_MEMORY) return ('\0'); 
-		prs->limit = file_read(prs->fil, prs->text, prs->size);
-		prs->ofs = 0;
-		if (prs->limit == 0) return ('\0');
-		}
+	if (! parse_fill(prs)) return ('\0');
 	c = prs->text[prs->ofs++];
 	if (c == '\0') parse_error(prs, "got \\0 character");
-	if (allow_all_chars) goto ok;
-	if ((c >= '0') && (c <= '9')) goto ok;
-	if ((c >= 'A') && (c <= 'Z')) goto ok;
-	if ((c >= 'a') && (c <= 'z')) goto ok;
-	for (i = 0; prs->valid_chars[i] != '\0'; i++)
-		{
-		if (c == prs->valid_chars[i]) goto ok;
-		}
-	parse_error(prs, "illegal character");
-ok:
-	if (c == '\t') prs->line_ofs += 8;
-	else prs->line_ofs++;
-	if (c == '\n') prs->line++, prs->line_ofs = 0;
+	if ((! allow_all_chars) && (! (prs->valid_map[(cw_u8_t) c / 8] & (1 << ((cw_u8_t) c % 8))))) parse_error(prs, "illegal character");
+	parse_count_char(prs, c);
 	return (c);
 	}
 
@@ -214,6 +268,7 @@ parse_init_file2(
 		.flags       = PARSE_FLAG_INITIALIZED
 		};
 	if (prs->text == NULL) error_oom();
+	parse_valid_map(prs);
 	}
 
 
@@ -276,6 +331,7 @@ parse_init_memory(
 		.mode        = PARSE_MODE_MEMORY,
 		.flags       = PARSE_FLAG_INITIALIZED
 		};
+	parse_valid_map(prs);
 	}
 
 
@@ -489,6 +545,63 @@ parse_error_invalid(
 
 
 
+/****************************************************************************
+ * parse_skip_block
+ ****************************************************************************/
+cw_bool_t
+parse_skip_block(
+	struct parse			*prs)
+
+	{
+	cw_bool_t			comment = CW_BOOL_FALSE;
+	cw_bool_t			quote = CW_BOOL_FALSE;
+	cw_count_t			depth = 0, len = 0;
+	cw_char_t			c, first = '\0';
+
+	/*
+	 * skip a block enclosed in { and } without interpreting it. only
+	 * comments, quoted strings and the tokens { and } are recognized,
+	 * everything else is checked when the block is parsed for real.
+	 * returns CW_BOOL_FAIL if the next token is not {, the parse
+	 * position is undefined then
+	 */
+
+	error_condition(! (prs->flags & PARSE_FLAG_INITIALIZED));
+	error_condition(prs->mode != PARSE_MODE_MEMORY);
+	while (1)
+		{
+		c = (prs->ofs < prs->limit) ? prs->text[prs->ofs] : '\0';
+		if ((! comment) && (! quote) && ((c == '\0') || (c == '#') || (c == '"') || (parse_is_space(c))) && (len > 0))
+			{
+			if ((len == 1) && (first == '{')) depth++;
+			else if ((len == 1) && (first == '}')) depth--;
+			else if (depth == 0) return (CW_BOOL_FAIL);
+			if (depth == 0) return (CW_BOOL_OK);
+			len = 0;
+			}
+		if (c == '\0') parse_error(prs, "} expected");
+		if ((depth == 0) && (len == 0) && (! comment) && (! parse_is_space(c)) && (c != '#') && (c != '{')) return (CW_BOOL_FAIL);
+		prs->ofs++;
+		parse_count_char(prs, c);
+		if (comment)
+			{
+			if (c == '\n') comment = CW_BOOL_FALSE;
+			continue;
+			}
+		if (quote)
+			{
+			if (c == '\n') parse_error(prs, "string exceeds line");
+			if (c == '"') quote = CW_BOOL_FALSE;
+			continue;
+			}
+		if (c == '#') comment = CW_BOOL_TRUE;
+		else if (c == '"') quote = CW_BOOL_TRUE;
+		else if (! parse_is_space(c)) if (len++ == 0) first = c;
+		}
+	}
+
+
+
 /****************************************************************************
  * parse_token
  ****************************************************************************/
@@ -602,6 +715,128 @@ parse_number(
 
 
 
+/****************************************************************************
+ * parse_numbers
+ ****************************************************************************/
+cw_count_t
+parse_numbers(
+	struct parse			*prs,
+	cw_u8_t				*data,
+	cw_size_t			size)
+
+	{
+	cw_u8_t				class[0x100];
+	cw_char_t			token[GLOBAL_MAX_NAME_SIZE];
+	cw_u8_t				*text = (cw_u8_t *) prs->text;
+	cw_bool_t			comment = CW_BOOL_FALSE;
+	cw_count_t			base = (prs->flags & PARSE_FLAG_HEX_ONLY) ? 16 : 10;
+	cw_count_t			fast = (base == 16) ? 2 : 3;
+	cw_count_t			len = 0, count = 0, num = 0, k;
+	cw_count_t			ofs = prs->ofs, limit = prs->limit;
+	cw_count_t			line = prs->line, line_ofs = prs->line_ofs;
+	const cw_char_t			*message = "} expected";
+	cw_u8_t				c;
+	cw_index_t			i;
+
+	/*
+	 * reads numbers up to the closing } of a block like a loop over
+	 * parse_token() and parse_number() would do, but with one table
+	 * lookup per character and the parse position kept in local
+	 * variables. short plain numbers are converted here, they can
+	 * neither be too large nor invalid. everything else is given to
+	 * parse_number(), so it is checked and reported the same way as
+	 * before
+	 */
+
+	error_condition(! (prs->flags & PARSE_FLAG_INITIALIZED));
+	for (i = 0; i < 0x100; i++)
+		{
+		if (! (prs->valid_map[i / 8] & (1 << (i % 8)))) class[i] = CLASS_INVALID;
+		else if (parse_is_space(i)) class[i] = CLASS_SPACE;
+		else if (i == '#') class[i] = CLASS_COMMENT;
+		else if ((i >= '0') && (i <= '9')) class[i] = i - '0';
+		else if ((i >= 'a') && (i < 'a' + base - 10)) class[i] = i - 'a' + 10;
+		else class[i] = CLASS_OTHER;
+		}
+	while (1)
+		{
+		if (ofs >= limit)
+			{
+			prs->ofs = ofs, prs->line = line, prs->line_ofs = line_ofs;
+
+			/*
+			 * a token at the end of the text is finished like
+			 * one followed by a space, so a } as last character
+			 * is no error
+			 */
+
+			if (! parse_fill(prs))
+				{
+				if (len == 0) break;
+				goto token_end;
+				}
+			ofs = prs->ofs, limit = prs->limit;
+			}
+		c = text[ofs++];
+		k = class[c];
+		if ((c == '\0') || ((k == CLASS_INVALID) && (! comment)))
+			{
+			ofs--;
+			message = (c == '\0') ? "got \\0 character" : "illegal character";
+			break;
+			}
+		if (c == '\t') line_ofs += 8;
+		else line_ofs++;
+		if (c == '\n') line++, line_ofs = 0;
+		if (comment)
+			{
+			if (c != '\n') continue;
+			comment = CW_BOOL_FALSE;
+			}
+
+		/* digits and other characters of a token */
+
+		if (k < CLASS_SPACE)
+			{
+			if (len >= sizeof (token) - 1)
+				{
+				message = "token too long";
+				break;
+				}
+			token[len++] = c;
+			num = ((num >= 0) && (k < base)) ? base * num + k : -1;
+			continue;
+			}
+		if (k == CLASS_COMMENT) comment = CW_BOOL_TRUE;
+		if (len == 0) continue;
+
+		/* end of token */
+
+	token_end:
+		prs->ofs = ofs, prs->line = line, prs->line_ofs = line_ofs;
+		if ((len == 1) && (token[0] == '}')) return (count);
+		if (count >= size) parse_error(prs, "track too large");
+		if ((len > fast) || (num < 0))
+			{
+			token[len] = '\0';
+			num = parse_number(prs, token, len);
+			}
+		data[count++] = num;
+		len = num = 0;
+		}
+
+	/* only errors get here */
+
+	prs->ofs = ofs, prs->line = line, prs->line_ofs = line_ofs;
+	parse_error(prs, "%s", message);
+
+	/* never reached, only to make gcc happy */
+
+	return (0);
+	}
+
+
+
 /****************************************************************************
  * parse_number_range
  ****************************************************************************/
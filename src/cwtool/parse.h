@@ -41,6 +41,7 @@ struct file;
 struct parse
 	{
 	const cw_char_t			*valid_chars;
+	cw_u8_t				valid_map[32];
 	struct file			*fil;
 	const cw_char_t			*path;
 	cw_char_t			*text;
@@ -141,6 +142,10 @@ parse_error_invalid(
 	struct parse			*prs,
 	const cw_char_t			*token);
 
+extern cw_bool_t
+parse_skip_block(
+	struct parse			*prs);
+
 extern cw_count_t
 parse_token(
 	struct parse			*prs,
@@ -159,6 +164,12 @@ parse_number(
 	cw_char_t			*token,
 	cw_count_t			len);
 
+extern cw_count_t
+parse_numbers(
+	struct parse			*prs,
+	cw_u8_t				*data,
+	cw_size_t			size);
+
 extern cw_s32_t
 parse_number_range(
 	struct parse			*prs,
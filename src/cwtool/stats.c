@@ -0,0 +1,351 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * stats.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stats.h"
+#include "error.h"
+#include "debug.h"
+#include "global.h"
+#include "file.h"
+
+
+
+
+/****************************************************************************
+ *
+ * local data structures, variables and defines
+ *
+ ****************************************************************************/
+
+
+
+
+struct stats_span
+	{
+	cw_index_t			stage;
+	cw_count64_t			mark;
+	};
+
+struct stats_try
+	{
+	cw_index_t			track;
+	cw_index_t			try;
+	cw_count64_t			ns[STATS_NR_STAGES];
+	};
+
+struct stats_track
+	{
+	cw_count_t			tries;
+	cw_count64_t			ns[STATS_NR_STAGES];
+	cw_count64_t			counter[STATS_NR_COUNTERS];
+	};
+
+static const cw_char_t			*stats_stage_name[STATS_NR_STAGES] =
+	{
+	"config", "read", "ioctl", "decode", "bitstream", "postcomp", "match", "encode", "write"
+	};
+
+static const cw_char_t			*stats_counter_name[STATS_NR_COUNTERS] =
+	{
+	"pulses", "image_bytes", "sectors_good", "sectors_weak", "sectors_bad"
+	};
+
+static cw_bool_t			stats_enabled;
+static cw_count64_t			stats_start;
+static cw_index_t			stats_depth;
+static struct stats_span		stats_stack[STATS_MAX_DEPTH];
+static cw_count64_t			stats_ns[STATS_NR_STAGES];
+static cw_count64_t			stats_calls[STATS_NR_STAGES];
+static cw_count64_t			stats_counter[STATS_NR_COUNTERS];
+static struct stats_track		stats_trk[GLOBAL_NR_TRACKS];
+static struct stats_try			*stats_tries;
+static cw_count_t			stats_tries_count;
+static cw_count_t			stats_tries_size;
+static cw_index_t			stats_current_track = -1;
+static cw_index_t			stats_current_try = -1;
+
+
+
+
+/****************************************************************************
+ *
+ * misc helper functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * stats_now
+ ****************************************************************************/
+static cw_count64_t
+stats_now(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((cw_count64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec);
+	}
+
+
+
+/****************************************************************************
+ * stats_charge
+ ****************************************************************************/
+static cw_void_t
+stats_charge(
+	cw_count64_t			now)
+
+	{
+	struct stats_span		*spn = &stats_stack[stats_depth - 1];
+	cw_count64_t			ns = now - spn->mark;
+
+	/*
+	 * spans nest (decode calls bitstream and match, match calls decode
+	 * again), only the time not spent in inner spans is charged to a
+	 * stage, so the stages add up to the measured time
+	 */
+
+	stats_ns[spn->stage] += ns;
+	if (stats_current_track >= 0) stats_trk[stats_current_track].ns[spn->stage] += ns;
+	if (stats_current_try >= 0) stats_tries[stats_current_try].ns[spn->stage] += ns;
+	spn->mark = now;
+	}
+
+
+
+/****************************************************************************
+ * stats_write_stages
+ ****************************************************************************/
+static cw_void_t
+stats_write_stages(
+	struct file			*fil,
+	cw_count64_t			*ns)
+
+	{
+	cw_index_t			i;
+
+	file_write_string(fil, "{ ");
+	for (i = 0; i < STATS_NR_STAGES; i++) file_write_sprintf(fil, "%s\"%s\": %lld", (i > 0) ? ", " : "", stats_stage_name[i], ns[i]);
+	file_write_string(fil, " }");
+	}
+
+
+
+/****************************************************************************
+ * stats_write_counters
+ ****************************************************************************/
+static cw_void_t
+stats_write_counters(
+	struct file			*fil,
+	cw_count64_t			*counter)
+
+	{
+	cw_index_t			i;
+
+	file_write_string(fil, "{ ");
+	for (i = 0; i < STATS_NR_COUNTERS; i++) file_write_sprintf(fil, "%s\"%s\": %lld", (i > 0) ? ", " : "", stats_counter_name[i], counter[i]);
+	file_write_string(fil, " }");
+	}
+
+
+
+/****************************************************************************
+ * stats_write_track
+ ****************************************************************************/
+static cw_void_t
+stats_write_track(
+	struct file			*fil,
+	cw_index_t			track,
+	cw_bool_t			first)
+
+	{
+	struct stats_track		*trk = &stats_trk[track];
+	cw_index_t			i, j;
+
+	file_write_sprintf(fil, "%s\n\t\t{\n\t\t\"track\": %d,\n\t\t\"tries\": %d,\n\t\t\"ns\": ", first ? "" : ",", track, trk->tries);
+	stats_write_stages(fil, trk->ns);
+	file_write_string(fil, ",\n\t\t\"counters\": ");
+	stats_write_counters(fil, trk->counter);
+	file_write_string(fil, ",\n\t\t\"try\": [");
+	for (i = j = 0; i < stats_tries_count; i++)
+		{
+		if (stats_tries[i].track != track) continue;
+		file_write_sprintf(fil, "%s\n\t\t\t{ \"try\": %d, \"ns\": ", (j++ > 0) ? "," : "", stats_tries[i].try);
+		stats_write_stages(fil, stats_tries[i].ns);
+		file_write_string(fil, " }");
+		}
+	file_write_string(fil, (j > 0) ? "\n\t\t\t]\n\t\t}" : " ]\n\t\t}");
+	}
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * stats_enable
+ ****************************************************************************/
+cw_void_t
+stats_enable(
+	cw_void_t)
+
+	{
+	stats_enabled = CW_BOOL_TRUE;
+	stats_start   = stats_now();
+	}
+
+
+
+/****************************************************************************
+ * stats_begin2
+ ****************************************************************************/
+cw_void_t
+stats_begin2(
+	cw_index_t			stage)
+
+	{
+	cw_count64_t			now;
+
+	if (! stats_enabled) return;
+	debug_error_condition(stats_depth >= STATS_MAX_DEPTH);
+	now = stats_now();
+	if (stats_depth > 0) stats_charge(now);
+	stats_stack[stats_depth++] = (struct stats_span) { .stage = stage, .mark = now };
+	stats_calls[stage]++;
+	}
+
+
+
+/****************************************************************************
+ * stats_end2
+ ****************************************************************************/
+cw_void_t
+stats_end2(
+	cw_index_t			stage)
+
+	{
+	cw_count64_t			now;
+
+	if (! stats_enabled) return;
+	debug_error_condition((stats_depth == 0) || (stats_stack[stats_depth - 1].stage != stage));
+	now = stats_now();
+	stats_charge(now);
+	if (--stats_depth > 0) stats_stack[stats_depth - 1].mark = now;
+	}
+
+
+
+/****************************************************************************
+ * stats_try2
+ ****************************************************************************/
+cw_void_t
+stats_try2(
+	cw_index_t			track,
+	cw_index_t			try)
+
+	{
+	if (! stats_enabled) return;
+	debug_error_condition((track < 0) || (track >= GLOBAL_NR_TRACKS));
+	if (stats_tries_count >= stats_tries_size)
+		{
+		stats_tries_size = (stats_tries_size == 0) ? GLOBAL_NR_TRACKS : 2 * stats_tries_size;
+		stats_tries = (struct stats_try *) realloc(stats_tries, stats_tries_size * sizeof (struct stats_try));
+		if (stats_tries == NULL) error_oom();
+		}
+	stats_tries[stats_tries_count] = (struct stats_try) { .track = track, .try = try };
+	stats_current_track = track;
+	stats_current_try   = stats_tries_count++;
+	stats_trk[track].tries++;
+	}
+
+
+
+/****************************************************************************
+ * stats_track2
+ ****************************************************************************/
+cw_void_t
+stats_track2(
+	cw_index_t			track)
+
+	{
+	if (! stats_enabled) return;
+	debug_error_condition((track < -1) || (track >= GLOBAL_NR_TRACKS));
+	stats_current_track = track;
+	stats_current_try   = -1;
+	}
+
+
+
+/****************************************************************************
+ * stats_count2
+ ****************************************************************************/
+cw_void_t
+stats_count2(
+	cw_index_t			counter,
+	cw_index_t			track,
+	cw_count64_t			value)
+
+	{
+	if (! stats_enabled) return;
+	debug_error_condition((track < 0) || (track >= GLOBAL_NR_TRACKS));
+	stats_counter[counter] += value;
+	stats_trk[track].counter[counter] += value;
+	}
+
+
+
+/****************************************************************************
+ * stats_write
+ ****************************************************************************/
+cw_void_t
+stats_write(
+	const cw_char_t			*path)
+
+	{
+	struct file			fil;
+	cw_count64_t			total = stats_now() - stats_start;
+	double				seconds = (total > 0) ? total / 1e9 : 1.0;
+	cw_index_t			i, j;
+
+	if (! stats_enabled) return;
+	file_open(&fil, path, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	file_write_sprintf(&fil, "{\n\t\"version\": \"%s\",\n\t\"total_ns\": %lld,\n\t\"ns\": ", GLOBAL_VERSION_STRING, total);
+	stats_write_stages(&fil, stats_ns);
+	file_write_string(&fil, ",\n\t\"calls\": ");
+	stats_write_stages(&fil, stats_calls);
+	file_write_string(&fil, ",\n\t\"counters\": ");
+	stats_write_counters(&fil, stats_counter);
+	file_write_sprintf(&fil, ",\n\t\"throughput\": { \"pulses_per_second\": %.0f, \"image_bytes_per_second\": %.0f },\n\t\"tracks\": [",
+		stats_counter[STATS_COUNTER_PULSES] / seconds,
+		stats_counter[STATS_COUNTER_IMAGE_BYTES] / seconds);
+	for (i = j = 0; i < GLOBAL_NR_TRACKS; i++)
+		{
+		if ((stats_trk[i].tries == 0) && (stats_trk[i].counter[STATS_COUNTER_IMAGE_BYTES] == 0)) continue;
+		stats_write_track(&fil, i, (j++ == 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE);
+		}
+	file_write_string(&fil, (j > 0) ? "\n\t\t]\n\t}\n" : " ]\n\t}\n");
+	file_close(&fil);
+	}
+/******************************************************** Karsten Scheibler */
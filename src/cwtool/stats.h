@@ -0,0 +1,113 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * stats.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_STATS_H
+#define CWTOOL_STATS_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define STATS_STAGE_CONFIG		0
+#define STATS_STAGE_READ		1
+#define STATS_STAGE_IOCTL		2
+#define STATS_STAGE_DECODE		3
+#define STATS_STAGE_BITSTREAM		4
+#define STATS_STAGE_POSTCOMP		5
+#define STATS_STAGE_MATCH		6
+#define STATS_STAGE_ENCODE		7
+#define STATS_STAGE_WRITE		8
+#define STATS_NR_STAGES			9
+
+#define STATS_COUNTER_PULSES		0
+#define STATS_COUNTER_IMAGE_BYTES	1
+#define STATS_COUNTER_SECTORS_GOOD	2
+#define STATS_COUNTER_SECTORS_WEAK	3
+#define STATS_COUNTER_SECTORS_BAD	4
+#define STATS_NR_COUNTERS		5
+
+#define STATS_MAX_DEPTH			16
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+stats_enable(
+	cw_void_t);
+
+extern cw_void_t
+stats_begin2(
+	cw_index_t			stage);
+
+extern cw_void_t
+stats_end2(
+	cw_index_t			stage);
+
+extern cw_void_t
+stats_try2(
+	cw_index_t			track,
+	cw_index_t			try);
+
+extern cw_void_t
+stats_track2(
+	cw_index_t			track);
+
+extern cw_void_t
+stats_count2(
+	cw_index_t			counter,
+	cw_index_t			track,
+	cw_count64_t			value);
+
+extern cw_void_t
+stats_write(
+	const cw_char_t			*path);
+
+#ifdef CWTOOL_STATS
+#define stats_compiled_in		1
+#define stats_begin(stage)		stats_begin2(STATS_STAGE_ ##stage)
+#define stats_end(stage)		stats_end2(STATS_STAGE_ ##stage)
+#define stats_try(track, try)		stats_try2(track, try)
+#define stats_track(track)		stats_track2(track)
+#define stats_count(counter, track, value)				\
+	stats_count2(STATS_COUNTER_ ##counter, track, value)
+#else /* CWTOOL_STATS */
+#define stats_compiled_in		0
+#define stats_begin(s)			while (0)
+#define stats_end(s)			while (0)
+#define stats_try(t, r)			while (0)
+#define stats_track(t)			while (0)
+#define stats_count(c, t, v)		while (0)
+#endif /* CWTOOL_STATS */
+
+
+
+#endif /* !CWTOOL_STATS_H */
+/******************************************************** Karsten Scheibler */
@@ -14,7 +14,9 @@
 #include <linux/uaccess.h>
 #include <linux/delay.h>
 #include <linux/fs.h>
+#include <linux/hrtimer.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/sched.h>
 #include <linux/spinlock.h>
@@ -48,6 +50,10 @@
 typedef wait_queue_entry_t wait_queue_t;
 #endif
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,13,0)
+#define CW_FLOPPY_HRTIMER_SETUP
+#endif /* LINUX_VERSION_CODE */
+
 #ifdef CW_FLOPPY_NO_SLEEP_ON
 #define do_sleep_on(cond, wq)					\
 	do							\
@@ -238,6 +244,28 @@ cw_floppy_get_parameters(
 
 
 
+/****************************************************************************
+ * cw_floppy_get_seek_statistics
+ ****************************************************************************/
+static int
+cw_floppy_get_seek_statistics(
+	struct cw_floppy		*flp,
+	struct cw_seekinfo		*ski,
+	int				nonblock)
+
+	{
+	int				result;
+
+	if (ski->version != CW_STRUCT_VERSION) return (-EINVAL);
+	result = cw_floppy_lock_floppy(flp, nonblock);
+	if (result < 0) return (result);
+	*ski = flp->ski;
+	cw_floppy_unlock_floppy(flp);
+	return (0);
+	}
+
+
+
 /****************************************************************************
  * cw_floppy_set_parameters
  ****************************************************************************/
@@ -304,6 +332,9 @@ cw_floppy_check_parameters(
 		(tri->timeout > CW_MAX_TIMEOUT)) return (-EINVAL);
 	if ((write) && ((tri->size > fli->max_size - CW_WRITE_OVERHEAD) ||
 		(tri->mode == CW_TRACKINFO_MODE_INDEX_STORE))) return (-EINVAL);
+	if ((tri->flags > CW_TRACKINFO_FLAG_ALL) ||
+		((tri->flags & CW_TRACKINFO_FLAG_SEEK_AHEAD) &&
+		(tri->track_next >= fli->nr_tracks))) return (-EINVAL);
 	return (0);
 	}
 
@@ -443,14 +474,71 @@ cw_floppy_motor_off(
 
 
 /****************************************************************************
- * cw_floppy_step_timer_func
+ * cw_floppy_step_timer_start
+ ****************************************************************************/
+static void
+cw_floppy_step_timer_start(
+	struct cw_floppy		*flp,
+	int				track_wanted)
+
+	{
+
+	/*
+	 * step_time and settle_time are only a few milliseconds, with
+	 * jiffies they would be rounded up to the next timer tick, so
+	 * a hrtimer is used for stepping
+	 */
+
+	cw_debug(1, "[c%df%d] registering floppies_step_timer", cnt_num, flp->num);
+	flp->track_wanted = track_wanted;
+	flp->step_start   = ktime_get();
+	hrtimer_start(&flp->step_timer, ms_to_ktime(1), HRTIMER_MODE_REL_SOFT);
+	}
+
+
+
+/****************************************************************************
+ * cw_floppy_step_timer_done
  ****************************************************************************/
 static void
+cw_floppy_step_timer_done(
+	struct cw_floppy		*flp)
+
+	{
+	s64				time = ktime_us_delta(ktime_get(), flp->step_start);
+
+	/* account seek time including settle time */
+
+	flp->ski.seeks++;
+	flp->ski.time_total += time;
+	if (time > flp->ski.time_max) flp->ski.time_max = time;
+	cw_debug(2, "[c%df%d] seek took %lld us", cnt_num, flp->num, (long long) time);
+
+	/*
+	 * if we did a seek ahead nobody sleeps on step_wq, instead the
+	 * controller is still locked and has to be unlocked now
+	 */
+
+	if (flp->seek_ahead)
+		{
+		cw_debug(1, "[c%df%d] seek ahead done, track = %d", cnt_num, flp->num, flp->track);
+		flp->seek_ahead = 0;
+		cw_floppy_unlock_controller(flp->fls);
+		}
+	wake_up(&flp->step_wq);
+	}
+
+
+
+/****************************************************************************
+ * cw_floppy_step_timer_func
+ ****************************************************************************/
+static enum hrtimer_restart
 cw_floppy_step_timer_func(
-	struct timer_list 		*t)
+	struct hrtimer			*t)
 
 	{
-	struct cw_floppy		*flp = from_timer(flp, t, step_timer);
+	struct cw_floppy		*flp = container_of(t, struct cw_floppy, step_timer);
 	int				direction = 1;
 	int				time = flp->fli.settle_time;
 
@@ -458,8 +546,8 @@ cw_floppy_step_timer_func(
 
 	if (flp->track_wanted == flp->track)
 		{
-		wake_up(&flp->step_wq);
-		return;
+		cw_floppy_step_timer_done(flp);
+		return (HRTIMER_NORESTART);
 		}
 
 	/* check if explicit track0 sensing is wanted */
@@ -496,13 +584,15 @@ cw_floppy_step_timer_func(
 		cw_hardware_floppy_step(&cnt_hrd, 0, direction);
 		spin_unlock(&flp->fls->lock);
 		flp->track += direction ? 1 : -1;
+		flp->ski.steps++;
 		if (flp->track_wanted != flp->track) time = flp->fli.step_time;
 		}
 	else cw_debug(2, "[c%df%d] will try again", cnt_num, flp->num);
 
 	/* schedule next call */
 done:
-	cwfloppy_add_timer(&flp->step_timer, jiffies + (time * HZ + 999) / 1000, flp);
+	hrtimer_forward_now(t, ms_to_ktime(time));
+	return (HRTIMER_RESTART);
 	}
 
 
@@ -516,10 +606,8 @@ cw_floppy_step(
 	int				track_wanted)
 
 	{
-	flp->track_wanted = track_wanted;
-	if (flp->track_wanted == flp->track) return (0);
-	cw_debug(1, "[c%df%d] registering floppies_step_timer", cnt_num, flp->num);
-	cwfloppy_add_timer(&flp->step_timer, jiffies + 2, flp);
+	if (track_wanted == flp->track) return (0);
+	cw_floppy_step_timer_start(flp, track_wanted);
 	do_sleep_on(flp->track_wanted != flp->track, &flp->step_wq);
 	cw_debug(1, "[c%df%d] track_wanted(%d) == track(%d)", cnt_num, flp->num, flp->track_wanted, flp->track);
 	return (1);
@@ -527,6 +615,34 @@ cw_floppy_step(
 
 
 
+/****************************************************************************
+ * cw_floppy_seek_ahead
+ ****************************************************************************/
+static int
+cw_floppy_seek_ahead(
+	struct cw_floppy		*flp,
+	int				track_wanted)
+
+	{
+
+	/*
+	 * like cw_floppy_step(), but do not wait until the head reached
+	 * track_wanted. the caller must hold the controller lock, it is
+	 * handed over to cw_floppy_step_timer_done(), which releases it
+	 * after the head settled. so the other floppy on this controller
+	 * can not be selected while we are still stepping
+	 */
+
+	if (track_wanted == flp->track) return (0);
+	cw_debug(1, "[c%df%d] seek ahead to track %d", cnt_num, flp->num, track_wanted);
+	flp->seek_ahead = 1;
+	flp->ski.seeks_ahead++;
+	cw_floppy_step_timer_start(flp, track_wanted);
+	return (1);
+	}
+
+
+
 /****************************************************************************
  * cw_floppy_dummy_step
  ****************************************************************************/
@@ -538,8 +654,14 @@ cw_floppy_dummy_step(
 	int				track = flp->track;
 	int				ofs = (track > 0) ? 1 : -1;
 
+	/*
+	 * just step one track away and back again to update the disk
+	 * change flag, the head ends at the same position
+	 */
+
+	flp->ski.dummy_steps++;
 	cw_floppy_step(flp, track - ofs);
-	cw_floppy_step(flp, track + ofs);
+	cw_floppy_step(flp, track);
 	return (1);
 	}
 
@@ -553,8 +675,17 @@ cw_floppy_calibrate(
 	struct cw_floppy		*flp)
 
 	{
+
+	/*
+	 * the head position is unknown. if track0 is signaled we first
+	 * step away from it, otherwise it is sufficient to step outwards
+	 * with explicit track0 sensing
+	 */
+
+	flp->ski.calibrations++;
 	flp->track = 0;
-	cw_floppy_step(flp, 3);
+	if (cw_hardware_floppy_track0(&cnt_hrd)) cw_floppy_step(flp, 3);
+	else cw_debug(1, "[c%df%d] no track0 signal, not stepping inwards", cnt_num, flp->num);
 	cw_floppy_step(flp, -CW_NR_TRACKS);
 	flp->track_dirty = 0;
 	return (1);
@@ -562,6 +693,33 @@ cw_floppy_calibrate(
 
 
 
+/****************************************************************************
+ * cw_floppy_recalibrate
+ ****************************************************************************/
+static int
+cw_floppy_recalibrate(
+	struct cw_floppy		*flp)
+
+	{
+
+	/*
+	 * the host controller selected this floppy and may have moved the
+	 * head. if we left the head on track 0 and track0 is still
+	 * signaled, the position can be trusted without stepping. in all
+	 * other cases we can not know where the host left it
+	 */
+
+	if ((flp->track == 0) && (cw_hardware_floppy_track0(&cnt_hrd)))
+		{
+		cw_debug(1, "[c%df%d] head still on track 0, no recalibration needed", cnt_num, flp->num);
+		flp->track_dirty = 0;
+		return (0);
+		}
+	return (cw_floppy_calibrate(flp));
+	}
+
+
+
 /****************************************************************************
  * cw_floppy_get_model
  ****************************************************************************/
@@ -734,7 +892,7 @@ cw_floppy_read_write_track(
 	spin_lock_irqsave(&flp->fls->lock, flags);
 	cw_hardware_floppy_select(&cnt_hrd, flp->num, tri->side, cw_floppy_get_density(flp));
 	spin_unlock_irqrestore(&flp->fls->lock, flags);
-	if (flp->track_dirty) stepped = cw_floppy_calibrate(flp);
+	if (flp->track_dirty) stepped = cw_floppy_recalibrate(flp);
 	stepped |= cw_floppy_step(flp, tri->track_seek);
 
 	/*
@@ -793,6 +951,18 @@ cw_floppy_read_write_track(
 	if (write) result -= aborted;
 	else result = cw_hardware_floppy_read_track_copy(&cnt_hrd, flp->track_data, tri->size);
 
+	/*
+	 * the catweasel memory is not needed anymore, so if userspace told
+	 * us which track comes next, start stepping now. the copy to user
+	 * space and the decoding in userspace overlap with step and settle
+	 * time. the controller gets unlocked by cw_floppy_step_timer_done()
+	 */
+
+	if ((result >= 0) && (tri->flags & CW_TRACKINFO_FLAG_SEEK_AHEAD))
+		{
+		if (cw_floppy_seek_ahead(flp, tri->track_next)) goto done2;
+		}
+
 	/* done */
 done:
 	cw_floppy_unlock_controller(flp->fls);
@@ -958,6 +1128,7 @@ cw_floppy_char_unlocked_ioctl(
 	struct cw_floppy		*flp = (struct cw_floppy *) file->private_data;
 	struct cw_trackinfo		tri;
 	struct cw_floppyinfo		fli;
+	struct cw_seekinfo		ski;
 	int				nonblock = (file->f_flags & O_NONBLOCK) ? 1 : 0;
 	int				result   = -ENOTTY;
 
@@ -996,6 +1167,13 @@ cw_floppy_char_unlocked_ioctl(
 		result = -EFAULT;
 		if (copy_from_user(&tri, (void *) arg, sizeof (struct cw_trackinfo)) == 0) result = cw_floppy_write_track(flp, &tri, nonblock);
 		}
+	else if (cmd == CW_IOC_GSKINFO)
+		{
+		cw_debug(1, "[c%df%d] ioctl(CW_IOC_GSKINFO, ...)", cnt_num, flp->num);
+		result = -EFAULT;
+		if (copy_from_user(&ski, (void *) arg, sizeof (struct cw_seekinfo)) == 0) result = cw_floppy_get_seek_statistics(flp, &ski, nonblock);
+		if ((result == 0) && (copy_to_user((void *) arg, &ski, sizeof (struct cw_seekinfo)) != 0)) result = -EFAULT;
+		}
 	return (result);
 	}
 
@@ -1081,7 +1259,13 @@ cw_floppy_init(
 		cw_debug(1, "[c%df%d] initializing", cnt_num, flp->num);
 		init_waitqueue_head(&flp->busy_wq);
 		init_waitqueue_head(&flp->step_wq);
-		timer_setup(&flp->step_timer, cw_floppy_step_timer_func, 0);
+#ifdef CW_FLOPPY_HRTIMER_SETUP
+		hrtimer_setup(&flp->step_timer, cw_floppy_step_timer_func, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+#else /* CW_FLOPPY_HRTIMER_SETUP */
+		hrtimer_init(&flp->step_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_SOFT);
+		flp->step_timer.function  = cw_floppy_step_timer_func;
+#endif /* CW_FLOPPY_HRTIMER_SETUP */
+		flp->ski                  = CW_SEEKINFO_INIT;
 		timer_setup(&flp->motor_timer, cw_floppy_motor_timer_func, 0);
 		flp->fli                  = cw_floppy_default_parameters();
 		flp->model                = cw_floppy_get_model(flp);
@@ -1123,6 +1307,7 @@ cw_floppy_exit(
 		if (flp->model == CW_FLOPPY_MODEL_NONE) continue;
 
 		cw_debug(1, "[c%df%d] deinitializing", cnt_num, flp->num);
+		hrtimer_cancel(&flp->step_timer);
 		del_timer_sync(&flp->motor_timer);
 		flp->motor_request = 0;
 		if (flp->motor) cw_hardware_floppy_motor_off(&cnt_hrd, flp->num);
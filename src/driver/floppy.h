@@ -14,6 +14,7 @@
 #define CW_FLOPPY_H
 
 #include <linux/fs.h>
+#include <linux/hrtimer.h>
 
 #include "types.h"
 #include "ioctl.h"
@@ -48,11 +49,14 @@ struct cw_floppy
 	int				track;
 	int				track_wanted;
 	int				track_dirty;
+	int				seek_ahead;
 	int				motor;
 	int				motor_request;
 	struct timer_list		motor_timer;
 	wait_queue_head_t		step_wq;
-	struct timer_list		step_timer;
+	struct hrtimer			step_timer;
+	ktime_t				step_start;
+	struct cw_seekinfo		ski;
 	cw_raw_t			*track_data;
 	struct cw_floppyinfo		fli;
 	};
@@ -42,6 +42,7 @@
 #define CW_IOC_SFLPARM			_IOW(CW_IOC_MAGIC, 1, struct cw_floppyinfo)
 #define CW_IOC_READ			_IOW(CW_IOC_MAGIC, 2, struct cw_trackinfo)
 #define CW_IOC_WRITE			_IOW(CW_IOC_MAGIC, 3, struct cw_trackinfo)
+#define CW_IOC_GSKINFO			_IOR(CW_IOC_MAGIC, 4, struct cw_seekinfo)
 
 /*
  * if structure or semantics of data changes, which is exchanged between
@@ -109,6 +110,17 @@ struct cw_floppyinfo
 #define CW_TRACKINFO_MODE_NORMAL	0
 #define CW_TRACKINFO_MODE_INDEX_WAIT	1
 #define CW_TRACKINFO_MODE_INDEX_STORE	2
+
+/*
+ * with CW_TRACKINFO_FLAG_SEEK_AHEAD the driver starts stepping to
+ * track_next as soon as the track data was fetched from catweasel memory,
+ * so the head is already settled when the next request arrives. older
+ * drivers ignore flags and track_next, so no version change is needed
+ */
+
+#define CW_TRACKINFO_FLAG_NONE		0
+#define CW_TRACKINFO_FLAG_SEEK_AHEAD	(1 << 0)
+#define CW_TRACKINFO_FLAG_ALL		((1 << 1) - 1)
 #define CW_TRACKINFO_INIT		(struct cw_trackinfo) { .version = CW_STRUCT_VERSION }
 
 struct cw_trackinfo
@@ -119,7 +131,8 @@ struct cw_trackinfo
 	cw_snum_t			side;
 	cw_snum_t			clock;
 	cw_snum_t			mode;
-	cw_snum_t			reserved[3];
+	cw_snum_t			track_next;
+	cw_snum_t			reserved[2];
 	cw_flag_t			flags;
 	cw_msecs_t			timeout;
 	cw_raw_t			*data;
@@ -127,6 +140,27 @@ struct cw_trackinfo
 	};
 
 
+/*
+ * seek statistics of a drive, accumulated since the driver was loaded.
+ * all times are in microseconds and include the settle time
+ */
+
+#define CW_SEEKINFO_INIT		(struct cw_seekinfo) { .version = CW_STRUCT_VERSION }
+
+struct cw_seekinfo
+	{
+	cw_count_t			version;
+	cw_count_t			seeks;
+	cw_count_t			seeks_ahead;
+	cw_count_t			steps;
+	cw_count_t			dummy_steps;
+	cw_count_t			calibrations;
+	cw_count_t			time_max;
+	cw_count_t			reserved;
+	cw_count64_t			time_total;
+	};
+
+
 
 #endif /* !CW_IOCTL_H */
 /******************************************************** Karsten Scheibler */
@@ -0,0 +1,165 @@
+#############################################################################
+#############################################################################
+#
+# check.bash
+#
+#############################################################################
+#############################################################################
+
+
+
+
+
+#############################################################################
+# error
+#############################################################################
+error()
+	{
+	echo "$(basename "$0"): $@" 1>&2
+	exit 1
+	}
+
+
+
+#############################################################################
+# cleanup
+#############################################################################
+cleanup()
+	{
+	[ -n "$CHECK_DIR" ] && rm -rf "$CHECK_DIR"
+	}
+
+
+
+#############################################################################
+# check_begin
+#############################################################################
+check_begin()
+	{
+	echo -n "checking $1 ... "
+	}
+
+
+
+#############################################################################
+# check_end
+#############################################################################
+check_end()
+	{
+	if [ "$1" = 0 ]
+	then
+		echo "ok"
+	else
+		echo "FAILED"
+		FAILED=$((FAILED + 1))
+	fi
+	}
+
+
+
+#############################################################################
+# cwtool
+#############################################################################
+cwtool()
+	{
+	"$CWTOOL" "$1" -n "${@:2}" 2> "$CHECK_DIR/stderr" ||
+		{ cat "$CHECK_DIR/stderr" 1>&2 ; return 1 ; }
+	}
+
+
+
+#############################################################################
+# check_prepare
+#############################################################################
+check_prepare()
+	{
+	# amiga_dd is written to a raw file, so the checks do not depend
+	# on any image besides the ones generated here
+
+	head -c 901120 /dev/urandom > "$CHECK_DIR/amiga.adf" &&
+	cwtool -W amiga_dd "$CHECK_DIR/amiga.adf" "$CHECK_DIR/amiga.raw" ||
+		error "could not generate test data"
+	}
+
+
+
+#############################################################################
+# check_config_copy
+#############################################################################
+check_config_copy()
+	{
+	# a builtin disk copying another builtin disk has to get the
+	# definition which existed when it was defined, even if the copied
+	# disk is replaced later by -e or ~/.cwtoolrc
+
+	check_begin "copy of a replaced builtin disk"
+	cwtool -R raw_dd "$CHECK_DIR/amiga.raw" "$CHECK_DIR/copy1.raw" &&
+	cwtool -R -e 'disk "raw_14" { copy "raw_28" }' raw_dd "$CHECK_DIR/amiga.raw" "$CHECK_DIR/copy2.raw" &&
+	cmp -s "$CHECK_DIR/copy1.raw" "$CHECK_DIR/copy2.raw"
+	check_end $?
+	}
+
+
+
+#############################################################################
+# check_corpus
+#############################################################################
+check_corpus()
+	{
+	# cwbench -u writes checksum, sector counts and baseline of the
+	# generated image, a second run has to match them. an image which
+	# can not be read must not stop the images after it
+
+	check_begin "cwbench corpus mode"
+	mkdir -p "$CHECK_DIR/corpus" &&
+	cp "$CHECK_DIR/amiga.raw" "$CHECK_DIR/corpus/amiga.raw" &&
+	echo "amiga_dd amiga.raw" > "$CHECK_DIR/corpus/corpus" &&
+	"$CWBENCH" -u -c "$CHECK_DIR/corpus" -o "$CHECK_DIR/corpus.csv" 2> "$CHECK_DIR/stderr" &&
+	"$CWBENCH" -m 1000000 -c "$CHECK_DIR/corpus" -o "$CHECK_DIR/corpus.csv" 2> "$CHECK_DIR/stderr" &&
+	grep -q "^amiga_dd,amiga.raw,all,.*,ok$" "$CHECK_DIR/corpus.csv"
+	check_end $?
+
+	check_begin "cwbench corpus mode with an unreadable image"
+	{ echo "amiga_dd missing.raw 0 0 0 0" ; cat "$CHECK_DIR/corpus/corpus" ; } > "$CHECK_DIR/corpus/corpus2" &&
+	mv "$CHECK_DIR/corpus/corpus2" "$CHECK_DIR/corpus/corpus" &&
+	! "$CWBENCH" -m 1000000 -c "$CHECK_DIR/corpus" -o "$CHECK_DIR/corpus.csv" 2> "$CHECK_DIR/stderr" &&
+	grep -q "^amiga_dd,missing.raw,all,.*,error$" "$CHECK_DIR/corpus.csv" &&
+	grep -q "^amiga_dd,amiga.raw,all,.*,ok$" "$CHECK_DIR/corpus.csv"
+	check_end $?
+	}
+
+
+
+#############################################################################
+# check_kernels
+#############################################################################
+check_kernels()
+	{
+	# the block kernels of image/raw.c have to give the same bytes as
+	# the per byte loops they replaced
+
+	check_begin "block kernels against per byte loops"
+	"$CWBENCH" -k -o "$CHECK_DIR/kernels.csv" 2> "$CHECK_DIR/stderr" ||
+		{ cat "$CHECK_DIR/stderr" 1>&2 ; false ; }
+	check_end $?
+	}
+
+
+
+#############################################################################
+# main
+#############################################################################
+[ $# = 2 ] || error "usage: $(basename "$0") <cwtool> <cwbench>"
+CWTOOL="$1"
+CWBENCH="$2"
+FAILED=0
+[ -x "$CWTOOL" ] || error "'$CWTOOL' not found"
+[ -x "$CWBENCH" ] || error "'$CWBENCH' not found"
+CHECK_DIR="$(mktemp -d)" || error "could not create temporary directory"
+trap cleanup EXIT
+check_prepare
+check_config_copy
+check_corpus
+check_kernels
+[ "$FAILED" = 0 ] || error "$FAILED checks failed"
+######################################################### Karsten Scheibler #